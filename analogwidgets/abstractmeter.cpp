@@ -29,6 +29,7 @@ AbstractMeter::AbstractMeter(QWidget * parent )
 {
   m_min=m_minimum=0.0;
   m_max=m_maximum=1.0;
+  m_value=0.0;
   m_digitOffset=1.0;
   m_nominal=0.25;
   m_critical=0.75; 
@@ -44,8 +45,9 @@ void AbstractMeter::setValue( double val )
 {
   if ( m_value != val )
   {
+    QRegion dirty = valueRegion();
     m_value = val;
-    update(); 
+    update(dirty | valueRegion());
     emit valueChanged(val);
     emit valueChanged((int)val); 
   }
@@ -55,8 +57,9 @@ void AbstractMeter::setValue( int val )
 {
   if ( m_value != val )
   {
+    QRegion dirty = valueRegion();
     m_value = val;
-    update(); // Ciekawe czy tak jest lepiej ??
+    update(dirty | valueRegion()); // Ciekawe czy tak jest lepiej ??
     // to znaczy najpierw odmalowa a potem generowa sygna ? 
     emit valueChanged(val);
     emit valueChanged(double(val));
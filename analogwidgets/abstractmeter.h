@@ -88,6 +88,14 @@
 
     protected:
 
+       /**
+         * Part of the widget that changes with the value (needle, value
+         * string etc.), for the value as it is now. setValue() repaints
+         * only this region for the old and new values.
+         * @return Whole widget unless reimplemented
+         */
+	virtual QRegion valueRegion() { return QRegion(rect()); }
+
        /**
          * Calculate m_max and m_min values shown on scale 
 	 * @return true if m_max or m_min has been changed
@@ -29,8 +29,20 @@
 
 //using namespace Qt;
 ManoMeter::ManoMeter(QWidget *parent)
-        : AbstractMeter(parent)
+        : AbstractMeter(parent), m_metricsFont(m_valueFont), m_valueMetrics(m_valueFont, this)
 {
+	static const int hand[12] = {-4, 0, -1, 129, 1, 129, 4, 0, 8,-50, -8,-50};
+
+        m_handPath.moveTo(QPointF(hand[0],hand[1]));
+
+        for (int i=2;i<10;i+=2)
+	 m_handPath.lineTo(hand[i],hand[i+1]);
+
+	m_handPath.cubicTo ( 8.1,-51.0, 5.0,-48.0,   0.0,-48.0);
+	m_handPath.cubicTo(  -5.0,-48.0, -8.1,-51.0, -8.0,-50.0);
+
+	m_handBounds = m_handPath.boundingRect() | QRectF(-10,-10,20,20);
+
         m_max=300.0;
         m_min=0.0;
 
@@ -56,13 +68,65 @@ ManoMeter::ManoMeter(QWidget *parent)
 
 
 
+const QTransform & ManoMeter::coordinateTransform()
+{
+        if (m_transformSize != size())
+        {
+          int side = qMin(width(), height());
+          m_transform.reset();
+          m_transform.translate(width() / 2, height() / 2);
+          m_transform.scale(side / 335.0, side / 335.0);
+          m_transformSize = size();
+        }
+        return m_transform;
+}
+
 void ManoMeter::initCoordinateSystem(QPainter & painter)
 {
-        int side = qMin(width(), height());
         // painter initialization
         painter.setRenderHint(QPainter::Antialiasing);
-        painter.translate(width() / 2, height() / 2);
-        painter.scale(side / 335.0, side / 335.0);
+        painter.setWorldTransform(coordinateTransform(), true);
+}
+
+const QString & ManoMeter::valueText(QSize & size)
+{
+        if (m_metricsFont != valueFont())
+        {
+          m_metricsFont = valueFont();
+          m_valueMetrics = QFontMetrics(m_metricsFont, this);
+          m_valueText.clear();
+        }
+
+        QString Str = prefix() + QString("%1").arg(value()) + suffix();
+        if (Str != m_valueText)
+        {
+          m_valueText = Str;
+          m_valueTextSize = m_valueMetrics.size(Qt::TextSingleLine, Str);
+        }
+        size = m_valueTextSize;
+        return m_valueText;
+}
+
+/**
+ * Bounding boxes of the needle and of the value string, in widget
+ * coordinates, with a pixel to spare for antialiasing.
+ */
+QRegion ManoMeter::valueRegion()
+{
+        QTransform needle = coordinateTransform();
+        needle.rotate(60.0 + ((value()-m_min) * 240.0) / static_cast<double> (m_max - m_min));
+
+        QRegion region(needle.mapRect(m_handBounds).toAlignedRect().adjusted(-2,-2,2,2));
+
+        if (valueOffset())
+        {
+          QSize Size;
+          valueText(Size);
+          QRectF text(Size.width() / -2.0, static_cast<int>( 0 - valueOffset()) - m_valueMetrics.ascent(),
+                      Size.width(), Size.height());
+          region += coordinateTransform().mapRect(text).toAlignedRect().adjusted(-2,-2,2,2);
+        }
+        return region;
 }
 
 void ManoMeter::paintBackground(QPainter & painter)
@@ -174,17 +238,6 @@ void ManoMeter::paintEvent(QPaintEvent * )
 	QPainter painter(this);
         initCoordinateSystem(painter);
       // --------------------------------------------- ///
-	static const int hand[12] = {-4, 0, -1, 129, 1, 129, 4, 0, 8,-50, -8,-50};
-
-
-        QPainterPath hand_path;
-        hand_path.moveTo(QPointF(hand[0],hand[1]));
-
-        for (int i=2;i<10;i+=2)
-	 hand_path.lineTo(hand[i],hand[i+1]);
-
-	hand_path.cubicTo ( 8.1,-51.0, 5.0,-48.0,   0.0,-48.0);
-	hand_path.cubicTo(  -5.0,-48.0, -8.1,-51.0, -8.0,-50.0);
 
         // Rysowanie wskazwki
 	painter.save();
@@ -193,7 +246,7 @@ void ManoMeter::paintEvent(QPaintEvent * )
 	painter.setBrush(QBrush(Qt::black));
    	painter.rotate(  ((  value()-m_min) * 240.0) / static_cast<double> (m_max - m_min) );
 
-	painter.drawPath(hand_path);
+	painter.drawPath(m_handPath);
 
 	painter.drawEllipse(-10,-10,20,20);
 
@@ -206,8 +259,8 @@ void ManoMeter::paintEvent(QPaintEvent * )
 
 	  if (value() >= critical() ) painter.setPen(Qt::red);
 	  painter.setFont(valueFont());
-          QString Str = prefix() + QString("%1").arg(value()) + suffix();
-          QSize Size = painter.fontMetrics().size(Qt::TextSingleLine, Str);
+          QSize Size;
+          const QString & Str = valueText(Size);
           painter.drawText( QPointF( Size.width() / -2.0,static_cast<int>( 0 - valueOffset())) , Str);
         }
 }// paintEvent
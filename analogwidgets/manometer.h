@@ -23,6 +23,9 @@
 #ifndef BARMETER_H
 #define BARMETER_H
 
+#include <QPainterPath>
+#include <QTransform>
+#include <QFontMetrics>
 #include "abstractmeter.h"
 
 class ManoMeter : public AbstractMeter
@@ -34,5 +37,25 @@ class ManoMeter : public AbstractMeter
     void paintEvent(QPaintEvent *event); 	 // inherited from WidgetWithBackground 
     void paintBackground(QPainter & painter);// inherited form WidgetWithBackground 
     void initCoordinateSystem(QPainter & painter);
+    QRegion valueRegion();			 // inherited from AbstractMeter
+  private:
+    /** Maps the scale (335 x 335, centred on 0,0) onto the widget at its current size */
+    const QTransform & coordinateTransform();
+    /** Value string with prefix and suffix, measured with the value font */
+    const QString & valueText(QSize & size);
+
+    /** Needle outline in scale coordinates; doesn't depend on the size */
+    QPainterPath m_handPath;
+    /** Needle and its hub, in scale coordinates, pointing at 0 */
+    QRectF m_handBounds;
+    /** Widget size m_transform was worked out for */
+    QSize m_transformSize;
+    QTransform m_transform;
+    /** Font m_valueMetrics were made for */
+    QFont m_metricsFont;
+    QFontMetrics m_valueMetrics;
+    /** Last value string measured, and its size */
+    QString m_valueText;
+    QSize m_valueTextSize;
 };
 #endif // BARMETER_H
@@ -0,0 +1,659 @@
+#include <string.h>
+#include "binarylog.h"
+#include "logdeadband.h"
+
+const char BinaryLog::s_magic[8] = { 'M', 'E', 'M', 'S', 'L', 'O', 'G', 0 };
+
+namespace
+{
+  const char s_keyframeRecord = 'K';
+  const char s_deltaRecord = 'D';
+  const char s_commentRecord = 'C';
+
+  struct ChannelDef
+  {
+    const char *name;
+    BinaryLog::ChannelKind kind;
+  };
+
+  const ChannelDef s_channels[BinaryLog::NumChannels] =
+  {
+    { "engineSpeed",       BinaryLog::UnsignedChannel },
+    { "waterTemp",         BinaryLog::UnsignedChannel },
+    { "ambientTemp",       BinaryLog::UnsignedChannel },
+    { "intakeAirTemp",     BinaryLog::UnsignedChannel },
+    { "fuelTemp",          BinaryLog::UnsignedChannel },
+    { "manifoldPressure",  BinaryLog::FloatChannel },
+    { "mainVoltage",       BinaryLog::FloatChannel },
+    { "throttleVoltage",   BinaryLog::FloatChannel },
+    { "idleSwitch",        BinaryLog::UnsignedChannel },
+    { "parkNeutralSwitch", BinaryLog::UnsignedChannel },
+    { "faultCodes",        BinaryLog::UnsignedChannel },
+    { "idleBypassPos",     BinaryLog::UnsignedChannel },
+    { "lambdaVoltage_mV",  BinaryLog::UnsignedChannel },
+    { "closedLoop",        BinaryLog::UnsignedChannel }
+  };
+
+  void appendVarint(QByteArray& out, quint64 value)
+  {
+    while (value >= 0x80)
+    {
+      out.append((char)((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    out.append((char)value);
+  }
+
+  quint64 zigzag(qint64 value)
+  {
+    return ((quint64)value << 1) ^ (quint64)(value >> 63);
+  }
+
+  qint64 unzigzag(quint64 value)
+  {
+    return (qint64)(value >> 1) ^ -(qint64)(value & 1);
+  }
+
+  void appendLE16(QByteArray& out, quint16 value)
+  {
+    out.append((char)(value & 0xFF));
+    out.append((char)(value >> 8));
+  }
+
+  void appendLE32(QByteArray& out, quint32 value)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      out.append((char)((value >> (i * 8)) & 0xFF));
+    }
+  }
+}
+
+const char* BinaryLog::channelName(int channel)
+{
+  return s_channels[channel].name;
+}
+
+BinaryLog::ChannelKind BinaryLog::channelKind(int channel)
+{
+  return s_channels[channel].kind;
+}
+
+/**
+ * Returns the value of a channel as it's stored in the log: integers as
+ * they are, and floats as their raw bits.
+ */
+quint32 BinaryLog::channelValue(const mems_data *data, int channel)
+{
+  float f = 0.0f;
+  quint32 bits = 0;
+
+  switch (channel)
+  {
+  case EngineRpm:          return data->engine_rpm;
+  case CoolantTemp:        return data->coolant_temp_c;
+  case AmbientTemp:        return data->ambient_temp_c;
+  case IntakeAirTemp:      return data->intake_air_temp_c;
+  case FuelTemp:           return data->fuel_temp_c;
+  case MapKpa:             f = data->map_kpa; break;
+  case BatteryVoltage:     f = data->battery_voltage; break;
+  case ThrottlePotVoltage: f = data->throttle_pot_voltage; break;
+  case IdleSwitch:         return data->idle_switch ? 1 : 0;
+  case ParkNeutralSwitch:  return data->park_neutral_switch ? 1 : 0;
+  case FaultCodes:         return data->fault_codes;
+  case IacPosition:        return data->iac_position;
+  case LambdaVoltage:      return data->lambda_voltage_mv;
+  case ClosedLoop:         return data->closed_loop ? 1 : 0;
+  default:                 return 0;
+  }
+
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+/**
+ * Sets a channel from its stored value (the inverse of channelValue()).
+ */
+void BinaryLog::setChannelValue(mems_data *data, int channel, quint32 value)
+{
+  float f;
+  memcpy(&f, &value, sizeof(f));
+
+  switch (channel)
+  {
+  case EngineRpm:          data->engine_rpm = value; break;
+  case CoolantTemp:        data->coolant_temp_c = value; break;
+  case AmbientTemp:        data->ambient_temp_c = value; break;
+  case IntakeAirTemp:      data->intake_air_temp_c = value; break;
+  case FuelTemp:           data->fuel_temp_c = value; break;
+  case MapKpa:             data->map_kpa = f; break;
+  case BatteryVoltage:     data->battery_voltage = f; break;
+  case ThrottlePotVoltage: data->throttle_pot_voltage = f; break;
+  case IdleSwitch:         data->idle_switch = (value != 0); break;
+  case ParkNeutralSwitch:  data->park_neutral_switch = (value != 0); break;
+  case FaultCodes:         data->fault_codes = value; break;
+  case IacPosition:        data->iac_position = value; break;
+  case LambdaVoltage:      data->lambda_voltage_mv = value; break;
+  case ClosedLoop:         data->closed_loop = (value != 0); break;
+  default:                 break;
+  }
+}
+
+/**
+ * Constructor.
+ */
+BinaryLogEncoder::BinaryLogEncoder():
+m_deadband(0)
+{
+  reset();
+}
+
+/**
+ * Forgets the previous sample, so that the next one is written as a
+ * keyframe. Call this when starting a new file (or appending to one).
+ */
+void BinaryLogEncoder::reset()
+{
+  m_havePrevious = false;
+  m_sinceKeyframe = 0;
+  m_keyframeTimestampMs = 0;
+  m_prevMonotonicUs = 0;
+  m_prevTimestampMs = 0;
+  memset(m_prevValues, 0, sizeof(m_prevValues));
+}
+
+/**
+ * Builds the file header.
+ * @param units Temperature units to use when the log is exported as text
+ */
+QByteArray BinaryLogEncoder::header(TemperatureUnits units)
+{
+  QByteArray out;
+
+  out.append(BinaryLog::s_magic, sizeof(BinaryLog::s_magic));
+  appendLE16(out, BinaryLog::s_version);
+  out.append((char)units);
+  out.append((char)0);
+  appendLE16(out, BinaryLog::NumChannels);
+
+  for (int i = 0; i < BinaryLog::NumChannels; i++)
+  {
+    const QByteArray name(BinaryLog::channelName(i));
+
+    out.append((char)BinaryLog::channelKind(i));
+    out.append((char)name.size());
+    out.append(name);
+  }
+
+  return out;
+}
+
+/**
+ * Appends a sample to the output, as a keyframe or as a delta from the
+ * previous sample. With a deadband set, the delta is from the values last
+ * written, and only covers the channels that have moved by more than their
+ * tolerance.
+ * @return False if the sample was left out because nothing had changed
+ *  enough (only in change-only mode)
+ */
+bool BinaryLogEncoder::encodeSample(const MEMSSample& sample, QByteArray& out)
+{
+  quint32 values[BinaryLog::NumChannels];
+
+  for (int i = 0; i < BinaryLog::NumChannels; i++)
+  {
+    values[i] = BinaryLog::channelValue(&sample.data, i);
+  }
+
+  const bool keyframeDue = !m_havePrevious || (m_sinceKeyframe >= BinaryLog::s_keyframeInterval) ||
+    (m_deadband && ((sample.timestampMs - m_keyframeTimestampMs) >= LogDeadband::s_keyframeIntervalMs));
+
+  if (keyframeDue)
+  {
+    out.append(s_keyframeRecord);
+    appendVarint(out, (quint64)sample.monotonicUs);
+    appendVarint(out, (quint64)sample.timestampMs);
+
+    for (int i = 0; i < BinaryLog::NumChannels; i++)
+    {
+      if (BinaryLog::channelKind(i) == BinaryLog::FloatChannel)
+      {
+        appendLE32(out, values[i]);
+      }
+      else
+      {
+        appendVarint(out, values[i]);
+      }
+    }
+    memcpy(m_prevValues, values, sizeof(m_prevValues));
+    m_sinceKeyframe = 0;
+    m_keyframeTimestampMs = sample.timestampMs;
+  }
+  else
+  {
+    quint64 changed = 0;
+
+    for (int i = 0; i < BinaryLog::NumChannels; i++)
+    {
+      if (m_deadband ? m_deadband->exceeds(i, m_prevValues[i], values[i]) : (values[i] != m_prevValues[i]))
+      {
+        changed |= (Q_UINT64_C(1) << i);
+      }
+    }
+
+    if (m_deadband && (changed == 0))
+    {
+      return false;
+    }
+
+    out.append(s_deltaRecord);
+    appendVarint(out, zigzag(sample.monotonicUs - m_prevMonotonicUs));
+    appendVarint(out, zigzag(sample.timestampMs - m_prevTimestampMs));
+    appendVarint(out, changed);
+
+    for (int i = 0; i < BinaryLog::NumChannels; i++)
+    {
+      if (changed & (Q_UINT64_C(1) << i))
+      {
+        if (BinaryLog::channelKind(i) == BinaryLog::FloatChannel)
+        {
+          appendVarint(out, values[i] ^ m_prevValues[i]);
+        }
+        else
+        {
+          appendVarint(out, zigzag((qint64)values[i] - (qint64)m_prevValues[i]));
+        }
+        m_prevValues[i] = values[i];
+      }
+    }
+    m_sinceKeyframe++;
+  }
+
+  m_prevMonotonicUs = sample.monotonicUs;
+  m_prevTimestampMs = sample.timestampMs;
+  m_havePrevious = true;
+  return true;
+}
+
+/**
+ * Appends a comment (such as a note about a gap in the data) to the
+ * output. The sample after a comment is always written as a keyframe.
+ */
+void BinaryLogEncoder::encodeComment(qint64 timestampMs, QString note, QByteArray& out)
+{
+  const QByteArray text = note.toUtf8();
+
+  out.append(s_commentRecord);
+  appendVarint(out, (quint64)timestampMs);
+  appendVarint(out, text.size());
+  out.append(text);
+
+  m_havePrevious = false;
+}
+
+/**
+ * Constructor.
+ */
+BinaryLogReader::BinaryLogReader():
+m_device(&m_file), m_map(0), m_mapSize(0), m_offset(0), m_dataStart(0), m_version(0), m_units(Fahrenheit), m_truncated(false), m_haveKeyframe(false),
+m_monotonicUs(0), m_timestampMs(0)
+{
+}
+
+/**
+ * Opens a log file and reads its header.
+ * @return True if the file is a binary log this version can read
+ */
+bool BinaryLogReader::open(QString path)
+{
+  close();
+
+  if (Journal::isJournal(path))
+  {
+    m_device = &m_journal;
+    if (!m_journal.openJournal(path))
+    {
+      m_error = "Unable to open " + path;
+      return false;
+    }
+  }
+  else
+  {
+    m_device = &m_file;
+    m_file.setFileName(path);
+    if (!m_file.open(QFile::ReadOnly))
+    {
+      m_error = "Unable to open " + path;
+      return false;
+    }
+
+    // if mapping fails, reads simply go through the file instead
+    m_mapSize = m_file.size();
+    m_map = (m_mapSize > 0) ? m_file.map(0, m_mapSize) : 0;
+  }
+
+  if (!readHeader())
+  {
+    const QString error = m_error;
+
+    close();
+    m_error = error;
+    return false;
+  }
+
+  m_dataStart = m_offset;
+  return true;
+}
+
+void BinaryLogReader::close()
+{
+  if (m_map)
+  {
+    m_file.unmap(m_map);
+    m_map = 0;
+  }
+  m_mapSize = 0;
+  m_dataStart = 0;
+  m_file.close();
+  m_journal.close();
+  m_offset = 0;
+  m_error.clear();
+  m_truncated = false;
+  m_haveKeyframe = false;
+  m_channelMap.clear();
+  m_channelKinds.clear();
+  m_values.clear();
+}
+
+/**
+ * Continues reading from the record at the given offset, which must be a
+ * keyframe or comment for the following samples to be read. Only plain
+ * (not journaled) files can be sought.
+ * @return True if the offset is within the file's records
+ */
+bool BinaryLogReader::seek(qint64 offset)
+{
+  if ((m_device != &m_file) || !m_file.isOpen() || (offset < m_dataStart) || (offset > m_file.size()) ||
+      (!m_map && !m_file.seek(offset)))
+  {
+    return false;
+  }
+
+  m_offset = offset;
+  m_error.clear();
+  m_truncated = false;
+  m_haveKeyframe = false;
+  return true;
+}
+
+bool BinaryLogReader::readByte(quint8& byte)
+{
+  char c;
+
+  if (m_map)
+  {
+    if (m_offset >= m_mapSize)
+    {
+      return false;
+    }
+    byte = m_map[m_offset++];
+    return true;
+  }
+
+  if (!m_device->getChar(&c))
+  {
+    return false;
+  }
+  byte = (quint8)c;
+  m_offset++;
+  return true;
+}
+
+bool BinaryLogReader::readRaw(char *buf, int len)
+{
+  if (m_map)
+  {
+    const qint64 count = qMin((qint64)len, m_mapSize - m_offset);
+
+    memcpy(buf, m_map + m_offset, count);
+    m_offset += count;
+    return (count == len);
+  }
+
+  const qint64 count = m_device->read(buf, len);
+
+  m_offset += qMax(Q_INT64_C(0), count);
+  return (count == len);
+}
+
+bool BinaryLogReader::readVarint(quint64& value)
+{
+  quint8 byte;
+  int shift = 0;
+
+  value = 0;
+  do
+  {
+    if ((shift > 63) || !readByte(byte))
+    {
+      return false;
+    }
+    value |= (quint64)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  return true;
+}
+
+/**
+ * Reads and checks the header, and maps the file's channels onto the ones
+ * this version knows about.
+ */
+bool BinaryLogReader::readHeader()
+{
+  char magic[sizeof(BinaryLog::s_magic)];
+  quint8 b[6];
+
+  if (!readRaw(magic, sizeof(magic)) || (memcmp(magic, BinaryLog::s_magic, sizeof(magic)) != 0))
+  {
+    m_error = "Not a binary log file";
+    return false;
+  }
+
+  if (!readRaw((char*)b, 6))
+  {
+    m_error = "Header is truncated";
+    return false;
+  }
+
+  m_version = b[0] | (b[1] << 8);
+  m_units = (b[2] == Celsius) ? Celsius : Fahrenheit;
+  const int channelCount = b[4] | (b[5] << 8);
+
+  if (m_version > BinaryLog::s_version)
+  {
+    m_error = QString("Unsupported log format version %1").arg(m_version);
+    return false;
+  }
+
+  if (channelCount > 64)
+  {
+    m_error = "Too many channels in header";
+    return false;
+  }
+
+  for (int i = 0; i < channelCount; i++)
+  {
+    quint8 kind, nameLen;
+    char name[256];
+
+    if (!readByte(kind) || !readByte(nameLen) || !readRaw(name, nameLen))
+    {
+      m_error = "Header is truncated";
+      return false;
+    }
+
+    if ((kind != BinaryLog::UnsignedChannel) && (kind != BinaryLog::FloatChannel))
+    {
+      m_error = "Unknown channel type in header";
+      return false;
+    }
+
+    const QByteArray channelName(name, nameLen);
+    int known = -1;
+
+    for (int c = 0; c < BinaryLog::NumChannels; c++)
+    {
+      if ((channelName == BinaryLog::channelName(c)) && (kind == BinaryLog::channelKind(c)))
+      {
+        known = c;
+      }
+    }
+
+    m_channelMap.append(known);
+    m_channelKinds.append(kind);
+    m_values.append(0);
+  }
+
+  return true;
+}
+
+/**
+ * Builds a mems_data from the current channel values.
+ */
+void BinaryLogReader::fillData(mems_data *data) const
+{
+  memset(data, 0, sizeof(mems_data));
+
+  for (int i = 0; i < m_channelMap.count(); i++)
+  {
+    if (m_channelMap.at(i) >= 0)
+    {
+      BinaryLog::setChannelValue(data, m_channelMap.at(i), m_values.at(i));
+    }
+  }
+}
+
+/**
+ * Reads the next record.
+ * @return True if a record was read; false at the end of the file (or if
+ *  the file is damaged, in which case errorString() says why)
+ */
+bool BinaryLogReader::next(BinaryLogRecord& record)
+{
+  quint8 type;
+
+  while (readByte(type))
+  {
+    bool ok = true;
+    quint64 v;
+
+    if (type == s_keyframeRecord)
+    {
+      quint64 mono, wall;
+
+      ok = readVarint(mono) && readVarint(wall);
+      for (int i = 0; ok && (i < m_channelMap.count()); i++)
+      {
+        if (m_channelKinds.at(i) == BinaryLog::FloatChannel)
+        {
+          quint8 b[4];
+          ok = readRaw((char*)b, 4);
+          m_values[i] = b[0] | (b[1] << 8) | (b[2] << 16) | ((quint32)b[3] << 24);
+        }
+        else
+        {
+          ok = readVarint(v);
+          m_values[i] = (quint32)v;
+        }
+      }
+
+      if (ok)
+      {
+        m_monotonicUs = (qint64)mono;
+        m_timestampMs = (qint64)wall;
+        m_haveKeyframe = true;
+      }
+    }
+    else if (type == s_deltaRecord)
+    {
+      quint64 dMono, dWall, changed;
+
+      ok = readVarint(dMono) && readVarint(dWall) && readVarint(changed);
+      for (int i = 0; ok && (i < m_channelMap.count()); i++)
+      {
+        if (changed & (Q_UINT64_C(1) << i))
+        {
+          ok = readVarint(v);
+          if (m_channelKinds.at(i) == BinaryLog::FloatChannel)
+          {
+            m_values[i] ^= (quint32)v;
+          }
+          else
+          {
+            m_values[i] = (quint32)((qint64)m_values[i] + unzigzag(v));
+          }
+        }
+      }
+
+      if (ok)
+      {
+        m_monotonicUs += unzigzag(dMono);
+        m_timestampMs += unzigzag(dWall);
+
+        if (!m_haveKeyframe)
+        {
+          // there's no full state to apply this to, so skip ahead to the
+          // next keyframe
+          continue;
+        }
+      }
+    }
+    else if (type == s_commentRecord)
+    {
+      quint64 wall, len;
+
+      ok = readVarint(wall) && readVarint(len) && (len < 65536);
+      if (ok)
+      {
+        QByteArray text((int)len, 0);
+        ok = readRaw(text.data(), (int)len);
+        if (ok)
+        {
+          record.type = BinaryLogRecord::Comment;
+          record.timestampMs = (qint64)wall;
+          record.monotonicUs = m_monotonicUs;
+          record.comment = QString::fromUtf8(text);
+          memset(&record.data, 0, sizeof(mems_data));
+
+          // deltas can't continue across a comment
+          m_haveKeyframe = false;
+          return true;
+        }
+      }
+    }
+    else
+    {
+      m_error = QString("Unknown record type 0x%1 at offset %2")
+                .arg(type, 2, 16, QChar('0')).arg(m_offset - 1);
+      return false;
+    }
+
+    if (!ok)
+    {
+      // most likely the last record was only partly written
+      m_truncated = true;
+      m_error = "Log ends with a partial record";
+      return false;
+    }
+
+    record.type = BinaryLogRecord::Sample;
+    record.monotonicUs = m_monotonicUs;
+    record.timestampMs = m_timestampMs;
+    record.comment.clear();
+    fillData(&record.data);
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,178 @@
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include "rosco.h"
+#include "commonunits.h"
+#include "samplering.h"
+#include "journal.h"
+
+class LogDeadband;
+
+/**
+ * Compact binary log format.
+ *
+ * The file starts with a header: the magic "MEMSLOG\0", a 16-bit format
+ * version, the temperature units to use when exporting, and the channel
+ * schema (the type and name of each stored mems_data field, in the order
+ * they're stored). All multi-byte header values are little-endian.
+ *
+ * The header is followed by records, each starting with a type byte:
+ *  'K' keyframe: monotonic time (usecs) and wall-clock time (msecs since
+ *      the epoch) as varints, then every channel's full value.
+ *  'D' delta: changes in monotonic and wall-clock time (zigzag varints), a
+ *      varint bitmask of the channels that changed, then the change in each
+ *      of those channels.
+ *  'C' comment: wall-clock time (varint) and a length-prefixed UTF-8 note.
+ *
+ * Integer channels are stored as varints, with deltas zigzag-encoded.
+ * Float channels are stored as their raw IEEE bits (four bytes) in
+ * keyframes and as the XOR with the previous bits (a varint) in deltas, so
+ * values round-trip exactly. A keyframe is written every s_keyframeInterval
+ * records and after every comment, which bounds how far a reader has to
+ * go back to pick up the full state.
+ *
+ * In change-only mode (see LogDeadband), a delta only carries the channels
+ * that have moved by more than their tolerance, and samples in which no
+ * channel has are left out altogether. Keyframes are then also written at
+ * least every LogDeadband::s_keyframeIntervalMs. Readers need nothing
+ * special for this: a channel simply keeps its value until it's changed.
+ */
+class BinaryLog
+{
+public:
+    enum ChannelKind
+    {
+        UnsignedChannel = 1,
+        FloatChannel    = 2
+    };
+
+    enum Channel
+    {
+        EngineRpm = 0,
+        CoolantTemp,
+        AmbientTemp,
+        IntakeAirTemp,
+        FuelTemp,
+        MapKpa,
+        BatteryVoltage,
+        ThrottlePotVoltage,
+        IdleSwitch,
+        ParkNeutralSwitch,
+        FaultCodes,
+        IacPosition,
+        LambdaVoltage,
+        ClosedLoop,
+        NumChannels
+    };
+
+    static const quint16 s_version = 1;
+    static const int s_keyframeInterval = 256;
+    static const char s_magic[8];
+
+    static const char* channelName(int channel);
+    static ChannelKind channelKind(int channel);
+    static quint32 channelValue(const mems_data *data, int channel);
+    static void setChannelValue(mems_data *data, int channel, quint32 value);
+};
+
+/**
+ * Encodes samples into the binary log format. The encoder remembers the
+ * previous sample so that it can write deltas.
+ */
+class BinaryLogEncoder
+{
+public:
+    BinaryLogEncoder();
+
+    static QByteArray header(TemperatureUnits units);
+
+    void reset();
+    void setDeadband(const LogDeadband *deadband) { m_deadband = deadband; }
+    void forceKeyframe() { m_havePrevious = false; }
+    bool encodeSample(const MEMSSample& sample, QByteArray& out);
+    void encodeComment(qint64 timestampMs, QString note, QByteArray& out);
+
+private:
+    const LogDeadband *m_deadband;
+    bool m_havePrevious;
+    int m_sinceKeyframe;
+    qint64 m_keyframeTimestampMs;
+    qint64 m_prevMonotonicUs;
+    qint64 m_prevTimestampMs;
+    quint32 m_prevValues[BinaryLog::NumChannels];
+};
+
+/**
+ * A single record read back from a binary log.
+ */
+struct BinaryLogRecord
+{
+    enum Type
+    {
+        Sample,
+        Comment
+    };
+
+    Type type;
+    qint64 monotonicUs;
+    qint64 timestampMs;
+    mems_data data;
+    QString comment;
+};
+
+/**
+ * Reads records from a binary log file (plain or journaled). Channels that
+ * this version doesn't know about are skipped; channels missing from the
+ * file read as zero. Plain files are memory-mapped where possible, and
+ * reading can be restarted at any keyframe with seek() (e.g. at an offset
+ * found in the log's LogIndex).
+ */
+class BinaryLogReader
+{
+public:
+    BinaryLogReader();
+
+    bool open(QString path);
+    void close();
+    QString errorString() const { return m_error; }
+
+    quint16 version() const                  { return m_version; }
+    TemperatureUnits temperatureUnits() const { return m_units; }
+
+    bool next(BinaryLogRecord& record);
+    bool seek(qint64 offset);
+    qint64 position() const { return m_offset; }
+    bool truncated() const { return m_truncated; }
+
+private:
+    QFile m_file;
+    JournalReader m_journal;
+    QIODevice *m_device;
+    uchar *m_map;
+    qint64 m_mapSize;
+    qint64 m_offset;
+    qint64 m_dataStart;
+    QString m_error;
+    quint16 m_version;
+    TemperatureUnits m_units;
+    bool m_truncated;
+
+    QList<int> m_channelMap;     // file channel -> BinaryLog::Channel, or -1
+    QList<int> m_channelKinds;   // file channel -> ChannelKind
+    QList<quint32> m_values;     // current value of each file channel
+    bool m_haveKeyframe;
+    qint64 m_monotonicUs;
+    qint64 m_timestampMs;
+
+    bool readHeader();
+    bool readByte(quint8& byte);
+    bool readVarint(quint64& value);
+    bool readRaw(char *buf, int len);
+    void fillData(mems_data *data) const;
+};
+
+#endif // BINARYLOG_H
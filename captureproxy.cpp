@@ -0,0 +1,251 @@
+#include <QElapsedTimer>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include "captureproxy.h"
+
+namespace
+{
+  /**
+   * Writes all of a buffer to a non-blocking descriptor, waiting for room
+   * when necessary.
+   */
+  bool writeAll(int fd, const char *data, ssize_t length)
+  {
+    while (length > 0)
+    {
+      const ssize_t written = write(fd, data, length);
+
+      if (written > 0)
+      {
+        data += written;
+        length -= written;
+      }
+      else if ((written < 0) && (errno == EAGAIN))
+      {
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+
+        if (poll(&pfd, 1, 1000) <= 0)
+        {
+          return false;
+        }
+      }
+      else if ((written < 0) && (errno != EINTR))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+/**
+ * Constructor.
+ */
+CaptureProxy::CaptureProxy(QObject *parent):
+QThread(parent), m_serialFd(-1), m_stop(0)
+{
+}
+
+/**
+ * Destructor. Stops forwarding and closes the pty and the capture file.
+ */
+CaptureProxy::~CaptureProxy()
+{
+  stop();
+  m_capture.close();
+  m_pty.close();
+}
+
+/**
+ * Opens the serial device and starts forwarding. The pty and the capture
+ * file are only created the first time; if the proxy is stopped and started
+ * again (e.g. when the link is re-established after the device was
+ * unplugged), the same pty is offered and recording continues in the same
+ * file.
+ * @param serialDevice Name of (or path to) the real serial device
+ * @param capturePath Path of the capture file
+ * @return True if forwarding has started; false otherwise (see errorString())
+ */
+bool CaptureProxy::start(QString serialDevice, QString capturePath)
+{
+  char discard[256];
+
+  stop();
+
+  if (!m_pty.open())
+  {
+    m_error = "couldn't create a pseudo-terminal";
+    return false;
+  }
+
+  if ((m_capture.path() != capturePath) || !m_capture.isOpen())
+  {
+    if (!m_capture.open(capturePath))
+    {
+      m_error = QString("couldn't create %1").arg(capturePath);
+      return false;
+    }
+  }
+
+  if (!openSerial(serialDevice))
+  {
+    m_error = QString("couldn't open %1").arg(serialDevice);
+    return false;
+  }
+
+  // anything written to the pty while the proxy was stopped is stale
+  while (read(m_pty.masterFd(), discard, sizeof(discard)) > 0)
+  {
+  }
+
+  m_stop.store(0);
+  QThread::start();
+  return true;
+}
+
+/**
+ * Stops forwarding and closes the serial device.
+ */
+void CaptureProxy::stop()
+{
+  if (isRunning())
+  {
+    m_stop.store(1);
+    wait();
+  }
+
+  if (m_serialFd >= 0)
+  {
+    ::close(m_serialFd);
+    m_serialFd = -1;
+  }
+  m_capture.flush();
+}
+
+/**
+ * Opens the serial device with the settings used by the ECU (9600 baud,
+ * 8N1), in raw, non-blocking mode.
+ */
+bool CaptureProxy::openSerial(QString device)
+{
+  struct termios tio;
+
+  if (!device.startsWith("/"))
+  {
+    device.prepend("/dev/");
+  }
+
+  m_serialFd = ::open(device.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (m_serialFd < 0)
+  {
+    return false;
+  }
+
+  if (tcgetattr(m_serialFd, &tio) != 0)
+  {
+    ::close(m_serialFd);
+    m_serialFd = -1;
+    return false;
+  }
+
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, B9600);
+  cfsetospeed(&tio, B9600);
+  tio.c_cflag |= (CLOCAL | CREAD);
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(m_serialFd, TCSANOW, &tio);
+  tcflush(m_serialFd, TCIOFLUSH);
+
+  return true;
+}
+
+/**
+ * Copies whatever can be read from one side to the other, recording it.
+ * @return False if the source has failed (e.g. the device was unplugged)
+ */
+bool CaptureProxy::forward(int fromFd, int toFd, RawCapture::Direction direction)
+{
+  char buf[256];
+  const ssize_t count = read(fromFd, buf, sizeof(buf));
+
+  if (count < 0)
+  {
+    return (errno == EAGAIN) || (errno == EINTR);
+  }
+
+  if (count > 0)
+  {
+    m_capture.record(direction, buf, (int)count);
+    writeAll(toFd, buf, count);
+  }
+  return true;
+}
+
+/**
+ * Forwards bytes until stopped or until the serial device fails. The
+ * capture is written to disk whenever the link has been quiet for a while,
+ * so that little is lost if the application doesn't exit cleanly.
+ */
+void CaptureProxy::run()
+{
+  struct pollfd fds[2];
+  QElapsedTimer lastActivity;
+  bool unflushed = false;
+
+  fds[0].fd = m_pty.masterFd();
+  fds[0].events = POLLIN;
+  fds[1].fd = m_serialFd;
+  fds[1].events = POLLIN;
+  lastActivity.start();
+
+  while (!m_stop.load())
+  {
+    const int ready = poll(fds, 2, 100);
+
+    if (ready < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+
+    if (ready == 0)
+    {
+      if (unflushed && lastActivity.hasExpired(s_idleFlushMsecs))
+      {
+        m_capture.flush();
+        unflushed = false;
+      }
+      continue;
+    }
+
+    if ((fds[0].revents & POLLIN) &&
+        !forward(m_pty.masterFd(), m_serialFd, RawCapture::Transmit))
+    {
+      break;
+    }
+
+    if ((fds[1].revents & POLLIN) &&
+        !forward(m_serialFd, m_pty.masterFd(), RawCapture::Receive))
+    {
+      break;
+    }
+
+    if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL))
+    {
+      break;
+    }
+
+    lastActivity.restart();
+    unflushed = true;
+  }
+
+  m_capture.flush();
+}
@@ -0,0 +1,45 @@
+#ifndef CAPTUREPROXY_H
+#define CAPTUREPROXY_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QString>
+#include "ptyport.h"
+#include "rawcapture.h"
+
+/**
+ * Sits between librosco and a serial device, recording every byte that
+ * passes in either direction. librosco opens the serial device itself, so
+ * it's given the slave side of a pty instead; this thread copies bytes
+ * between the pty and the real device, writing each run of bytes to a
+ * capture file as it goes. (Requires Unix pseudo-terminals.)
+ */
+class CaptureProxy : public QThread
+{
+    Q_OBJECT
+public:
+    explicit CaptureProxy(QObject *parent = 0);
+    ~CaptureProxy();
+
+    bool start(QString serialDevice, QString capturePath);
+    void stop();
+    QString devicePath() const { return m_pty.slaveName(); }
+    QString errorString() const { return m_error; }
+
+protected:
+    void run();
+
+private:
+    static const int s_idleFlushMsecs = 500;
+
+    PtyPort m_pty;
+    int m_serialFd;
+    RawCaptureWriter m_capture;
+    QAtomicInt m_stop;
+    QString m_error;
+
+    bool openSerial(QString device);
+    bool forward(int fromFd, int toFd, RawCapture::Direction direction);
+};
+
+#endif // CAPTUREPROXY_H
@@ -0,0 +1,117 @@
+#include "commandqueue.h"
+
+/**
+ * Constructor.
+ */
+CommandQueue::CommandQueue():
+m_nextOrder(0)
+{
+  m_clock.start();
+}
+
+/**
+ * Adds a command to the queue.
+ * @param cmd Command to add
+ * @param delayMsecs Time to wait before the command may be sent
+ */
+void CommandQueue::enqueue(const ECUCommand& cmd, int delayMsecs)
+{
+  Entry e;
+
+  e.cmd = cmd;
+  e.dueMsecs = m_clock.elapsed() + delayMsecs;
+  e.order = m_nextOrder++;
+  m_entries.append(e);
+}
+
+/**
+ * Finds the command that should be sent next: highest priority first, then
+ * in the order in which they were queued.
+ * @param readyOnly If true, only consider commands that are due
+ * @return Index of the command, or -1 if there isn't one
+ */
+int CommandQueue::findBest(bool readyOnly) const
+{
+  const qint64 now = m_clock.elapsed();
+  int best = -1;
+
+  for (int i = 0; i < m_entries.count(); i++)
+  {
+    const Entry& e = m_entries.at(i);
+
+    if (readyOnly && (e.dueMsecs > now))
+    {
+      continue;
+    }
+
+    if ((best < 0) ||
+        (e.cmd.priority > m_entries.at(best).cmd.priority) ||
+        ((e.cmd.priority == m_entries.at(best).cmd.priority) && (e.order < m_entries.at(best).order)))
+    {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+/**
+ * Removes and returns the next command that is due to be sent.
+ * @return True if a command was ready; false otherwise
+ */
+bool CommandQueue::takeReady(ECUCommand& cmd)
+{
+  const int index = findBest(true);
+
+  if (index < 0)
+  {
+    return false;
+  }
+
+  cmd = m_entries.takeAt(index).cmd;
+  return true;
+}
+
+/**
+ * Removes and returns the next command regardless of whether it's due yet.
+ * Used to flush the queue (e.g. to switch off relays) before disconnecting.
+ * @return True if the queue wasn't empty; false otherwise
+ */
+bool CommandQueue::takeAny(ECUCommand& cmd)
+{
+  const int index = findBest(false);
+
+  if (index < 0)
+  {
+    return false;
+  }
+
+  cmd = m_entries.takeAt(index).cmd;
+  return true;
+}
+
+/**
+ * Returns the time until the earliest queued command becomes due.
+ * @return Milliseconds (0 if a command is already due), or -1 if the queue
+ *  is empty
+ */
+int CommandQueue::msecsUntilNextReady() const
+{
+  const qint64 now = m_clock.elapsed();
+  qint64 earliest = -1;
+
+  foreach (const Entry& e, m_entries)
+  {
+    if ((earliest < 0) || (e.dueMsecs < earliest))
+    {
+      earliest = e.dueMsecs;
+    }
+  }
+
+  if (earliest < 0)
+  {
+    return -1;
+  }
+
+  return (earliest > now) ? (int)(earliest - now) : 0;
+}
@@ -0,0 +1,82 @@
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <QList>
+#include <QElapsedTimer>
+#include "rosco.h"
+
+/**
+ * A command to be sent to the ECU between reads.
+ */
+struct ECUCommand
+{
+    enum Type
+    {
+        Actuator,
+        ClearFaults,
+        MoveIAC
+    };
+
+    // what to report once this command (and any follow-up) is finished
+    enum Completion
+    {
+        NoCompletion,
+        FuelPumpTestDone,
+        PTCRelayTestDone,
+        ACRelayTestDone,
+        MoveIACDone
+    };
+
+    // commands that turn something off go ahead of everything else
+    enum Priority
+    {
+        NormalPriority = 0,
+        OffPriority = 1
+    };
+
+    Type type;
+    Priority priority;
+    Completion completion;
+    actuator_cmd actuator;
+    int iacPosition;
+
+    // optional command to queue (after a delay) once this one succeeds
+    bool hasFollowUp;
+    actuator_cmd followUp;
+    int followUpDelayMsecs;
+};
+
+/**
+ * Prioritised queue of ECU commands. Commands may be deferred until a given
+ * time, which is how the "off" half of an on/off actuator test is scheduled
+ * without sleeping on the interface thread.
+ */
+class CommandQueue
+{
+public:
+    CommandQueue();
+
+    void enqueue(const ECUCommand& cmd, int delayMsecs = 0);
+    bool takeReady(ECUCommand& cmd);
+    bool takeAny(ECUCommand& cmd);
+    int msecsUntilNextReady() const;
+
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    int count() const    { return m_entries.count(); }
+
+private:
+    struct Entry
+    {
+        ECUCommand cmd;
+        qint64 dueMsecs;
+        quint64 order;
+    };
+
+    QList<Entry> m_entries;
+    quint64 m_nextOrder;
+    QElapsedTimer m_clock;
+
+    int findBest(bool readyOnly) const;
+};
+
+#endif // COMMANDQUEUE_H
@@ -0,0 +1,198 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <string.h>
+#include "csvdecoder.h"
+#include "csvencoder.h"
+#include "csvformat.h"
+
+/**
+ * Fills in a sample with values that change from one sample to the next,
+ * so that the lines are a realistic length.
+ */
+static void makeSample(mems_data *data, quint64 n)
+{
+  memset(data, 0, sizeof(mems_data));
+  data->engine_rpm = 800 + (n % 3000);
+  data->coolant_temp_c = 20 + ((n / 1000) % 70);
+  data->intake_air_temp_c = 25 + ((n / 5000) % 10);
+  data->throttle_pot_voltage = 0.5f + (n % 200) * 0.02f;
+  data->map_kpa = 30.0f + (n % 70) * 0.5f;
+  data->iac_position = n % 180;
+  data->battery_voltage = 13.0f + (n % 10) * 0.1f;
+  data->idle_switch = (n % 2);
+  data->closed_loop = ((n / 100) % 2);
+  data->lambda_voltage_mv = n % 900;
+}
+
+/**
+ * Sums some of the values of a record, so that the decoders can be checked
+ * against each other (and so that the compiler can't skip the decoding).
+ */
+static double checksum(const mems_data& data)
+{
+  return data.engine_rpm + data.coolant_temp_c + data.map_kpa + data.battery_voltage +
+         data.throttle_pot_voltage + data.lambda_voltage_mv + data.iac_position + data.closed_loop;
+}
+
+/**
+ * Decodes the log the way a straightforward importer would: convert it to a
+ * QString, split it into lines and each line into fields, and convert the
+ * fields one by one.
+ */
+static double decodeWithSplit(const QByteArray& log, quint64& records)
+{
+  const QStringList lines = QString::fromLatin1(log).split('\n');
+  double sum = 0.0;
+  mems_data data;
+
+  foreach (const QString& line, lines)
+  {
+    const QStringList fields = line.split(',');
+
+    if ((fields.count() < CsvDecoder::s_fieldCount) || line.startsWith('#'))
+    {
+      continue;
+    }
+
+    memset(&data, 0, sizeof(mems_data));
+    data.engine_rpm = fields.at(1).toUInt();
+    data.coolant_temp_c = fields.at(2).toUInt();
+    data.intake_air_temp_c = fields.at(3).toUInt();
+    data.throttle_pot_voltage = fields.at(4).toFloat();
+    data.map_kpa = fields.at(5).toFloat();
+    data.iac_position = fields.at(6).toUInt();
+    data.battery_voltage = fields.at(7).toFloat();
+    data.idle_switch = fields.at(8).toInt();
+    data.closed_loop = fields.at(9).toInt();
+    data.lambda_voltage_mv = fields.at(10).toUInt();
+    sum += checksum(data);
+    records++;
+  }
+  return sum;
+}
+
+static double decodeWithDecoder(const QByteArray& log, CsvDecoder::Implementation impl, quint64& records)
+{
+  CsvDecoder decoder(impl);
+  CsvDecoder::Record record;
+  CsvDecoder::LineType type;
+  double sum = 0.0;
+
+  decoder.setData(log.constData(), log.constData() + log.size());
+  while ((type = decoder.next(record)) != CsvDecoder::EndOfData)
+  {
+    if (type == CsvDecoder::SampleLine)
+    {
+      sum += checksum(record.data);
+      records++;
+    }
+  }
+  return sum;
+}
+
+/**
+ * Measures how quickly text logs can be decoded by CsvDecoder, with each
+ * delimiter scanner the processor supports, compared with splitting the
+ * text into QStrings. The log is either generated in memory or read from a
+ * file, and each decoder is run several times, keeping the fastest.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("memscsvbench");
+  QTextStream out(stdout);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures text log decoding throughput.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("log", "Text log to decode (default: a generated one).", "[log]");
+
+  QCommandLineOption sizeOpt(QStringList() << "s" << "size", "Size of the generated log (default 64).", "MB", "64");
+  QCommandLineOption runsOpt(QStringList() << "r" << "runs", "Runs of each decoder; the fastest is kept (default 5).", "count", "5");
+
+  parser.addOption(sizeOpt);
+  parser.addOption(runsOpt);
+  parser.process(app);
+
+  const int runs = qMax(1, parser.value(runsOpt).toInt());
+  QByteArray log;
+
+  if (!parser.positionalArguments().isEmpty())
+  {
+    QFile file(parser.positionalArguments().at(0));
+    if (!file.open(QFile::ReadOnly))
+    {
+      out << "Unable to open " << file.fileName() << Qt::endl;
+      return 1;
+    }
+    log = file.readAll();
+  }
+  else
+  {
+    const qint64 size = qMax(1, parser.value(sizeOpt).toInt()) * Q_INT64_C(1024) * 1024;
+    CsvEncoder encoder;
+    mems_data data;
+
+    log.reserve(size + 256);
+    log.append(CsvFormat::header());
+    for (quint64 n = 0; log.size() < size; n++)
+    {
+      makeSample(&data, n);
+      encoder.encode(Q_INT64_C(1704110400000) + (n * 100), &data, log);
+    }
+  }
+
+  out << "Decoding " << QString::number(log.size() / (1024.0 * 1024.0), 'f', 1) << " MB, best of "
+      << runs << " runs" << Qt::endl << Qt::endl;
+  out << QString("%1 %2 %3 %4 %5").arg("decoder", -18).arg("records", 10).arg("GB/s", 8)
+                                  .arg("speedup", 8).arg("checksum", 16) << Qt::endl;
+
+  double baselineSecs = 0.0;
+
+  for (int d = -1; d <= CsvDecoder::Avx2; d++)
+  {
+    const CsvDecoder::Implementation impl = (CsvDecoder::Implementation)qMax(0, d);
+    double bestSecs = 0.0;
+    double sum = 0.0;
+    quint64 records = 0;
+
+    if ((d >= 0) && !CsvDecoder::isSupported(impl))
+    {
+      out << QString("%1 (not supported by this processor)").arg(CsvDecoder::name(impl), -18) << Qt::endl;
+      continue;
+    }
+
+    for (int run = 0; run < runs; run++)
+    {
+      QElapsedTimer timer;
+
+      records = 0;
+      timer.start();
+      sum = (d < 0) ? decodeWithSplit(log, records) : decodeWithDecoder(log, impl, records);
+
+      const double secs = timer.nsecsElapsed() / 1e9;
+      if ((run == 0) || (secs < bestSecs))
+      {
+        bestSecs = secs;
+      }
+    }
+
+    if (d < 0)
+    {
+      baselineSecs = bestSecs;
+    }
+
+    const QString speedup = QString::number(baselineSecs / bestSecs, 'f', 1) + "x";
+    out << QString("%1 %2 %3 %4 %5").arg((d < 0) ? "QString::split" : CsvDecoder::name(impl), -18)
+                                    .arg(records, 10)
+                                    .arg(log.size() / bestSecs / 1e9, 8, 'f', 3)
+                                    .arg(speedup, 8)
+                                    .arg(sum, 16, 'f', 1) << Qt::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,510 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <QtEndian>
+#include "csvdecoder.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CSVDECODER_X86
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+  const quint64 s_asciiZeros = Q_UINT64_C(0x3030303030303030);
+
+  const double s_pow10[] =
+  {
+    1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0, 10000000.0, 100000000.0
+  };
+
+  inline bool isDigit(char c)
+  {
+    return (c >= '0') && (c <= '9');
+  }
+
+  inline bool isDelimiter(char c)
+  {
+    return (c == ',') || (c == '\n');
+  }
+
+  /**
+   * Returns the position of the lowest set bit; mask must not be zero.
+   */
+  inline int lowestBit(quint32 mask)
+  {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    int index = 0;
+    while ((mask & 1) == 0)
+    {
+      mask >>= 1;
+      index++;
+    }
+    return index;
+#endif
+  }
+
+  /**
+   * Finds the commas and newlines in a block by testing each byte.
+   * @param out Receives the offset of each, in order
+   * @return Number found
+   */
+  int scanScalar(const char *p, int len, quint16 *out)
+  {
+    int count = 0;
+
+    for (int i = 0; i < len; i++)
+    {
+      if (isDelimiter(p[i]))
+      {
+        out[count++] = (quint16)i;
+      }
+    }
+    return count;
+  }
+
+#ifdef CSVDECODER_X86
+  /**
+   * Finds the commas and newlines in a block, 16 bytes at a time.
+   */
+  __attribute__((target("sse2")))
+  int scanSse2(const char *p, int len, quint16 *out)
+  {
+    const __m128i commas = _mm_set1_epi8(',');
+    const __m128i newlines = _mm_set1_epi8('\n');
+    int count = 0;
+    int i = 0;
+
+    for (; (i + 16) <= len; i += 16)
+    {
+      const __m128i bytes = _mm_loadu_si128((const __m128i*)(p + i));
+      quint32 mask = (quint32)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, commas),
+                                                             _mm_cmpeq_epi8(bytes, newlines)));
+      while (mask)
+      {
+        out[count++] = (quint16)(i + lowestBit(mask));
+        mask &= mask - 1;
+      }
+    }
+
+    for (; i < len; i++)
+    {
+      if (isDelimiter(p[i]))
+      {
+        out[count++] = (quint16)i;
+      }
+    }
+    return count;
+  }
+
+  /**
+   * Finds the commas and newlines in a block, 32 bytes at a time.
+   */
+  __attribute__((target("avx2")))
+  int scanAvx2(const char *p, int len, quint16 *out)
+  {
+    const __m256i commas = _mm256_set1_epi8(',');
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    int count = 0;
+    int i = 0;
+
+    for (; (i + 32) <= len; i += 32)
+    {
+      const __m256i bytes = _mm256_loadu_si256((const __m256i*)(p + i));
+      quint32 mask = (quint32)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, commas),
+                                                                   _mm256_cmpeq_epi8(bytes, newlines)));
+      while (mask)
+      {
+        out[count++] = (quint16)(i + lowestBit(mask));
+        mask &= mask - 1;
+      }
+    }
+
+    for (; i < len; i++)
+    {
+      if (isDelimiter(p[i]))
+      {
+        out[count++] = (quint16)i;
+      }
+    }
+    return count;
+  }
+#endif
+
+  /**
+   * Converts a run of one to eight digits that has at least eight readable
+   * bytes from its start, treating the bytes as a single 64-bit word.
+   * @return False if any of the characters isn't a digit
+   */
+  inline bool convertDigits(const char *p, int len, quint32& value)
+  {
+    quint64 word;
+
+    memcpy(&word, p, sizeof(word));
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    word = qbswap(word);
+#endif
+
+    // move the digits to the top of the word (the least significant end of
+    // the number) and fill in below them with leading zeros
+    if (len < 8)
+    {
+      word = (word << (8 * (8 - len))) | (s_asciiZeros >> (8 * len));
+    }
+
+    // every byte must be 0x30 to 0x39
+    if ((((word & Q_UINT64_C(0xF0F0F0F0F0F0F0F0)) |
+          (((word + Q_UINT64_C(0x0606060606060606)) & Q_UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4)) != Q_UINT64_C(0x3333333333333333)))
+    {
+      return false;
+    }
+
+    // combine pairs of digits, then pairs of pairs, then the two halves
+    word -= s_asciiZeros;
+    word = (word * 10) + (word >> 8);
+    word = (((word & Q_UINT64_C(0x000000FF000000FF)) * (100 + (Q_UINT64_C(1000000) << 32))) +
+            (((word >> 16) & Q_UINT64_C(0x000000FF000000FF)) * (1 + (Q_UINT64_C(10000) << 32)))) >> 32;
+    value = (quint32)word;
+    return true;
+  }
+
+  /**
+   * Converts a run of digits one at a time (e.g. near the end of the data).
+   */
+  inline bool convertDigitsSlowly(const char *p, int len, quint32& value)
+  {
+    value = 0;
+    for (int i = 0; i < len; i++)
+    {
+      if (!isDigit(p[i]))
+      {
+        return false;
+      }
+      value = (value * 10) + (p[i] - '0');
+    }
+    return true;
+  }
+
+  /**
+   * Converts a field that isn't in one of the forms the decoder handles
+   * itself.
+   */
+  bool convertWithStrtod(const char *p, const char *end, double& value)
+  {
+    char buf[64];
+    char *stop;
+    const int len = (int)(end - p);
+
+    if ((len <= 0) || (len >= (int)sizeof(buf)))
+    {
+      return false;
+    }
+
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    value = strtod(buf, &stop);
+    return (stop == (buf + len)) && isfinite(value);
+  }
+}
+
+/**
+ * Constructor.
+ * @param impl Delimiter scanner to use; falls back to the scalar version if
+ *  the processor doesn't support the one requested
+ */
+CsvDecoder::CsvDecoder(Implementation impl):
+m_scan(scanScalar), m_begin(0), m_end(0), m_pos(0), m_lineStart(0), m_window(0), m_scanned(0),
+m_delimCount(0), m_delimNext(0)
+{
+#ifdef CSVDECODER_X86
+  if ((impl == Avx2) && isSupported(Avx2))
+  {
+    m_scan = scanAvx2;
+  }
+  else if ((impl == Sse2) && isSupported(Sse2))
+  {
+    m_scan = scanSse2;
+  }
+#else
+  Q_UNUSED(impl)
+#endif
+}
+
+/**
+ * Checks whether the processor can run a particular scanner.
+ */
+bool CsvDecoder::isSupported(Implementation impl)
+{
+#ifdef CSVDECODER_X86
+  __builtin_cpu_init();
+#endif
+
+  switch (impl)
+  {
+  case Scalar:
+    return true;
+#ifdef CSVDECODER_X86
+  case Sse2:
+    return __builtin_cpu_supports("sse2");
+  case Avx2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+/**
+ * Returns the fastest scanner the processor supports.
+ */
+CsvDecoder::Implementation CsvDecoder::best()
+{
+  static const Implementation impl = isSupported(Avx2) ? Avx2 : (isSupported(Sse2) ? Sse2 : Scalar);
+  return impl;
+}
+
+const char* CsvDecoder::name(Implementation impl)
+{
+  switch (impl)
+  {
+  case Sse2:
+    return "SSE2";
+  case Avx2:
+    return "AVX2";
+  default:
+    return "scalar";
+  }
+}
+
+/**
+ * Starts decoding a new block of data, which should begin at the start of
+ * a line. A final line without a newline is read as far as the end.
+ */
+void CsvDecoder::setData(const char *begin, const char *end)
+{
+  m_begin = begin;
+  m_end = end;
+  m_pos = begin;
+  m_lineStart = begin;
+  m_window = begin;
+  m_scanned = begin;
+  m_delimCount = 0;
+  m_delimNext = 0;
+}
+
+/**
+ * Returns the position of the next comma or newline, or the end of the
+ * data if there are no more, scanning another window of data when those
+ * already found have been used up.
+ */
+const char* CsvDecoder::nextDelimiter()
+{
+  while (m_delimNext == m_delimCount)
+  {
+    if (m_scanned >= m_end)
+    {
+      return m_end;
+    }
+
+    const int len = (int)qMin((qint64)s_windowBytes, (qint64)(m_end - m_scanned));
+    m_window = m_scanned;
+    m_delimCount = m_scan(m_window, len, m_delims);
+    m_delimNext = 0;
+    m_scanned += len;
+  }
+
+  return m_window + m_delims[m_delimNext++];
+}
+
+/**
+ * Decodes the next line of the data.
+ * @param record Receives the values, if the line is a sample
+ * @return The kind of line read, or EndOfData if there are no more lines
+ */
+CsvDecoder::LineType CsvDecoder::next(Record& record)
+{
+  const char *fieldEnds[s_fieldCount];
+  const char *delim;
+  int fields = 0;
+
+  if (m_pos >= m_end)
+  {
+    return EndOfData;
+  }
+
+  m_lineStart = m_pos;
+  do
+  {
+    delim = nextDelimiter();
+    if (fields < s_fieldCount)
+    {
+      fieldEnds[fields] = delim;
+    }
+    fields++;
+  } while ((delim < m_end) && (*delim != '\n'));
+
+  const char *line = m_pos;
+  const char *lineEnd = delim;
+  m_pos = delim + 1;
+
+  if ((lineEnd > line) && (lineEnd[-1] == '\r'))
+  {
+    lineEnd--;
+    if (fields <= s_fieldCount)
+    {
+      fieldEnds[fields - 1] = lineEnd;
+    }
+  }
+
+  if (lineEnd == line)
+  {
+    return BlankLine;
+  }
+  if (*line == '#')
+  {
+    return CommentLine;
+  }
+  if ((fields < s_fieldCount) || !parseFields(line, fieldEnds, record))
+  {
+    return BadLine;
+  }
+  return SampleLine;
+}
+
+/**
+ * Decodes a single line.
+ * @param end End of the line (with or without its newline)
+ */
+CsvDecoder::LineType CsvDecoder::decodeLine(const char *line, const char *end, Record& record)
+{
+  setData(line, end);
+  const LineType type = next(record);
+  return (type == EndOfData) ? BlankLine : type;
+}
+
+/**
+ * Converts the fields of a sample line, in the order of
+ * CsvFormat::header(). Fields after the last one known are ignored.
+ */
+bool CsvDecoder::parseFields(const char *line, const char *const *fieldEnds, Record& record) const
+{
+  mems_data *data = &record.data;
+  quint32 v[5];
+
+  if (!parseTime(line, fieldEnds[0], record.timeOfDayMs) ||
+      !parseUnsigned(fieldEnds[0] + 1, fieldEnds[1], v[0]) ||
+      !parseUnsigned(fieldEnds[1] + 1, fieldEnds[2], v[1]) ||
+      !parseUnsigned(fieldEnds[2] + 1, fieldEnds[3], v[2]) ||
+      !parseFloat(fieldEnds[3] + 1, fieldEnds[4], data->throttle_pot_voltage) ||
+      !parseFloat(fieldEnds[4] + 1, fieldEnds[5], data->map_kpa) ||
+      !parseUnsigned(fieldEnds[5] + 1, fieldEnds[6], v[3]) ||
+      !parseFloat(fieldEnds[6] + 1, fieldEnds[7], data->battery_voltage) ||
+      (fieldEnds[8] != (fieldEnds[7] + 2)) || !isDigit(fieldEnds[7][1]) ||
+      (fieldEnds[9] != (fieldEnds[8] + 2)) || !isDigit(fieldEnds[8][1]) ||
+      !parseUnsigned(fieldEnds[9] + 1, fieldEnds[10], v[4]))
+  {
+    return false;
+  }
+
+  data->engine_rpm = v[0];
+  data->coolant_temp_c = v[1];
+  data->intake_air_temp_c = v[2];
+  data->iac_position = v[3];
+  data->idle_switch = (fieldEnds[7][1] != '0');
+  data->closed_loop = (fieldEnds[8][1] != '0');
+  data->lambda_voltage_mv = v[4];
+
+  // not in the text log
+  data->ambient_temp_c = 0;
+  data->fuel_temp_c = 0;
+  data->park_neutral_switch = false;
+  data->fault_codes = 0;
+  return true;
+}
+
+/**
+ * Reads the hh:mm:ss.zzz time at the start of a line.
+ */
+bool CsvDecoder::parseTime(const char *p, const char *end, qint64& timeMs)
+{
+  if (((end - p) != 12) || (p[2] != ':') || (p[5] != ':') || (p[8] != '.'))
+  {
+    return false;
+  }
+
+  for (int i = 0; i < 12; i++)
+  {
+    if ((i != 2) && (i != 5) && (i != 8) && !isDigit(p[i]))
+    {
+      return false;
+    }
+  }
+
+  timeMs = ((((((p[0] - '0') * 10) + (p[1] - '0')) * 60) + (((p[3] - '0') * 10) + (p[4] - '0'))) * 60 +
+             (((p[6] - '0') * 10) + (p[7] - '0'))) * Q_INT64_C(1000) +
+           ((p[9] - '0') * 100) + ((p[10] - '0') * 10) + (p[11] - '0');
+  return true;
+}
+
+bool CsvDecoder::parseUnsigned(const char *p, const char *end, quint32& value) const
+{
+  const int len = (int)(end - p);
+
+  if ((len < 1) || (len > 8))
+  {
+    double d;
+    if (!convertWithStrtod(p, end, d) || (d < 0.0) || (d > 4294967295.0))
+    {
+      return false;
+    }
+    value = (quint32)d;
+    return true;
+  }
+
+  return ((m_end - p) >= 8) ? convertDigits(p, len, value) : convertDigitsSlowly(p, len, value);
+}
+
+bool CsvDecoder::parseFloat(const char *p, const char *end, float& value) const
+{
+  const char *point = p;
+  quint32 whole;
+  quint32 fraction = 0;
+  int places = 0;
+
+  while ((point < end) && (*point != '.'))
+  {
+    point++;
+  }
+
+  if (point < end)
+  {
+    places = (int)(end - point - 1);
+    if ((places < 1) || (places > 8) || !parseUnsigned(point + 1, end, fraction))
+    {
+      places = -1;
+    }
+  }
+
+  if ((places < 0) || (point == p) || ((point - p) > 8) || !parseUnsigned(p, point, whole))
+  {
+    // a sign, an exponent, or simply too many digits
+    double d;
+    if (!convertWithStrtod(p, end, d))
+    {
+      return false;
+    }
+    value = (float)d;
+    return true;
+  }
+
+  value = (float)(whole + (fraction / s_pow10[places]));
+  return true;
+}
@@ -0,0 +1,91 @@
+#ifndef CSVDECODER_H
+#define CSVDECODER_H
+
+#include <QtGlobal>
+#include "rosco.h"
+
+/**
+ * Reads the text log written by Logger (the layout of CsvFormat::header(),
+ * as produced by CsvEncoder) much faster than splitting lines into strings.
+ *
+ * The data is scanned a block at a time for commas and newlines with SSE2
+ * or AVX2 compares, where the processor has them, and the positions found
+ * are then used to pick out the fields of each line. Because the layout is
+ * fixed, each field is converted straight into the corresponding mems_data
+ * member: digit runs of up to eight characters are converted eight at a
+ * time within a 64-bit word, and the hh:mm:ss.zzz time is read without any
+ * searching. Anything unusual (e.g. a number with an exponent) falls back
+ * to strtod().
+ *
+ * The decoder doesn't copy the data, which must stay in place while it's
+ * being read.
+ */
+class CsvDecoder
+{
+public:
+    enum Implementation
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    enum LineType
+    {
+        SampleLine,
+        CommentLine,
+        BlankLine,
+        BadLine,
+        EndOfData
+    };
+
+    /**
+     * One sample line. Temperatures are as written (i.e. in the units the
+     * log was recorded with), and the time is msecs since midnight.
+     */
+    struct Record
+    {
+        qint64 timeOfDayMs;
+        mems_data data;
+    };
+
+    static const int s_fieldCount = 11;   // including the time
+
+    explicit CsvDecoder(Implementation impl = best());
+
+    static Implementation best();
+    static bool isSupported(Implementation impl);
+    static const char* name(Implementation impl);
+
+    void setData(const char *begin, const char *end);
+    LineType next(Record& record);
+    const char* lineStart() const { return m_lineStart; }
+
+    LineType decodeLine(const char *line, const char *end, Record& record);
+
+private:
+    static const int s_windowBytes = 4096;
+
+    typedef int (*ScanFunction)(const char *p, int len, quint16 *out);
+
+    ScanFunction m_scan;
+    const char *m_begin;
+    const char *m_end;
+    const char *m_pos;
+    const char *m_lineStart;
+
+    // delimiter positions in the current window, relative to its start
+    const char *m_window;
+    const char *m_scanned;
+    quint16 m_delims[s_windowBytes];
+    int m_delimCount;
+    int m_delimNext;
+
+    const char* nextDelimiter();
+    bool parseFields(const char *line, const char *const *fieldEnds, Record& record) const;
+    bool parseUnsigned(const char *p, const char *end, quint32& value) const;
+    bool parseFloat(const char *p, const char *end, float& value) const;
+    static bool parseTime(const char *p, const char *end, qint64& timeMs);
+};
+
+#endif // CSVDECODER_H
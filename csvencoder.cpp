@@ -0,0 +1,329 @@
+#include <QDateTime>
+#include <math.h>
+#include <string.h>
+#include "csvencoder.h"
+#include "csvformat.h"
+
+// order of the fields after the timestamp; must match CsvFormat::header()
+const CsvEncoder::Field CsvEncoder::s_fields[] =
+{
+  EngineSpeed,
+  WaterTemp,
+  IntakeAirTemp,
+  ThrottleVoltage,
+  ManifoldPressure,
+  IdleBypassPos,
+  MainVoltage,
+  IdleSwitch,
+  ClosedLoop,
+  LambdaVoltage
+};
+
+const int CsvEncoder::s_fieldCount = sizeof(CsvEncoder::s_fields) / sizeof(CsvEncoder::s_fields[0]);
+
+namespace
+{
+  const int s_significantDigits = 6;
+
+  const quint64 s_pow10[] =
+  {
+    Q_UINT64_C(1), Q_UINT64_C(10), Q_UINT64_C(100), Q_UINT64_C(1000), Q_UINT64_C(10000),
+    Q_UINT64_C(100000), Q_UINT64_C(1000000), Q_UINT64_C(10000000), Q_UINT64_C(100000000),
+    Q_UINT64_C(1000000000), Q_UINT64_C(10000000000), Q_UINT64_C(100000000000),
+    Q_UINT64_C(1000000000000), Q_UINT64_C(10000000000000), Q_UINT64_C(100000000000000),
+    Q_UINT64_C(1000000000000000), Q_UINT64_C(10000000000000000),
+    Q_UINT64_C(100000000000000000), Q_UINT64_C(1000000000000000000)
+  };
+  const int s_maxPow10 = 18;
+
+  /**
+   * Computes (mantissa * 2^exp2 * 10^exp10) exactly, as an integer part and
+   * a flag saying whether the fraction is at least one half.
+   * @return False if the intermediate values won't fit in 64 bits
+   */
+  bool scaleExact(quint32 mantissa, int exp2, int exp10, quint64& whole, bool& roundUp)
+  {
+    quint64 num = mantissa;
+    quint64 den = 1;
+
+    if (exp2 >= 0)
+    {
+      if (exp2 > 39)
+      {
+        return false;
+      }
+      num <<= exp2;
+    }
+    else
+    {
+      if (-exp2 > 62)
+      {
+        return false;
+      }
+      den <<= -exp2;
+    }
+
+    if (exp10 >= 0)
+    {
+      if ((exp10 > s_maxPow10) || (num > (~Q_UINT64_C(0) / s_pow10[exp10])))
+      {
+        return false;
+      }
+      num *= s_pow10[exp10];
+    }
+    else
+    {
+      if ((-exp10 > s_maxPow10) || (den > (~Q_UINT64_C(0) / s_pow10[-exp10])))
+      {
+        return false;
+      }
+      den *= s_pow10[-exp10];
+    }
+
+    whole = num / den;
+    const quint64 rem = num % den;
+
+    // halves round away from zero, as Qt's own conversion does
+    roundUp = (rem >= (den - rem));
+    return true;
+  }
+
+  int copyFallback(char *buf, float value)
+  {
+    const QByteArray text = QByteArray::number((double)value, 'g', s_significantDigits);
+    memcpy(buf, text.constData(), text.size());
+    return text.size();
+  }
+}
+
+/**
+ * Constructor.
+ */
+CsvEncoder::CsvEncoder():
+m_units(Fahrenheit), m_prefixSecond(-1), m_prefixLen(0)
+{
+}
+
+/**
+ * Writes the decimal form of an unsigned value.
+ * @return Number of characters written
+ */
+int CsvEncoder::formatUnsigned(char *buf, quint32 value)
+{
+  char digits[10];
+  int count = 0;
+
+  do
+  {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  for (int i = 0; i < count; i++)
+  {
+    buf[i] = digits[count - 1 - i];
+  }
+  return count;
+}
+
+/**
+ * Writes a float the way QTextStream does by default: six significant
+ * digits, trailing zeros removed, and exponent notation only for very
+ * large or very small values. The rounding is done with integer arithmetic
+ * on the exact value of the float, so the result matches Qt's to the
+ * digit. (Values too small or large for that fall back to Qt itself.)
+ * @return Number of characters written
+ */
+int CsvEncoder::formatFloat(char *buf, float value)
+{
+  char *p = buf;
+
+  if (!isfinite(value))
+  {
+    return copyFallback(buf, value);
+  }
+
+  if (signbit(value))
+  {
+    *p++ = '-';
+    value = -value;
+  }
+
+  if (value == 0.0f)
+  {
+    *p++ = '0';
+    return p - buf;
+  }
+
+  // value == mantissa * 2^exp2, exactly
+  int exp;
+  const float fraction = frexpf(value, &exp);
+  const quint32 mantissa = (quint32)ldexpf(fraction, 24);
+  const int exp2 = exp - 24;
+
+  // find the decimal exponent, then the six digits
+  int exp10 = (int)floor(log10((double)value));
+  quint64 digits = 0;
+  bool roundUp = false;
+
+  for (int attempt = 0; attempt < 3; attempt++)
+  {
+    if (!scaleExact(mantissa, exp2, (s_significantDigits - 1) - exp10, digits, roundUp))
+    {
+      return (p - buf) + copyFallback(p, value);
+    }
+
+    if (digits < s_pow10[s_significantDigits - 1])
+    {
+      exp10--;
+    }
+    else if (digits >= s_pow10[s_significantDigits])
+    {
+      exp10++;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  if (roundUp && (++digits == s_pow10[s_significantDigits]))
+  {
+    digits = s_pow10[s_significantDigits - 1];
+    exp10++;
+  }
+
+  char d[s_significantDigits];
+  int count = s_significantDigits;
+
+  for (int i = s_significantDigits - 1; i >= 0; i--)
+  {
+    d[i] = '0' + (digits % 10);
+    digits /= 10;
+  }
+  while ((count > 1) && (d[count - 1] == '0'))
+  {
+    count--;
+  }
+
+  if ((exp10 < -4) || (exp10 >= s_significantDigits))
+  {
+    *p++ = d[0];
+    if (count > 1)
+    {
+      *p++ = '.';
+      memcpy(p, d + 1, count - 1);
+      p += count - 1;
+    }
+    *p++ = 'e';
+    *p++ = (exp10 < 0) ? '-' : '+';
+    if ((exp10 > -10) && (exp10 < 10))
+    {
+      *p++ = '0';
+    }
+    p += formatUnsigned(p, (exp10 < 0) ? -exp10 : exp10);
+  }
+  else if (exp10 >= 0)
+  {
+    memcpy(p, d, exp10 + 1);
+    p += exp10 + 1;
+    if (count > exp10 + 1)
+    {
+      *p++ = '.';
+      memcpy(p, d + exp10 + 1, count - (exp10 + 1));
+      p += count - (exp10 + 1);
+    }
+  }
+  else
+  {
+    *p++ = '0';
+    *p++ = '.';
+    for (int i = 0; i < -exp10 - 1; i++)
+    {
+      *p++ = '0';
+    }
+    memcpy(p, d, count);
+    p += count;
+  }
+
+  return p - buf;
+}
+
+/**
+ * Renders the "hh:mm:ss." part of the timestamp for the given second.
+ */
+void CsvEncoder::renderPrefix(qint64 second)
+{
+  const QByteArray text = QDateTime::fromMSecsSinceEpoch(second * 1000).toString("hh:mm:ss.").toLatin1();
+
+  m_prefixLen = qMin(text.size(), (int)sizeof(m_prefix));
+  memcpy(m_prefix, text.constData(), m_prefixLen);
+  m_prefixSecond = second;
+}
+
+/**
+ * Appends one sample as a line of the text log.
+ * @param timestampMs Time of the sample, in msecs since the epoch
+ * @param data Sample data
+ * @param out Buffer to append to
+ */
+void CsvEncoder::encode(qint64 timestampMs, const mems_data *data, QByteArray& out)
+{
+  char line[256];
+  char *p = line;
+  const qint64 second = (timestampMs >= 0) ? (timestampMs / 1000) : ((timestampMs - 999) / 1000);
+  const int msecs = timestampMs - (second * 1000);
+
+  if (second != m_prefixSecond)
+  {
+    renderPrefix(second);
+  }
+
+  memcpy(p, m_prefix, m_prefixLen);
+  p += m_prefixLen;
+  *p++ = '0' + (msecs / 100);
+  *p++ = '0' + ((msecs / 10) % 10);
+  *p++ = '0' + (msecs % 10);
+
+  for (int i = 0; i < s_fieldCount; i++)
+  {
+    *p++ = ',';
+
+    switch (s_fields[i])
+    {
+    case EngineSpeed:
+      p += formatUnsigned(p, data->engine_rpm);
+      break;
+    case WaterTemp:
+      p += formatUnsigned(p, CsvFormat::convertTemp(data->coolant_temp_c, m_units));
+      break;
+    case IntakeAirTemp:
+      p += formatUnsigned(p, CsvFormat::convertTemp(data->intake_air_temp_c, m_units));
+      break;
+    case ThrottleVoltage:
+      p += formatFloat(p, data->throttle_pot_voltage);
+      break;
+    case ManifoldPressure:
+      p += formatFloat(p, data->map_kpa);
+      break;
+    case IdleBypassPos:
+      p += formatUnsigned(p, data->iac_position);
+      break;
+    case MainVoltage:
+      p += formatFloat(p, data->battery_voltage);
+      break;
+    case IdleSwitch:
+      *p++ = data->idle_switch ? '1' : '0';
+      break;
+    case ClosedLoop:
+      *p++ = data->closed_loop ? '1' : '0';
+      break;
+    case LambdaVoltage:
+      p += formatUnsigned(p, data->lambda_voltage_mv);
+      break;
+    }
+  }
+
+  *p++ = '\n';
+  out.append(line, p - line);
+}
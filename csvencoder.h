@@ -0,0 +1,54 @@
+#ifndef CSVENCODER_H
+#define CSVENCODER_H
+
+#include <QByteArray>
+#include "rosco.h"
+#include "commonunits.h"
+
+/**
+ * Formats samples as lines of the text log without going through
+ * QTextStream or QDateTime for every sample. Numbers are formatted by
+ * hand into a fixed buffer, producing exactly what QTextStream would (the
+ * C locale, with floats to six significant digits), and the "hh:mm:ss."
+ * part of the timestamp is only rendered again when the second changes.
+ * Appending to a QByteArray that has enough capacity reserved therefore
+ * allocates nothing.
+ */
+class CsvEncoder
+{
+public:
+    CsvEncoder();
+
+    void setTemperatureUnits(TemperatureUnits units) { m_units = units; }
+    void encode(qint64 timestampMs, const mems_data *data, QByteArray& out);
+
+    static int formatUnsigned(char *buf, quint32 value);
+    static int formatFloat(char *buf, float value);
+
+private:
+    enum Field
+    {
+        EngineSpeed,
+        WaterTemp,
+        IntakeAirTemp,
+        ThrottleVoltage,
+        ManifoldPressure,
+        IdleBypassPos,
+        MainVoltage,
+        IdleSwitch,
+        ClosedLoop,
+        LambdaVoltage
+    };
+
+    static const Field s_fields[];
+    static const int s_fieldCount;
+
+    TemperatureUnits m_units;
+    qint64 m_prefixSecond;
+    char m_prefix[16];
+    int m_prefixLen;
+
+    void renderPrefix(qint64 second);
+};
+
+#endif // CSVENCODER_H
@@ -0,0 +1,53 @@
+#include <QDateTime>
+#include <math.h>
+#include "csvformat.h"
+
+/**
+ * Returns the header line (including the newline).
+ */
+const char* CsvFormat::header()
+{
+  return "#time,engineSpeed,waterTemp,intakeAirTemp,"
+         "throttleVoltage,manifoldPressure,idleBypassPos,mainVoltage,"
+         "idleswitch,closedloop,lambdaVoltage_mV\n";
+}
+
+/**
+ * Converts degrees C to degrees F if necessary
+ */
+uint8_t CsvFormat::convertTemp(uint8_t degreesC, TemperatureUnits units)
+{
+  if (units == Celsius)
+  {
+    return degreesC;
+  }
+  else
+  {
+    return ((degreesC * 1.8) + 32);
+  }
+}
+
+/**
+ * Converts a temperature read from a text log back to degrees C. The
+ * conversion to Fahrenheit truncates, so rounding up recovers the original
+ * whole degrees.
+ */
+uint8_t CsvFormat::celsiusTemp(uint8_t degrees, TemperatureUnits units)
+{
+  if (units == Celsius)
+  {
+    return degrees;
+  }
+  else
+  {
+    return (uint8_t)qMax(0.0, ceil(((degrees - 32) / 1.8) - 1e-6));
+  }
+}
+
+/**
+ * Writes a comment line (used to mark gaps in the data).
+ */
+void CsvFormat::writeComment(QTextStream& out, qint64 timestampMs, QString note)
+{
+  out << "# " << QDateTime::fromMSecsSinceEpoch(timestampMs).toString("hh:mm:ss.zzz") << " " << note << "\n";
+}
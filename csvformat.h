@@ -0,0 +1,23 @@
+#ifndef CSVFORMAT_H
+#define CSVFORMAT_H
+
+#include <QTextStream>
+#include "rosco.h"
+#include "commonunits.h"
+
+/**
+ * Layout of the text (CSV) log: the header line, temperature conversion,
+ * and comment lines. (Samples themselves are formatted by CsvEncoder.)
+ * Shared by Logger and the log conversion tool so that both produce
+ * exactly the same output.
+ */
+class CsvFormat
+{
+public:
+    static const char* header();
+    static uint8_t convertTemp(uint8_t degreesC, TemperatureUnits units);
+    static uint8_t celsiusTemp(uint8_t degrees, TemperatureUnits units);
+    static void writeComment(QTextStream& out, qint64 timestampMs, QString note);
+};
+
+#endif // CSVFORMAT_H
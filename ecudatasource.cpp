@@ -0,0 +1,53 @@
+#include "ecudatasource.h"
+#include "roscodatasource.h"
+#include "replaydatasource.h"
+#include "syntheticdatasource.h"
+
+/**
+ * Creates the appropriate data source for a device name. Names starting
+ * with "replay:" are followed by the path to a log file, optionally after
+ * "celsius:" or "fahrenheit:" to give the units of the temperatures in a
+ * text log (Fahrenheit, as Logger writes them by default, if not given);
+ * names starting with "synthetic:" may be followed by a seed for the
+ * generator. Anything else is taken to be the name of a serial device.
+ * @param device Device name, as entered in the options dialog
+ * @param replayClock Playback position for a replayed log (may be 0)
+ * @return New data source, owned by the caller
+ */
+ECUDataSource* ECUDataSource::create(QString device, ReplayClock *replayClock)
+{
+  if (device.startsWith(replayPrefix()))
+  {
+    QString path = device.mid(replayPrefix().length());
+    TemperatureUnits units = Fahrenheit;
+
+    if (path.startsWith("celsius:", Qt::CaseInsensitive))
+    {
+      units = Celsius;
+      path.remove(0, 8);
+    }
+    else if (path.startsWith("fahrenheit:", Qt::CaseInsensitive))
+    {
+      path.remove(0, 11);
+    }
+    return new ReplayDataSource(path, replayClock, units);
+  }
+  else if (device.startsWith(syntheticPrefix()))
+  {
+    return new SyntheticDataSource(device.mid(syntheticPrefix().length()).toUInt());
+  }
+
+  return new RoscoDataSource(device);
+}
+
+/**
+ * Re-establishes communication after the link has dropped. By default this
+ * simply closes and reopens the source.
+ * @param ecuId Receives the four ID bytes returned by the ECU
+ * @return True if the source is usable again; false otherwise
+ */
+bool ECUDataSource::reinitLink(uint8_t *ecuId)
+{
+  disconnect();
+  return connect(ecuId);
+}
@@ -0,0 +1,42 @@
+#ifndef ECUDATASOURCE_H
+#define ECUDATASOURCE_H
+
+#include <QString>
+#include "rosco.h"
+
+class ReplayClock;
+
+/**
+ * Abstract source of ECU data. MEMSInterface talks to one of these rather
+ * than directly to librosco, so that the rest of the application (display,
+ * logging, etc.) can be driven by recorded or generated data as well as by
+ * a real ECU.
+ */
+class ECUDataSource
+{
+public:
+    virtual ~ECUDataSource() {}
+
+    virtual bool connect(uint8_t *ecuId) = 0;
+    virtual void disconnect() = 0;
+    virtual bool isConnected() = 0;
+    virtual bool read(mems_data *data) = 0;
+    virtual bool reinitLink(uint8_t *ecuId);
+
+    virtual bool testActuator(actuator_cmd cmd) = 0;
+    virtual bool clearFaults() = 0;
+    virtual bool moveIAC(uint8_t desiredPos) = 0;
+
+    // only sources that talk to a serial device have raw bytes to record
+    virtual bool supportsCapture() const { return false; }
+    virtual void setCapturePath(QString) {}
+
+    // only sources that can block on a device have a read to interrupt
+    virtual void cancelRead() {}
+
+    static ECUDataSource* create(QString device, ReplayClock *replayClock = 0);
+    static QString replayPrefix()    { return "replay:"; }
+    static QString syntheticPrefix() { return "synthetic:"; }
+};
+
+#endif // ECUDATASOURCE_H
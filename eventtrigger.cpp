@@ -0,0 +1,150 @@
+#include <QStringList>
+#include "eventtrigger.h"
+
+/**
+ * Constructor. By default, new fault codes and coolant over 98 C trigger
+ * logging, with a 30-second window either side.
+ */
+EventTrigger::EventTrigger():
+m_held(s_maxHeldSamples), m_head(0), m_count(0), m_triggers(0)
+{
+  m_settings.newFault = true;
+  m_settings.coolantLimitC = s_defaultCoolantLimitC;
+  m_settings.rpmLimit = 0;
+  m_settings.preTriggerSecs = s_defaultWindowSecs;
+  m_settings.postTriggerSecs = s_defaultWindowSecs;
+  reset();
+}
+
+void EventTrigger::setSettings(const Settings& settings)
+{
+  m_settings = settings;
+  m_settings.preTriggerSecs = qMax(0, settings.preTriggerSecs);
+  m_settings.postTriggerSecs = qMax(0, settings.postTriggerSecs);
+}
+
+/**
+ * Empties the pre-trigger buffer and forgets the previous sample, e.g. when
+ * a new log is opened.
+ */
+void EventTrigger::reset()
+{
+  m_head = 0;
+  m_count = 0;
+  m_active = false;
+  m_windowEndMs = 0;
+  m_haveFaults = false;
+  m_lastFaults = 0;
+  m_coolantOver = false;
+  m_rpmOver = false;
+}
+
+/**
+ * Checks a sample against the trigger conditions.
+ * @param reason Receives a description of the conditions met, when a
+ *  trigger fires
+ * @return What the logger should do with the sample
+ */
+EventTrigger::Action EventTrigger::process(const MEMSSample& sample, QString& reason)
+{
+  const QString met = check(sample.data);
+
+  if (!met.isEmpty())
+  {
+    reason = met;
+    m_active = true;
+    m_windowEndMs = sample.timestampMs + (m_settings.postTriggerSecs * Q_INT64_C(1000));
+    m_triggers++;
+    return Fire;
+  }
+
+  if (m_active)
+  {
+    if (sample.timestampMs <= m_windowEndMs)
+    {
+      return Continue;
+    }
+    m_active = false;
+    hold(sample);
+    return End;
+  }
+
+  hold(sample);
+  return Hold;
+}
+
+/**
+ * Removes the oldest sample from the pre-trigger buffer.
+ * @return False once the buffer is empty
+ */
+bool EventTrigger::takeHeld(MEMSSample& sample)
+{
+  if (m_count == 0)
+  {
+    return false;
+  }
+
+  sample = m_held.at(m_head);
+  m_head = (m_head + 1) % s_maxHeldSamples;
+  m_count--;
+  return true;
+}
+
+/**
+ * Adds a sample to the pre-trigger buffer, dropping any that are now older
+ * than the pre-trigger window (or the oldest, if the buffer is full).
+ */
+void EventTrigger::hold(const MEMSSample& sample)
+{
+  const qint64 oldestMs = sample.timestampMs - (m_settings.preTriggerSecs * Q_INT64_C(1000));
+
+  while ((m_count > 0) &&
+         ((m_count == s_maxHeldSamples) || (m_held.at(m_head).timestampMs < oldestMs)))
+  {
+    m_head = (m_head + 1) % s_maxHeldSamples;
+    m_count--;
+  }
+
+  if (m_settings.preTriggerSecs > 0)
+  {
+    m_held[(m_head + m_count) % s_maxHeldSamples] = sample;
+    m_count++;
+  }
+}
+
+/**
+ * Evaluates the trigger conditions, updating the state that makes them
+ * fire on a change rather than on every sample.
+ * @return Description of the conditions met, or an empty string if none
+ */
+QString EventTrigger::check(const mems_data& data)
+{
+  QStringList met;
+
+  if (m_settings.newFault && m_haveFaults)
+  {
+    const uint8_t newFaults = data.fault_codes & ~m_lastFaults;
+    if (newFaults != 0)
+    {
+      met.append(QString("new fault code 0x%1").arg(newFaults, 2, 16, QChar('0')));
+    }
+  }
+  m_lastFaults = data.fault_codes;
+  m_haveFaults = true;
+
+  const bool coolantOver = (m_settings.coolantLimitC >= 0) && (data.coolant_temp_c > m_settings.coolantLimitC);
+  if (coolantOver && !m_coolantOver)
+  {
+    met.append(QString("coolant at %1 C").arg(data.coolant_temp_c));
+  }
+  m_coolantOver = coolantOver;
+
+  const bool rpmOver = (m_settings.rpmLimit > 0) && (data.engine_rpm > m_settings.rpmLimit);
+  if (rpmOver && !m_rpmOver)
+  {
+    met.append(QString("engine speed at %1 RPM").arg(data.engine_rpm));
+  }
+  m_rpmOver = rpmOver;
+
+  return met.join(", ");
+}
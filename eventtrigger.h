@@ -0,0 +1,72 @@
+#ifndef EVENTTRIGGER_H
+#define EVENTTRIGGER_H
+
+#include <QString>
+#include <QVector>
+#include "samplering.h"
+
+/**
+ * Decides which samples are worth logging when only the periods around
+ * interesting events are wanted. Samples are held in a bounded pre-trigger
+ * buffer until one meets a trigger condition (a new fault code, coolant
+ * temperature over a limit, or engine speed over a limit). The buffered
+ * samples are then logged, followed by every sample until the post-trigger
+ * window has passed without another trigger.
+ *
+ * The temperature and speed conditions fire when the value goes over the
+ * limit, and are re-armed once it drops back; a fault code fires when its
+ * bit is set in a sample but wasn't in the previous one.
+ */
+class EventTrigger
+{
+public:
+    struct Settings
+    {
+        bool newFault;          // a fault code appears
+        int coolantLimitC;      // coolant temperature over this (-1 to disable)
+        int rpmLimit;           // engine speed over this (0 to disable)
+        int preTriggerSecs;     // history logged when a trigger fires
+        int postTriggerSecs;    // logging continues this long after a trigger
+    };
+
+    enum Action
+    {
+        Hold,       // sample was buffered; nothing to log
+        Fire,       // a trigger fired: log the buffered samples, then this one
+        Continue,   // inside the post-trigger window: log this sample
+        End         // window has closed; this sample was buffered
+    };
+
+    static const int s_maxHeldSamples = 16384;
+    static const int s_defaultCoolantLimitC = 98;
+    static const int s_defaultWindowSecs = 30;
+
+    EventTrigger();
+
+    void setSettings(const Settings& settings);
+    Settings settings() const { return m_settings; }
+    void reset();
+
+    Action process(const MEMSSample& sample, QString& reason);
+    bool takeHeld(MEMSSample& sample);
+    quint64 triggerCount() const { return m_triggers; }
+
+private:
+    Settings m_settings;
+    QVector<MEMSSample> m_held;
+    int m_head;
+    int m_count;
+
+    bool m_active;
+    qint64 m_windowEndMs;
+    bool m_haveFaults;
+    uint8_t m_lastFaults;
+    bool m_coolantOver;
+    bool m_rpmOver;
+    quint64 m_triggers;
+
+    QString check(const mems_data& data);
+    void hold(const MEMSSample& sample);
+};
+
+#endif // EVENTTRIGGER_H
@@ -0,0 +1,159 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QTextStream>
+#include <QWidget>
+#include <math.h>
+#include <time.h>
+#include "manometer.h"
+
+/**
+ * One of the gauges on the main window, set up as MainWindow does, with a
+ * made-up signal that changes on every frame.
+ */
+struct GaugeConfig
+{
+    const char *name;
+    double minimum;
+    double maximum;
+    const char *suffix;
+    double nominal;
+    double critical;
+    bool wholeNumbers;      // as engine speed and temperatures are in the ECU data
+    double base;
+    double swing;
+    int period;
+};
+
+static const GaugeConfig s_gauges[] =
+{
+  { "m_revCounter",      0.0, 8000.0, " RPM", 100000.0,  8000.0, true,  3000.0, 2200.0, 400 },
+  { "m_mapGauge",        0.0,  140.0, " kPa",   1000.0,  1000.0, false,   60.0,   35.0, 300 },
+  { "m_waterTempGauge", -40.0, 280.0, " F",      180.0,   210.0, true,   150.0,  120.0, 700 },
+  { "m_airTempGauge",   -40.0, 280.0, " F",    10000.0, 10000.0, true,    80.0,   40.0, 900 }
+};
+
+static const int s_gaugeCount = sizeof(s_gauges) / sizeof(s_gauges[0]);
+
+/**
+ * Value for a frame.
+ */
+static double gaugeValue(const GaugeConfig& config, int frame)
+{
+  const double v = config.base + (config.swing * sin((2.0 * M_PI * frame) / config.period));
+  return config.wholeNumbers ? floor(v) : v;
+}
+
+/**
+ * Result of one run: CPU and wall-clock time per frame.
+ */
+struct FrameCost
+{
+    double cpuUsecs;
+    double wallUsecs;
+};
+
+/**
+ * Feeds a gauge a value per frame and processes the resulting repaint. For
+ * the full repaint, the whole gauge is marked as needing to be drawn
+ * whenever the value changes, as it was before setValue() limited the
+ * repaint to the needle and value string.
+ */
+static FrameCost runFrames(ManoMeter *gauge, const GaugeConfig& config, int frames, bool fullRepaint)
+{
+  QElapsedTimer timer;
+  FrameCost cost;
+
+  // draw the background (and settle the layout) before timing anything
+  gauge->setValue(gaugeValue(config, -1));
+  gauge->repaint();
+  QApplication::processEvents();
+
+  const clock_t start = clock();
+  timer.start();
+
+  for (int frame = 0; frame < frames; frame++)
+  {
+    const double before = gauge->value();
+
+    gauge->setValue(gaugeValue(config, frame));
+    if (fullRepaint && (gauge->value() != before))
+    {
+      gauge->update();
+    }
+    QApplication::processEvents();
+  }
+
+  cost.wallUsecs = (timer.nsecsElapsed() / 1e3) / frames;
+  cost.cpuUsecs = ((clock() - start) * 1e6 / CLOCKS_PER_SEC) / frames;
+  return cost;
+}
+
+/**
+ * Measures how long the gauges take to redraw after each new sample, with
+ * the whole gauge repainted and with only the parts that move. The gauges
+ * are laid out as on the main window; set QT_QPA_PLATFORM=offscreen to run
+ * without a display.
+ */
+int main(int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+  QApplication::setApplicationName("memsgaugebench");
+  QTextStream out(stdout);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures the time taken to redraw the gauges for each sample.");
+  parser.addHelpOption();
+
+  QCommandLineOption framesOpt(QStringList() << "f" << "frames", "Frames drawn per gauge and mode (default 2000).", "count", "2000");
+  QCommandLineOption sizeOpt(QStringList() << "s" << "size", "Width and height of each gauge (default 250).", "pixels", "250");
+
+  parser.addOption(framesOpt);
+  parser.addOption(sizeOpt);
+  parser.process(app);
+
+  const int frames = qMax(1, parser.value(framesOpt).toInt());
+  const int size = qMax(50, parser.value(sizeOpt).toInt());
+
+  QWidget window;
+  QGridLayout *layout = new QGridLayout(&window);
+  ManoMeter *gauges[s_gaugeCount];
+
+  for (int i = 0; i < s_gaugeCount; i++)
+  {
+    const GaugeConfig& config = s_gauges[i];
+
+    gauges[i] = new ManoMeter(&window);
+    gauges[i]->setFixedSize(size, size);
+    gauges[i]->setMinimum(config.minimum);
+    gauges[i]->setMaximum(config.maximum);
+    gauges[i]->setSuffix(config.suffix);
+    gauges[i]->setNominal(config.nominal);
+    gauges[i]->setCritical(config.critical);
+    layout->addWidget(gauges[i], i / 2, i % 2);
+  }
+
+  window.show();
+  QApplication::processEvents();
+
+  out << "Redrawing " << size << "x" << size << " gauges, " << frames << " frames each" << Qt::endl << Qt::endl;
+  out << QString("%1 %2 %3 %4 %5 %6").arg("gauge", -18).arg("full cpu us", 12).arg("full wall us", 13)
+                                      .arg("region cpu us", 14).arg("region wall us", 15).arg("speedup", 8) << Qt::endl;
+
+  for (int i = 0; i < s_gaugeCount; i++)
+  {
+    const FrameCost full = runFrames(gauges[i], s_gauges[i], frames, true);
+    const FrameCost region = runFrames(gauges[i], s_gauges[i], frames, false);
+    const QString speedup = QString::number(full.cpuUsecs / qMax(0.001, region.cpuUsecs), 'f', 1) + "x";
+
+    out << QString("%1 %2 %3 %4 %5 %6").arg(s_gauges[i].name, -18)
+                                        .arg(full.cpuUsecs, 12, 'f', 1)
+                                        .arg(full.wallUsecs, 13, 'f', 1)
+                                        .arg(region.cpuUsecs, 14, 'f', 1)
+                                        .arg(region.wallUsecs, 15, 'f', 1)
+                                        .arg(speedup, 8) << Qt::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include "headlessrunner.h"
+
+/**
+ * Constructor. Creates a worker for each device, but doesn't connect yet.
+ */
+HeadlessRunner::HeadlessRunner(const Settings& settings, QObject *parent):
+QObject(parent), m_settings(settings), m_out(stdout), m_stopping(false)
+{
+  m_session = new SessionManager(this);
+  m_session->setPollRate(m_settings.pollRateHz);
+  m_session->setTemperatureUnits(m_settings.tempUnits);
+  m_session->setAutoReconnect(m_settings.autoReconnect);
+  m_session->setLogDirectory(m_settings.logDir);
+  m_session->setLogFlushPolicy(m_settings.flushMsecs, 64 * 1024);
+  m_session->setLogFormat(m_settings.logFormat);
+  m_session->setLogRotation(m_settings.rotateBytes, m_settings.rotateSecs, m_settings.compress);
+  m_session->setLogDurability(m_settings.journaled, m_settings.durability, 1000);
+  m_session->setRawCapture(m_settings.rawCapture);
+  m_session->setChangeOnlyLogging(m_settings.changeOnly, m_settings.deadband);
+  m_session->setTriggeredLogging(m_settings.triggered, m_settings.trigger);
+  m_session->setDevices(m_settings.devices);
+
+  connect(m_session, SIGNAL(failedToConnect(QString)), this, SLOT(onFailedToConnect(QString)));
+
+  foreach (QString id, m_session->deviceIds())
+  {
+    MEMSInterface *mems = m_session->getInterface(id);
+
+    mems->getReplayClock()->setSpeed(m_settings.replaySpeed);
+    connect(mems, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(mems, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(mems, SIGNAL(linkLost()), this, SLOT(onLinkLost()));
+    connect(mems, SIGNAL(linkRecovered(qint64,int)), this, SLOT(onLinkRecovered(qint64,int)));
+  }
+
+  m_retryTimer = new QTimer(this);
+  m_retryTimer->setSingleShot(true);
+  connect(m_retryTimer, SIGNAL(timeout()), this, SLOT(onRetryTimer()));
+}
+
+/**
+ * Opens the log files and starts connecting to the ECUs.
+ * @return True if the logs were opened; false otherwise
+ */
+bool HeadlessRunner::start()
+{
+  if (!m_session->openLogs(m_settings.logName))
+  {
+    message(QString(), "Failed to open log file " + m_session->getLastLogPath());
+    return false;
+  }
+
+  message(QString(), "Logging to " + m_session->getLastLogPath());
+  foreach (QString id, m_session->deviceIds())
+  {
+    const quint64 recovered = m_session->getLogStats(id).bytesRecovered;
+    if (recovered > 0)
+    {
+      message(id, QString("Discarded %1 damaged bytes from the end of the existing log").arg(recovered));
+    }
+  }
+  m_session->connectAll();
+  return true;
+}
+
+/**
+ * Closes the logs and stops all the worker threads.
+ */
+void HeadlessRunner::stop()
+{
+  if (m_stopping)
+  {
+    return;
+  }
+  m_stopping = true;
+  m_retryTimer->stop();
+
+  if (!m_session->shutdown(2000))
+  {
+    message(QString(), "Timed out waiting for a device to close");
+  }
+
+  if (m_settings.printStats)
+  {
+    foreach (QString id, m_session->deviceIds())
+    {
+      const LogWriter::Stats logStats = m_session->getLogStats(id);
+
+      m_out << id << ":" << Qt::endl << m_session->getInterface(id)->getLinkStats().toText() << Qt::endl;
+      m_out << QString("Log: %1 lines written, %2 dropped, %3 write errors, max queue depth %4 lines, %5 syncs")
+               .arg(logStats.linesWritten).arg(logStats.linesDropped)
+               .arg(logStats.writeErrors).arg(logStats.maxQueueDepth).arg(logStats.syncs) << Qt::endl;
+      if (m_settings.triggered)
+      {
+        m_out << QString("Triggers: %1").arg(m_session->getTriggerCount(id)) << Qt::endl;
+      }
+    }
+  }
+}
+
+/**
+ * Writes a timestamped status message, tagged with the device ID if
+ * there's more than one device.
+ */
+void HeadlessRunner::message(QString id, QString text)
+{
+  m_out << QDateTime::currentDateTime().toString("hh:mm:ss.zzz") << " ";
+  if (!id.isEmpty() && (m_settings.devices.count() > 1))
+  {
+    m_out << "[" << id << "] ";
+  }
+  m_out << text << Qt::endl;
+}
+
+void HeadlessRunner::onConnected()
+{
+  MEMSInterface *mems = qobject_cast<MEMSInterface*>(sender());
+  message(mems->getDeviceId(), "Connected to " + mems->getSerialDevice());
+}
+
+void HeadlessRunner::onFailedToConnect(QString dev)
+{
+  message(QString(), "Failed to connect to " + dev);
+  retryOrQuit();
+}
+
+/**
+ * Responds to a worker stopping. If this wasn't requested, the link has
+ * been lost for good (or automatic reconnection is turned off).
+ */
+void HeadlessRunner::onDisconnected()
+{
+  if (!m_stopping)
+  {
+    MEMSInterface *mems = qobject_cast<MEMSInterface*>(sender());
+    message(mems->getDeviceId(), "Disconnected from " + mems->getSerialDevice());
+    retryOrQuit();
+  }
+}
+
+void HeadlessRunner::onLinkLost()
+{
+  MEMSInterface *mems = qobject_cast<MEMSInterface*>(sender());
+  message(mems->getDeviceId(), "Link lost; reconnecting");
+}
+
+void HeadlessRunner::onLinkRecovered(qint64 outageMsecs, int attempts)
+{
+  MEMSInterface *mems = qobject_cast<MEMSInterface*>(sender());
+  message(mems->getDeviceId(), QString("Link recovered after %1 ms (%2 attempts)").arg(outageMsecs).arg(attempts));
+}
+
+/**
+ * Schedules another connection attempt, or exits if retrying is disabled.
+ */
+void HeadlessRunner::retryOrQuit()
+{
+  if (m_stopping)
+  {
+    return;
+  }
+
+  if (m_settings.retrySecs > 0)
+  {
+    if (!m_retryTimer->isActive())
+    {
+      m_retryTimer->start(m_settings.retrySecs * 1000);
+    }
+  }
+  else
+  {
+    QCoreApplication::exit(1);
+  }
+}
+
+/**
+ * Asks every worker that isn't connected to try again.
+ */
+void HeadlessRunner::onRetryTimer()
+{
+  m_session->connectAll();
+}
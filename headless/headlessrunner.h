@@ -0,0 +1,71 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+#include "sessionmanager.h"
+#include "commonunits.h"
+
+/**
+ * Reads from one or more ECUs and logs the data without any GUI. Status
+ * messages are written to stdout.
+ */
+class HeadlessRunner : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        QStringList devices;          // first one is the primary device
+        double pollRateHz;            // 0 for maximum
+        QString logDir;
+        QString logName;
+        TemperatureUnits tempUnits;
+        bool autoReconnect;
+        int retrySecs;                // 0 to give up if a connection fails
+        int flushMsecs;               // longest time log data is held in memory
+        Logger::Format logFormat;
+        qint64 rotateBytes;           // 0 for no size limit per log file
+        int rotateSecs;               // 0 for no time limit per log file
+        bool compress;                // gzip each log file once it's finished
+        bool journaled;               // write crash-safe journaled logs
+        LogWriter::Durability durability;
+        double replaySpeed;           // for replay: devices (0 for unpaced)
+        bool rawCapture;              // record raw serial traffic with the logs
+        bool changeOnly;              // log only values that change
+        LogDeadband deadband;
+        bool triggered;               // log only around events
+        EventTrigger::Settings trigger;
+        bool printStats;              // print link statistics when stopping
+    };
+
+    explicit HeadlessRunner(const Settings& settings, QObject *parent = 0);
+
+    bool start();
+
+public slots:
+    void stop();
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onFailedToConnect(QString dev);
+    void onLinkLost();
+    void onLinkRecovered(qint64 outageMsecs, int attempts);
+    void onRetryTimer();
+
+private:
+    Settings m_settings;
+    SessionManager *m_session;
+    QTimer *m_retryTimer;
+    QTextStream m_out;
+    bool m_stopping;
+
+    void message(QString id, QString text);
+    void retryOrQuit();
+};
+
+#endif // HEADLESSRUNNER_H
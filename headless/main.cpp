@@ -0,0 +1,156 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QTextStream>
+#include <QTimer>
+#include "headlessrunner.h"
+#include "terminationsignals.h"
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName(PROJECTNAME);
+  QTextStream err(stderr);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Reads data from one or more MEMS 1.6 ECUs and logs it, without a GUI.");
+  parser.addHelpOption();
+
+  QCommandLineOption deviceOpt(QStringList() << "d" << "device", "Serial device to read from (may be given more than once).", "dev");
+  QCommandLineOption rateOpt(QStringList() << "r" << "rate", "Polling rate in Hz; 0 for maximum (default 0).", "hz", "0");
+  QCommandLineOption dirOpt(QStringList() << "o" << "output-dir", "Directory for log files (default logs).", "dir", "logs");
+  QCommandLineOption nameOpt(QStringList() << "n" << "name", "Log file name, without extension (default: date and time).", "name");
+  QCommandLineOption celsiusOpt("celsius", "Log temperatures in Celsius rather than Fahrenheit.");
+  QCommandLineOption noReconnectOpt("no-reconnect", "Don't try to re-establish the link if it drops.");
+  QCommandLineOption retryOpt("retry", "If a connection fails, try again every <secs> seconds rather than exiting.", "secs", "0");
+  QCommandLineOption durationOpt("duration", "Stop after <secs> seconds.", "secs");
+  QCommandLineOption flushOpt("flush-interval", "Write log data to disk at least every <ms> milliseconds (default 1000).", "ms", "1000");
+  QCommandLineOption binaryOpt("binary", "Write compact binary logs (convert them to text with memslog2csv).");
+  QCommandLineOption rotateSizeOpt("rotate-size", "Start a new log file every <mb> megabytes.", "mb", "0");
+  QCommandLineOption rotateTimeOpt("rotate-time", "Start a new log file every <mins> minutes.", "mins", "0");
+  QCommandLineOption compressOpt("compress", "Gzip each log file once logging has moved on to the next one.");
+  QCommandLineOption journalOpt("journal", "Write journaled logs, which can be recovered after a power cut.");
+  QCommandLineOption syncOpt("sync", "When to sync logs to disk: none, periodic (every second) or block (after every write). Default none.", "when", "none");
+  QCommandLineOption replaySpeedOpt("replay-speed", "Speed to play replay: devices at, from 0.1 to 50 times real time, or 0 for one record per poll (default 1).", "x", "1");
+  QCommandLineOption captureOpt("capture", "Record the raw serial traffic of each device in the log directory, for replay with memsemu.");
+  QCommandLineOption changesOpt("changes-only", "Log a value only when it moves by more than its tolerance, with a full record every 10 seconds.");
+  QCommandLineOption deadbandOpt("deadband", "Tolerances for --changes-only, as a list such as engineSpeed=10,mainVoltage=0.1 (using the channel names in the log headers).", "list");
+  QCommandLineOption triggerOpt("trigger", "Log only around events: a new fault code, coolant over the --trigger-coolant limit, or engine speed over --trigger-rpm.");
+  QCommandLineOption preTriggerOpt("pre-trigger", "Seconds of data to log from before each event (default 30).", "secs", "30");
+  QCommandLineOption postTriggerOpt("post-trigger", "Seconds to keep logging after each event (default 30).", "secs", "30");
+  QCommandLineOption triggerCoolantOpt("trigger-coolant", "Coolant temperature that counts as an event, in the units being logged (default 98 C / 210 F).", "degrees");
+  QCommandLineOption triggerRpmOpt("trigger-rpm", "Engine speed that counts as an event (default none).", "rpm", "0");
+  QCommandLineOption statsOpt("stats", "Print link and log statistics on exit.");
+
+  parser.addOption(deviceOpt);
+  parser.addOption(rateOpt);
+  parser.addOption(dirOpt);
+  parser.addOption(nameOpt);
+  parser.addOption(celsiusOpt);
+  parser.addOption(noReconnectOpt);
+  parser.addOption(retryOpt);
+  parser.addOption(durationOpt);
+  parser.addOption(flushOpt);
+  parser.addOption(binaryOpt);
+  parser.addOption(rotateSizeOpt);
+  parser.addOption(rotateTimeOpt);
+  parser.addOption(compressOpt);
+  parser.addOption(journalOpt);
+  parser.addOption(syncOpt);
+  parser.addOption(replaySpeedOpt);
+  parser.addOption(captureOpt);
+  parser.addOption(changesOpt);
+  parser.addOption(deadbandOpt);
+  parser.addOption(triggerOpt);
+  parser.addOption(preTriggerOpt);
+  parser.addOption(postTriggerOpt);
+  parser.addOption(triggerCoolantOpt);
+  parser.addOption(triggerRpmOpt);
+  parser.addOption(statsOpt);
+  parser.process(app);
+
+  HeadlessRunner::Settings settings;
+  settings.devices = parser.values(deviceOpt);
+  settings.pollRateHz = parser.value(rateOpt).toDouble();
+  settings.logDir = parser.value(dirOpt);
+  settings.logName = parser.isSet(nameOpt) ? parser.value(nameOpt) :
+                     QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+  settings.tempUnits = parser.isSet(celsiusOpt) ? Celsius : Fahrenheit;
+  settings.autoReconnect = !parser.isSet(noReconnectOpt);
+  settings.retrySecs = parser.value(retryOpt).toInt();
+  settings.flushMsecs = parser.value(flushOpt).toInt();
+  settings.logFormat = parser.isSet(binaryOpt) ? Logger::BinaryFormat : Logger::TextFormat;
+  settings.rotateBytes = parser.value(rotateSizeOpt).toLongLong() * 1024 * 1024;
+  settings.rotateSecs = parser.value(rotateTimeOpt).toInt() * 60;
+  settings.compress = parser.isSet(compressOpt);
+  settings.journaled = parser.isSet(journalOpt);
+  if (parser.value(syncOpt) == "none")
+  {
+    settings.durability = LogWriter::NoSync;
+  }
+  else if (parser.value(syncOpt) == "periodic")
+  {
+    settings.durability = LogWriter::PeriodicSync;
+  }
+  else if (parser.value(syncOpt) == "block")
+  {
+    settings.durability = LogWriter::BlockSync;
+  }
+  else
+  {
+    err << "--sync must be none, periodic or block." << Qt::endl;
+    return 1;
+  }
+  settings.replaySpeed = parser.value(replaySpeedOpt).toDouble();
+  settings.rawCapture = parser.isSet(captureOpt);
+  settings.changeOnly = parser.isSet(changesOpt) || parser.isSet(deadbandOpt);
+  settings.deadband = LogDeadband::defaults();
+  if (parser.isSet(deadbandOpt))
+  {
+    QString error;
+    if (!settings.deadband.parse(parser.value(deadbandOpt), error))
+    {
+      err << error << Qt::endl;
+      return 1;
+    }
+  }
+  settings.triggered = parser.isSet(triggerOpt);
+  settings.trigger.newFault = true;
+  settings.trigger.coolantLimitC = EventTrigger::s_defaultCoolantLimitC;
+  if (parser.isSet(triggerCoolantOpt))
+  {
+    const int degrees = parser.value(triggerCoolantOpt).toInt();
+    settings.trigger.coolantLimitC = (settings.tempUnits == Celsius) ? degrees : (int)((degrees - 32) / 1.8);
+  }
+  settings.trigger.rpmLimit = parser.value(triggerRpmOpt).toInt();
+  settings.trigger.preTriggerSecs = parser.value(preTriggerOpt).toInt();
+  settings.trigger.postTriggerSecs = parser.value(postTriggerOpt).toInt();
+  settings.printStats = parser.isSet(statsOpt);
+
+  if (settings.devices.isEmpty())
+  {
+    err << "At least one device must be given with --device." << Qt::endl;
+    return 1;
+  }
+
+  HeadlessRunner runner(settings);
+  QObject::connect(&app, SIGNAL(aboutToQuit()), &runner, SLOT(stop()));
+
+  if (!runner.start())
+  {
+    return 1;
+  }
+
+  if (parser.isSet(durationOpt))
+  {
+    QTimer::singleShot(parser.value(durationOpt).toInt() * 1000, &app, SLOT(quit()));
+  }
+
+  if (!installTerminationHandlers(app))
+  {
+    err << "Unable to install the signal handlers." << Qt::endl;
+    return 1;
+  }
+
+  return app.exec();
+}
@@ -0,0 +1,277 @@
+#include <string.h>
+#include <zlib.h>
+#include "journal.h"
+
+const char Journal::s_fileMagic[8] = { 'M', 'E', 'M', 'S', 'J', 'N', 'L', 0 };
+const char Journal::s_blockMagic[4] = { 'J', 'B', 'L', 'K' };
+
+namespace
+{
+  // anything longer than this is taken to be a corrupt length field
+  const quint32 s_maxBlockSize = 64 * 1024 * 1024;
+
+  void putLE32(char *p, quint32 value)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      p[i] = (char)((value >> (i * 8)) & 0xFF);
+    }
+  }
+
+  quint32 getLE32(const char *p)
+  {
+    const uchar *u = (const uchar*)p;
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((quint32)u[3] << 24);
+  }
+
+  quint32 checksum(const char *data, int length)
+  {
+    return (quint32)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data, (uInt)length);
+  }
+
+  /**
+   * Reads and checks one block from the device's current position.
+   * @return True if a complete, intact block was read
+   */
+  bool readBlock(QIODevice *dev, QByteArray& payload)
+  {
+    char header[Journal::s_blockHeaderSize];
+
+    if ((dev->read(header, sizeof(header)) != (qint64)sizeof(header)) ||
+        (memcmp(header, Journal::s_blockMagic, sizeof(Journal::s_blockMagic)) != 0))
+    {
+      return false;
+    }
+
+    const quint32 length = getLE32(header + 4);
+    if (length > s_maxBlockSize)
+    {
+      return false;
+    }
+
+    payload.resize(length);
+    return (dev->read(payload.data(), length) == (qint64)length) &&
+           (checksum(payload.constData(), length) == getLE32(header + 8));
+  }
+}
+
+/**
+ * Returns the header written at the start of a new journaled file.
+ */
+QByteArray Journal::fileHeader()
+{
+  QByteArray header(s_fileMagic, sizeof(s_fileMagic));
+
+  header.append((char)(s_version & 0xFF));
+  header.append((char)(s_version >> 8));
+  header.append((char)0);
+  header.append((char)0);
+  return header;
+}
+
+/**
+ * Fills in the header for a block.
+ * @param header Buffer of s_blockHeaderSize bytes
+ * @param payload Data the block will hold
+ * @param length Length of the data
+ */
+void Journal::blockHeader(char *header, const char *payload, int length)
+{
+  memcpy(header, s_blockMagic, sizeof(s_blockMagic));
+  putLE32(header + 4, length);
+  putLE32(header + 8, checksum(payload, length));
+}
+
+/**
+ * Returns true if the file exists and starts with the journal header.
+ */
+bool Journal::isJournal(QString path)
+{
+  QFile file(path);
+  char magic[sizeof(s_fileMagic)];
+
+  return file.open(QFile::ReadOnly) &&
+         (file.read(magic, sizeof(magic)) == (qint64)sizeof(magic)) &&
+         (memcmp(magic, s_fileMagic, sizeof(magic)) == 0);
+}
+
+/**
+ * Walks through a journal from the start, checking every block.
+ * @param dev Device positioned at the start of the journal
+ * @param blocks Set to the number of good blocks (if not null)
+ * @return Offset just past the last good block, or -1 if the device
+ *  doesn't hold a journal
+ */
+qint64 Journal::scan(QIODevice *dev, quint64 *blocks)
+{
+  char header[s_fileHeaderSize];
+  QByteArray payload;
+  quint64 count = 0;
+  qint64 end = s_fileHeaderSize;
+
+  if ((dev->read(header, sizeof(header)) != (qint64)sizeof(header)) ||
+      (memcmp(header, s_fileMagic, sizeof(s_fileMagic)) != 0))
+  {
+    return -1;
+  }
+
+  while (readBlock(dev, payload))
+  {
+    end += s_blockHeaderSize + payload.size();
+    count++;
+  }
+
+  if (blocks)
+  {
+    *blocks = count;
+  }
+  return end;
+}
+
+/**
+ * Makes an existing journal safe to append to, by cutting off anything
+ * after the last good block (such as a block that was only partly written
+ * when the power went off). A file that holds only the start of a header
+ * is truncated to nothing.
+ * @param bytesDiscarded Set to the number of bytes removed (if not null)
+ * @return False if the file couldn't be opened or isn't a journal
+ */
+bool Journal::recover(QString path, qint64 *bytesDiscarded)
+{
+  QFile file(path);
+
+  if (!file.open(QFile::ReadWrite))
+  {
+    return false;
+  }
+
+  const qint64 size = file.size();
+
+  // the file header itself may have been only partly written; if so, the
+  // file is emptied and the writer starts it again
+  if (size < s_fileHeaderSize)
+  {
+    const QByteArray header = fileHeader();
+
+    if (!header.startsWith(file.read(size)))
+    {
+      return false;
+    }
+    if (bytesDiscarded)
+    {
+      *bytesDiscarded = size;
+    }
+    return file.resize(0);
+  }
+
+  const qint64 end = scan(&file);
+
+  if (end < 0)
+  {
+    return false;
+  }
+
+  if (bytesDiscarded)
+  {
+    *bytesDiscarded = size - end;
+  }
+
+  return (end == size) || file.resize(end);
+}
+
+/**
+ * Constructor.
+ */
+JournalReader::JournalReader(QObject *parent):
+QIODevice(parent), m_blockPos(0), m_damaged(false)
+{
+}
+
+/**
+ * Destructor.
+ */
+JournalReader::~JournalReader()
+{
+  close();
+}
+
+/**
+ * Opens a journaled log for reading.
+ * @return False if the file couldn't be opened or isn't a journal
+ */
+bool JournalReader::openJournal(QString path)
+{
+  char header[Journal::s_fileHeaderSize];
+
+  close();
+  m_file.setFileName(path);
+
+  if (!m_file.open(QFile::ReadOnly) ||
+      (m_file.read(header, sizeof(header)) != (qint64)sizeof(header)) ||
+      (memcmp(header, Journal::s_fileMagic, sizeof(Journal::s_fileMagic)) != 0))
+  {
+    m_file.close();
+    return false;
+  }
+
+  m_block.clear();
+  m_blockPos = 0;
+  m_damaged = false;
+  return QIODevice::open(QIODevice::ReadOnly);
+}
+
+void JournalReader::close()
+{
+  QIODevice::close();
+  m_file.close();
+}
+
+/**
+ * Moves on to the next good block.
+ * @return False at the end of the journal
+ */
+bool JournalReader::nextBlock()
+{
+  m_blockPos = 0;
+
+  if (m_file.atEnd())
+  {
+    m_block.clear();
+    return false;
+  }
+
+  if (!readBlock(&m_file, m_block))
+  {
+    // a damaged block ends the journal, just as recovery would
+    m_damaged = true;
+    m_block.clear();
+    return false;
+  }
+
+  return true;
+}
+
+qint64 JournalReader::readData(char *data, qint64 maxSize)
+{
+  qint64 copied = 0;
+
+  while (copied < maxSize)
+  {
+    if ((m_blockPos >= m_block.size()) && !nextBlock())
+    {
+      break;
+    }
+
+    const qint64 count = qMin(maxSize - copied, (qint64)(m_block.size() - m_blockPos));
+    memcpy(data + copied, m_block.constData() + m_blockPos, count);
+    m_blockPos += count;
+    copied += count;
+  }
+
+  return copied;
+}
+
+qint64 JournalReader::writeData(const char *, qint64)
+{
+  return -1;
+}
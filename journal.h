@@ -0,0 +1,68 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+
+/**
+ * Crash-safe container for log files.
+ *
+ * A journaled log starts with a 12-byte header (the magic "MEMSJNL\0",
+ * then a 16-bit version and 16 reserved bits) followed by blocks. Each
+ * block is a 12-byte header (the magic "JBLK", the payload length, and the
+ * CRC-32 of the payload, all little-endian 32-bit values) and the payload.
+ * The writer only ever puts whole log records in a block, so the payloads
+ * joined together are an ordinary text or binary log.
+ *
+ * If power is lost part way through a write, the last block is short or
+ * fails its checksum. scan() finds the end of the last good block, and
+ * recover() truncates the file there before more blocks are appended.
+ */
+class Journal
+{
+public:
+    static const quint16 s_version = 1;
+    static const int s_fileHeaderSize = 12;
+    static const int s_blockHeaderSize = 12;
+    static const char s_fileMagic[8];
+    static const char s_blockMagic[4];
+
+    static QByteArray fileHeader();
+    static void blockHeader(char *header, const char *payload, int length);
+    static bool isJournal(QString path);
+    static qint64 scan(QIODevice *dev, quint64 *blocks = 0);
+    static bool recover(QString path, qint64 *bytesDiscarded = 0);
+};
+
+/**
+ * Presents the payloads of a journaled log as one continuous, read-only
+ * stream. Reading stops at the end of the last good block.
+ */
+class JournalReader : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit JournalReader(QObject *parent = 0);
+    ~JournalReader();
+
+    bool openJournal(QString path);
+    void close();
+    bool isSequential() const { return true; }
+    bool damaged() const { return m_damaged; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private:
+    QFile m_file;
+    QByteArray m_block;
+    int m_blockPos;
+    bool m_damaged;
+
+    bool nextBlock();
+};
+
+#endif // JOURNAL_H
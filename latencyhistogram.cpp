@@ -0,0 +1,164 @@
+#include <string.h>
+#include <QtAlgorithms>
+#include "latencyhistogram.h"
+
+/**
+ * Constructor. Starts with all buckets empty.
+ */
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+/**
+ * Empties all the buckets.
+ */
+void LatencyHistogram::reset()
+{
+  memset(m_buckets, 0, sizeof(m_buckets));
+  m_count = 0;
+  m_sum = 0;
+  m_min = 0;
+  m_max = 0;
+}
+
+/**
+ * Finds the bucket that holds a value. Values below 16us each get their own
+ * bucket; above that, the position of the most significant bit selects the
+ * group and the next four bits select the bucket within it.
+ */
+int LatencyHistogram::indexOf(qint64 usecs)
+{
+  if (usecs < s_subBucketCount)
+  {
+    return (usecs < 0) ? 0 : (int)usecs;
+  }
+
+  const quint64 value = qMin((quint64)usecs, (Q_UINT64_C(1) << s_maxValueBits) - 1);
+  const int msb = 63 - (int)qCountLeadingZeroBits(value);
+  const int shift = msb - s_subBucketBits;
+
+  return ((shift + 1) * s_subBucketCount) + (int)((value >> shift) - s_subBucketCount);
+}
+
+/**
+ * Returns the smallest value that is counted in the given bucket.
+ */
+qint64 LatencyHistogram::bucketLowerBound(int index)
+{
+  if (index < s_subBucketCount)
+  {
+    return index;
+  }
+
+  const int shift = (index / s_subBucketCount) - 1;
+  const int sub = index % s_subBucketCount;
+
+  return (qint64)(sub + s_subBucketCount) << shift;
+}
+
+/**
+ * Returns the largest value that is counted in the given bucket.
+ */
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+  return bucketLowerBound(index + 1) - 1;
+}
+
+/**
+ * Adds a value to the histogram.
+ * @param usecs Duration in microseconds
+ */
+void LatencyHistogram::record(qint64 usecs)
+{
+  m_buckets[indexOf(usecs)]++;
+
+  if ((m_count == 0) || (usecs < m_min))
+  {
+    m_min = usecs;
+  }
+  if (usecs > m_max)
+  {
+    m_max = usecs;
+  }
+
+  m_count++;
+  m_sum += usecs;
+}
+
+/**
+ * Adds the contents of another histogram to this one.
+ */
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+  if (other.m_count == 0)
+  {
+    return;
+  }
+
+  for (int i = 0; i < s_numBuckets; i++)
+  {
+    m_buckets[i] += other.m_buckets[i];
+  }
+
+  m_min = (m_count > 0) ? qMin(m_min, other.m_min) : other.m_min;
+  m_max = qMax(m_max, other.m_max);
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+}
+
+/**
+ * Returns the mean of the recorded values, in microseconds.
+ */
+double LatencyHistogram::mean() const
+{
+  return (m_count > 0) ? ((double)m_sum / m_count) : 0.0;
+}
+
+/**
+ * Returns the value below which the given percentage of the recorded
+ * values fall. The result is the upper bound of the bucket that contains
+ * that value, but is never more than the largest value recorded.
+ * @param pct Percentile, from 0 to 100
+ */
+qint64 LatencyHistogram::percentile(double pct) const
+{
+  if (m_count == 0)
+  {
+    return 0;
+  }
+
+  const quint64 target = qMax((quint64)1, (quint64)((qBound(0.0, pct, 100.0) / 100.0) * m_count + 0.5));
+  quint64 seen = 0;
+
+  for (int i = 0; i < s_numBuckets; i++)
+  {
+    seen += m_buckets[i];
+    if (seen >= target)
+    {
+      return qBound(m_min, bucketUpperBound(i), m_max);
+    }
+  }
+
+  return m_max;
+}
+
+/**
+ * Returns a one-line summary of the distribution, with values in
+ * milliseconds.
+ */
+QString LatencyHistogram::summary() const
+{
+  if (m_count == 0)
+  {
+    return QString("no samples");
+  }
+
+  return QString("n=%1 min=%2 p50=%3 p90=%4 p99=%5 max=%6 ms")
+    .arg(m_count)
+    .arg(min() / 1000.0, 0, 'f', 1)
+    .arg(percentile(50.0) / 1000.0, 0, 'f', 1)
+    .arg(percentile(90.0) / 1000.0, 0, 'f', 1)
+    .arg(percentile(99.0) / 1000.0, 0, 'f', 1)
+    .arg(max() / 1000.0, 0, 'f', 1);
+}
@@ -0,0 +1,51 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+#include <QString>
+
+/**
+ * Histogram of durations in microseconds, with a fixed set of log-linear
+ * buckets (in the style of HdrHistogram). Each power-of-two range is split
+ * into 16 equal sub-buckets, so any recorded value is known to within about
+ * 6%, from 1us up to a bit over an hour. Recording a value is a few integer
+ * operations and never allocates.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 usecs);
+    void reset();
+    void merge(const LatencyHistogram& other);
+
+    quint64 count() const { return m_count; }
+    qint64 min() const    { return (m_count > 0) ? m_min : 0; }
+    qint64 max() const    { return m_max; }
+    double mean() const;
+    qint64 percentile(double pct) const;
+
+    int bucketCount() const { return s_numBuckets; }
+    quint64 bucketValue(int index) const { return m_buckets[index]; }
+    static qint64 bucketLowerBound(int index);
+    static qint64 bucketUpperBound(int index);
+
+    QString summary() const;
+
+private:
+    static const int s_subBucketBits = 4;
+    static const int s_subBucketCount = 1 << s_subBucketBits;
+    static const int s_maxValueBits = 32;
+    static const int s_numBuckets = (s_maxValueBits - s_subBucketBits + 1) * s_subBucketCount;
+
+    quint64 m_buckets[s_numBuckets];
+    quint64 m_count;
+    qint64 m_sum;
+    qint64 m_min;
+    qint64 m_max;
+
+    static int indexOf(qint64 usecs);
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,170 @@
+#include "linkstats.h"
+
+/**
+ * Constructor.
+ */
+LinkStats::LinkStats()
+{
+  reset();
+}
+
+/**
+ * Clears all the measurements and restarts the clock.
+ */
+void LinkStats::reset()
+{
+  m_readLatency.reset();
+  m_commandLatency.reset();
+  m_sampleInterval.reset();
+  m_intervalJitter.reset();
+  m_recoveryTime.reset();
+
+  m_lastSampleUsecs = -1;
+  m_lastIntervalUsecs = -1;
+
+  m_reads = 0;
+  m_readErrors = 0;
+  m_readTimeouts = 0;
+  m_commands = 0;
+  m_commandErrors = 0;
+  m_reconnects = 0;
+  m_achievedRateHz = 0.0;
+
+  m_clock.start();
+}
+
+/**
+ * Records the outcome of a data read. Successful reads also update the
+ * inter-sample interval, and the jitter (the change in interval from one
+ * sample to the next).
+ * @param startUsecs Time at which the read was started (from nowUsecs())
+ * @param success True if the read returned valid data
+ */
+void LinkStats::recordRead(qint64 startUsecs, bool success)
+{
+  const qint64 now = nowUsecs();
+  const qint64 latency = now - startUsecs;
+
+  m_reads++;
+  m_readLatency.record(latency);
+
+  if (!success)
+  {
+    m_readErrors++;
+    if (latency >= s_timeoutUsecs)
+    {
+      m_readTimeouts++;
+    }
+    return;
+  }
+
+  if (m_lastSampleUsecs >= 0)
+  {
+    const qint64 interval = now - m_lastSampleUsecs;
+
+    m_sampleInterval.record(interval);
+    if (m_lastIntervalUsecs >= 0)
+    {
+      m_intervalJitter.record(qAbs(interval - m_lastIntervalUsecs));
+    }
+    m_lastIntervalUsecs = interval;
+  }
+  m_lastSampleUsecs = now;
+}
+
+/**
+ * Records the outcome of an actuator, IAC, or fault-clearing command.
+ * @param startUsecs Time at which the command was started (from nowUsecs())
+ * @param success True if the ECU acknowledged the command
+ */
+void LinkStats::recordCommand(qint64 startUsecs, bool success)
+{
+  m_commands++;
+  m_commandLatency.record(nowUsecs() - startUsecs);
+
+  if (!success)
+  {
+    m_commandErrors++;
+  }
+}
+
+/**
+ * Records a successful reconnect after the link dropped.
+ * @param outageUsecs Time from losing the link to getting it back
+ */
+void LinkStats::recordReconnect(qint64 outageUsecs)
+{
+  m_reconnects++;
+  m_recoveryTime.record(outageUsecs);
+}
+
+/**
+ * Returns the average number of successful reads per second since the
+ * measurements were last reset.
+ */
+double LinkStats::averageRate() const
+{
+  const qint64 elapsed = nowUsecs();
+
+  return (elapsed > 0) ? ((m_reads - m_readErrors) * 1000000.0 / elapsed) : 0.0;
+}
+
+/**
+ * Returns a human-readable summary of the measurements.
+ */
+QString LinkStats::toText() const
+{
+  QString text;
+
+  text += QString("Reads: %1 (%2 errors, %3 timeouts)\n").arg(m_reads).arg(m_readErrors).arg(m_readTimeouts);
+  text += QString("Commands: %1 (%2 errors)\n").arg(m_commands).arg(m_commandErrors);
+  text += QString("Reconnects: %1\n").arg(m_reconnects);
+  text += QString("Samples/sec: %1 (average %2)\n")
+    .arg(m_achievedRateHz, 0, 'f', 1).arg(averageRate(), 0, 'f', 1);
+  text += "Read latency: " + m_readLatency.summary() + "\n";
+  text += "Command latency: " + m_commandLatency.summary() + "\n";
+  text += "Sample interval: " + m_sampleInterval.summary() + "\n";
+  text += "Interval jitter: " + m_intervalJitter.summary() + "\n";
+  text += "Time to recover: " + m_recoveryTime.summary();
+
+  return text;
+}
+
+/**
+ * Returns the measurements as CSV: the counters as comment lines, followed
+ * by one row for each non-empty histogram bucket.
+ */
+QString LinkStats::toCsv() const
+{
+  QString csv;
+
+  csv += QString("#reads=%1,readErrors=%2,readTimeouts=%3,commands=%4,commandErrors=%5,reconnects=%6,samplesPerSec=%7\n")
+    .arg(m_reads).arg(m_readErrors).arg(m_readTimeouts).arg(m_commands)
+    .arg(m_commandErrors).arg(m_reconnects).arg(averageRate(), 0, 'f', 2);
+  csv += "#histogram,lower_us,upper_us,count\n";
+
+  appendCsv(csv, "readLatency", m_readLatency);
+  appendCsv(csv, "commandLatency", m_commandLatency);
+  appendCsv(csv, "sampleInterval", m_sampleInterval);
+  appendCsv(csv, "intervalJitter", m_intervalJitter);
+  appendCsv(csv, "recoveryTime", m_recoveryTime);
+
+  return csv;
+}
+
+/**
+ * Appends the non-empty buckets of a histogram to a CSV string.
+ */
+void LinkStats::appendCsv(QString& csv, QString name, const LatencyHistogram& hist) const
+{
+  for (int i = 0; i < hist.bucketCount(); i++)
+  {
+    if (hist.bucketValue(i) > 0)
+    {
+      csv += QString("%1,%2,%3,%4\n").arg(name)
+        .arg(LatencyHistogram::bucketLowerBound(i))
+        .arg(LatencyHistogram::bucketUpperBound(i))
+        .arg(hist.bucketValue(i));
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef LINKSTATS_H
+#define LINKSTATS_H
+
+#include <QString>
+#include <QElapsedTimer>
+#include "latencyhistogram.h"
+
+/**
+ * Measurements of the quality of the serial link to the ECU: how long each
+ * read and command took, how regularly samples arrived, how many calls
+ * failed, and how long the link took to recover after each dropout. All of the recording is done on the interface thread; other
+ * threads should work with a copy (see MEMSInterface::getLinkStats()).
+ */
+class LinkStats
+{
+public:
+    LinkStats();
+
+    void reset();
+    qint64 nowUsecs() const { return m_clock.nsecsElapsed() / 1000; }
+
+    void recordRead(qint64 startUsecs, bool success);
+    void recordCommand(qint64 startUsecs, bool success);
+    void recordReconnect(qint64 outageUsecs);
+    void setAchievedRate(double hz) { m_achievedRateHz = hz; }
+
+    const LatencyHistogram& readLatency() const    { return m_readLatency; }
+    const LatencyHistogram& commandLatency() const { return m_commandLatency; }
+    const LatencyHistogram& sampleInterval() const { return m_sampleInterval; }
+    const LatencyHistogram& intervalJitter() const { return m_intervalJitter; }
+    const LatencyHistogram& recoveryTime() const   { return m_recoveryTime; }
+
+    quint64 reads() const         { return m_reads; }
+    quint64 readErrors() const    { return m_readErrors; }
+    quint64 readTimeouts() const  { return m_readTimeouts; }
+    quint64 commands() const      { return m_commands; }
+    quint64 commandErrors() const { return m_commandErrors; }
+    quint64 reconnects() const    { return m_reconnects; }
+    double achievedRate() const   { return m_achievedRateHz; }
+    double averageRate() const;
+
+    QString toText() const;
+    QString toCsv() const;
+
+private:
+    QElapsedTimer m_clock;
+
+    LatencyHistogram m_readLatency;
+    LatencyHistogram m_commandLatency;
+    LatencyHistogram m_sampleInterval;
+    LatencyHistogram m_intervalJitter;
+    LatencyHistogram m_recoveryTime;
+
+    qint64 m_lastSampleUsecs;
+    qint64 m_lastIntervalUsecs;
+
+    quint64 m_reads;
+    quint64 m_readErrors;
+    quint64 m_readTimeouts;
+    quint64 m_commands;
+    quint64 m_commandErrors;
+    quint64 m_reconnects;
+    double m_achievedRateHz;
+
+    // a failed read that took at least this long is assumed to have run
+    // into the serial timeout, rather than having received a bad response
+    static const qint64 s_timeoutUsecs = 500000;
+
+    void appendCsv(QString& csv, QString name, const LatencyHistogram& hist) const;
+};
+
+#endif // LINKSTATS_H
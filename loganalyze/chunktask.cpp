@@ -0,0 +1,102 @@
+#include "chunktask.h"
+#include "csvdecoder.h"
+#include "csvformat.h"
+#include "binarylog.h"
+
+/**
+ * Constructor.
+ * @param result Receives the summary; must stay valid until the task has run
+ */
+TextChunkTask::TextChunkTask(const char *begin, const char *end, TemperatureUnits units,
+                             const AnalysisSettings& settings, SessionStats *result):
+m_begin(begin), m_end(end), m_units(units), m_settings(settings), m_result(result)
+{
+}
+
+void TextChunkTask::run()
+{
+  CsvDecoder decoder;
+  CsvDecoder::Record record;
+  CsvDecoder::LineType type;
+  SessionStats::Sample sample;
+
+  decoder.setData(m_begin, m_end);
+  while ((type = decoder.next(record)) != CsvDecoder::EndOfData)
+  {
+    switch (type)
+    {
+    case CsvDecoder::SampleLine:
+      sample.timeMs = record.timeOfDayMs;
+      sample.rpm = record.data.engine_rpm;
+      sample.mapKpa = record.data.map_kpa;
+      sample.coolantC = CsvFormat::celsiusTemp(record.data.coolant_temp_c, m_units);
+      sample.idleSwitch = record.data.idle_switch;
+      sample.closedLoop = record.data.closed_loop;
+      sample.faults = 0;
+      m_result->add(sample, m_settings);
+      break;
+    case CsvDecoder::CommentLine:
+      m_result->addComment();
+      break;
+    case CsvDecoder::BadLine:
+      m_result->addBadLine();
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/**
+ * Constructor.
+ * @param result Receives the summary; must stay valid until the task has run
+ * @param error Receives a description of any problem reading the file
+ */
+BinaryChunkTask::BinaryChunkTask(QString path, qint64 begin, qint64 end, const AnalysisSettings& settings,
+                                 SessionStats *result, QString *error):
+m_path(path), m_begin(begin), m_end(end), m_settings(settings), m_result(result), m_error(error)
+{
+}
+
+void BinaryChunkTask::run()
+{
+  BinaryLogReader reader;
+  BinaryLogRecord record;
+  SessionStats::Sample sample;
+
+  if (!reader.open(m_path))
+  {
+    *m_error = reader.errorString();
+    return;
+  }
+
+  if ((m_begin >= 0) && !reader.seek(m_begin))
+  {
+    *m_error = QString("unable to seek to offset %1").arg(m_begin);
+    return;
+  }
+
+  while (((m_end < 0) || (reader.position() < m_end)) && reader.next(record))
+  {
+    if (record.type == BinaryLogRecord::Comment)
+    {
+      m_result->addComment();
+      continue;
+    }
+
+    sample.timeMs = record.timestampMs;
+    sample.rpm = record.data.engine_rpm;
+    sample.mapKpa = record.data.map_kpa;
+    sample.coolantC = record.data.coolant_temp_c;
+    sample.idleSwitch = record.data.idle_switch;
+    sample.closedLoop = record.data.closed_loop;
+    sample.faults = record.data.fault_codes;
+    m_result->add(sample, m_settings);
+  }
+
+  // a truncated final record is expected if the logger was interrupted
+  if (!reader.errorString().isEmpty() && !reader.truncated())
+  {
+    *m_error = reader.errorString();
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef CHUNKTASK_H
+#define CHUNKTASK_H
+
+#include <QRunnable>
+#include <QString>
+#include "commonunits.h"
+#include "sessionstats.h"
+
+/**
+ * Summarises the lines of a text log between two positions in memory. The
+ * range must start at the beginning of a line and end just after a newline
+ * (or at the end of the file).
+ */
+class TextChunkTask : public QRunnable
+{
+public:
+    TextChunkTask(const char *begin, const char *end, TemperatureUnits units,
+                  const AnalysisSettings& settings, SessionStats *result);
+    void run();
+
+private:
+    const char *m_begin;
+    const char *m_end;
+    TemperatureUnits m_units;
+    AnalysisSettings m_settings;
+    SessionStats *m_result;
+};
+
+/**
+ * Summarises the records of a binary log between two file offsets. Each
+ * task reads the file independently, so a chunk other than the first must
+ * start at a keyframe (i.e. at an offset taken from the log's index).
+ */
+class BinaryChunkTask : public QRunnable
+{
+public:
+    BinaryChunkTask(QString path, qint64 begin, qint64 end, const AnalysisSettings& settings,
+                    SessionStats *result, QString *error);
+    void run();
+
+private:
+    QString m_path;
+    qint64 m_begin;     // -1 to start at the beginning
+    qint64 m_end;       // -1 to read to the end
+    AnalysisSettings m_settings;
+    SessionStats *m_result;
+    QString *m_error;
+};
+
+#endif // CHUNKTASK_H
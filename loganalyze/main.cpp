@@ -0,0 +1,357 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <string.h>
+#include "binarylog.h"
+#include "chunktask.h"
+#include "journal.h"
+#include "logindex.h"
+#include "sessionstats.h"
+
+/**
+ * A log being analysed, along with the summaries of its chunks.
+ */
+struct LogFile
+{
+    QString path;
+    bool binary;
+    QFile file;
+    uchar *map;
+    QByteArray data;        // contents of a text log that couldn't be mapped
+    qint64 size;
+    QVector<SessionStats> chunks;
+    QVector<QString> errors;
+
+    LogFile(): binary(false), map(0), size(0) {}
+};
+
+/**
+ * Checks whether a log (plain or journaled) is in the binary format.
+ */
+static bool isBinaryLog(QString path)
+{
+  const QByteArray magic(BinaryLog::s_magic, sizeof(BinaryLog::s_magic));
+
+  if (Journal::isJournal(path))
+  {
+    JournalReader journal;
+    return journal.openJournal(path) && (journal.peek(magic.size()) == magic);
+  }
+
+  QFile file(path);
+  return file.open(QFile::ReadOnly) && (file.peek(magic.size()) == magic);
+}
+
+/**
+ * Expands the paths given on the command line: directories are replaced by
+ * the logs they contain, in name order.
+ */
+static QStringList findLogs(QStringList args)
+{
+  const QStringList filters = QStringList() << "*.txt" << "*.txt.jnl" << "*.mlog" << "*.mlog.jnl";
+  QStringList paths;
+
+  foreach (QString arg, args)
+  {
+    if (QFileInfo(arg).isDir())
+    {
+      const QDir dir(arg);
+      foreach (QString name, dir.entryList(filters, QDir::Files, QDir::Name))
+      {
+        paths.append(dir.filePath(name));
+      }
+    }
+    else
+    {
+      paths.append(arg);
+    }
+  }
+  return paths;
+}
+
+/**
+ * Divides a text log into chunks of roughly the given size, each ending
+ * just after a newline, and queues a task for each.
+ */
+static bool planTextLog(LogFile *log, qint64 chunkBytes, TemperatureUnits units,
+                        const AnalysisSettings& settings, QList<QRunnable*>& tasks)
+{
+  const char *text;
+
+  if (Journal::isJournal(log->path))
+  {
+    JournalReader journal;
+    if (!journal.openJournal(log->path))
+    {
+      return false;
+    }
+    log->data = journal.readAll();
+  }
+  else
+  {
+    log->file.setFileName(log->path);
+    if (!log->file.open(QFile::ReadOnly))
+    {
+      return false;
+    }
+    log->map = (log->file.size() > 0) ? log->file.map(0, log->file.size()) : 0;
+    if (!log->map)
+    {
+      log->data = log->file.readAll();
+    }
+  }
+
+  text = log->map ? (const char*)log->map : log->data.constData();
+  log->size = log->map ? log->file.size() : log->data.size();
+
+  QVector<qint64> bounds;
+  qint64 pos = 0;
+
+  bounds.append(0);
+  while ((log->size - pos) > chunkBytes)
+  {
+    const char *newline = (const char*)memchr(text + pos + chunkBytes, '\n', log->size - pos - chunkBytes);
+    if (!newline)
+    {
+      break;
+    }
+    pos = (newline - text) + 1;
+    bounds.append(pos);
+  }
+  bounds.append(log->size);
+
+  log->chunks.fill(SessionStats(true), bounds.count() - 1);
+  log->errors.resize(bounds.count() - 1);
+  for (int i = 0; i < log->chunks.count(); i++)
+  {
+    tasks.append(new TextChunkTask(text + bounds.at(i), text + bounds.at(i + 1), units,
+                                   settings, &log->chunks[i]));
+  }
+  return true;
+}
+
+/**
+ * Divides a binary log into chunks of roughly the given size, starting at
+ * keyframes listed in its index, and queues a task for each. Logs without
+ * an index (including all journaled logs) are read as a single chunk.
+ */
+static void planBinaryLog(LogFile *log, qint64 chunkBytes, const AnalysisSettings& settings,
+                          QList<QRunnable*>& tasks)
+{
+  QVector<qint64> bounds;
+  LogIndex index;
+
+  log->size = QFileInfo(log->path).size();
+  bounds.append(-1);
+
+  if (!Journal::isJournal(log->path) && index.open(log->path))
+  {
+    qint64 chunkStart = 0;
+
+    for (int i = 0; i < index.count(); i++)
+    {
+      const qint64 offset = index.offsetAt(i);
+
+      if ((offset >= log->size) || (offset <= chunkStart))
+      {
+        continue;
+      }
+      if ((offset - chunkStart) >= chunkBytes)
+      {
+        bounds.append(offset);
+        chunkStart = offset;
+      }
+    }
+  }
+  bounds.append(-1);
+
+  log->chunks.fill(SessionStats(false), bounds.count() - 1);
+  log->errors.resize(bounds.count() - 1);
+  for (int i = 0; i < log->chunks.count(); i++)
+  {
+    tasks.append(new BinaryChunkTask(log->path, bounds.at(i), bounds.at(i + 1), settings,
+                                     &log->chunks[i], &log->errors[i]));
+  }
+}
+
+/**
+ * Summarises logs (text or binary, plain or journaled) on a pool of
+ * threads. Each file is divided into chunks that are analysed in parallel,
+ * and the chunk summaries are then merged in order, so a directory full of
+ * logs is read in a single pass at close to the combined speed of all the
+ * cores. The result is a JSON document with one summary per file.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("memsloganalyze");
+  QTextStream err(stderr);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Summarises MEMS logs: engine speed and MAP histograms, closed loop time, "
+                                   "warm-up time, idle switch duty and fault codes.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("logs", "Log files, or directories of logs (.txt, .mlog, and journaled versions).",
+                               "logs...");
+
+  QCommandLineOption threadsOpt("threads", "Number of worker threads (default: one per core).", "count");
+  QCommandLineOption chunkOpt("chunk-size", "Size of the pieces that logs are divided into (default: 4).", "MB", "4");
+  QCommandLineOption celsiusOpt("celsius", "Text logs were recorded in Celsius rather than Fahrenheit.");
+  QCommandLineOption warmOpt("warm-temp", "Coolant temperature at which the engine counts as warm (default: 80).",
+                             "degrees C", "80");
+  QCommandLineOption gapOpt("max-interval", "Longest time between samples that counts as logged time (default: 2).",
+                            "secs", "2");
+  QCommandLineOption outputOpt("output", "File to write the summary to (default: stdout).", "file");
+  QCommandLineOption compactOpt("compact", "Write the JSON without indentation.");
+  QCommandLineOption timingOpt("timing", "Report the time taken and throughput on stderr.");
+
+  parser.addOption(threadsOpt);
+  parser.addOption(chunkOpt);
+  parser.addOption(celsiusOpt);
+  parser.addOption(warmOpt);
+  parser.addOption(gapOpt);
+  parser.addOption(outputOpt);
+  parser.addOption(compactOpt);
+  parser.addOption(timingOpt);
+  parser.process(app);
+
+  const QStringList paths = findLogs(parser.positionalArguments());
+  if (paths.isEmpty())
+  {
+    parser.showHelp(1);
+  }
+
+  int threads = QThread::idealThreadCount();
+  if (parser.isSet(threadsOpt))
+  {
+    threads = parser.value(threadsOpt).toInt();
+  }
+
+  bool chunkOk = false;
+  bool warmOk = false;
+  bool gapOk = false;
+  const double chunkMB = parser.value(chunkOpt).toDouble(&chunkOk);
+  AnalysisSettings settings;
+  settings.warmTempC = parser.value(warmOpt).toInt(&warmOk);
+  settings.maxIntervalMs = (qint64)(parser.value(gapOpt).toDouble(&gapOk) * 1000);
+
+  if ((threads < 1) || !chunkOk || (chunkMB <= 0.0) || !warmOk || !gapOk || (settings.maxIntervalMs <= 0))
+  {
+    err << "Invalid option value" << Qt::endl;
+    return 1;
+  }
+
+  const qint64 chunkBytes = qMax(Q_INT64_C(4096), (qint64)(chunkMB * 1024 * 1024));
+  const TemperatureUnits units = parser.isSet(celsiusOpt) ? Celsius : Fahrenheit;
+
+  QElapsedTimer timer;
+  QList<LogFile*> logs;
+  QList<QRunnable*> tasks;
+  qint64 totalBytes = 0;
+
+  timer.start();
+  foreach (QString path, paths)
+  {
+    LogFile *log = new LogFile;
+
+    log->path = path;
+    log->binary = isBinaryLog(path);
+    if (log->binary)
+    {
+      planBinaryLog(log, chunkBytes, settings, tasks);
+    }
+    else if (!planTextLog(log, chunkBytes, units, settings, tasks))
+    {
+      log->errors.append("Unable to open " + path);
+    }
+    totalBytes += log->size;
+    logs.append(log);
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  foreach (QRunnable *task, tasks)
+  {
+    pool.start(task);
+  }
+  pool.waitForDone();
+
+  QJsonArray files;
+  foreach (LogFile *log, logs)
+  {
+    SessionStats stats(!log->binary);
+    QStringList errors;
+
+    for (int i = 0; i < log->chunks.count(); i++)
+    {
+      stats.merge(log->chunks.at(i), settings);
+    }
+    foreach (QString error, log->errors)
+    {
+      if (!error.isEmpty())
+      {
+        errors.append(error);
+        err << log->path << ": " << error << Qt::endl;
+      }
+    }
+
+    QJsonObject json = stats.toJson(settings, log->binary);
+    json["file"] = log->path;
+    json["format"] = log->binary ? "binary" : "text";
+    if (!errors.isEmpty())
+    {
+      json["errors"] = QJsonArray::fromStringList(errors);
+    }
+    files.append(json);
+  }
+
+  const qint64 elapsedMs = timer.elapsed();
+
+  QJsonObject result;
+  result["files"] = files;
+
+  QFile outFile;
+  bool opened;
+
+  if (parser.isSet(outputOpt))
+  {
+    outFile.setFileName(parser.value(outputOpt));
+    opened = outFile.open(QFile::WriteOnly | QFile::Truncate);
+  }
+  else
+  {
+    opened = outFile.open(stdout, QFile::WriteOnly);
+  }
+
+  if (!opened)
+  {
+    err << "Unable to open " << parser.value(outputOpt) << " for writing" << Qt::endl;
+    qDeleteAll(logs);
+    return 1;
+  }
+  outFile.write(QJsonDocument(result).toJson(parser.isSet(compactOpt) ? QJsonDocument::Compact :
+                                                                        QJsonDocument::Indented));
+  outFile.close();
+
+  if (parser.isSet(timingOpt))
+  {
+    err << "Analysed " << logs.count() << " logs (" << tasks.count() << " chunks, "
+        << QString::number(totalBytes / (1024.0 * 1024.0), 'f', 1) << " MB) in " << elapsedMs << " ms with "
+        << threads << " threads: "
+        << QString::number((elapsedMs > 0) ? ((totalBytes / (1024.0 * 1024.0)) / (elapsedMs / 1000.0)) : 0.0, 'f', 1)
+        << " MB/s" << Qt::endl;
+  }
+
+  qDeleteAll(logs);
+  return 0;
+}
@@ -0,0 +1,285 @@
+#include <QDateTime>
+#include <QJsonArray>
+#include <QTime>
+#include <string.h>
+#include "sessionstats.h"
+
+namespace
+{
+  // names of the fault code bits, as shown by the LEDs in the main window
+  const char *const s_faultNames[SessionStats::s_faultBits] =
+  {
+    "coolantTempSensor",
+    "airTempSensor",
+    "fuelPumpCircuit",
+    "throttlePotCircuit",
+    "bit4",
+    "bit5",
+    "bit6",
+    "bit7"
+  };
+
+  double toSecs(qint64 ms)
+  {
+    return ms / 1000.0;
+  }
+}
+
+SessionStats::SessionStats(bool timeOfDay):
+m_timeOfDay(timeOfDay), m_samples(0), m_comments(0), m_badLines(0), m_gaps(0),
+m_elapsedMs(0), m_loggedMs(0), m_closedLoopMs(0), m_idleMs(0), m_warmAtMs(-1)
+{
+  memset(&m_first, 0, sizeof(Sample));
+  memset(&m_last, 0, sizeof(Sample));
+  memset(m_rpmSamples, 0, sizeof(m_rpmSamples));
+  memset(m_rpmMs, 0, sizeof(m_rpmMs));
+  memset(m_mapSamples, 0, sizeof(m_mapSamples));
+  memset(m_mapMs, 0, sizeof(m_mapMs));
+  memset(m_faultCount, 0, sizeof(m_faultCount));
+  memset(m_faultMs, 0, sizeof(m_faultMs));
+}
+
+int SessionStats::rpmBin(int rpm)
+{
+  return qBound(0, rpm / s_rpmBinWidth, s_rpmBins - 1);
+}
+
+int SessionStats::mapBin(float kpa)
+{
+  return (kpa > 0.0f) ? qMin((int)(kpa / s_mapBinWidthKpa), s_mapBins - 1) : 0;
+}
+
+/**
+ * Adds the next sample of the chunk (or session).
+ */
+void SessionStats::add(const Sample& sample, const AnalysisSettings& settings)
+{
+  if (m_samples > 0)
+  {
+    addInterval(m_last, sample, settings);
+  }
+  else
+  {
+    m_first = sample;
+  }
+
+  m_samples++;
+  m_rpmSamples[rpmBin(sample.rpm)]++;
+  m_mapSamples[mapBin(sample.mapKpa)]++;
+
+  if ((m_warmAtMs < 0) && (sample.coolantC >= settings.warmTempC))
+  {
+    m_warmAtMs = m_elapsedMs;
+  }
+  m_last = sample;
+}
+
+/**
+ * Accounts for the time between two consecutive samples, and for any fault
+ * codes that appeared between them.
+ */
+void SessionStats::addInterval(const Sample& from, const Sample& to, const AnalysisSettings& settings)
+{
+  qint64 dt = to.timeMs - from.timeMs;
+  const quint8 newFaults = to.faults & ~from.faults;
+
+  for (int bit = 0; bit < s_faultBits; bit++)
+  {
+    if (newFaults & (1 << bit))
+    {
+      m_faultCount[bit]++;
+    }
+  }
+
+  if (m_timeOfDay && (dt < 0))
+  {
+    dt += s_msecsPerDay;
+  }
+
+  // a clock that went backwards says nothing about how much time passed
+  if (dt >= 0)
+  {
+    m_elapsedMs += dt;
+  }
+
+  if ((dt < 0) || (dt > settings.maxIntervalMs))
+  {
+    m_gaps++;
+    return;
+  }
+
+  m_loggedMs += dt;
+  m_rpmMs[rpmBin(from.rpm)] += dt;
+  m_mapMs[mapBin(from.mapKpa)] += dt;
+  if (from.closedLoop)
+  {
+    m_closedLoopMs += dt;
+  }
+  if (from.idleSwitch)
+  {
+    m_idleMs += dt;
+  }
+  for (int bit = 0; bit < s_faultBits; bit++)
+  {
+    if (from.faults & (1 << bit))
+    {
+      m_faultMs[bit] += dt;
+    }
+  }
+}
+
+/**
+ * Appends the summary of the chunk that follows this one in the file.
+ */
+void SessionStats::merge(const SessionStats& next, const AnalysisSettings& settings)
+{
+  if (m_samples == 0)
+  {
+    const quint64 comments = m_comments;
+    const quint64 badLines = m_badLines;
+
+    *this = next;
+    m_comments += comments;
+    m_badLines += badLines;
+    return;
+  }
+
+  m_comments += next.m_comments;
+  m_badLines += next.m_badLines;
+  if (next.m_samples == 0)
+  {
+    return;
+  }
+
+  addInterval(m_last, next.m_first, settings);
+
+  if ((m_warmAtMs < 0) && (next.m_warmAtMs >= 0))
+  {
+    m_warmAtMs = m_elapsedMs + next.m_warmAtMs;
+  }
+
+  m_samples += next.m_samples;
+  m_gaps += next.m_gaps;
+  m_elapsedMs += next.m_elapsedMs;
+  m_loggedMs += next.m_loggedMs;
+  m_closedLoopMs += next.m_closedLoopMs;
+  m_idleMs += next.m_idleMs;
+
+  for (int i = 0; i < s_rpmBins; i++)
+  {
+    m_rpmSamples[i] += next.m_rpmSamples[i];
+    m_rpmMs[i] += next.m_rpmMs[i];
+  }
+  for (int i = 0; i < s_mapBins; i++)
+  {
+    m_mapSamples[i] += next.m_mapSamples[i];
+    m_mapMs[i] += next.m_mapMs[i];
+  }
+  for (int bit = 0; bit < s_faultBits; bit++)
+  {
+    m_faultCount[bit] += next.m_faultCount[bit];
+    m_faultMs[bit] += next.m_faultMs[bit];
+  }
+
+  m_last = next.m_last;
+}
+
+QString SessionStats::formatTime(qint64 timeMs) const
+{
+  if (m_timeOfDay)
+  {
+    return QTime::fromMSecsSinceStartOfDay((int)timeMs).toString("hh:mm:ss.zzz");
+  }
+  return QDateTime::fromMSecsSinceEpoch(timeMs).toString(Qt::ISODateWithMs);
+}
+
+/**
+ * Produces the summary of a whole session.
+ * @param haveFaults False if the log doesn't record fault codes (as text
+ *  logs don't), in which case "faults" is null
+ */
+QJsonObject SessionStats::toJson(const AnalysisSettings& settings, bool haveFaults) const
+{
+  QJsonObject json;
+  QJsonArray rpmSamples, rpmSecs, mapSamples, mapSecs;
+
+  json["samples"] = (double)m_samples;
+  json["comments"] = (double)m_comments;
+  json["badLines"] = (double)m_badLines;
+  if (m_samples == 0)
+  {
+    return json;
+  }
+
+  json["start"] = formatTime(m_first.timeMs);
+  json["end"] = formatTime(m_last.timeMs);
+  json["durationSecs"] = toSecs(m_elapsedMs);
+  json["loggedSecs"] = toSecs(m_loggedMs);
+  json["gaps"] = (double)m_gaps;
+
+  QJsonObject closedLoop;
+  closedLoop["secs"] = toSecs(m_closedLoopMs);
+  closedLoop["fraction"] = (m_loggedMs > 0) ? ((double)m_closedLoopMs / m_loggedMs) : 0.0;
+  json["closedLoop"] = closedLoop;
+
+  QJsonObject idle;
+  idle["secs"] = toSecs(m_idleMs);
+  idle["duty"] = (m_loggedMs > 0) ? ((double)m_idleMs / m_loggedMs) : 0.0;
+  json["idleSwitch"] = idle;
+
+  QJsonObject warmUp;
+  warmUp["thresholdC"] = settings.warmTempC;
+  warmUp["startedWarm"] = (m_first.coolantC >= settings.warmTempC);
+  warmUp["secs"] = (m_warmAtMs >= 0) ? QJsonValue(toSecs(m_warmAtMs)) : QJsonValue();
+  json["warmUp"] = warmUp;
+
+  for (int i = 0; i < s_rpmBins; i++)
+  {
+    rpmSamples.append((double)m_rpmSamples[i]);
+    rpmSecs.append(toSecs(m_rpmMs[i]));
+  }
+  QJsonObject rpm;
+  rpm["binWidth"] = s_rpmBinWidth;
+  rpm["samples"] = rpmSamples;
+  rpm["secs"] = rpmSecs;
+  json["rpmHistogram"] = rpm;
+
+  for (int i = 0; i < s_mapBins; i++)
+  {
+    mapSamples.append((double)m_mapSamples[i]);
+    mapSecs.append(toSecs(m_mapMs[i]));
+  }
+  QJsonObject map;
+  map["binWidthKpa"] = s_mapBinWidthKpa;
+  map["samples"] = mapSamples;
+  map["secs"] = mapSecs;
+  json["mapHistogram"] = map;
+
+  if (haveFaults)
+  {
+    QJsonArray faults;
+
+    for (int bit = 0; bit < s_faultBits; bit++)
+    {
+      // a fault already present at the start counts as an occurrence
+      const quint64 count = m_faultCount[bit] + ((m_first.faults & (1 << bit)) ? 1 : 0);
+
+      if (count > 0)
+      {
+        QJsonObject fault;
+        fault["code"] = s_faultNames[bit];
+        fault["mask"] = 1 << bit;
+        fault["occurrences"] = (double)count;
+        fault["secs"] = toSecs(m_faultMs[bit]);
+        faults.append(fault);
+      }
+    }
+    json["faults"] = faults;
+  }
+  else
+  {
+    json["faults"] = QJsonValue();
+  }
+
+  return json;
+}
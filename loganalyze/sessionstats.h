@@ -0,0 +1,94 @@
+#ifndef SESSIONSTATS_H
+#define SESSIONSTATS_H
+
+#include <QJsonObject>
+#include <QtGlobal>
+
+/**
+ * Settings shared by every part of an analysis run.
+ */
+struct AnalysisSettings
+{
+    int warmTempC;          // coolant temperature at which the engine counts as warm
+    qint64 maxIntervalMs;   // longer gaps between samples aren't counted as logged time
+};
+
+/**
+ * Summary of a logging session: engine speed and manifold pressure
+ * histograms, time in closed loop, coolant warm-up time, idle switch duty
+ * and fault code occurrences.
+ *
+ * While an analysis is running, each chunk of a file is summarised on its
+ * own and the chunks are then combined in file order with merge(). The
+ * interval between the last sample of one chunk and the first of the next
+ * is accounted for at that point, so the result doesn't depend on how the
+ * file was divided. Each interval is credited to the state at its start,
+ * and intervals longer than AnalysisSettings::maxIntervalMs are counted as
+ * gaps rather than as logged time.
+ *
+ * Text logs only record the time of day, so for those the times are msecs
+ * since midnight and an interval that crosses midnight wraps around.
+ */
+class SessionStats
+{
+public:
+    static const int s_rpmBinWidth = 250;
+    static const int s_rpmBins = 32;        // the last bin holds 7750 RPM and over
+    static const int s_mapBinWidthKpa = 5;
+    static const int s_mapBins = 24;        // the last bin holds 115 kPa and over
+    static const int s_faultBits = 8;
+    static const qint64 s_msecsPerDay = Q_INT64_C(86400000);
+
+    /**
+     * The values of one sample that the summary uses.
+     */
+    struct Sample
+    {
+        qint64 timeMs;
+        int rpm;
+        float mapKpa;
+        int coolantC;
+        bool idleSwitch;
+        bool closedLoop;
+        quint8 faults;
+    };
+
+    explicit SessionStats(bool timeOfDay = false);
+
+    void add(const Sample& sample, const AnalysisSettings& settings);
+    void addComment()  { m_comments++; }
+    void addBadLine()  { m_badLines++; }
+    void merge(const SessionStats& next, const AnalysisSettings& settings);
+
+    quint64 samples() const { return m_samples; }
+    QJsonObject toJson(const AnalysisSettings& settings, bool haveFaults) const;
+
+private:
+    bool m_timeOfDay;
+    quint64 m_samples;
+    quint64 m_comments;
+    quint64 m_badLines;
+    quint64 m_gaps;
+    Sample m_first;
+    Sample m_last;
+
+    qint64 m_elapsedMs;
+    qint64 m_loggedMs;
+    qint64 m_closedLoopMs;
+    qint64 m_idleMs;
+    qint64 m_warmAtMs;      // elapsed time when the coolant first reached the threshold, or -1
+
+    quint64 m_rpmSamples[s_rpmBins];
+    qint64 m_rpmMs[s_rpmBins];
+    quint64 m_mapSamples[s_mapBins];
+    qint64 m_mapMs[s_mapBins];
+    quint64 m_faultCount[s_faultBits];
+    qint64 m_faultMs[s_faultBits];
+
+    static int rpmBin(int rpm);
+    static int mapBin(float kpa);
+    void addInterval(const Sample& from, const Sample& to, const AnalysisSettings& settings);
+    QString formatTime(qint64 timeMs) const;
+};
+
+#endif // SESSIONSTATS_H
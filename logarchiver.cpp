@@ -0,0 +1,246 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <string.h>
+#include <zlib.h>
+#include "logarchiver.h"
+#include "logindex.h"
+
+namespace
+{
+  const int s_chunkSize = 64 * 1024;
+
+  /**
+   * Compresses (if requested) and records one closed segment.
+   */
+  class FinishSegmentJob : public QRunnable
+  {
+  public:
+    FinishSegmentJob(QString path, const LogArchiver::Segment& segment, QString manifestPath, bool compress):
+    m_path(path), m_segment(segment), m_manifestPath(manifestPath), m_compress(compress)
+    {
+    }
+
+    void run()
+    {
+      QString finishedPath = m_path;
+
+      if (m_compress)
+      {
+        const QString gzPath = m_path + ".gz";
+        const QString partPath = gzPath + ".part";
+
+        // the compressed file only appears under its final name once it's
+        // complete, and the original is only removed after that
+        if (LogArchiver::gzipFile(m_path, partPath) &&
+            (!QFile::exists(gzPath) || QFile::remove(gzPath)) &&
+            QFile::rename(partPath, gzPath))
+        {
+          // the index holds offsets into the uncompressed log, so it's
+          // no use once the log is gone
+          QFile::remove(m_path);
+          QFile::remove(LogIndex::pathFor(m_path));
+          finishedPath = gzPath;
+        }
+        else
+        {
+          QFile::remove(partPath);
+        }
+      }
+
+      if (!m_manifestPath.isEmpty())
+      {
+        appendToManifest(QFileInfo(finishedPath).fileName());
+      }
+    }
+
+  private:
+    QString m_path;
+    LogArchiver::Segment m_segment;
+    QString m_manifestPath;
+    bool m_compress;
+
+    static QString formatTime(qint64 msecs)
+    {
+      if (msecs == 0)
+      {
+        return "-";
+      }
+      return QDateTime::fromMSecsSinceEpoch(msecs).toString(Qt::ISODateWithMs);
+    }
+
+    void appendToManifest(QString fileName)
+    {
+      QFile manifest(m_manifestPath);
+      const bool isNew = !manifest.exists();
+
+      if (manifest.open(QFile::WriteOnly | QFile::Append))
+      {
+        QByteArray line;
+
+        if (isNew)
+        {
+          line.append(LogArchiver::manifestHeader().toUtf8());
+        }
+        line.append(QString("%1\t%2\t%3\t%4\t%5\t%6\n")
+                    .arg(m_segment.index)
+                    .arg(fileName)
+                    .arg(formatTime(m_segment.firstSampleMs))
+                    .arg(formatTime(m_segment.lastSampleMs))
+                    .arg(m_segment.samples)
+                    .arg(m_segment.bytes).toUtf8());
+        manifest.write(line);
+        manifest.close();
+      }
+    }
+  };
+}
+
+/**
+ * Constructor.
+ */
+LogArchiver::LogArchiver(QObject *parent):
+QObject(parent), m_compress(false)
+{
+  // one thread, so that segments are finished (and listed) in order
+  m_pool.setMaxThreadCount(1);
+}
+
+/**
+ * Destructor. Waits for any segments still being compressed.
+ */
+LogArchiver::~LogArchiver()
+{
+  m_pool.waitForDone();
+}
+
+/**
+ * Sets the manifest file. Segments closed before this is set (or while it's
+ * empty) aren't listed.
+ */
+void LogArchiver::setManifest(QString path)
+{
+  QMutexLocker locker(&m_mutex);
+  m_manifestPath = path;
+}
+
+/**
+ * Enables or disables gzip compression of finished segments.
+ */
+void LogArchiver::setCompression(bool enabled)
+{
+  QMutexLocker locker(&m_mutex);
+  m_compress = enabled;
+}
+
+/**
+ * Records the details of a segment, to be written to the manifest once the
+ * segment is closed. Files that haven't been described are left alone.
+ */
+void LogArchiver::describe(QString path, const Segment& segment)
+{
+  QMutexLocker locker(&m_mutex);
+  m_segments.insert(path, segment);
+}
+
+/**
+ * Waits for every closed segment to be finished.
+ * @return True if there's nothing left to do
+ */
+bool LogArchiver::waitForDone(int timeoutMsecs)
+{
+  return m_pool.waitForDone(timeoutMsecs);
+}
+
+/**
+ * Returns the comment line at the top of a manifest.
+ */
+QString LogArchiver::manifestHeader()
+{
+  return "#segment\tfile\tfirst_sample\tlast_sample\tsamples\tbytes\n";
+}
+
+/**
+ * Responds to the writer closing a file. This is called on the writer's
+ * thread, so it only queues the work.
+ */
+void LogArchiver::onFileClosed(QString path)
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (m_segments.contains(path))
+  {
+    m_pool.start(new FinishSegmentJob(path, m_segments.take(path), m_manifestPath, m_compress));
+  }
+}
+
+/**
+ * Compresses a file in the gzip format, streaming it through zlib in
+ * fixed-size chunks.
+ * @return True on success
+ */
+bool LogArchiver::gzipFile(QString srcPath, QString destPath)
+{
+  QFile src(srcPath);
+  QFile dest(destPath);
+  z_stream strm;
+  QByteArray in(s_chunkSize, 0);
+  QByteArray out(s_chunkSize, 0);
+  bool ok = true;
+  int flush = Z_NO_FLUSH;
+
+  if (!src.open(QFile::ReadOnly) || !dest.open(QFile::WriteOnly | QFile::Truncate))
+  {
+    return false;
+  }
+
+  memset(&strm, 0, sizeof(strm));
+
+  // 15 bits of window, plus 16 to ask for a gzip header and trailer
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    return false;
+  }
+
+  while (ok && (flush != Z_FINISH))
+  {
+    const qint64 count = src.read(in.data(), s_chunkSize);
+
+    if (count < 0)
+    {
+      ok = false;
+      break;
+    }
+
+    flush = src.atEnd() ? Z_FINISH : Z_NO_FLUSH;
+    strm.next_in = (Bytef*)in.data();
+    strm.avail_in = (uInt)count;
+
+    do
+    {
+      strm.next_out = (Bytef*)out.data();
+      strm.avail_out = s_chunkSize;
+
+      if (deflate(&strm, flush) == Z_STREAM_ERROR)
+      {
+        ok = false;
+        break;
+      }
+
+      const int have = s_chunkSize - strm.avail_out;
+      if (dest.write(out.constData(), have) != have)
+      {
+        ok = false;
+        break;
+      }
+    } while (strm.avail_out == 0);
+  }
+
+  deflateEnd(&strm);
+  dest.close();
+
+  return ok && (dest.error() == QFile::NoError);
+}
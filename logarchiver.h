@@ -0,0 +1,53 @@
+#ifndef LOGARCHIVER_H
+#define LOGARCHIVER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QString>
+
+/**
+ * Finishes log segments once the writer has closed them: optionally
+ * compresses each one with gzip, then adds it to the manifest (a text file
+ * listing the segments in order, so that other tools can read them back as
+ * one stream). This happens on a pool with a single thread, so segments
+ * are always finished in the order they were closed and compression never
+ * holds up logging.
+ */
+class LogArchiver : public QObject
+{
+    Q_OBJECT
+public:
+    struct Segment
+    {
+        int index;
+        qint64 firstSampleMs;  // msecs since the epoch; 0 if no samples
+        qint64 lastSampleMs;
+        quint64 samples;
+        quint64 bytes;         // uncompressed size
+    };
+
+    explicit LogArchiver(QObject *parent = 0);
+    ~LogArchiver();
+
+    void setManifest(QString path);
+    void setCompression(bool enabled);
+    void describe(QString path, const Segment& segment);
+    bool waitForDone(int timeoutMsecs = -1);
+
+    static QString manifestHeader();
+    static bool gzipFile(QString srcPath, QString destPath);
+
+public slots:
+    void onFileClosed(QString path);
+
+private:
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QHash<QString,Segment> m_segments;
+    QString m_manifestPath;
+    bool m_compress;
+};
+
+#endif // LOGARCHIVER_H
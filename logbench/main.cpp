@@ -0,0 +1,149 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <string.h>
+#include "logwriter.h"
+#include "csvencoder.h"
+#include "csvformat.h"
+
+/**
+ * One combination of settings to measure.
+ */
+struct BenchConfig
+{
+    const char *name;
+    bool journaled;
+    LogWriter::Durability durability;
+};
+
+static const BenchConfig s_configs[] =
+{
+  { "plain, no sync",          false, LogWriter::NoSync },
+  { "plain, periodic sync",    false, LogWriter::PeriodicSync },
+  { "plain, sync per block",   false, LogWriter::BlockSync },
+  { "journal, no sync",        true,  LogWriter::NoSync },
+  { "journal, periodic sync",  true,  LogWriter::PeriodicSync },
+  { "journal, sync per block", true,  LogWriter::BlockSync }
+};
+
+/**
+ * Fills in a sample with values that change from one sample to the next,
+ * so that the lines are a realistic length.
+ */
+static void makeSample(mems_data *data, quint64 n)
+{
+  memset(data, 0, sizeof(mems_data));
+  data->engine_rpm = 800 + (n % 3000);
+  data->coolant_temp_c = 20 + ((n / 1000) % 70);
+  data->intake_air_temp_c = 25 + ((n / 5000) % 10);
+  data->throttle_pot_voltage = 0.5f + (n % 200) * 0.02f;
+  data->map_kpa = 30.0f + (n % 70);
+  data->iac_position = n % 180;
+  data->battery_voltage = 13.0f + (n % 10) * 0.1f;
+  data->idle_switch = (n % 2);
+  data->closed_loop = ((n / 100) % 2);
+  data->lambda_voltage_mv = n % 900;
+}
+
+/**
+ * Measures how quickly log lines can be pushed through a LogWriter with
+ * each combination of journaling and durability. The producer runs flat
+ * out, backing off briefly whenever the writer's queue is full, so the
+ * figures are the sustained rate at which data reaches the file.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("memslogbench");
+  QTextStream out(stdout);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Measures log write throughput for each durability setting.");
+  parser.addHelpOption();
+
+  QCommandLineOption dirOpt(QStringList() << "d" << "dir", "Directory to write the test files in (default: the system temp directory).", "dir", QDir::tempPath());
+  QCommandLineOption secsOpt(QStringList() << "s" << "seconds", "Time to run each test (default 5).", "secs", "5");
+  QCommandLineOption blockOpt(QStringList() << "b" << "block-size", "Bytes queued before a block is written (default 65536).", "bytes", "65536");
+  QCommandLineOption batchOpt("batch", "Samples appended per call (default 1).", "samples", "1");
+  QCommandLineOption keepOpt("keep", "Keep the test files.");
+
+  parser.addOption(dirOpt);
+  parser.addOption(secsOpt);
+  parser.addOption(blockOpt);
+  parser.addOption(batchOpt);
+  parser.addOption(keepOpt);
+  parser.process(app);
+
+  const int runMsecs = parser.value(secsOpt).toInt() * 1000;
+  const int blockSize = qMax(1, parser.value(blockOpt).toInt());
+  const int batch = qMax(1, parser.value(batchOpt).toInt());
+
+  out << "Writing to " << parser.value(dirOpt) << ", " << (runMsecs / 1000) << " s per test, "
+      << blockSize << "-byte blocks, " << batch << " sample(s) per append" << Qt::endl << Qt::endl;
+  out << QString("%1 %2 %3 %4 %5").arg("configuration", -26).arg("samples/s", 12)
+                                  .arg("MB/s", 8).arg("blocks", 8).arg("syncs", 8) << Qt::endl;
+
+  for (unsigned int c = 0; c < sizeof(s_configs) / sizeof(s_configs[0]); c++)
+  {
+    const BenchConfig& config = s_configs[c];
+    const QString path = QDir(parser.value(dirOpt)).filePath(QString("memslogbench-%1.txt%2")
+                           .arg(c).arg(config.journaled ? ".jnl" : ""));
+    LogWriter writer;
+    CsvEncoder encoder;
+    QByteArray buffer;
+    mems_data data;
+    quint64 samples = 0;
+    QElapsedTimer timer;
+
+    QFile::remove(path);
+    writer.setJournaled(config.journaled);
+    writer.setDurability(config.durability, 1000);
+    writer.setFlushPolicy(1000, blockSize);
+    buffer.reserve(batch * 128);
+
+    if (!writer.open(path))
+    {
+      out << "Unable to open " << path << Qt::endl;
+      return 1;
+    }
+    writer.append(QByteArray(CsvFormat::header()), 1);
+
+    timer.start();
+    while (timer.elapsed() < runMsecs)
+    {
+      for (int i = 0; i < batch; i++)
+      {
+        makeSample(&data, samples + i);
+        encoder.encode(timer.elapsed(), &data, buffer);
+      }
+
+      // the writer drops data when its queue is full, so wait for room
+      while (!writer.append(buffer, batch))
+      {
+        QThread::usleep(200);
+      }
+      samples += batch;
+      buffer.resize(0);
+    }
+    writer.close();
+
+    const double secs = timer.nsecsElapsed() / 1e9;
+    const LogWriter::Stats stats = writer.stats();
+
+    out << QString("%1 %2 %3 %4 %5").arg(config.name, -26)
+                                    .arg(samples / secs, 12, 'f', 0)
+                                    .arg(stats.bytesWritten / secs / (1024.0 * 1024.0), 8, 'f', 2)
+                                    .arg(stats.flushes, 8).arg(stats.syncs, 8) << Qt::endl;
+
+    if (!parser.isSet(keepOpt))
+    {
+      QFile::remove(path);
+    }
+  }
+
+  return 0;
+}
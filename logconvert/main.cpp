@@ -0,0 +1,233 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include "binarylog.h"
+#include "csvformat.h"
+#include "csvencoder.h"
+#include "journal.h"
+#include "logindex.h"
+
+/**
+ * Opens the output file (or stdout, for "-").
+ */
+static bool openOutput(QFile& outFile, QString outPath)
+{
+  if (outPath == "-")
+  {
+    return outFile.open(stdout, QFile::WriteOnly);
+  }
+
+  outFile.setFileName(outPath);
+  return outFile.open(QFile::WriteOnly | QFile::Truncate);
+}
+
+/**
+ * Copies the contents of a journaled text log to a plain text file.
+ * @return Exit code
+ */
+static int unwrapTextJournal(JournalReader& journal, QString inPath, QString outPath, QTextStream& err)
+{
+  QFile outFile;
+  QByteArray buffer(64 * 1024, 0);
+  qint64 count;
+
+  if (!openOutput(outFile, outPath))
+  {
+    err << "Unable to open " << outPath << " for writing" << Qt::endl;
+    return 1;
+  }
+
+  while ((count = journal.read(buffer.data(), buffer.size())) > 0)
+  {
+    outFile.write(buffer.constData(), count);
+  }
+
+  if (journal.damaged())
+  {
+    err << inPath << ": journal ends with a damaged block, which was skipped" << Qt::endl;
+  }
+  return 0;
+}
+
+/**
+ * Reads a --from or --to time.
+ * @return Msecs since the epoch, or -1 if the time isn't valid
+ */
+static qint64 parseTime(QString text)
+{
+  const QDateTime time = QDateTime::fromString(text, Qt::ISODate);
+  return time.isValid() ? time.toMSecsSinceEpoch() : -1;
+}
+
+/**
+ * Converts a binary log (as written by the logger when the binary format is
+ * selected) into the same text (CSV) format that the logger writes. A
+ * journaled log (binary or text) is unwrapped at the same time.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("memslog2csv");
+  QTextStream err(stderr);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Converts a binary or journaled MEMS log to text (CSV).");
+  parser.addHelpOption();
+  parser.addPositionalArgument("input", "Binary or journaled log file (.mlog, .mlog.jnl or .txt.jnl).");
+  parser.addPositionalArgument("output", "Text file to write (default: the input name with .txt; - for stdout).", "[output]");
+
+  QCommandLineOption celsiusOpt("celsius", "Write temperatures in Celsius, whatever the log was recorded with.");
+  QCommandLineOption fahrenheitOpt("fahrenheit", "Write temperatures in Fahrenheit, whatever the log was recorded with.");
+
+  QCommandLineOption fromOpt("from", "Start at this local time, e.g. 2024-01-01T14:32:00 (binary logs only).", "time");
+  QCommandLineOption toOpt("to", "Stop after this local time (binary logs only).", "time");
+
+  parser.addOption(celsiusOpt);
+  parser.addOption(fahrenheitOpt);
+  parser.addOption(fromOpt);
+  parser.addOption(toOpt);
+  parser.process(app);
+
+  const qint64 fromMs = parser.isSet(fromOpt) ? parseTime(parser.value(fromOpt)) : 0;
+  const qint64 toMs = parser.isSet(toOpt) ? parseTime(parser.value(toOpt)) : Q_INT64_C(0x7FFFFFFFFFFFFFFF);
+  if ((fromMs < 0) || (toMs < 0))
+  {
+    err << "Times must be given as yyyy-MM-ddThh:mm:ss" << Qt::endl;
+    return 1;
+  }
+
+  const QStringList args = parser.positionalArguments();
+  if ((args.count() < 1) || (args.count() > 2))
+  {
+    parser.showHelp(1);
+  }
+
+  QString outPath = (args.count() == 2) ? args.at(1) : QString();
+  if (outPath.isEmpty())
+  {
+    QString inPath = args.at(0);
+    if (inPath.endsWith(".jnl"))
+    {
+      inPath.chop(4);
+    }
+
+    const QFileInfo info(inPath);
+    outPath = info.path() + "/" + info.completeBaseName() + ".txt";
+  }
+
+  // a journal holding a text log only needs unwrapping
+  if (Journal::isJournal(args.at(0)))
+  {
+    JournalReader journal;
+
+    if (journal.openJournal(args.at(0)) &&
+        (journal.peek(sizeof(BinaryLog::s_magic)) != QByteArray(BinaryLog::s_magic, sizeof(BinaryLog::s_magic))))
+    {
+      return unwrapTextJournal(journal, args.at(0), outPath, err);
+    }
+  }
+
+  BinaryLogReader reader;
+  if (!reader.open(args.at(0)))
+  {
+    err << args.at(0) << ": " << reader.errorString() << Qt::endl;
+    return 1;
+  }
+
+  // jump straight to the right part of the log if it has an index;
+  // otherwise everything before the start time is read and skipped
+  if (fromMs > 0)
+  {
+    LogIndex index;
+
+    if (index.open(args.at(0)))
+    {
+      const qint64 offset = index.find(fromMs);
+      if (offset >= 0)
+      {
+        reader.seek(offset);
+      }
+    }
+  }
+
+  TemperatureUnits units = reader.temperatureUnits();
+  if (parser.isSet(celsiusOpt))
+  {
+    units = Celsius;
+  }
+  else if (parser.isSet(fahrenheitOpt))
+  {
+    units = Fahrenheit;
+  }
+
+  const bool toStdout = (outPath == "-");
+  QFile outFile;
+  if (!openOutput(outFile, outPath))
+  {
+    err << "Unable to open " << outPath << " for writing" << Qt::endl;
+    return 1;
+  }
+
+  CsvEncoder encoder;
+  QByteArray buffer;
+  BinaryLogRecord record;
+  quint64 samples = 0;
+  const int flushSize = 64 * 1024;
+
+  encoder.setTemperatureUnits(units);
+  buffer.reserve(flushSize + 1024);
+  buffer.append(CsvFormat::header());
+
+  while (reader.next(record))
+  {
+    if (record.timestampMs < fromMs)
+    {
+      continue;
+    }
+    if (record.timestampMs > toMs)
+    {
+      break;
+    }
+
+    if (record.type == BinaryLogRecord::Sample)
+    {
+      encoder.encode(record.timestampMs, &record.data, buffer);
+      samples++;
+    }
+    else
+    {
+      QString line;
+      QTextStream comment(&line);
+      CsvFormat::writeComment(comment, record.timestampMs, record.comment);
+      comment.flush();
+      buffer.append(line.toUtf8());
+    }
+
+    if (buffer.size() >= flushSize)
+    {
+      outFile.write(buffer);
+      buffer.resize(0);
+    }
+  }
+  outFile.write(buffer);
+
+  if (reader.truncated())
+  {
+    err << args.at(0) << ": last record is incomplete and was skipped" << Qt::endl;
+  }
+  else if (!reader.errorString().isEmpty())
+  {
+    err << args.at(0) << ": " << reader.errorString() << Qt::endl;
+    return 1;
+  }
+
+  if (!toStdout)
+  {
+    err << "Wrote " << samples << " samples to " << outPath << Qt::endl;
+  }
+
+  return 0;
+}
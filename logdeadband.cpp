@@ -0,0 +1,123 @@
+#include <QStringList>
+#include <string.h>
+#include <math.h>
+#include "logdeadband.h"
+
+/**
+ * Constructor. All tolerances start at zero, so every change is logged.
+ */
+LogDeadband::LogDeadband()
+{
+  for (int i = 0; i < BinaryLog::NumChannels; i++)
+  {
+    m_tolerance[i] = 0.0;
+  }
+}
+
+/**
+ * Returns tolerances that hide the last-digit flicker of the noisier
+ * channels at idle. Switches, fault codes and temperatures (whole degrees)
+ * are logged on every change.
+ */
+LogDeadband LogDeadband::defaults()
+{
+  LogDeadband deadband;
+
+  deadband.setTolerance(BinaryLog::EngineRpm, 5);
+  deadband.setTolerance(BinaryLog::BatteryVoltage, 0.02);
+  deadband.setTolerance(BinaryLog::ThrottlePotVoltage, 0.02);
+  deadband.setTolerance(BinaryLog::IacPosition, 1);
+  deadband.setTolerance(BinaryLog::LambdaVoltage, 10);
+  return deadband;
+}
+
+void LogDeadband::setTolerance(int channel, double tolerance)
+{
+  if ((channel >= 0) && (channel < BinaryLog::NumChannels))
+  {
+    m_tolerance[channel] = qMax(0.0, tolerance);
+  }
+}
+
+/**
+ * Sets tolerances from a comma-separated list of "channel=tolerance"
+ * pairs, where the channel names are those used in the log headers (e.g.
+ * "engineSpeed=10,mainVoltage=0.1"). Channels not listed are unchanged.
+ * @param error Receives a description of the problem, if the list is invalid
+ * @return True if the whole list was understood
+ */
+bool LogDeadband::parse(QString spec, QString& error)
+{
+  foreach (QString item, spec.split(',', Qt::SkipEmptyParts))
+  {
+    const QStringList parts = item.trimmed().split('=');
+    bool ok = false;
+    int channel = -1;
+
+    for (int i = 0; i < BinaryLog::NumChannels; i++)
+    {
+      if ((parts.count() == 2) && (parts.at(0).trimmed() == BinaryLog::channelName(i)))
+      {
+        channel = i;
+      }
+    }
+
+    const double tolerance = (parts.count() == 2) ? parts.at(1).toDouble(&ok) : 0.0;
+    if ((channel < 0) || !ok || (tolerance < 0.0))
+    {
+      error = QString("invalid deadband setting \"%1\"").arg(item.trimmed());
+      return false;
+    }
+    m_tolerance[channel] = tolerance;
+  }
+
+  return true;
+}
+
+/**
+ * Checks whether a single channel has moved by more than its tolerance.
+ * @param previous Value last written, as stored by BinaryLog::channelValue()
+ * @param current Value now, in the same form
+ */
+bool LogDeadband::exceeds(int channel, quint32 previous, quint32 current) const
+{
+  double diff;
+
+  if (previous == current)
+  {
+    return false;
+  }
+
+  if (BinaryLog::channelKind(channel) == BinaryLog::FloatChannel)
+  {
+    float a;
+    float b;
+
+    memcpy(&a, &previous, sizeof(a));
+    memcpy(&b, &current, sizeof(b));
+    diff = fabs((double)b - (double)a);
+  }
+  else
+  {
+    diff = fabs((double)current - (double)previous);
+  }
+
+  // the float channels are stored in steps that aren't exact in binary,
+  // so allow for rounding when a change is exactly the tolerance
+  return (diff > (m_tolerance[channel] * (1.0 + 1e-6)));
+}
+
+/**
+ * Checks whether any channel has moved by more than its tolerance.
+ */
+bool LogDeadband::exceeds(const mems_data& previous, const mems_data& current) const
+{
+  for (int i = 0; i < BinaryLog::NumChannels; i++)
+  {
+    if (exceeds(i, BinaryLog::channelValue(&previous, i), BinaryLog::channelValue(&current, i)))
+    {
+      return true;
+    }
+  }
+  return false;
+}
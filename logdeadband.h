@@ -0,0 +1,40 @@
+#ifndef LOGDEADBAND_H
+#define LOGDEADBAND_H
+
+#include <QString>
+#include "rosco.h"
+#include "binarylog.h"
+
+/**
+ * Per-channel tolerances for change-only ("deadband") logging. A channel
+ * counts as changed only when it has moved by more than its tolerance from
+ * the value last written to the log; a tolerance of zero means that any
+ * change counts. Channels are those of BinaryLog, and tolerances are in
+ * the units of the corresponding mems_data field (e.g. RPM, volts, mV).
+ *
+ * Since the comparison is always against the last value written, a slow
+ * drift is still logged once it adds up to more than the tolerance, and
+ * the periodic keyframes (every s_keyframeIntervalMs at most) restore the
+ * exact values.
+ */
+class LogDeadband
+{
+public:
+    static const qint64 s_keyframeIntervalMs = 10000;
+
+    LogDeadband();
+
+    static LogDeadband defaults();
+
+    void setTolerance(int channel, double tolerance);
+    double tolerance(int channel) const { return m_tolerance[channel]; }
+    bool parse(QString spec, QString& error);
+
+    bool exceeds(int channel, quint32 previous, quint32 current) const;
+    bool exceeds(const mems_data& previous, const mems_data& current) const;
+
+private:
+    double m_tolerance[BinaryLog::NumChannels];
+};
+
+#endif // LOGDEADBAND_H
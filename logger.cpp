@@ -1,15 +1,196 @@
 #include <QDir>
 #include <QDateTime>
+#include <QFileInfo>
+#include <QTextStream>
+#include <string.h>
 #include "logger.h"
+#include "csvformat.h"
 
 /**
  * Constructor. Sets the interface class pointer as
  * well as log directory and log file extension.
  */
 Logger::Logger(MEMSInterface* memsiface):
-m_logExtension(".txt"), m_logDir("logs")
+m_logExtension(".txt"), m_logDir("logs"), m_tempUnits(Fahrenheit),
+m_format(TextFormat), m_requestedFormat(TextFormat),
+m_rotateBytes(0), m_rotateSecs(0), m_compress(false), m_segmentOpenedMs(0), m_fileBytes(0),
+m_journaled(false), m_durability(LogWriter::NoSync), m_syncIntervalMsecs(1000),
+m_triggered(false), m_changeOnly(false), m_lastRowMs(0), m_haveLastRow(false)
 {
   m_mems = memsiface;
+  m_reader = new SampleReader(m_mems->getSampleRing());
+
+  // formatted records are built here before going to the writer, so keep
+  // enough room that this normally never has to grow
+  m_buffer.reserve(16 * 1024);
+
+  memset(&m_segment, 0, sizeof(m_segment));
+  memset(&m_lastRow, 0, sizeof(m_lastRow));
+
+  // the archiver only queues work, so it's safe to call on the writer thread
+  QObject::connect(&m_writer, SIGNAL(fileClosed(QString)),
+                   &m_archiver, SLOT(onFileClosed(QString)), Qt::DirectConnection);
+}
+
+/**
+ * Destructor.
+ */
+Logger::~Logger()
+{
+  delete m_reader;
+}
+
+/**
+ * Selects text (CSV) or binary logs. Takes effect the next time a log is
+ * opened.
+ */
+void Logger::setFormat(Format format)
+{
+  m_requestedFormat = format;
+}
+
+/**
+ * Sets when the log moves on to a new file. With rotation enabled, each
+ * log is written as a series of numbered segments (name-0001.txt,
+ * name-0002.txt, ...) listed in name.manifest. Takes effect the next time
+ * a log is opened.
+ * @param maxBytes Size at which to start a new segment (0 for no limit)
+ * @param maxSecs Age at which to start a new segment (0 for no limit)
+ * @param compress True to gzip each segment once it's finished
+ */
+void Logger::setRotation(qint64 maxBytes, int maxSecs, bool compress)
+{
+  m_rotateBytes = qMax(Q_INT64_C(0), maxBytes);
+  m_rotateSecs = qMax(0, maxSecs);
+  m_compress = compress;
+}
+
+/**
+ * Sets how well the log survives a crash or power cut. Journaled logs
+ * (".jnl" is added to the file name) are written as checksummed blocks, so
+ * that a partly written tail can be detected and cut off when the log is
+ * next opened. The durability level decides how often the data is forced
+ * out to the disk. Takes effect the next time a log is opened.
+ * @param journaled True for a journaled log
+ * @param durability When to sync the file
+ * @param syncIntervalMsecs Longest time between syncs, for periodic syncing
+ */
+void Logger::setDurability(bool journaled, LogWriter::Durability durability, int syncIntervalMsecs)
+{
+  m_journaled = journaled;
+  m_durability = durability;
+  m_syncIntervalMsecs = syncIntervalMsecs;
+}
+
+/**
+ * Switches between logging every sample and logging only the periods
+ * around events (see EventTrigger). Takes effect immediately; when it's
+ * first enabled, the pre-trigger buffer starts empty.
+ * @param enabled True to log only around events
+ * @param settings Trigger conditions and window lengths
+ */
+void Logger::setTriggeredLogging(bool enabled, const EventTrigger::Settings& settings)
+{
+  if (enabled && !m_triggered)
+  {
+    m_trigger.reset();
+  }
+  m_triggered = enabled;
+  m_trigger.setSettings(settings);
+}
+
+/**
+ * Switches between logging every sample in full and logging only changes
+ * (see LogDeadband). Takes effect immediately.
+ * @param enabled True to log only changes
+ * @param deadband Tolerance for each channel
+ */
+void Logger::setChangeOnly(bool enabled, const LogDeadband& deadband)
+{
+  m_changeOnly = enabled;
+  m_deadband = deadband;
+  m_encoder.setDeadband(enabled ? &m_deadband : 0);
+}
+
+/**
+ * Returns the path of a numbered segment of the current log.
+ */
+QString Logger::segmentPath(int index) const
+{
+  return QString("%1-%2%3").arg(m_baseName).arg(index, 4, 10, QChar('0')).arg(m_logExtension);
+}
+
+/**
+ * Starts (or continues) the time index for the file being written.
+ * Journaled logs aren't indexed, since the writer adds block headers that
+ * would throw the offsets out.
+ * @param logPath Path of the log file
+ * @param logSize Bytes already in the file (including any header queued)
+ */
+void Logger::openIndex(QString logPath, qint64 logSize)
+{
+  m_index.close();
+  m_fileBytes = logSize;
+
+  if (!m_journaled)
+  {
+    m_index.open(logPath, logSize);
+  }
+}
+
+/**
+ * Resets the per-segment bookkeeping and queues the file header for a new
+ * segment.
+ */
+void Logger::startSegment(int index)
+{
+  const QByteArray header = (m_format == BinaryFormat) ?
+    BinaryLogEncoder::header(m_tempUnits) : QByteArray(CsvFormat::header());
+
+  memset(&m_segment, 0, sizeof(m_segment));
+  m_segment.index = index;
+  m_segment.bytes = header.size();
+  m_segmentOpenedMs = QDateTime::currentMSecsSinceEpoch();
+  m_lastAttemptedLog = segmentPath(index);
+
+  m_encoder.reset();
+  m_haveLastRow = false;
+  m_writer.append(header, 1);
+  openIndex(m_lastAttemptedLog, header.size());
+}
+
+/**
+ * Moves on to the next segment if the current one is big enough or old
+ * enough. The writer switches files on its own thread; the finished
+ * segment is then compressed and listed in the manifest by the archiver.
+ */
+void Logger::rotateSegment()
+{
+  const bool due =
+    ((m_rotateBytes > 0) && ((qint64)m_segment.bytes >= m_rotateBytes)) ||
+    ((m_rotateSecs > 0) && ((QDateTime::currentMSecsSinceEpoch() - m_segmentOpenedMs) >= (m_rotateSecs * Q_INT64_C(1000))));
+
+  if (due)
+  {
+    const QString finishedPath = m_lastAttemptedLog;
+
+    m_archiver.describe(finishedPath, m_segment);
+
+    // if the previous switch hasn't happened yet, try again next time
+    if (m_writer.rotate(segmentPath(m_segment.index + 1)))
+    {
+      startSegment(m_segment.index + 1);
+    }
+  }
+}
+
+/**
+ * Checks that an existing file is a binary log that we can append to.
+ */
+bool Logger::checkBinaryHeader(QString path)
+{
+  BinaryLogReader reader;
+  return reader.open(path);
 }
 
 /**
@@ -20,26 +201,82 @@ bool Logger::openLog(QString fileName)
 {
   bool success = false;
 
+  // the format of a log that's already open can't change
+  if (!m_writer.isOpen())
+  {
+    m_format = m_requestedFormat;
+    m_logExtension = (m_format == BinaryFormat) ? ".mlog" : ".txt";
+    if (m_journaled)
+    {
+      m_logExtension += ".jnl";
+    }
+
+    m_writer.setJournaled(m_journaled);
+    m_writer.setDurability(m_durability, m_syncIntervalMsecs);
+  }
+
   m_lastAttemptedLog = m_logDir + QDir::separator() + fileName + m_logExtension;
 
   // if the 'logs' directory exists, or if we're able to create it...
-  if (!m_logFile.isOpen() && (QDir(m_logDir).exists() || QDir().mkdir(m_logDir)))
+  if (!m_writer.isOpen() && (QDir(m_logDir).exists() || QDir().mkpath(m_logDir)))
   {
+    if (rotationEnabled())
+    {
+      // carry on after the last segment already on disk, if any
+      int index = 1;
+
+      m_baseName = m_logDir + QDir::separator() + fileName;
+      while (QFileInfo(segmentPath(index)).exists() || QFileInfo(segmentPath(index) + ".gz").exists())
+      {
+        index++;
+      }
+
+      m_archiver.setManifest(m_baseName + ".manifest");
+      m_archiver.setCompression(m_compress);
+
+      if (m_writer.open(segmentPath(index)))
+      {
+        startSegment(index);
+        m_reader->skipToEnd();
+        m_trigger.reset();
+        success = true;
+      }
+      else
+      {
+        m_lastAttemptedLog = segmentPath(index);
+      }
+
+      return success;
+    }
+
     // set the name of the log file and open it for writing
     const bool alreadyExists = QFileInfo(m_lastAttemptedLog).exists();
 
-    m_logFile.setFileName(m_lastAttemptedLog);
-    if (m_logFile.open(QFile::WriteOnly | QFile::Append))
+    // never append binary records to something that isn't a binary log
+    if (alreadyExists && (m_format == BinaryFormat) && !checkBinaryHeader(m_lastAttemptedLog))
     {
-      m_logFileStream.setDevice(&m_logFile);
+      return false;
+    }
+
+    if (m_writer.open(m_lastAttemptedLog))
+    {
+      qint64 size = QFileInfo(m_lastAttemptedLog).size();
 
       if (!alreadyExists)
       {
-        m_logFileStream << "#time,engineSpeed,waterTemp,intakeAirTemp," <<
-          "throttleVoltage,manifoldPressure,idleBypassPos,mainVoltage," <<
-          "idleswitch,closedloop,lambdaVoltage_mV" << Qt::endl;
+        const QByteArray header = (m_format == BinaryFormat) ?
+          BinaryLogEncoder::header(m_tempUnits) : QByteArray(CsvFormat::header());
+
+        m_writer.append(header, 1);
+        size = header.size();
       }
+      m_encoder.reset();
+      m_haveLastRow = false;
+      openIndex(m_lastAttemptedLog, size);
 
+      // only log samples that arrive after the file is opened
+      m_reader->skipToEnd();
+      m_trigger.reset();
       success = true;
     }
   }
@@ -48,49 +285,194 @@ bool Logger::openLog(QString fileName)
 }
 
 /**
- * Close the log file.
+ * Close the log file, once everything queued has been written.
  */
 void Logger::closeLog()
 {
-  m_logFile.close();
+  // the last segment is finished like the others once the writer closes it
+  if (m_writer.isOpen() && rotationEnabled())
+  {
+    m_archiver.describe(m_lastAttemptedLog, m_segment);
+  }
+  m_writer.close();
+  m_index.close();
+}
+
+/**
+ * Adds the record for one sample to the buffer of records to be written.
+ * In change-only mode, a text log only gets a row when some channel has
+ * moved by more than its tolerance since the last row (or when the last
+ * row is s_keyframeIntervalMs old); a binary log is handled the same way,
+ * channel by channel, by the encoder.
+ * @return True if a record was added; false if the sample was left out
+ */
+bool Logger::encodeSample(const MEMSSample& sample)
+{
+  if (m_index.isOpen() && m_index.due(sample.timestampMs))
+  {
+    // reading can only start from a keyframe
+    m_encoder.forceKeyframe();
+    m_haveLastRow = false;
+    m_index.add(sample.timestampMs, m_fileBytes + m_buffer.size());
+  }
+
+  if (m_format == BinaryFormat)
+  {
+    if (!m_encoder.encodeSample(sample, m_buffer))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    if (m_changeOnly && m_haveLastRow &&
+        ((sample.timestampMs - m_lastRowMs) < LogDeadband::s_keyframeIntervalMs) &&
+        !m_deadband.exceeds(m_lastRow, sample.data))
+    {
+      return false;
+    }
+
+    m_csv.encode(sample.timestampMs, &sample.data, m_buffer);
+    m_lastRow = sample.data;
+    m_lastRowMs = sample.timestampMs;
+    m_haveLastRow = true;
+  }
+
+  if (m_segment.samples++ == 0)
+  {
+    m_segment.firstSampleMs = sample.timestampMs;
+  }
+  m_segment.lastSampleMs = sample.timestampMs;
+  return true;
 }
 
 /**
- * Converts degrees F to degrees C if necessary
+ * Appends a comment record, in the format of the current log.
  */
-uint8_t Logger::convertTemp(uint8_t degrees)
+void Logger::encodeComment(qint64 timestampMs, QString note, QByteArray& out)
 {
-  if (m_tempUnits == Celsius)
+  // the first sample after a comment is always written in full
+  m_haveLastRow = false;
+
+  if (m_format == BinaryFormat)
   {
-    return degrees;
+    m_encoder.encodeComment(timestampMs, note, out);
   }
   else
   {
-    return ((degrees * 1.8) + 32);
+    QString line;
+    QTextStream stream(&line);
+    CsvFormat::writeComment(stream, timestampMs, note);
+    stream.flush();
+    out.append(line.toUtf8());
   }
 }
 
 /**
- * Commands the logger to query the interface for the currently
- * buffered data, and write it to the file.
+ * Writes every sample that has arrived from the interface since the last
+ * call (or since the log was opened) to the file. With triggered logging,
+ * samples are only written around events, and comments mark where each
+ * window of samples starts and ends.
  */
 void Logger::logData()
 {
-  mems_data* data = m_mems->getData();
-
-  if (m_logFile.isOpen() && (m_logFileStream.status() == QTextStream::Ok))
-  {
-    m_logFileStream << QDateTime::currentDateTime().toString("hh:mm:ss.zzz") << "," <<
-      data->engine_rpm << "," <<
-      convertTemp(data->coolant_temp_c) << "," <<
-      convertTemp(data->intake_air_temp_c) << "," <<
-      data->throttle_pot_voltage << "," <<
-      data->map_kpa << "," <<
-      data->iac_position << "," <<
-      data->battery_voltage << "," <<
-      data->idle_switch << "," <<
-      data->closed_loop << "," <<
-      data->lambda_voltage_mv << Qt::endl;
+  MEMSSample sample;
+  MEMSSample held;
+  QString reason;
+  int lines = 0;
+
+  // with no log open there's nothing to format the samples for
+  if (!m_writer.isOpen())
+  {
+    m_reader->skipToEnd();
+    return;
+  }
+
+  while (m_reader->next(sample))
+  {
+    if (m_triggered)
+    {
+      const EventTrigger::Action action = m_trigger.process(sample, reason);
+
+      if (action == EventTrigger::Hold)
+      {
+        continue;
+      }
+      else if (action == EventTrigger::End)
+      {
+        encodeComment(sample.timestampMs, "end of triggered window", m_buffer);
+        lines++;
+        continue;
+      }
+      else if (action == EventTrigger::Fire)
+      {
+        encodeComment(sample.timestampMs, "triggered: " + reason, m_buffer);
+        lines++;
+        while (m_trigger.takeHeld(held))
+        {
+          if (encodeSample(held))
+          {
+            lines++;
+          }
+        }
+      }
+    }
+
+    if (encodeSample(sample))
+    {
+      lines++;
+    }
+  }
+
+  // the records are handed to the writer thread in one go; nothing here
+  // waits for the disk
+  if (lines > 0)
+  {
+    if (m_writer.append(m_buffer, lines))
+    {
+      m_fileBytes += m_buffer.size();
+      m_index.commit();
+    }
+    else
+    {
+      // the batch was dropped, so the next sample can't be a delta from
+      // anything in it
+      m_index.discard();
+      m_encoder.reset();
+      m_haveLastRow = false;
+    }
+    m_segment.bytes += m_buffer.size();
+
+    if (rotationEnabled())
+    {
+      rotateSegment();
+    }
+  }
+
+  // resize() rather than clear() keeps the reserved capacity
+  m_buffer.resize(0);
+}
+
+/**
+ * Writes a comment line to the log to record a break in the data (e.g.
+ * while the link to the ECU was being re-established). Any samples that
+ * arrived before the break are written first.
+ */
+void Logger::markGap(QString note)
+{
+  logData();
+
+  if (m_writer.isOpen())
+  {
+    QByteArray record;
+
+    encodeComment(QDateTime::currentMSecsSinceEpoch(), note, record);
+
+    if (m_writer.append(record, 1))
+    {
+      m_fileBytes += record.size();
+    }
+    m_segment.bytes += record.size();
   }
 }
 
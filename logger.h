@@ -2,30 +2,89 @@
 #define LOGGER_H
 
 #include <QString>
-#include <QFile>
-#include <QTextStream>
 #include "memsinterface.h"
+#include "logwriter.h"
+#include "binarylog.h"
+#include "csvencoder.h"
+#include "logarchiver.h"
+#include "logindex.h"
+#include "eventtrigger.h"
+#include "logdeadband.h"
 
 class Logger
 {
 public:
+    enum Format
+    {
+        TextFormat   = 0,
+        BinaryFormat = 1
+    };
+
     Logger(MEMSInterface *memsiface);
+    ~Logger();
     bool openLog(QString fileName);
     void closeLog();
     void logData();
+    void markGap(QString note);
     QString getLogPath();
-    void setTemperatureUnits(TemperatureUnits type) { m_tempUnits = type; }
+    void setLogDirectory(QString dir) { m_logDir = dir; }
+    void setFlushPolicy(int intervalMsecs, int sizeBytes) { m_writer.setFlushPolicy(intervalMsecs, sizeBytes); }
+    LogWriter::Stats getWriterStats() { return m_writer.stats(); }
+    void setTemperatureUnits(TemperatureUnits type) { m_tempUnits = type; m_csv.setTemperatureUnits(type); }
+    void setFormat(Format format);
+    void setRotation(qint64 maxBytes, int maxSecs, bool compress);
+    void setDurability(bool journaled, LogWriter::Durability durability, int syncIntervalMsecs);
+    void setTriggeredLogging(bool enabled, const EventTrigger::Settings& settings);
+    quint64 getTriggerCount() const { return m_trigger.triggerCount(); }
+    void setChangeOnly(bool enabled, const LogDeadband& deadband);
+    bool waitForArchiving(int timeoutMsecs) { return m_archiver.waitForDone(timeoutMsecs); }
 
 private:
-    uint8_t convertTemp(uint8_t degrees);
+    bool checkBinaryHeader(QString path);
+    bool rotationEnabled() const { return (m_rotateBytes > 0) || (m_rotateSecs > 0); }
+    QString segmentPath(int index) const;
+    void startSegment(int index);
+    void rotateSegment();
+    void openIndex(QString logPath, qint64 logSize);
+    bool encodeSample(const MEMSSample& sample);
+    void encodeComment(qint64 timestampMs, QString note, QByteArray& out);
 
     MEMSInterface *m_mems;
+    SampleReader *m_reader;
     QString m_logExtension;
     QString m_logDir;
-    QFile m_logFile;
-    QTextStream m_logFileStream;
+    LogWriter m_writer;
     QString m_lastAttemptedLog;
     TemperatureUnits m_tempUnits;
+    Format m_format;
+    Format m_requestedFormat;
+    BinaryLogEncoder m_encoder;
+    CsvEncoder m_csv;
+    QByteArray m_buffer;
+
+    qint64 m_rotateBytes;
+    int m_rotateSecs;
+    bool m_compress;
+    LogArchiver m_archiver;
+    QString m_baseName;
+    LogArchiver::Segment m_segment;
+    qint64 m_segmentOpenedMs;
+
+    LogIndexWriter m_index;
+    qint64 m_fileBytes;
+
+    bool m_journaled;
+    LogWriter::Durability m_durability;
+    int m_syncIntervalMsecs;
+
+    bool m_triggered;
+    EventTrigger m_trigger;
+
+    bool m_changeOnly;
+    LogDeadband m_deadband;
+    mems_data m_lastRow;
+    qint64 m_lastRowMs;
+    bool m_haveLastRow;
 };
 
 #endif // LOGGER_H
@@ -0,0 +1,319 @@
+#include <QFileInfo>
+#include <string.h>
+#include "logindex.h"
+
+const char LogIndex::s_magic[8] = { 'M', 'E', 'M', 'S', 'I', 'D', 'X', 0 };
+
+namespace
+{
+  void appendLE64(QByteArray& out, qint64 value)
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      out.append((char)(((quint64)value >> (i * 8)) & 0xFF));
+    }
+  }
+
+  qint64 getLE64(const uchar *p)
+  {
+    quint64 value = 0;
+
+    for (int i = 7; i >= 0; i--)
+    {
+      value = (value << 8) | p[i];
+    }
+    return (qint64)value;
+  }
+
+  QByteArray indexHeader()
+  {
+    QByteArray header(LogIndex::s_magic, sizeof(LogIndex::s_magic));
+
+    header.append((char)(LogIndex::s_version & 0xFF));
+    header.append((char)(LogIndex::s_version >> 8));
+    header.append(6, (char)0);
+    return header;
+  }
+
+  bool validHeader(const QByteArray& header)
+  {
+    return (header.size() == LogIndex::s_headerSize) &&
+           (memcmp(header.constData(), LogIndex::s_magic, sizeof(LogIndex::s_magic)) == 0) &&
+           ((uchar)header.at(8) == LogIndex::s_version) && (header.at(9) == 0);
+  }
+}
+
+/**
+ * Constructor.
+ */
+LogIndex::LogIndex():
+m_map(0), m_count(0)
+{
+}
+
+/**
+ * Destructor.
+ */
+LogIndex::~LogIndex()
+{
+  close();
+}
+
+/**
+ * Maps the index of a log file. Entries pointing past the end of the log
+ * (e.g. written just before a crash, when the log itself hadn't reached
+ * the disk) are ignored.
+ * @param logPath Path of the log, not of the index
+ * @return True if the log has a usable index
+ */
+bool LogIndex::open(QString logPath)
+{
+  close();
+
+  m_file.setFileName(pathFor(logPath));
+  if (!m_file.open(QFile::ReadOnly) || !validHeader(m_file.read(s_headerSize)))
+  {
+    close();
+    return false;
+  }
+
+  const qint64 size = m_file.size();
+  m_count = (int)((size - s_headerSize) / s_entrySize);
+  m_map = (m_count > 0) ? m_file.map(0, size) : 0;
+  if (!m_map)
+  {
+    close();
+    return false;
+  }
+
+  const qint64 logSize = QFileInfo(logPath).size();
+  while ((m_count > 0) && (offsetAt(m_count - 1) >= logSize))
+  {
+    m_count--;
+  }
+
+  return (m_count > 0);
+}
+
+/**
+ * Unmaps the index.
+ */
+void LogIndex::close()
+{
+  if (m_map)
+  {
+    m_file.unmap(m_map);
+    m_map = 0;
+  }
+  m_file.close();
+  m_count = 0;
+}
+
+/**
+ * Returns the time of an entry, in msecs since the epoch.
+ */
+qint64 LogIndex::timestampAt(int entry) const
+{
+  return getLE64(m_map + s_headerSize + (qint64)entry * s_entrySize);
+}
+
+/**
+ * Returns the file offset of an entry's record.
+ */
+qint64 LogIndex::offsetAt(int entry) const
+{
+  return getLE64(m_map + s_headerSize + (qint64)entry * s_entrySize + 8);
+}
+
+/**
+ * Finds the last entry at or before a given time.
+ * @param timestampMs Time to find, in msecs since the epoch
+ * @return Entry number, or -1 if the time comes before the first entry
+ */
+int LogIndex::entryBefore(qint64 timestampMs) const
+{
+  int lo = 0;
+  int hi = m_count;
+
+  // find the first entry later than the time we're after
+  while (lo < hi)
+  {
+    const int mid = lo + (hi - lo) / 2;
+
+    if (timestampAt(mid) <= timestampMs)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+
+  return lo - 1;
+}
+
+/**
+ * Finds where to start reading to reach a given time: the offset of the
+ * last indexed record at or before that time.
+ * @param timestampMs Time to find, in msecs since the epoch
+ * @return File offset, or -1 if the time comes before the first entry (in
+ *  which case reading has to start from the beginning of the log)
+ */
+qint64 LogIndex::find(qint64 timestampMs) const
+{
+  const int entry = entryBefore(timestampMs);
+  return (entry >= 0) ? offsetAt(entry) : -1;
+}
+
+/**
+ * Constructor.
+ */
+LogIndexWriter::LogIndexWriter():
+m_haveEntry(false), m_lastMs(0), m_haveCommitted(false), m_lastCommittedMs(0), m_sinceEntry(0)
+{
+}
+
+/**
+ * Destructor.
+ */
+LogIndexWriter::~LogIndexWriter()
+{
+  close();
+}
+
+/**
+ * Opens (or creates) the index for a log. An existing index is appended
+ * to, after dropping any partly written entry and any entries that point
+ * beyond the current end of the log.
+ * @param logPath Path of the log, not of the index
+ * @param logSize Current size of the log, in bytes
+ * @return True on success
+ */
+bool LogIndexWriter::open(QString logPath, qint64 logSize)
+{
+  close();
+
+  m_file.setFileName(LogIndex::pathFor(logPath));
+  if (!m_file.open(QFile::ReadWrite))
+  {
+    return false;
+  }
+
+  qint64 size = m_file.size();
+  if ((size < LogIndex::s_headerSize) || !validHeader(m_file.read(LogIndex::s_headerSize)))
+  {
+    size = LogIndex::s_headerSize;
+    if (!m_file.resize(0) || !m_file.seek(0) || (m_file.write(indexHeader()) != LogIndex::s_headerSize))
+    {
+      close();
+      return false;
+    }
+  }
+
+  size -= (size - LogIndex::s_headerSize) % LogIndex::s_entrySize;
+  while (size > LogIndex::s_headerSize)
+  {
+    uchar entry[LogIndex::s_entrySize];
+
+    if (!m_file.seek(size - LogIndex::s_entrySize) ||
+        (m_file.read((char*)entry, sizeof(entry)) != (qint64)sizeof(entry)))
+    {
+      close();
+      return false;
+    }
+
+    if (getLE64(entry + 8) < logSize)
+    {
+      m_haveEntry = true;
+      m_lastMs = getLE64(entry);
+      break;
+    }
+    size -= LogIndex::s_entrySize;
+  }
+
+  if (!m_file.resize(size) || !m_file.seek(size))
+  {
+    close();
+    return false;
+  }
+
+  m_haveCommitted = m_haveEntry;
+  m_lastCommittedMs = m_lastMs;
+  return true;
+}
+
+/**
+ * Closes the index. Entries that haven't been committed are dropped.
+ */
+void LogIndexWriter::close()
+{
+  m_file.close();
+  m_pending.clear();
+  m_haveEntry = false;
+  m_lastMs = 0;
+  m_haveCommitted = false;
+  m_lastCommittedMs = 0;
+  m_sinceEntry = 0;
+}
+
+/**
+ * Decides whether a sample should be indexed. Call this once for every
+ * sample written, in order. A sample whose time is earlier than the last
+ * entry's (e.g. after the clock was set back) is never indexed, so that
+ * the entries stay in order.
+ * @param timestampMs Time of the sample, in msecs since the epoch
+ * @return True if the sample should be added with add()
+ */
+bool LogIndexWriter::due(qint64 timestampMs)
+{
+  m_sinceEntry++;
+
+  if (!m_haveEntry)
+  {
+    return true;
+  }
+
+  return (timestampMs >= m_lastMs) &&
+         (((timestampMs - m_lastMs) >= LogIndex::s_intervalMs) || (m_sinceEntry >= LogIndex::s_intervalSamples));
+}
+
+/**
+ * Adds an entry, to be written at the next commit().
+ * @param timestampMs Time of the sample, in msecs since the epoch
+ * @param offset File offset at which the sample's record will start
+ */
+void LogIndexWriter::add(qint64 timestampMs, qint64 offset)
+{
+  appendLE64(m_pending, timestampMs);
+  appendLE64(m_pending, offset);
+  m_haveEntry = true;
+  m_lastMs = timestampMs;
+  m_sinceEntry = 0;
+}
+
+/**
+ * Writes the entries added since the last commit. The file is buffered,
+ * so this rarely touches the disk.
+ */
+void LogIndexWriter::commit()
+{
+  if (!m_pending.isEmpty() && m_file.isOpen())
+  {
+    m_file.write(m_pending);
+  }
+  m_pending.resize(0);
+  m_haveCommitted = m_haveEntry;
+  m_lastCommittedMs = m_lastMs;
+}
+
+/**
+ * Drops the entries added since the last commit (because the records they
+ * point to were never written).
+ */
+void LogIndexWriter::discard()
+{
+  m_pending.resize(0);
+  m_haveEntry = m_haveCommitted;
+  m_lastMs = m_lastCommittedMs;
+}
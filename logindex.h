@@ -0,0 +1,80 @@
+#ifndef LOGINDEX_H
+#define LOGINDEX_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/**
+ * Sparse time index for a log file, kept next to the log as "<log>.idx".
+ *
+ * The index starts with a 16-byte header (the magic "MEMSIDX\0", a 16-bit
+ * version, and six reserved bytes) followed by fixed-size entries: the
+ * wall-clock time of a sample (msecs since the epoch) and the file offset
+ * of the record holding it, both little-endian 64-bit values. An entry is
+ * added for the first sample after every s_intervalMs of wall-clock time
+ * or every s_intervalSamples samples, whichever comes first. Entries are
+ * in order of both time and offset, so a reader can binary-search them in
+ * place and then read forward from the offset found; in binary logs, each
+ * indexed sample is written as a keyframe so that reading can start there.
+ */
+class LogIndex
+{
+public:
+    static const quint16 s_version = 1;
+    static const int s_headerSize = 16;
+    static const int s_entrySize = 16;
+    static const qint64 s_intervalMs = 1000;
+    static const int s_intervalSamples = 1000;
+    static const char s_magic[8];
+
+    static QString pathFor(QString logPath) { return logPath + ".idx"; }
+
+    LogIndex();
+    ~LogIndex();
+
+    bool open(QString logPath);
+    void close();
+    int count() const { return m_count; }
+    qint64 timestampAt(int entry) const;
+    qint64 offsetAt(int entry) const;
+    int entryBefore(qint64 timestampMs) const;
+    qint64 find(qint64 timestampMs) const;
+
+private:
+    QFile m_file;
+    uchar *m_map;
+    int m_count;
+};
+
+/**
+ * Writes the index for a log as the log is written. Entries for a batch of
+ * records are held back until the batch has been accepted by the log
+ * writer, so that the index never points at data that was dropped.
+ */
+class LogIndexWriter
+{
+public:
+    LogIndexWriter();
+    ~LogIndexWriter();
+
+    bool open(QString logPath, qint64 logSize);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    bool due(qint64 timestampMs);
+    void add(qint64 timestampMs, qint64 offset);
+    void commit();
+    void discard();
+
+private:
+    QFile m_file;
+    QByteArray m_pending;
+    bool m_haveEntry;
+    qint64 m_lastMs;
+    bool m_haveCommitted;
+    qint64 m_lastCommittedMs;
+    int m_sinceEntry;
+};
+
+#endif // LOGINDEX_H
@@ -0,0 +1,421 @@
+#include <QFile>
+#include <algorithm>
+#include <string.h>
+#include "logpyramid.h"
+#include "binarylog.h"
+#include "csvdecoder.h"
+#include "journal.h"
+
+namespace
+{
+  // names as used in the text log's header
+  const char *const s_channelNames[LogPyramid::NumChannels] =
+  {
+    "engineSpeed",
+    "waterTemp",
+    "intakeAirTemp",
+    "throttleVoltage",
+    "manifoldPressure",
+    "idleBypassPos",
+    "mainVoltage",
+    "idleswitch",
+    "closedloop",
+    "lambdaVoltage_mV"
+  };
+
+  const qint64 s_msecsPerDay = 24 * 60 * 60 * 1000;
+
+  void fillValues(const mems_data& data, float *values)
+  {
+    values[LogPyramid::EngineSpeed] = data.engine_rpm;
+    values[LogPyramid::WaterTemp] = data.coolant_temp_c;
+    values[LogPyramid::IntakeAirTemp] = data.intake_air_temp_c;
+    values[LogPyramid::ThrottleVoltage] = data.throttle_pot_voltage;
+    values[LogPyramid::ManifoldPressure] = data.map_kpa;
+    values[LogPyramid::IdleBypassPos] = data.iac_position;
+    values[LogPyramid::MainVoltage] = data.battery_voltage;
+    values[LogPyramid::IdleSwitch] = data.idle_switch ? 1 : 0;
+    values[LogPyramid::ClosedLoop] = data.closed_loop ? 1 : 0;
+    values[LogPyramid::LambdaVoltage] = data.lambda_voltage_mv;
+  }
+}
+
+LogPyramid::LogPyramid(QObject *parent):
+QThread(parent), m_cancel(0), m_binary(false), m_startMs(0), m_lastPercent(-1)
+{
+  reset();
+}
+
+LogPyramid::~LogPyramid()
+{
+  cancel();
+  wait();
+}
+
+const char* LogPyramid::channelName(int channel)
+{
+  return ((channel >= 0) && (channel < NumChannels)) ? s_channelNames[channel] : "";
+}
+
+void LogPyramid::reset()
+{
+  for (int level = 0; level < s_levels; level++)
+  {
+    m_levels[level].timeMs.clear();
+    for (int c = 0; c < NumChannels; c++)
+    {
+      m_levels[level].min[c].clear();
+      m_levels[level].max[c].clear();
+    }
+    m_buckets[level].count = 0;
+  }
+
+  for (int c = 0; c < NumChannels; c++)
+  {
+    m_channelMin[c] = 0.0f;
+    m_channelMax[c] = 0.0f;
+  }
+  m_error.clear();
+  m_startMs = 0;
+  m_lastPercent = -1;
+}
+
+/**
+ * Starts reading a log and building the levels. progress() is emitted as
+ * this goes on, and finished() once the levels are complete (or the log
+ * couldn't be read, in which case errorString() says why).
+ */
+void LogPyramid::load(QString path)
+{
+  cancel();
+  wait();
+
+  m_path = path;
+  m_cancel.store(0);
+  start(QThread::LowPriority);
+}
+
+/**
+ * Asks the thread to stop early. Whatever was read up to that point is
+ * kept.
+ */
+void LogPyramid::cancel()
+{
+  m_cancel.store(1);
+}
+
+void LogPyramid::run()
+{
+  const QByteArray magic(BinaryLog::s_magic, sizeof(BinaryLog::s_magic));
+
+  reset();
+
+  if (Journal::isJournal(m_path))
+  {
+    JournalReader journal;
+    m_binary = journal.openJournal(m_path) && (journal.peek(magic.size()) == magic);
+  }
+  else
+  {
+    QFile file(m_path);
+    m_binary = file.open(QFile::ReadOnly) && (file.peek(magic.size()) == magic);
+  }
+
+  if (m_binary ? readBinary() : readText())
+  {
+    flushBuckets();
+    if (m_levels[0].timeMs.isEmpty() && m_error.isEmpty())
+    {
+      m_error = "The log doesn't contain any samples";
+    }
+  }
+  emit progress(100);
+}
+
+/**
+ * Reads a text log, with the whole file mapped into memory where possible.
+ */
+bool LogPyramid::readText()
+{
+  QFile file;
+  QByteArray contents;
+  const char *data;
+  qint64 size;
+
+  if (Journal::isJournal(m_path))
+  {
+    JournalReader journal;
+    if (!journal.openJournal(m_path))
+    {
+      m_error = "Unable to open " + m_path;
+      return false;
+    }
+    contents = journal.readAll();
+    data = contents.constData();
+    size = contents.size();
+  }
+  else
+  {
+    file.setFileName(m_path);
+    if (!file.open(QFile::ReadOnly))
+    {
+      m_error = "Unable to open " + m_path;
+      return false;
+    }
+
+    size = file.size();
+    uchar *map = (size > 0) ? file.map(0, size) : 0;
+    if (!map)
+    {
+      contents = file.readAll();
+    }
+    data = map ? (const char*)map : contents.constData();
+  }
+
+  CsvDecoder decoder;
+  CsvDecoder::Record record;
+  CsvDecoder::LineType type;
+  float values[NumChannels];
+  bool haveTime = false;
+  qint64 lastTimeOfDayMs = 0;
+  qint64 positionMs = 0;
+  int lines = 0;
+
+  decoder.setData(data, data + size);
+  while (((type = decoder.next(record)) != CsvDecoder::EndOfData) && !m_cancel.load())
+  {
+    if (type != CsvDecoder::SampleLine)
+    {
+      continue;
+    }
+
+    if (haveTime)
+    {
+      qint64 deltaMs = record.timeOfDayMs - lastTimeOfDayMs;
+      if (deltaMs < -(s_msecsPerDay / 2))
+      {
+        deltaMs += s_msecsPerDay;
+      }
+      positionMs += qMax(Q_INT64_C(0), deltaMs);
+    }
+    else
+    {
+      m_startMs = record.timeOfDayMs;
+      haveTime = true;
+    }
+    lastTimeOfDayMs = record.timeOfDayMs;
+
+    fillValues(record.data, values);
+    addSample(positionMs, values);
+
+    if ((++lines % 4096) == 0)
+    {
+      reportProgress(decoder.lineStart() - data, size);
+    }
+  }
+
+  return true;
+}
+
+bool LogPyramid::readBinary()
+{
+  BinaryLogReader reader;
+  BinaryLogRecord record;
+  float values[NumChannels];
+  const qint64 size = QFile(m_path).size();
+  bool haveTime = false;
+  qint64 lastMs = 0;
+  int records = 0;
+
+  if (!reader.open(m_path))
+  {
+    m_error = reader.errorString();
+    return false;
+  }
+
+  while (!m_cancel.load() && reader.next(record))
+  {
+    if (record.type != BinaryLogRecord::Sample)
+    {
+      continue;
+    }
+
+    if (!haveTime)
+    {
+      m_startMs = record.timestampMs;
+      haveTime = true;
+    }
+
+    // keep the times in order even if the clock was set back
+    lastMs = qMax(lastMs, record.timestampMs - m_startMs);
+
+    fillValues(record.data, values);
+    addSample(lastMs, values);
+
+    // journaled logs don't report a useful position
+    if (((++records % 4096) == 0) && !Journal::isJournal(m_path))
+    {
+      reportProgress(reader.position(), size);
+    }
+  }
+
+  if (!reader.errorString().isEmpty() && !reader.truncated())
+  {
+    m_error = reader.errorString();
+  }
+  return true;
+}
+
+void LogPyramid::reportProgress(qint64 done, qint64 total)
+{
+  const int percent = (total > 0) ? (int)((done * 100) / total) : 0;
+
+  if (percent != m_lastPercent)
+  {
+    m_lastPercent = percent;
+    emit progress(percent);
+  }
+}
+
+void LogPyramid::addSample(qint64 timeMs, const float *values)
+{
+  if (m_levels[0].timeMs.isEmpty())
+  {
+    for (int c = 0; c < NumChannels; c++)
+    {
+      m_channelMin[c] = values[c];
+      m_channelMax[c] = values[c];
+    }
+  }
+  else
+  {
+    for (int c = 0; c < NumChannels; c++)
+    {
+      m_channelMin[c] = qMin(m_channelMin[c], values[c]);
+      m_channelMax[c] = qMax(m_channelMax[c], values[c]);
+    }
+  }
+
+  addEntry(0, timeMs, values, values);
+}
+
+/**
+ * Appends an entry to a level, and adds it to the partly-built entry of
+ * the level above, which is itself appended once it covers s_decimation
+ * entries.
+ */
+void LogPyramid::addEntry(int level, qint64 timeMs, const float *min, const float *max)
+{
+  Level& l = m_levels[level];
+
+  l.timeMs.append(timeMs);
+  for (int c = 0; c < NumChannels; c++)
+  {
+    l.min[c].append(min[c]);
+    if (level > 0)
+    {
+      l.max[c].append(max[c]);
+    }
+  }
+
+  if ((level + 1) < s_levels)
+  {
+    mergeIntoBucket(level + 1, timeMs, min, max);
+
+    Bucket& b = m_buckets[level + 1];
+    if (b.count == s_decimation)
+    {
+      b.count = 0;
+      addEntry(level + 1, b.timeMs, b.min, b.max);
+    }
+  }
+}
+
+void LogPyramid::mergeIntoBucket(int level, qint64 timeMs, const float *min, const float *max)
+{
+  Bucket& b = m_buckets[level];
+
+  if (b.count == 0)
+  {
+    b.timeMs = timeMs;
+    memcpy(b.min, min, sizeof(b.min));
+    memcpy(b.max, max, sizeof(b.max));
+  }
+  else
+  {
+    for (int c = 0; c < NumChannels; c++)
+    {
+      b.min[c] = qMin(b.min[c], min[c]);
+      b.max[c] = qMax(b.max[c], max[c]);
+    }
+  }
+  b.count++;
+}
+
+/**
+ * Appends the partly-built entries at the end of the log, from the bottom
+ * level up, so that every level covers the whole log.
+ */
+void LogPyramid::flushBuckets()
+{
+  for (int level = 1; level < s_levels; level++)
+  {
+    Bucket& b = m_buckets[level];
+
+    if (b.count > 0)
+    {
+      Level& l = m_levels[level];
+
+      l.timeMs.append(b.timeMs);
+      for (int c = 0; c < NumChannels; c++)
+      {
+        l.min[c].append(b.min[c]);
+        l.max[c].append(b.max[c]);
+      }
+
+      if ((level + 1) < s_levels)
+      {
+        mergeIntoBucket(level + 1, b.timeMs, b.min, b.max);
+      }
+      b.count = 0;
+    }
+  }
+}
+
+qint64 LogPyramid::durationMs() const
+{
+  return m_levels[0].timeMs.isEmpty() ? 0 : m_levels[0].timeMs.last();
+}
+
+float LogPyramid::maxAt(int level, int channel, int index) const
+{
+  return (level == 0) ? m_levels[0].min[channel].at(index) : m_levels[level].max[channel].at(index);
+}
+
+/**
+ * Finds the first entry of a level at or after the given time.
+ * @return Index of the entry, or count(level) if there is none
+ */
+int LogPyramid::indexAt(int level, qint64 timeMs) const
+{
+  const QVector<qint64>& times = m_levels[level].timeMs;
+  return std::lower_bound(times.constBegin(), times.constEnd(), timeMs) - times.constBegin();
+}
+
+/**
+ * Chooses the most detailed level that has no more than two entries per
+ * pixel over the given time span, so that drawing it costs about the same
+ * at any zoom.
+ */
+int LogPyramid::levelFor(qint64 fromMs, qint64 toMs, int pixels) const
+{
+  qint64 entries = indexAt(0, toMs) - indexAt(0, fromMs);
+  int level = 0;
+
+  while (((level + 1) < s_levels) && (entries > (2 * qMax(1, pixels))))
+  {
+    entries /= s_decimation;
+    level++;
+  }
+  return level;
+}
@@ -0,0 +1,116 @@
+#ifndef LOGPYRAMID_H
+#define LOGPYRAMID_H
+
+#include <QThread>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+
+/**
+ * Multi-resolution copy of a recorded log, for drawing it at any zoom
+ * level without visiting every sample. Level 0 holds the samples
+ * themselves; each level after that holds the minimum and maximum of each
+ * channel over s_decimation consecutive entries of the level below (so
+ * 1:16, 1:256 and 1:4096 samples), along with the time of the first.
+ *
+ * The log (text or binary, plain or journaled, as written by Logger) is
+ * read and all levels are built in a single pass on a thread of its own,
+ * which reports progress as it goes. Once the thread has finished, the
+ * levels don't change, so they can be read from any thread without
+ * locking.
+ *
+ * Times are msecs from the first sample. Text logs only record the time of
+ * day, so their times are worked out from the change between samples
+ * (allowing for midnight), as for replay.
+ */
+class LogPyramid : public QThread
+{
+    Q_OBJECT
+public:
+    // in the column order of the text log
+    enum Channel
+    {
+        EngineSpeed,
+        WaterTemp,
+        IntakeAirTemp,
+        ThrottleVoltage,
+        ManifoldPressure,
+        IdleBypassPos,
+        MainVoltage,
+        IdleSwitch,
+        ClosedLoop,
+        LambdaVoltage,
+        NumChannels
+    };
+
+    static const int s_levels = 4;
+    static const int s_decimation = 16;
+
+    explicit LogPyramid(QObject *parent = 0);
+    ~LogPyramid();
+
+    void load(QString path);
+    void cancel();
+
+    static const char* channelName(int channel);
+
+    // valid once the thread has finished
+    QString errorString() const { return m_error; }
+    QString path() const { return m_path; }
+    qint64 startTimeMs() const { return m_startMs; }
+    bool timeOfDayOnly() const { return !m_binary; }
+    qint64 durationMs() const;
+    int count(int level) const { return m_levels[level].timeMs.count(); }
+    qint64 timeAt(int level, int index) const { return m_levels[level].timeMs.at(index); }
+    float minAt(int level, int channel, int index) const { return m_levels[level].min[channel].at(index); }
+    float maxAt(int level, int channel, int index) const;
+    float channelMin(int channel) const { return m_channelMin[channel]; }
+    float channelMax(int channel) const { return m_channelMax[channel]; }
+    int indexAt(int level, qint64 timeMs) const;
+    int levelFor(qint64 fromMs, qint64 toMs, int pixels) const;
+
+signals:
+    void progress(int percent);
+
+protected:
+    void run();
+
+private:
+    struct Level
+    {
+        QVector<qint64> timeMs;
+        QVector<float> min[NumChannels];
+        QVector<float> max[NumChannels];   // empty for level 0, where min == max
+    };
+
+    // partly-filled entry of a level above 0
+    struct Bucket
+    {
+        int count;
+        qint64 timeMs;
+        float min[NumChannels];
+        float max[NumChannels];
+    };
+
+    QString m_path;
+    QString m_error;
+    QAtomicInt m_cancel;
+    bool m_binary;
+    qint64 m_startMs;
+    Level m_levels[s_levels];
+    Bucket m_buckets[s_levels];
+    float m_channelMin[NumChannels];
+    float m_channelMax[NumChannels];
+    int m_lastPercent;
+
+    void reset();
+    bool readText();
+    bool readBinary();
+    void addSample(qint64 timeMs, const float *values);
+    void addEntry(int level, qint64 timeMs, const float *min, const float *max);
+    void mergeIntoBucket(int level, qint64 timeMs, const float *min, const float *max);
+    void flushBuckets();
+    void reportProgress(qint64 done, qint64 total);
+};
+
+#endif // LOGPYRAMID_H
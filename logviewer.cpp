@@ -0,0 +1,473 @@
+#include <QPainter>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QKeyEvent>
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QAction>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTime>
+#include <QVector>
+#include <QLineF>
+#include <math.h>
+#include "logviewer.h"
+
+namespace
+{
+  // candidate spacings of the time axis ticks
+  const qint64 s_tickSpacingsMs[] =
+  {
+    10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 15000, 30000, 60000, 120000, 300000,
+    600000, 900000, 1800000, 3600000, 7200000, 10800000, 21600000, 43200000
+  };
+
+  const int s_minTickPixels = 90;
+  const qint64 s_msecsPerDay = 24 * 60 * 60 * 1000;
+}
+
+LogViewer::LogViewer(QWidget *parent):
+QWidget(parent), m_loaded(false), m_progress(0), m_viewStartMs(0), m_viewSpanMs(s_minSpanMs),
+m_dragging(false), m_dragX(0), m_dragStartMs(0), m_hoverX(-1), m_lastLevel(0), m_lastFrameMs(0.0)
+{
+  for (int c = 0; c < LogPyramid::NumChannels; c++)
+  {
+    m_visible[c] = false;
+  }
+  m_visible[LogPyramid::EngineSpeed] = true;
+  m_visible[LogPyramid::WaterTemp] = true;
+  m_visible[LogPyramid::ThrottleVoltage] = true;
+  m_visible[LogPyramid::ManifoldPressure] = true;
+  m_visible[LogPyramid::LambdaVoltage] = true;
+
+  m_pyramid = new LogPyramid(this);
+  connect(m_pyramid, SIGNAL(progress(int)), this, SLOT(onProgress(int)));
+  connect(m_pyramid, SIGNAL(finished()), this, SLOT(onLoaded()));
+
+  setFocusPolicy(Qt::StrongFocus);
+  setMouseTracking(true);
+  setMinimumSize(320, 240);
+}
+
+QSize LogViewer::sizeHint() const
+{
+  return QSize(900, 600);
+}
+
+/**
+ * Starts loading a log (text or binary, as written by Logger). The view
+ * shows the progress until the log is ready.
+ */
+void LogViewer::open(QString path)
+{
+  m_loaded = false;
+  m_progress = 0;
+  m_pyramid->load(path);
+  update();
+}
+
+void LogViewer::setChannelVisible(int channel, bool visible)
+{
+  if ((channel >= 0) && (channel < LogPyramid::NumChannels))
+  {
+    m_visible[channel] = visible;
+    update();
+  }
+}
+
+void LogViewer::onProgress(int percent)
+{
+  if (!m_loaded && (percent != m_progress))
+  {
+    m_progress = percent;
+    update();
+  }
+}
+
+void LogViewer::onLoaded()
+{
+  // ignore a load that was cancelled by opening another log
+  if (m_pyramid->isRunning())
+  {
+    return;
+  }
+
+  m_loaded = true;
+  setView(0, m_pyramid->durationMs());
+}
+
+QRect LogViewer::plotArea() const
+{
+  return QRect(s_marginLeft, s_stripSpacing, width() - s_marginLeft - s_marginRight,
+               height() - s_stripSpacing - s_axisHeight);
+}
+
+qint64 LogViewer::timeAtX(int x) const
+{
+  const QRect area = plotArea();
+  return m_viewStartMs + (qint64)((double)(x - area.left()) * m_viewSpanMs / qMax(1, area.width()));
+}
+
+double LogViewer::xAtTime(qint64 timeMs) const
+{
+  const QRect area = plotArea();
+  return area.left() + ((double)(timeMs - m_viewStartMs) * area.width() / m_viewSpanMs);
+}
+
+/**
+ * Moves the view, keeping it within the log. Does nothing while the log is
+ * loading, since the pyramid's levels are still being built.
+ */
+void LogViewer::setView(qint64 startMs, qint64 spanMs)
+{
+  if (!m_loaded)
+  {
+    return;
+  }
+
+  const qint64 durationMs = qMax(Q_INT64_C(1), m_pyramid->durationMs());
+
+  m_viewSpanMs = qBound(qMin(s_minSpanMs, durationMs), spanMs, durationMs);
+  m_viewStartMs = qBound(Q_INT64_C(0), startMs, durationMs - m_viewSpanMs);
+  update();
+}
+
+/**
+ * Changes the span shown, keeping the time under the given position still.
+ * @param factor New span as a multiple of the current one
+ */
+void LogViewer::zoom(double factor, int aroundX)
+{
+  const QRect area = plotArea();
+  const qint64 anchorMs = timeAtX(aroundX);
+  const qint64 spanMs = (qint64)(m_viewSpanMs * factor);
+
+  setView(anchorMs - (qint64)((double)(aroundX - area.left()) * spanMs / qMax(1, area.width())), spanMs);
+}
+
+void LogViewer::paintEvent(QPaintEvent *)
+{
+  QElapsedTimer timer;
+  QPainter painter(this);
+
+  timer.start();
+  painter.fillRect(rect(), palette().color(QPalette::Base));
+  painter.setPen(palette().color(QPalette::Text));
+
+  if (!m_loaded)
+  {
+    painter.drawText(rect(), Qt::AlignCenter, QString("Loading %1... %2%").arg(QFileInfo(m_pyramid->path()).fileName()).arg(m_progress));
+    return;
+  }
+  if (m_pyramid->count(0) == 0)
+  {
+    painter.drawText(rect(), Qt::AlignCenter, m_pyramid->errorString());
+    return;
+  }
+
+  QList<int> channels;
+  for (int c = 0; c < LogPyramid::NumChannels; c++)
+  {
+    if (m_visible[c])
+    {
+      channels.append(c);
+    }
+  }
+
+  const QRect area = plotArea();
+  const int level = m_pyramid->levelFor(m_viewStartMs, m_viewStartMs + m_viewSpanMs, area.width());
+
+  if (!channels.isEmpty())
+  {
+    const int stripHeight = (area.height() - ((channels.count() - 1) * s_stripSpacing)) / channels.count();
+
+    for (int i = 0; i < channels.count(); i++)
+    {
+      const QRect strip(area.left(), area.top() + (i * (stripHeight + s_stripSpacing)), area.width(), stripHeight);
+      drawChannel(painter, channels.at(i), strip, level);
+    }
+  }
+  else
+  {
+    painter.drawText(area, Qt::AlignCenter, "No channels selected (right-click to choose)");
+  }
+
+  drawTimeAxis(painter, QRect(area.left(), area.bottom() + 1, area.width(), s_axisHeight));
+
+  // values under the pointer, from the samples themselves
+  if ((m_hoverX >= area.left()) && (m_hoverX <= area.right()) && !channels.isEmpty())
+  {
+    const int stripHeight = (area.height() - ((channels.count() - 1) * s_stripSpacing)) / channels.count();
+    const int index = qMin(m_pyramid->indexAt(0, timeAtX(m_hoverX)), m_pyramid->count(0) - 1);
+
+    painter.setPen(QPen(palette().color(QPalette::Mid), 0, Qt::DashLine));
+    painter.drawLine(m_hoverX, area.top(), m_hoverX, area.bottom());
+    painter.setPen(palette().color(QPalette::Text));
+
+    for (int i = 0; i < channels.count(); i++)
+    {
+      const QRect strip(area.left() + 4, area.top() + (i * (stripHeight + s_stripSpacing)) + 2,
+                        area.width() - 8, stripHeight - 4);
+      painter.drawText(strip, Qt::AlignRight | Qt::AlignTop,
+                       QString::number(m_pyramid->minAt(0, channels.at(i), index), 'g', 5));
+    }
+  }
+
+  m_lastLevel = level;
+  m_lastFrameMs = timer.nsecsElapsed() / 1e6;
+}
+
+/**
+ * Draws one channel in its strip. Each pixel column gets a vertical line
+ * covering the range of the entries that fall in it, extended to meet the
+ * previous column, so that short spikes are never lost however far out
+ * the view is zoomed.
+ */
+void LogViewer::drawChannel(QPainter& painter, int channel, const QRect& strip, int level)
+{
+  const QColor color = QColor::fromHsv((channel * 36) % 360, 200, 170);
+  float lo = m_pyramid->channelMin(channel);
+  float hi = m_pyramid->channelMax(channel);
+
+  painter.setPen(palette().color(QPalette::Mid));
+  painter.drawRect(strip.adjusted(0, 0, -1, -1));
+  painter.setPen(palette().color(QPalette::Text));
+  painter.drawText(strip.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop, LogPyramid::channelName(channel));
+  painter.drawText(strip.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignBottom,
+                   QString("%1 to %2").arg(lo, 0, 'g', 5).arg(hi, 0, 'g', 5));
+
+  if ((hi - lo) < 1e-6f)
+  {
+    lo -= 1.0f;
+    hi += 1.0f;
+  }
+
+  const double top = strip.top() + 2;
+  const double scale = (strip.height() - 5) / (double)(hi - lo);
+  const int count = m_pyramid->count(level);
+  const int first = qMax(0, m_pyramid->indexAt(level, m_viewStartMs) - 1);
+  const int last = qMin(count, m_pyramid->indexAt(level, m_viewStartMs + m_viewSpanMs) + 1);
+
+  QVector<QLineF> lines;
+  lines.reserve(2 * strip.width() + 16);
+
+  bool haveColumn = false;
+  bool havePrevious = false;
+  int colX = 0;
+  float colLo = 0.0f;
+  float colHi = 0.0f;
+  int prevX = 0;
+  float prevLo = 0.0f;
+  float prevHi = 0.0f;
+
+  for (int i = first; i <= last; i++)
+  {
+    const bool end = (i == last);
+    const int x = end ? 0 : (int)floor(xAtTime(m_pyramid->timeAt(level, i)));
+    const float vLo = end ? 0.0f : m_pyramid->minAt(level, channel, i);
+    const float vHi = end ? 0.0f : m_pyramid->maxAt(level, channel, i);
+
+    if (!end && haveColumn && (x == colX))
+    {
+      colLo = qMin(colLo, vLo);
+      colHi = qMax(colHi, vHi);
+      continue;
+    }
+
+    if (haveColumn)
+    {
+      float segLo = colLo;
+      float segHi = colHi;
+
+      if (havePrevious && ((colX - prevX) > 1))
+      {
+        // far apart (zoomed in): join the middles
+        lines.append(QLineF(prevX + 0.5, top + ((hi - (prevLo + prevHi) / 2) * scale),
+                            colX + 0.5, top + ((hi - (colLo + colHi) / 2) * scale)));
+      }
+      else if (havePrevious)
+      {
+        segLo = qMin(segLo, prevHi);
+        segHi = qMax(segHi, prevLo);
+      }
+
+      const double yTop = top + ((hi - segHi) * scale);
+      const double yBottom = qMax(yTop + 1.0, top + ((hi - segLo) * scale));
+      lines.append(QLineF(colX + 0.5, yTop, colX + 0.5, yBottom));
+
+      prevX = colX;
+      prevLo = colLo;
+      prevHi = colHi;
+      havePrevious = true;
+    }
+
+    haveColumn = !end;
+    colX = x;
+    colLo = vLo;
+    colHi = vHi;
+  }
+
+  painter.save();
+  painter.setClipRect(strip.adjusted(1, 1, -1, -1));
+  painter.setPen(QPen(color, 0));
+  painter.drawLines(lines);
+  painter.restore();
+}
+
+void LogViewer::drawTimeAxis(QPainter& painter, const QRect& area)
+{
+  const double pixelsPerMs = (double)area.width() / m_viewSpanMs;
+  const int spacings = sizeof(s_tickSpacingsMs) / sizeof(s_tickSpacingsMs[0]);
+  qint64 tickMs = s_tickSpacingsMs[spacings - 1];
+
+  for (int i = 0; i < spacings; i++)
+  {
+    if ((s_tickSpacingsMs[i] * pixelsPerMs) >= s_minTickPixels)
+    {
+      tickMs = s_tickSpacingsMs[i];
+      break;
+    }
+  }
+
+  // put the ticks on round wall-clock times
+  const qint64 startMs = m_pyramid->startTimeMs();
+  const qint64 firstWallMs = startMs + m_viewStartMs;
+  qint64 tickWallMs = ((firstWallMs + tickMs - 1) / tickMs) * tickMs;
+
+  painter.setPen(palette().color(QPalette::Text));
+  for (; tickWallMs <= (firstWallMs + m_viewSpanMs); tickWallMs += tickMs)
+  {
+    const int x = (int)xAtTime(tickWallMs - startMs);
+
+    painter.drawLine(x, area.top(), x, area.top() + 4);
+    painter.drawText(QRect(x - (s_minTickPixels / 2), area.top() + 4, s_minTickPixels, area.height() - 4),
+                     Qt::AlignHCenter | Qt::AlignTop, formatTime(tickWallMs - startMs, tickMs));
+  }
+
+  // which level was drawn, and how long the last frame took
+  const QString status = QString("1:%1, %2 ms")
+                         .arg((int)pow((double)LogPyramid::s_decimation, m_lastLevel))
+                         .arg(m_lastFrameMs, 0, 'f', 1);
+  painter.setPen(palette().color(QPalette::Mid));
+  painter.drawText(QRect(0, area.top() + 4, width() - s_marginRight, area.height() - 4),
+                   Qt::AlignRight | Qt::AlignTop, status);
+}
+
+/**
+ * Formats a time on the axis as the wall-clock time.
+ */
+QString LogViewer::formatTime(qint64 timeMs, qint64 tickMs) const
+{
+  const QString format = (tickMs < 1000) ? "hh:mm:ss.zzz" : "hh:mm:ss";
+  const qint64 wallMs = m_pyramid->startTimeMs() + timeMs;
+
+  if (m_pyramid->timeOfDayOnly())
+  {
+    return QTime::fromMSecsSinceStartOfDay((int)(wallMs % s_msecsPerDay)).toString(format);
+  }
+  return QDateTime::fromMSecsSinceEpoch(wallMs).toString(format);
+}
+
+void LogViewer::wheelEvent(QWheelEvent *event)
+{
+  if (m_loaded)
+  {
+    const double steps = event->angleDelta().y() / 120.0;
+    zoom(pow(0.8, steps), event->position().toPoint().x());
+  }
+  event->accept();
+}
+
+void LogViewer::mousePressEvent(QMouseEvent *event)
+{
+  if (event->button() == Qt::LeftButton)
+  {
+    m_dragging = true;
+    m_dragX = event->x();
+    m_dragStartMs = m_viewStartMs;
+    setCursor(Qt::ClosedHandCursor);
+  }
+}
+
+void LogViewer::mouseMoveEvent(QMouseEvent *event)
+{
+  m_hoverX = event->x();
+
+  if (m_dragging)
+  {
+    const qint64 deltaMs = (qint64)((double)(m_dragX - event->x()) * m_viewSpanMs / qMax(1, plotArea().width()));
+    setView(m_dragStartMs + deltaMs, m_viewSpanMs);
+  }
+  else
+  {
+    update();
+  }
+}
+
+void LogViewer::mouseReleaseEvent(QMouseEvent *event)
+{
+  if (event->button() == Qt::LeftButton)
+  {
+    m_dragging = false;
+    unsetCursor();
+  }
+}
+
+void LogViewer::mouseDoubleClickEvent(QMouseEvent *)
+{
+  setView(0, m_pyramid->durationMs());
+}
+
+void LogViewer::leaveEvent(QEvent *)
+{
+  m_hoverX = -1;
+  update();
+}
+
+void LogViewer::keyPressEvent(QKeyEvent *event)
+{
+  const int centre = plotArea().center().x();
+
+  switch (event->key())
+  {
+  case Qt::Key_Plus:
+  case Qt::Key_Equal:
+    zoom(0.5, centre);
+    break;
+  case Qt::Key_Minus:
+    zoom(2.0, centre);
+    break;
+  case Qt::Key_Left:
+    setView(m_viewStartMs - (m_viewSpanMs / 10), m_viewSpanMs);
+    break;
+  case Qt::Key_Right:
+    setView(m_viewStartMs + (m_viewSpanMs / 10), m_viewSpanMs);
+    break;
+  case Qt::Key_Home:
+    setView(0, m_pyramid->durationMs());
+    break;
+  default:
+    QWidget::keyPressEvent(event);
+    break;
+  }
+}
+
+void LogViewer::contextMenuEvent(QContextMenuEvent *event)
+{
+  QMenu menu(this);
+
+  for (int c = 0; c < LogPyramid::NumChannels; c++)
+  {
+    QAction *action = menu.addAction(LogPyramid::channelName(c));
+    action->setCheckable(true);
+    action->setChecked(m_visible[c]);
+    action->setData(c);
+  }
+
+  QAction *chosen = menu.exec(event->globalPos());
+  if (chosen)
+  {
+    setChannelVisible(chosen->data().toInt(), chosen->isChecked());
+  }
+}
@@ -0,0 +1,75 @@
+#ifndef LOGVIEWER_H
+#define LOGVIEWER_H
+
+#include <QWidget>
+#include <QString>
+#include "logpyramid.h"
+
+/**
+ * Zoomable time-series view of a recorded log, with a strip for each
+ * channel shown. The log is loaded into a LogPyramid, and each redraw uses
+ * the level that has about one entry per pixel for the span on screen, so
+ * the cost of drawing is the same whether a few seconds or the whole of a
+ * long log is in view.
+ *
+ * The mouse wheel (or +/-) zooms around the pointer, dragging (or the
+ * arrow keys) pans, and a double-click (or Home) shows the whole log. The
+ * channels shown are chosen from the context menu.
+ */
+class LogViewer : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit LogViewer(QWidget *parent = 0);
+
+    void open(QString path);
+    void setChannelVisible(int channel, bool visible);
+    QSize sizeHint() const;
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+    void leaveEvent(QEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+    void contextMenuEvent(QContextMenuEvent *event);
+
+private slots:
+    void onProgress(int percent);
+    void onLoaded();
+
+private:
+    static const int s_marginLeft = 8;
+    static const int s_marginRight = 8;
+    static const int s_axisHeight = 22;
+    static const int s_stripSpacing = 4;
+    static const qint64 s_minSpanMs = 1000;
+
+    LogPyramid *m_pyramid;
+    bool m_loaded;
+    int m_progress;
+    bool m_visible[LogPyramid::NumChannels];
+
+    qint64 m_viewStartMs;
+    qint64 m_viewSpanMs;
+    bool m_dragging;
+    int m_dragX;
+    qint64 m_dragStartMs;
+    int m_hoverX;
+    int m_lastLevel;
+    double m_lastFrameMs;
+
+    QRect plotArea() const;
+    qint64 timeAtX(int x) const;
+    double xAtTime(qint64 timeMs) const;
+    void setView(qint64 startMs, qint64 spanMs);
+    void zoom(double factor, int aroundX);
+    void drawChannel(QPainter& painter, int channel, const QRect& strip, int level);
+    void drawTimeAxis(QPainter& painter, const QRect& area);
+    QString formatTime(qint64 timeMs, qint64 tickMs) const;
+};
+
+#endif // LOGVIEWER_H
@@ -0,0 +1,390 @@
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <string.h>
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "logwriter.h"
+#include "journal.h"
+
+/**
+ * Constructor. By default, data is written at least once a second, or
+ * sooner if 64KB has built up; up to 4MB may be queued.
+ */
+LogWriter::LogWriter(QObject *parent):
+QThread(parent), m_frontLines(0), m_stop(false), m_opened(false),
+m_rotatePending(false), m_rotateAt(0),
+m_flushIntervalMsecs(1000), m_flushSizeBytes(64 * 1024), m_maxQueuedBytes(4 * 1024 * 1024),
+m_journaled(false), m_durability(NoSync), m_syncIntervalMsecs(1000), m_unsynced(false), m_newSyncs(0)
+{
+  memset(&m_stats, 0, sizeof(Stats));
+}
+
+/**
+ * Destructor. Writes out anything still queued and closes the file.
+ */
+LogWriter::~LogWriter()
+{
+  close();
+}
+
+/**
+ * Sets when queued data is written out.
+ * @param intervalMsecs Longest time data may wait before being written
+ * @param sizeBytes Amount of queued data that triggers an immediate write
+ */
+void LogWriter::setFlushPolicy(int intervalMsecs, int sizeBytes)
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_flushIntervalMsecs = qMax(1, intervalMsecs);
+  m_flushSizeBytes = qMax(1, sizeBytes);
+}
+
+/**
+ * Sets how hard the writer tries to get data onto the storage device, as
+ * opposed to the OS's cache. Only call this while the writer is closed.
+ * @param durability When to sync
+ * @param syncIntervalMsecs Longest time between syncs, for PeriodicSync
+ */
+void LogWriter::setDurability(Durability durability, int syncIntervalMsecs)
+{
+  m_durability = durability;
+  m_syncIntervalMsecs = qMax(1, syncIntervalMsecs);
+}
+
+/**
+ * Opens a file for appending. In journaled mode, an existing journal is
+ * first truncated to its last good block, and a new (or emptied) one gets
+ * its header.
+ * @param bytesRecovered Set to the number of damaged bytes cut off
+ */
+bool LogWriter::openFile(QString path, qint64& bytesRecovered)
+{
+  bytesRecovered = 0;
+  m_file.setFileName(path);
+
+  if (m_journaled && (QFileInfo(path).size() > 0) && !Journal::recover(path, &bytesRecovered))
+  {
+    // not a journal, so appending blocks to it would make a mess
+    return false;
+  }
+
+  if (!m_file.open(QFile::WriteOnly | QFile::Append))
+  {
+    return false;
+  }
+
+  if (m_journaled && (m_file.size() == 0))
+  {
+    const QByteArray header = Journal::fileHeader();
+
+    if ((m_file.write(header) != header.size()) || !m_file.flush())
+    {
+      m_file.close();
+      return false;
+    }
+    m_unsynced = true;
+  }
+
+  m_sinceSync.start();
+  return true;
+}
+
+/**
+ * Opens a file for appending and starts the writer thread.
+ * @return True if the file was opened; false otherwise
+ */
+bool LogWriter::open(QString path)
+{
+  qint64 bytesRecovered;
+
+  if (isRunning() || m_file.isOpen())
+  {
+    return false;
+  }
+
+  m_unsynced = false;
+  m_newSyncs = 0;
+  if (!openFile(path, bytesRecovered))
+  {
+    return false;
+  }
+
+  memset(&m_stats, 0, sizeof(Stats));
+  m_stats.bytesRecovered = bytesRecovered;
+  m_front.clear();
+  m_front.reserve(m_flushSizeBytes * 2);
+  m_back.reserve(m_flushSizeBytes * 2);
+  m_frontLines = 0;
+  m_stop = false;
+  m_rotatePending = false;
+  m_opened = true;
+
+  start();
+  return true;
+}
+
+/**
+ * Writes out anything still queued, stops the writer thread, and closes
+ * the file.
+ */
+void LogWriter::close()
+{
+  if (isRunning())
+  {
+    m_mutex.lock();
+    m_stop = true;
+    m_dataReady.wakeOne();
+    m_mutex.unlock();
+
+    wait();
+  }
+
+  if (m_file.isOpen())
+  {
+    const QString path = m_file.fileName();
+
+    if ((m_durability != NoSync) && m_unsynced)
+    {
+      syncFile();
+      m_stats.syncs += m_newSyncs;
+      m_newSyncs = 0;
+    }
+    m_file.close();
+    emit fileClosed(path);
+  }
+  m_opened = false;
+}
+
+/**
+ * Queues text to be written. This never waits for the disk.
+ * @param text One or more complete lines
+ * @param lines Number of lines in the text (used for statistics)
+ * @return True if the text was queued; false if the queue was full (or
+ *  the file isn't open) and the text was dropped
+ */
+bool LogWriter::append(const QByteArray& text, int lines)
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (!isRunning() || m_stop || ((m_front.size() + text.size()) > m_maxQueuedBytes))
+  {
+    m_stats.linesDropped += lines;
+    return false;
+  }
+
+  const bool wasBelowThreshold = (m_front.size() < m_flushSizeBytes);
+
+  m_front.append(text);
+  m_frontLines += lines;
+  m_stats.linesQueued += lines;
+  m_stats.maxQueueDepth = qMax(m_stats.maxQueueDepth, m_frontLines);
+
+  // only wake the writer early when the buffer first crosses the threshold
+  if (wasBelowThreshold && (m_front.size() >= m_flushSizeBytes))
+  {
+    m_dataReady.wakeOne();
+  }
+
+  return true;
+}
+
+/**
+ * Switches to a new file. Everything queued before this call is written to
+ * the current file; everything after it goes to the new one. The switch
+ * happens on the writer thread, so this never waits for the disk.
+ * @param newPath File to continue in (opened for appending)
+ * @return True if the switch was queued; false if the writer isn't
+ *  running or a previous switch hasn't happened yet
+ */
+bool LogWriter::rotate(QString newPath)
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (!isRunning() || m_stop || m_rotatePending)
+  {
+    return false;
+  }
+
+  m_rotatePending = true;
+  m_rotateAt = m_front.size();
+  m_nextPath = newPath;
+  m_dataReady.wakeOne();
+
+  return true;
+}
+
+/**
+ * Writes a block to the current file (on the writer thread).
+ */
+bool LogWriter::writeOut(const char *data, int size)
+{
+  if (size == 0)
+  {
+    return true;
+  }
+
+  if (!m_file.isOpen())
+  {
+    return false;
+  }
+
+  if (m_journaled)
+  {
+    char header[Journal::s_blockHeaderSize];
+
+    Journal::blockHeader(header, data, size);
+    if (m_file.write(header, sizeof(header)) != (qint64)sizeof(header))
+    {
+      return false;
+    }
+  }
+
+  bool ok = (m_file.write(data, size) == size) && m_file.flush();
+  m_unsynced = true;
+
+  if (ok && (m_durability == BlockSync))
+  {
+    ok = syncFile();
+  }
+  return ok;
+}
+
+/**
+ * Forces everything written so far out to the storage device.
+ */
+bool LogWriter::syncFile()
+{
+  const int fd = m_file.handle();
+
+#ifdef WIN32
+  const bool ok = (fd >= 0) && (_commit(fd) == 0);
+#else
+  const bool ok = (fd >= 0) && (fsync(fd) == 0);
+#endif
+
+  m_unsynced = false;
+  m_newSyncs++;
+  m_sinceSync.start();
+  return ok;
+}
+
+/**
+ * Returns true if it's time for a periodic sync.
+ */
+bool LogWriter::periodicSyncDue() const
+{
+  return (m_durability == PeriodicSync) && m_unsynced && (m_sinceSync.elapsed() >= m_syncIntervalMsecs);
+}
+
+/**
+ * Returns a copy of the writer's statistics.
+ */
+LogWriter::Stats LogWriter::stats()
+{
+  QMutexLocker locker(&m_mutex);
+  Stats s = m_stats;
+
+  s.queueDepth = m_frontLines;
+  return s;
+}
+
+/**
+ * Writer thread. Waits until there's enough data (or the flush interval has
+ * passed), then swaps the buffers and writes everything that was queued in
+ * one go, without holding the lock.
+ */
+void LogWriter::run()
+{
+  m_mutex.lock();
+
+  while (true)
+  {
+    if (!m_stop && (m_front.size() < m_flushSizeBytes))
+    {
+      m_dataReady.wait(&m_mutex, m_flushIntervalMsecs);
+    }
+
+    if (m_front.isEmpty() && !m_rotatePending)
+    {
+      if (m_stop)
+      {
+        break;
+      }
+
+      // data written just before things went quiet still gets synced
+      if (periodicSyncDue())
+      {
+        m_mutex.unlock();
+        syncFile();
+        m_mutex.lock();
+        m_stats.syncs += m_newSyncs;
+        m_newSyncs = 0;
+      }
+      continue;
+    }
+
+    m_front.swap(m_back);
+    const int lines = m_frontLines;
+    const bool rotating = m_rotatePending;
+    const int splitAt = m_rotateAt;
+    const QString nextPath = m_nextPath;
+    m_frontLines = 0;
+    m_rotatePending = false;
+    m_mutex.unlock();
+
+    bool ok;
+    const int bytes = m_back.size();
+
+    qint64 bytesRecovered = 0;
+
+    if (rotating)
+    {
+      const QString oldPath = m_file.fileName();
+
+      ok = writeOut(m_back.constData(), splitAt);
+      if ((m_durability != NoSync) && m_unsynced)
+      {
+        syncFile();
+      }
+      m_file.close();
+      emit fileClosed(oldPath);
+
+      ok = openFile(nextPath, bytesRecovered) &&
+           writeOut(m_back.constData() + splitAt, bytes - splitAt) && ok;
+    }
+    else
+    {
+      ok = writeOut(m_back.constData(), bytes);
+    }
+
+    if (periodicSyncDue())
+    {
+      syncFile();
+    }
+
+    // keep the allocation for next time
+    m_back.resize(0);
+
+    m_mutex.lock();
+    m_stats.flushes++;
+    m_stats.syncs += m_newSyncs;
+    m_stats.bytesRecovered += bytesRecovered;
+    m_newSyncs = 0;
+    if (ok)
+    {
+      m_stats.linesWritten += lines;
+      m_stats.bytesWritten += bytes;
+    }
+    else
+    {
+      m_stats.writeErrors++;
+      m_stats.linesDropped += lines;
+    }
+  }
+
+  m_mutex.unlock();
+}
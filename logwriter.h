@@ -0,0 +1,116 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/**
+ * Writes log data to a file on a thread of its own, so that a slow disk
+ * (or SD card) never holds up the thread producing the data. Callers
+ * append formatted text to a bounded in-memory buffer; the writer thread
+ * swaps that buffer for a second one and writes the whole lot in a single
+ * call, either once a given amount of data has built up or after a given
+ * interval, whichever comes first. If the writer falls so far behind that
+ * the buffer fills, new data is dropped (and counted) rather than blocking
+ * the caller.
+ *
+ * The writer can also switch to a new file part way through the stream
+ * (see rotate()); everything queued before the switch goes to the old
+ * file, and fileClosed() is emitted from the writer thread once the old
+ * file has been closed.
+ *
+ * In journaled mode, each write is framed as a checksummed block (see
+ * Journal), and a damaged tail left by a power cut is cut off when the
+ * file is next opened. How often the data is forced out to the storage
+ * device is set separately with setDurability().
+ */
+class LogWriter : public QThread
+{
+    Q_OBJECT
+public:
+    enum Durability
+    {
+        NoSync       = 0,   // leave it to the OS to write data to the disk
+        PeriodicSync = 1,   // sync at most once per sync interval
+        BlockSync    = 2    // sync after every block written
+    };
+
+    struct Stats
+    {
+        quint64 linesQueued;
+        quint64 linesWritten;
+        quint64 linesDropped;
+        quint64 bytesWritten;
+        quint64 flushes;
+        quint64 writeErrors;
+        quint64 syncs;
+        quint64 bytesRecovered; // damaged journal tail discarded on open
+        int queueDepth;       // lines waiting to be written
+        int maxQueueDepth;
+    };
+
+    explicit LogWriter(QObject *parent = 0);
+    ~LogWriter();
+
+    bool open(QString path);
+    void close();
+    bool isOpen() const { return m_opened; }
+
+    bool append(const QByteArray& text, int lines);
+    bool rotate(QString newPath);
+    void setFlushPolicy(int intervalMsecs, int sizeBytes);
+    void setMaxQueuedBytes(int bytes) { m_maxQueuedBytes = bytes; }
+    void setJournaled(bool journaled) { m_journaled = journaled; }
+    void setDurability(Durability durability, int syncIntervalMsecs = 1000);
+
+    Stats stats();
+
+signals:
+    void fileClosed(QString path);
+
+protected:
+    void run();
+
+private:
+    QFile m_file;
+    QMutex m_mutex;
+    QWaitCondition m_dataReady;
+
+    QByteArray m_front;   // being filled by callers
+    QByteArray m_back;    // being written by the writer thread
+    int m_frontLines;
+    bool m_stop;
+    bool m_opened;
+
+    bool m_rotatePending;
+    int m_rotateAt;       // bytes in m_front that belong to the old file
+    QString m_nextPath;
+
+    int m_flushIntervalMsecs;
+    int m_flushSizeBytes;
+    int m_maxQueuedBytes;
+
+    Stats m_stats;
+
+    // only changed while closed, so the writer thread never sees a change
+    bool m_journaled;
+    Durability m_durability;
+    int m_syncIntervalMsecs;
+
+    // only used by the thread doing the writing
+    QElapsedTimer m_sinceSync;
+    bool m_unsynced;
+    int m_newSyncs;
+
+    bool openFile(QString path, qint64& bytesRecovered);
+    bool writeOut(const char *data, int size);
+    bool syncFile();
+    bool periodicSyncDue() const;
+};
+
+#endif // LOGWRITER_H
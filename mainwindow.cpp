@@ -9,13 +9,20 @@
 #include <QDesktopWidget>
 #include <QCryptographicHash>
 #include <QGraphicsOpacityEffect>
+#include <QStatusBar>
+#include <QFile>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QVBoxLayout>
+#include <QDialog>
 #include "mainwindow.h"
+#include "logviewer.h"
 #include "ui_mainwindow.h"
 
 MainWindow::MainWindow(QWidget* parent):QMainWindow(parent),
 m_ui(new Ui::MainWindow),
-m_memsThread(0),
-m_mems(0), m_options(0), m_aboutBox(0), m_pleaseWaitBox(0), m_helpViewerDialog(0), m_actuatorTestsEnabled(false)
+m_session(0),
+m_mems(0), m_displayReader(0), m_devMonitor(0), m_devMonitorThread(0), m_deviceSelector(0), m_replayToolBar(0), m_replayControls(0), m_options(0), m_aboutBox(0), m_pleaseWaitBox(0), m_helpViewerDialog(0), m_actuatorTestsEnabled(false)
 {
   buildSpeedAndTempUnitTables();
   m_ui->setupUi(this);
@@ -25,38 +32,39 @@ m_mems(0), m_options(0), m_aboutBox(0), m_pleaseWaitBox(0), m_helpViewerDialog(0
       QString::number(VER_PATCH));
 
   m_options = new OptionsDialog(this->windowTitle(), this);
-  m_mems = new MEMSInterface(m_options->getSerialDeviceName());
-  m_logger = new Logger(m_mems);
 
-  connect(m_mems, SIGNAL(dataReady()), this, SLOT(onDataReady()));
-  connect(m_mems, SIGNAL(connected()), this, SLOT(onConnect()));
-  connect(m_mems, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
-  connect(m_mems, SIGNAL(readError()), this, SLOT(onReadError()));
-  connect(m_mems, SIGNAL(readSuccess()), this, SLOT(onReadSuccess()));
-  connect(m_mems, SIGNAL(failedToConnect(QString)), this, SLOT(onFailedToConnect(QString)));
-  connect(m_mems, SIGNAL(interfaceThreadReady()), this, SLOT(onInterfaceThreadReady()));
-  connect(m_mems, SIGNAL(notConnected()), this, SLOT(onNotConnected()));
-  connect(m_mems, SIGNAL(gotEcuId(uint8_t *)), this, SLOT(onEcuIdReceived(uint8_t *)));
-  connect(m_mems, SIGNAL(errorSendingCommand()), this, SLOT(onCommandError()));
-
-  connect(m_mems, SIGNAL(fuelPumpTestComplete()), this, SLOT(onFuelPumpTestComplete()));
-  connect(m_mems, SIGNAL(acRelayTestComplete()), this, SLOT(onACRelayTestComplete()));
-  connect(m_mems, SIGNAL(ptcRelayTestComplete()), this, SLOT(onPTCRelayTestComplete()));
-  connect(m_mems, SIGNAL(moveIACComplete()), this, SLOT(onMoveIACComplete()));
-  connect(this, SIGNAL(moveIAC(int)), m_mems, SLOT(onIdleAirControlMovementRequest(int)));
-
-  connect(this, SIGNAL(fuelPumpTest()), m_mems, SLOT(onFuelPumpTest()));
-  connect(this, SIGNAL(acRelayTest()), m_mems, SLOT(onACRelayTest()));
-  connect(this, SIGNAL(ptcRelayTest()), m_mems, SLOT(onPTCRelayTest()));
-
-  connect(m_mems, SIGNAL(faultCodesClearSuccess()), this, SLOT(onFaultCodeClearComplete()));
-
-  connect(this, SIGNAL(requestToStartPolling()), m_mems, SLOT(onStartPollingRequest()));
-  connect(this, SIGNAL(requestThreadShutdown()), m_mems, SLOT(onShutdownThreadRequest()));
+  m_session = new SessionManager(this);
+  m_session->setPollRate(m_options->getPollRateHz());
+  m_session->setTemperatureUnits(m_options->getTemperatureUnits());
+  m_session->setAutoReconnect(m_options->getAutoReconnect());
+  m_session->setBatchDelivery(m_options->getBatchDelivery());
+  m_session->setLogFormat((Logger::Format)m_options->getLogFormat());
+  m_session->setLogRotation(m_options->getLogRotateSizeMB() * Q_INT64_C(1024 * 1024),
+                            m_options->getLogRotateMinutes() * 60, m_options->getCompressLogs());
+  m_session->setLogDurability(m_options->getJournaledLogs(),
+                              (LogWriter::Durability)m_options->getLogDurability(), 1000);
+  m_session->setRawCapture(m_options->getRawCapture());
+  m_session->setChangeOnlyLogging(m_options->getChangeOnlyLogs(), LogDeadband::defaults());
+  updateLogTrigger();
+  m_session->setDevices(m_options->getSerialDeviceNames());
+
+  connect(m_session, SIGNAL(failedToConnect(QString)), this, SLOT(onFailedToConnect(QString)));
+
+  // watch for serial adapters being plugged in and removed
+  m_devMonitorThread = new QThread(this);
+  m_devMonitor = new SerialDevMonitor();
+  m_devMonitor->moveToThread(m_devMonitorThread);
+  connect(m_devMonitorThread, SIGNAL(started()), m_devMonitor, SLOT(onParentThreadStarted()));
+  connect(m_devMonitorThread, SIGNAL(finished()), m_devMonitor, SLOT(deleteLater()));
+  connect(m_devMonitor, SIGNAL(devicesChanged(QStringList)), m_options, SLOT(onSerialDevicesChanged(QStringList)));
+  connect(m_devMonitor, SIGNAL(deviceAdded(QString)), this, SLOT(onSerialDeviceAdded(QString)));
+  connect(m_devMonitor, SIGNAL(deviceRemoved(QString)), this, SLOT(onSerialDeviceRemoved(QString)));
+  m_devMonitorThread->start();
 
   setWindowIcon(QIcon(":/icons/key.png"));
 
   setupWidgets();
+  attachInterface(m_session->getInterface(m_session->deviceIds().first()));
 }
 
 MainWindow::~MainWindow()
@@ -66,8 +74,8 @@ MainWindow::~MainWindow()
   delete m_tempUnitSuffix;
   delete m_aboutBox;
   delete m_options;
-  delete m_mems;
-  delete m_memsThread;
+  delete m_displayReader;
+  delete m_session;
 }
 
 /**
@@ -106,6 +114,8 @@ void MainWindow::setupWidgets()
   // connect menu item signals
   connect(m_ui->m_exitAction, SIGNAL(triggered()), this, SLOT(onExitSelected()));
   connect(m_ui->m_editSettingsAction, SIGNAL(triggered()), this, SLOT(onEditOptionsClicked()));
+  connect(m_ui->m_viewLogAction, SIGNAL(triggered()), this, SLOT(onViewLogClicked()));
+  connect(m_ui->m_exportLinkStatsAction, SIGNAL(triggered()), this, SLOT(onExportLinkStatsClicked()));
   connect(m_ui->m_helpContentsAction, SIGNAL(triggered()), this, SLOT(onHelpContentsClicked()));
   connect(m_ui->m_helpAboutAction, SIGNAL(triggered()), this, SLOT(onHelpAboutClicked()));
 
@@ -114,12 +124,12 @@ void MainWindow::setupWidgets()
   connect(m_ui->m_disconnectButton, SIGNAL(clicked()), this, SLOT(onDisconnectClicked()));
   connect(m_ui->m_startLoggingButton, SIGNAL(clicked()), this, SLOT(onStartLogging()));
   connect(m_ui->m_stopLoggingButton, SIGNAL(clicked()), this, SLOT(onStopLogging()));
-  connect(m_ui->m_clearFaultsButton, SIGNAL(clicked()), m_mems, SLOT(onFaultCodesClearRequested()));
+  connect(m_ui->m_clearFaultsButton, SIGNAL(clicked()), this, SIGNAL(clearFaults()));
   connect(m_ui->m_testACRelayButton, SIGNAL(clicked()), this, SLOT(onTestACRelayClicked()));
   connect(m_ui->m_testFuelPumpRelayButton, SIGNAL(clicked()), this, SLOT(onTestFuelPumpRelayClicked()));
   connect(m_ui->m_testPTCRelayButton, SIGNAL(clicked()), this, SLOT(onTestPTCRelayClicked()));
-  connect(m_ui->m_testIgnitionCoilButton, SIGNAL(clicked()), m_mems, SLOT(onIgnitionCoilTest()));
-  connect(m_ui->m_testFuelInjectorButton, SIGNAL(clicked()), m_mems, SLOT(onFuelInjectorTest()));
+  connect(m_ui->m_testIgnitionCoilButton, SIGNAL(clicked()), this, SIGNAL(coilTest()));
+  connect(m_ui->m_testFuelInjectorButton, SIGNAL(clicked()), this, SIGNAL(injectorTest()));
   connect(m_ui->m_moveIACButton, SIGNAL(clicked()), this, SLOT(onMoveIACClicked()));
 
   // set the LED colors
@@ -158,6 +168,20 @@ void MainWindow::setupWidgets()
   m_ui->m_faultLedTps->setOffColor1(QColor(20, 0, 0));
   m_ui->m_faultLedTps->setOffColor2(QColor(90, 0, 2));
 
+  // selects which ECU is shown when more than one device is configured
+  m_deviceSelector = new QComboBox(this);
+  m_ui->horizontalLayout_2->insertWidget(2, m_deviceSelector);
+  updateDeviceSelector();
+  connect(m_deviceSelector, SIGNAL(activated(int)), this, SLOT(onDisplayedDeviceChanged(int)));
+
+  // only shown when the displayed ECU is a replayed log
+  m_replayControls = new ReplayControls(this);
+  m_replayToolBar = new QToolBar("Replay", this);
+  m_replayToolBar->setMovable(false);
+  m_replayToolBar->addWidget(m_replayControls);
+  m_replayToolBar->setVisible(false);
+  addToolBar(Qt::BottomToolBarArea, m_replayToolBar);
+
   m_ui->m_logFileNameBox->setText(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh.mm.ss"));
 
   m_ui->m_mapGauge->setMinimum(0.0);
@@ -192,53 +216,156 @@ void MainWindow::setupWidgets()
 }
 
 /**
- * Attempts to open the serial device connected to the ECU,
- * and starts updating the display with data if successful.
+ * Connects the display, indicators, and actuator controls to the interface
+ * for one ECU, detaching them from the previously displayed one (if any).
+ * @param mems Interface whose data should be shown
  */
-void MainWindow::onConnectClicked()
+void MainWindow::attachInterface(MEMSInterface* mems)
 {
-  // If the worker thread hasn't been created yet, do that now.
-  if (m_memsThread == 0)
+  if (m_mems != 0)
   {
-    m_memsThread = new QThread(this);
-    m_mems->moveToThread(m_memsThread);
-    connect(m_memsThread, SIGNAL(started()), m_mems, SLOT(onParentThreadStarted()));
+    disconnect(m_mems, 0, this, 0);
+    disconnect(this, 0, m_mems, 0);
   }
 
-  // If the worker thread is alreay running, ask it to start polling the ECU.
-  // Otherwise, start the worker thread, but don't ask it to begin polling
-  // yet; it'll signal us when it's ready.
-  if (m_memsThread->isRunning())
+  m_mems = mems;
+  delete m_displayReader;
+  m_displayReader = new SampleReader(m_mems->getSampleRing());
+
+  connect(m_mems, SIGNAL(dataReady()), this, SLOT(onDataReady()));
+  connect(m_mems, SIGNAL(samplesReady(quint64,int,int,bool)), this, SLOT(onSamplesReady(quint64,int,int,bool)));
+  connect(m_mems, SIGNAL(connected()), this, SLOT(onConnect()));
+  connect(m_mems, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
+  connect(m_mems, SIGNAL(readError()), this, SLOT(onReadError()));
+  connect(m_mems, SIGNAL(readSuccess()), this, SLOT(onReadSuccess()));
+  connect(m_mems, SIGNAL(notConnected()), this, SLOT(onNotConnected()));
+  connect(m_mems, SIGNAL(gotEcuId(QByteArray)), this, SLOT(onEcuIdReceived(QByteArray)));
+  connect(m_mems, SIGNAL(errorSendingCommand()), this, SLOT(onCommandError()));
+
+  connect(m_mems, SIGNAL(fuelPumpTestComplete()), this, SLOT(onFuelPumpTestComplete()));
+  connect(m_mems, SIGNAL(acRelayTestComplete()), this, SLOT(onACRelayTestComplete()));
+  connect(m_mems, SIGNAL(ptcRelayTestComplete()), this, SLOT(onPTCRelayTestComplete()));
+  connect(m_mems, SIGNAL(moveIACComplete()), this, SLOT(onMoveIACComplete()));
+  connect(this, SIGNAL(moveIAC(int)), m_mems, SLOT(onIdleAirControlMovementRequest(int)));
+
+  connect(this, SIGNAL(fuelPumpTest()), m_mems, SLOT(onFuelPumpTest()));
+  connect(this, SIGNAL(acRelayTest()), m_mems, SLOT(onACRelayTest()));
+  connect(this, SIGNAL(ptcRelayTest()), m_mems, SLOT(onPTCRelayTest()));
+  connect(this, SIGNAL(injectorTest()), m_mems, SLOT(onFuelInjectorTest()));
+  connect(this, SIGNAL(coilTest()), m_mems, SLOT(onIgnitionCoilTest()));
+  connect(this, SIGNAL(clearFaults()), m_mems, SLOT(onFaultCodesClearRequested()));
+
+  updateReplayControls();
+
+  connect(m_mems, SIGNAL(faultCodesClearSuccess()), this, SLOT(onFaultCodeClearComplete()));
+  connect(m_mems, SIGNAL(pollRateMeasured(double,double)), this, SLOT(onPollRateMeasured(double,double)));
+  connect(m_mems, SIGNAL(linkLost()), this, SLOT(onLinkLost()));
+  connect(m_mems, SIGNAL(reconnecting(int,int)), this, SLOT(onReconnecting(int,int)));
+  connect(m_mems, SIGNAL(linkRecovered(qint64,int)), this, SLOT(onLinkRecovered(qint64,int)));
+
+  // bring the buttons and gauges in line with the state of this interface
+  if (m_mems->isConnected())
   {
-    emit requestToStartPolling();
+    onConnect();
   }
   else
   {
-    m_memsThread->start();
+    onDisconnect();
   }
+
+  const QString ecuId = m_session->getEcuId(m_mems->getDeviceId());
+  if (!ecuId.isEmpty())
+  {
+    m_ui->m_ecuIdLabel->setText("ECU ID: " + ecuId);
+  }
+}
+
+/**
+ * Fills the device selector with the IDs and device names of the
+ * configured ECUs. The selector is only shown if there's more than one.
+ */
+void MainWindow::updateDeviceSelector()
+{
+  m_deviceSelector->clear();
+  foreach (QString id, m_session->deviceIds())
+  {
+    m_deviceSelector->addItem(id + " (" + m_session->getInterface(id)->getSerialDevice() + ")", id);
+  }
+
+  if (m_mems != 0)
+  {
+    m_deviceSelector->setCurrentIndex(qMax(0, m_deviceSelector->findData(m_mems->getDeviceId())));
+  }
+  m_deviceSelector->setVisible(m_deviceSelector->count() > 1);
+}
+
+/**
+ * Passes the event-triggered logging options to the session. Overheating is
+ * judged by the critical value on the coolant temperature gauge.
+ */
+void MainWindow::updateLogTrigger()
+{
+  const TemperatureUnits units = m_options->getTemperatureUnits();
+  const int critical = m_tempLimits->value(units).second;
+  EventTrigger::Settings trigger;
+
+  trigger.newFault = true;
+  trigger.coolantLimitC = (units == Celsius) ? critical : (int)((critical - 32) / 1.8);
+  trigger.rpmLimit = m_options->getTriggerRpm();
+  trigger.preTriggerSecs = m_options->getTriggerPreSecs();
+  trigger.postTriggerSecs = m_options->getTriggerPostSecs();
+
+  m_session->setTriggeredLogging(m_options->getTriggeredLogging(), trigger);
+}
+
+/**
+ * Shows the replay controls if the displayed ECU is a replayed log, and
+ * hides them otherwise.
+ */
+void MainWindow::updateReplayControls()
+{
+  const bool replay = (m_mems != 0) && m_mems->isReplay();
+
+  m_replayControls->setClock(replay ? m_mems->getReplayClock() : 0);
+  m_replayToolBar->setVisible(replay);
 }
 
-void MainWindow::onInterfaceThreadReady()
+/**
+ * Switches the display over to a different ECU.
+ * @param index Index of the device in the selector
+ */
+void MainWindow::onDisplayedDeviceChanged(int index)
 {
-  emit requestToStartPolling();
+  MEMSInterface *mems = m_session->getInterface(m_deviceSelector->itemData(index).toString());
+
+  if ((mems != 0) && (mems != m_mems))
+  {
+    attachInterface(mems);
+  }
 }
 
-void MainWindow::onEcuIdReceived(uint8_t* id)
+/**
+ * Attempts to open the serial device connected to each ECU,
+ * and starts updating the display with data if successful.
+ */
+void MainWindow::onConnectClicked()
 {
-  char idString[20];
+  m_session->connectAll();
+}
 
-  sprintf(idString, "ECU ID: %02X %02X %02X %02X", id[0], id[1], id[2], id[3]);
-  m_ui->m_ecuIdLabel->setText(QString(idString));
+void MainWindow::onEcuIdReceived(QByteArray id)
+{
+  m_ui->m_ecuIdLabel->setText("ECU ID: " + QString(id.toHex(' ').toUpper()));
 }
 
 /**
- * Sets a flag in the worker thread that tells it to disconnect from the
+ * Sets a flag in each worker thread that tells it to disconnect from its
  * serial device.
  */
 void MainWindow::onDisconnectClicked()
 {
   m_ui->m_disconnectButton->setEnabled(false);
-  m_mems->disconnectFromECU();
+  m_session->disconnectAll();
 }
 
 /**
@@ -288,7 +415,17 @@ void MainWindow::setActuatorTestsEnabled(bool enabled)
  */
 void MainWindow::onDataReady()
 {
-  mems_data* data = m_mems->getData();
+  MEMSSample sample;
+
+  // Logging is handled by the session manager, which keeps its own read
+  // position, so it still gets every sample even if we coalesce several
+  // queued signals into one display update.
+  if (!m_displayReader->latest(sample))
+  {
+    return;
+  }
+
+  const mems_data* data = &sample.data;
   int corrected_iac = (data->iac_position > IAC_MAXIMUM) ? IAC_MAXIMUM : data->iac_position;
   float corrected_throttle = (data->throttle_pot_voltage > 5.0) ? 5.0 : data->throttle_pot_voltage;
 
@@ -318,8 +455,6 @@ void MainWindow::onDataReady()
 
   m_ui->m_idleSwitchLed->setChecked(data->idle_switch);
   m_ui->m_neutralSwitchLed->setChecked(data->park_neutral_switch);
-
-  m_logger->logData();
 }
 
 /**
@@ -340,7 +475,18 @@ void MainWindow::onEditOptionsClicked()
     int tempNominal = m_tempLimits->value(tempUnits).first;
     int tempCritical = m_tempLimits->value(tempUnits).second;
 
-    m_logger->setTemperatureUnits(tempUnits);
+    m_session->setTemperatureUnits(tempUnits);
+    m_session->setPollRate(m_options->getPollRateHz());
+    m_session->setAutoReconnect(m_options->getAutoReconnect());
+    m_session->setBatchDelivery(m_options->getBatchDelivery());
+    m_session->setLogFormat((Logger::Format)m_options->getLogFormat());
+    m_session->setLogRotation(m_options->getLogRotateSizeMB() * Q_INT64_C(1024 * 1024),
+                              m_options->getLogRotateMinutes() * 60, m_options->getCompressLogs());
+    m_session->setLogDurability(m_options->getJournaledLogs(),
+                                (LogWriter::Durability)m_options->getLogDurability(), 1000);
+    m_session->setRawCapture(m_options->getRawCapture());
+    m_session->setChangeOnlyLogging(m_options->getChangeOnlyLogs(), LogDeadband::defaults());
+    updateLogTrigger();
 
     m_ui->m_airTempGauge->setSuffix(tempUnitStr);
     m_ui->m_airTempGauge->setValue(tempMin);
@@ -361,11 +507,22 @@ void MainWindow::onEditOptionsClicked()
     // and restart the timer
     if (m_options->getSerialDeviceChanged())
     {
-      if (m_mems->isConnected())
+      const QString displayedId = m_mems->getDeviceId();
+
+      m_session->setDevices(m_options->getSerialDeviceNames());
+
+      // the displayed ECU may have been removed from the list
+      MEMSInterface *mems = m_session->getInterface(displayedId);
+      if (mems == 0)
+      {
+        mems = m_session->getInterface(m_session->deviceIds().first());
+      }
+      if (mems != m_mems)
       {
-        m_mems->disconnectFromECU();
+        attachInterface(mems);
       }
-      m_mems->setSerialDevice(m_options->getSerialDeviceName());
+      updateDeviceSelector();
+      updateReplayControls();
     }
   }
 }
@@ -377,14 +534,10 @@ void MainWindow::onEditOptionsClicked()
  */
 void MainWindow::closeEvent(QCloseEvent* event)
 {
-  m_logger->closeLog();
+  m_session->shutdown(2000);
 
-  if ((m_memsThread != 0) && m_memsThread->isRunning())
-  {
-    emit requestThreadShutdown();
-
-    m_memsThread->wait(2000);
-  }
+  m_devMonitorThread->quit();
+  m_devMonitorThread->wait(1000);
 
   event->accept();
 }
@@ -434,6 +587,7 @@ void MainWindow::onDisconnect()
   setActuatorTestsEnabled(false);
 
   m_ui->m_clearFaultsButton->setEnabled(false);
+  statusBar()->clearMessage();
 }
 
 /**
@@ -456,19 +610,44 @@ void MainWindow::onReadSuccess()
   m_ui->m_commsBadLed->setChecked(false);
 }
 
+/**
+ * Responds to a batch of reads (in batched delivery mode) by setting the
+ * comms lamps according to the most recent read and updating the display
+ * with the newest sample.
+ */
+void MainWindow::onSamplesReady(quint64 firstSeq, int count, int readErrors, bool lastReadOk)
+{
+  Q_UNUSED(firstSeq);
+  Q_UNUSED(readErrors);
+
+  if (lastReadOk)
+  {
+    onReadSuccess();
+  }
+  else
+  {
+    onReadError();
+  }
+
+  if (count > 0)
+  {
+    onDataReady();
+  }
+}
+
 /**
  * Opens the log file for writing.
  */
 void MainWindow::onStartLogging()
 {
-  if (m_logger->openLog(m_ui->m_logFileNameBox->text()))
+  if (m_session->openLogs(m_ui->m_logFileNameBox->text()))
   {
     m_ui->m_startLoggingButton->setEnabled(false);
     m_ui->m_stopLoggingButton->setEnabled(true);
   }
   else
   {
-    QMessageBox::warning(this, "Error", "Failed to open log file (" + m_logger->getLogPath() + ")", QMessageBox::Ok);
+    QMessageBox::warning(this, "Error", "Failed to open log file (" + m_session->getLastLogPath() + ")", QMessageBox::Ok);
   }
 }
 
@@ -477,7 +656,7 @@ void MainWindow::onStartLogging()
  */
 void MainWindow::onStopLogging()
 {
-  m_logger->closeLog();
+  m_session->closeLogs();
   m_ui->m_stopLoggingButton->setEnabled(false);
   m_ui->m_startLoggingButton->setEnabled(true);
 }
@@ -601,3 +780,150 @@ void MainWindow::onFaultCodeClearComplete()
 {
   QMessageBox::information(this, "Complete", "Successfully cleared fault codes.", QMessageBox::Ok);
 }
+
+/**
+ * Shows the achieved polling rate (and the rate that was requested) in the
+ * status bar.
+ */
+void MainWindow::onPollRateMeasured(double requestedHz, double achievedHz)
+{
+  QString requested = (requestedHz > 0.0) ? (QString::number(requestedHz, 'f', 1) + " Hz") : QString("maximum");
+
+  QString message = "Polling rate: " + QString::number(achievedHz, 'f', 1) + " Hz (requested: " + requested + ")";
+
+  if (m_ui->m_stopLoggingButton->isEnabled())
+  {
+    const LogWriter::Stats logStats = m_session->getLogStats(m_mems->getDeviceId());
+    message += QString("   Log queue: %1 lines").arg(logStats.queueDepth);
+    if (logStats.linesDropped > 0)
+    {
+      message += QString(", %1 dropped").arg(logStats.linesDropped);
+    }
+  }
+
+  statusBar()->showMessage(message);
+
+  // keep the link statistics available from the comms lamps
+  const QString stats = m_mems->getLinkStats().toText();
+  m_ui->m_commsGoodLed->setToolTip(stats);
+  m_ui->m_commsBadLed->setToolTip(stats);
+}
+
+/**
+ * Saves the link statistics for the displayed device to a file, either as
+ * a text summary or (if the name ends in .csv) as CSV with the full
+ * histograms.
+ */
+void MainWindow::onExportLinkStatsClicked()
+{
+  const QString fileName = QFileDialog::getSaveFileName(this, "Export link statistics", "linkstats.csv",
+                                                        "CSV files (*.csv);;Text files (*.txt)");
+  if (fileName.isEmpty())
+  {
+    return;
+  }
+
+  const LinkStats stats = m_mems->getLinkStats();
+  QFile file(fileName);
+
+  if (file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+  {
+    QTextStream out(&file);
+    out << (fileName.endsWith(".csv", Qt::CaseInsensitive) ? stats.toCsv() : (stats.toText() + "\n"));
+  }
+  else
+  {
+    QMessageBox::warning(this, "Error", "Failed to write " + fileName, QMessageBox::Ok);
+  }
+}
+
+/**
+ * Opens a recorded log (text or binary) in a window of its own, which can
+ * be left open while the live display carries on.
+ */
+void MainWindow::onViewLogClicked()
+{
+  const QString lastLog = m_session->getLastLogPath();
+  const QString fileName = QFileDialog::getOpenFileName(this, "View log",
+                                                        lastLog.isEmpty() ? "logs" : QFileInfo(lastLog).path(),
+                                                        "Logs (*.txt *.mlog *.jnl);;All files (*)");
+  if (fileName.isEmpty())
+  {
+    return;
+  }
+
+  QDialog *dialog = new QDialog(this);
+  QVBoxLayout *layout = new QVBoxLayout(dialog);
+  LogViewer *viewer = new LogViewer(dialog);
+
+  dialog->setAttribute(Qt::WA_DeleteOnClose);
+  dialog->setWindowTitle(QFileInfo(fileName).fileName());
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(viewer);
+
+  viewer->open(fileName);
+  dialog->show();
+}
+
+/**
+ * Responds to the link dropping by turning on the red lamp and disabling
+ * the controls that send commands, while the interface tries to reconnect.
+ */
+void MainWindow::onLinkLost()
+{
+  m_ui->m_commsGoodLed->setChecked(false);
+  m_ui->m_commsBadLed->setChecked(true);
+  setActuatorTestsEnabled(false);
+  m_ui->m_clearFaultsButton->setEnabled(false);
+  statusBar()->showMessage("Link lost; reconnecting...");
+}
+
+/**
+ * Shows the progress of the reconnect attempts in the status bar.
+ */
+void MainWindow::onReconnecting(int attempt, int nextDelayMsecs)
+{
+  statusBar()->showMessage(QString("Link lost; reconnect attempt %1 failed, retrying in %2 s...")
+                           .arg(attempt).arg(nextDelayMsecs / 1000.0, 0, 'f', 1));
+}
+
+/**
+ * Re-enables the controls once the link has been re-established. (The
+ * actuator tests are re-enabled by the next sample if the engine is off.)
+ */
+void MainWindow::onLinkRecovered(qint64 outageMsecs, int attempts)
+{
+  m_ui->m_clearFaultsButton->setEnabled(true);
+  statusBar()->showMessage(QString("Link recovered after %1 s (%2 attempts)")
+                           .arg(outageMsecs / 1000.0, 0, 'f', 1).arg(attempts), 5000);
+}
+
+/**
+ * Responds to a serial device being plugged in. If it's one of the
+ * configured devices and the option is set, connects to it.
+ */
+void MainWindow::onSerialDeviceAdded(QString dev)
+{
+  const QString id = m_session->findDevice(dev);
+
+  if (!id.isEmpty())
+  {
+    statusBar()->showMessage("Serial device " + dev + " connected", 5000);
+
+    if (m_options->getAutoConnectOnPlug())
+    {
+      m_session->connectDevice(id);
+    }
+  }
+}
+
+/**
+ * Responds to a serial device being removed.
+ */
+void MainWindow::onSerialDeviceRemoved(QString dev)
+{
+  if (!m_session->findDevice(dev).isEmpty())
+  {
+    statusBar()->showMessage("Serial device " + dev + " removed", 5000);
+  }
+}
@@ -8,14 +8,18 @@
 #include <QHash>
 #include <QPair>
 #include <QTimer>
+#include <QComboBox>
+#include <QToolBar>
 #include <analogwidgets/manometer.h>
 #include <qledindicator/qledindicator.h>
 #include "optionsdialog.h"
 #include "memsinterface.h"
 #include "aboutbox.h"
-#include "logger.h"
+#include "sessionmanager.h"
 #include "commonunits.h"
 #include "helpviewer.h"
+#include "serialdevmonitor.h"
+#include "replaycontrols.h"
 
 namespace Ui
 {
@@ -36,27 +40,31 @@ public slots:
     void onDisconnect();
     void onReadError();
     void onReadSuccess();
+    void onSamplesReady(quint64 firstSeq, int count, int readErrors, bool lastReadOk);
     void onFailedToConnect(QString dev);
-    void onInterfaceThreadReady();
     void onNotConnected();
-    void onEcuIdReceived(uint8_t* id);
+    void onEcuIdReceived(QByteArray id);
     void onFuelPumpTestComplete();
     void onACRelayTestComplete();
     void onPTCRelayTestComplete();
     void onMoveIACComplete();
     void onCommandError();
     void onFaultCodeClearComplete();
+    void onPollRateMeasured(double requestedHz, double achievedHz);
+    void onLinkLost();
+    void onReconnecting(int attempt, int nextDelayMsecs);
+    void onLinkRecovered(qint64 outageMsecs, int attempts);
+    void onSerialDeviceAdded(QString dev);
+    void onSerialDeviceRemoved(QString dev);
 
 signals:
-    void requestToStartPolling();
-    void requestThreadShutdown();
-
     void fuelPumpTest();
     void ptcRelayTest();
     void acRelayTest();
     void injectorTest();
     void coilTest();
     void moveIAC(int desiredPos);
+    void clearFaults();
 
 protected:
     void closeEvent(QCloseEvent *event);
@@ -64,15 +72,19 @@ protected:
 private:
     Ui::MainWindow *m_ui;
 
-    QThread *m_memsThread;
+    SessionManager *m_session;
     MEMSInterface *m_mems;
+    SampleReader *m_displayReader;
+    SerialDevMonitor *m_devMonitor;
+    QThread *m_devMonitorThread;
+    QComboBox *m_deviceSelector;
+    QToolBar *m_replayToolBar;
+    ReplayControls *m_replayControls;
     OptionsDialog *m_options;
     AboutBox *m_aboutBox;
     QMessageBox *m_pleaseWaitBox;
     HelpViewer *m_helpViewerDialog;
 
-    Logger *m_logger;
-
     bool m_actuatorTestsEnabled;
 
     QHash<TemperatureUnits,QString> *m_tempUnitSuffix;
@@ -81,6 +93,10 @@ private:
 
     void buildSpeedAndTempUnitTables();
     void setupWidgets();
+    void attachInterface(MEMSInterface *mems);
+    void updateDeviceSelector();
+    void updateReplayControls();
+    void updateLogTrigger();
     int convertTemperature(int tempF);
 
 private slots:
@@ -96,6 +112,9 @@ private slots:
     void onTestFuelPumpRelayClicked();
     void onTestACRelayClicked();
     void onTestPTCRelayClicked();    
+    void onDisplayedDeviceChanged(int index);
+    void onExportLinkStatsClicked();
+    void onViewLogClicked();
 
     void setActuatorTestsEnabled(bool enabled);
 };
@@ -0,0 +1,166 @@
+#include <unistd.h>
+#include <string.h>
+#include "capturereplayer.h"
+
+/**
+ * Constructor. Starts watching the pty for commands.
+ * @param pty Open pty; the replayer answers on its master side
+ * @param records Contents of the capture, which must include at least one
+ *  command (i.e. a record in the Transmit direction)
+ * @param speed Multiple of the original timing, or 0 to send each reply as
+ *  soon as it's due
+ */
+CaptureReplayer::CaptureReplayer(PtyPort *pty, const QVector<RawCapture::Record>& records, double speed, QObject *parent):
+QObject(parent), m_pty(pty), m_records(records), m_speed(speed), m_firstCommand(0), m_next(0),
+m_lastCaptureUs(0), m_lastRealUs(0)
+{
+  memset(&m_stats, 0, sizeof(Statistics));
+
+  // anything the ECU sent before the first command can't be an answer to
+  // the decoder, so playback always starts (and restarts) at a command
+  while ((m_firstCommand < m_records.count()) &&
+         (m_records.at(m_firstCommand).direction != RawCapture::Transmit))
+  {
+    m_firstCommand++;
+  }
+  m_next = m_firstCommand;
+
+  m_sendTimer = new QTimer(this);
+  m_sendTimer->setSingleShot(true);
+  m_sendTimer->setTimerType(Qt::PreciseTimer);
+  connect(m_sendTimer, SIGNAL(timeout()), this, SLOT(onSendTimer()));
+
+  m_notifier = new QSocketNotifier(m_pty->masterFd(), QSocketNotifier::Read, this);
+  connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onMasterReadable()));
+
+  m_clock.start();
+}
+
+/**
+ * Reads all available command bytes from the pty and plays the capture
+ * forward as far as they allow.
+ */
+void CaptureReplayer::onMasterReadable()
+{
+  char buf[256];
+  ssize_t count;
+
+  while ((count = read(m_pty->masterFd(), buf, sizeof(buf))) > 0)
+  {
+    m_received.append(buf, (int)count);
+  }
+
+  process();
+}
+
+void CaptureReplayer::onSendTimer()
+{
+  process();
+}
+
+/**
+ * Finds the next command in the capture (after the current position,
+ * wrapping around at the end) that matches the start of the bytes received.
+ * @return Index of the command's record, or -1 if there is none
+ */
+int CaptureReplayer::findCommand() const
+{
+  const int count = m_records.count();
+
+  for (int i = 1; i < count; i++)
+  {
+    const RawCapture::Record& record = m_records.at((m_next + i) % count);
+
+    if ((record.direction == RawCapture::Transmit) && m_received.startsWith(record.bytes))
+    {
+      return (m_next + i) % count;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Steps through the capture: commands are consumed as they're received, and
+ * replies are sent once their time has come. Returns when waiting for
+ * either, with the send timer armed in the latter case.
+ */
+void CaptureReplayer::process()
+{
+  if (m_firstCommand >= m_records.count())
+  {
+    return;
+  }
+
+  m_sendTimer->stop();
+
+  while (true)
+  {
+    if (m_next >= m_records.count())
+    {
+      m_next = m_firstCommand;
+      m_stats.loops++;
+    }
+
+    const RawCapture::Record& record = m_records.at(m_next);
+    const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+
+    if (record.direction == RawCapture::Transmit)
+    {
+      if (m_received.isEmpty() || record.bytes.startsWith(m_received))
+      {
+        // nothing yet, or only the first part of the expected command
+        if (m_received.size() < record.bytes.size())
+        {
+          return;
+        }
+      }
+
+      if (!m_received.startsWith(record.bytes))
+      {
+        const int found = findCommand();
+
+        if (found < 0)
+        {
+          m_stats.mismatches++;
+          m_received.clear();
+          return;
+        }
+        m_stats.resyncs++;
+        m_next = found;
+        continue;
+      }
+
+      m_received.remove(0, record.bytes.size());
+      m_stats.commands++;
+      m_lastCaptureUs = record.timeUs;
+      m_lastRealUs = nowUs;
+      m_next++;
+    }
+    else
+    {
+      qint64 dueUs = m_lastRealUs;
+
+      if (m_speed > 0.0)
+      {
+        dueUs += (qint64)((record.timeUs - m_lastCaptureUs) / m_speed);
+      }
+
+      if (dueUs > nowUs)
+      {
+        m_sendTimer->start((int)((dueUs - nowUs + 999) / 1000));
+        return;
+      }
+
+      if (write(m_pty->masterFd(), record.bytes.constData(), record.bytes.size()) == record.bytes.size())
+      {
+        m_stats.replies++;
+      }
+
+      // measuring from when the reply was due, rather than when it went
+      // out, stops timer lateness from accumulating
+      m_lastCaptureUs = record.timeUs;
+      m_lastRealUs = dueUs;
+      m_next++;
+    }
+  }
+}
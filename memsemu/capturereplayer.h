@@ -0,0 +1,61 @@
+#ifndef CAPTUREREPLAYER_H
+#define CAPTUREREPLAYER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+#include "ptyport.h"
+#include "rawcapture.h"
+
+/**
+ * Plays a raw serial capture back on the master side of a pty, so that the
+ * decoder sees exactly the bytes (and, optionally, the timing) that a real
+ * ECU produced. Each command received is matched against the next command
+ * in the capture, and the bytes that the ECU sent after it are replayed
+ * with their original spacing divided by the speed. A command that doesn't
+ * match makes the replayer look for the next place in the capture where the
+ * same command was sent; the capture loops when it reaches the end.
+ */
+class CaptureReplayer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Statistics
+    {
+        quint64 commands;     // commands that matched the capture
+        quint64 replies;      // runs of bytes sent back
+        quint64 resyncs;      // jumps to a different point in the capture
+        quint64 mismatches;   // commands that appear nowhere in the capture
+        quint64 loops;        // times the capture has been played through
+    };
+
+    CaptureReplayer(PtyPort *pty, const QVector<RawCapture::Record>& records, double speed, QObject *parent = 0);
+
+    Statistics statistics() const { return m_stats; }
+
+private slots:
+    void onMasterReadable();
+    void onSendTimer();
+
+private:
+    PtyPort *m_pty;
+    QVector<RawCapture::Record> m_records;
+    double m_speed;
+    int m_firstCommand;
+    int m_next;
+    QByteArray m_received;
+    QSocketNotifier *m_notifier;
+    QTimer *m_sendTimer;
+    QElapsedTimer m_clock;
+    qint64 m_lastCaptureUs;
+    qint64 m_lastRealUs;
+    Statistics m_stats;
+
+    void process();
+    int findCommand() const;
+};
+
+#endif // CAPTUREREPLAYER_H
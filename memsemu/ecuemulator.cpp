@@ -0,0 +1,238 @@
+#include <unistd.h>
+#include <string.h>
+#include "ecuemulator.h"
+
+/**
+ * Constructor. Starts watching the pty for commands.
+ * @param pty Open pty; the emulator answers on its master side
+ * @param settings Response timing and fault-injection settings
+ * @param script Waveforms for the sensor values reported in data frames
+ */
+ECUEmulator::ECUEmulator(PtyPort *pty, const Settings& settings, const SensorScript& script, QObject *parent):
+QObject(parent), m_pty(pty), m_settings(settings), m_script(script),
+m_random(settings.seed), m_lastDueMsecs(0), m_iacOffset(0), m_clearedFaults(0)
+{
+  memset(&m_stats, 0, sizeof(Statistics));
+
+  m_sendTimer = new QTimer(this);
+  m_sendTimer->setSingleShot(true);
+  m_sendTimer->setTimerType(Qt::PreciseTimer);
+  connect(m_sendTimer, SIGNAL(timeout()), this, SLOT(onSendTimer()));
+
+  m_notifier = new QSocketNotifier(m_pty->masterFd(), QSocketNotifier::Read, this);
+  connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onMasterReadable()));
+
+  m_clock.start();
+}
+
+/**
+ * Reads all available command bytes from the pty and handles each one.
+ */
+void ECUEmulator::onMasterReadable()
+{
+  uint8_t buf[256];
+  ssize_t count;
+
+  while ((count = read(m_pty->masterFd(), buf, sizeof(buf))) > 0)
+  {
+    for (ssize_t i = 0; i < count; i++)
+    {
+      handleCommand(buf[i]);
+    }
+  }
+}
+
+/**
+ * Builds the reply to a single command byte and queues it for sending.
+ * The ECU echoes every command byte; most commands are followed by a
+ * single status byte, while the data and ID requests return more.
+ */
+void ECUEmulator::handleCommand(uint8_t cmd)
+{
+  QByteArray reply;
+
+  m_stats.commands++;
+
+  if (m_random.generateDouble() < m_settings.dropRate)
+  {
+    m_stats.dropped++;
+    return;
+  }
+
+  reply.append((char)cmd);
+
+  switch (cmd)
+  {
+  case 0xCA:  // init sequence, echo only
+  case 0x75:
+    break;
+
+  case 0xD0:  // ECU ID
+    reply.append((const char*)m_settings.ecuId, 4);
+    break;
+
+  case 0x80:
+    reply.append(buildFrame80());
+    m_stats.frames80++;
+    break;
+
+  case 0x7D:
+    reply.append(buildFrame7d());
+    m_stats.frames7d++;
+    break;
+
+  case 0xCC:  // clear faults
+    m_clearedFaults = (uint8_t)m_script.value(SensorScript::FaultCodes, m_clock.elapsed() / 1000.0);
+    reply.append((char)0x00);
+    break;
+
+  case 0xFB:  // report IAC position
+    reply.append((char)clampByte(m_script.value(SensorScript::IACPosition, m_clock.elapsed() / 1000.0) + m_iacOffset));
+    break;
+
+  case 0xFD:  // open IAC one step
+  case 0xFE:  // close IAC one step
+    m_iacOffset += (cmd == 0xFD) ? 1 : -1;
+    reply.append((char)clampByte(m_script.value(SensorScript::IACPosition, m_clock.elapsed() / 1000.0) + m_iacOffset));
+    break;
+
+  default:
+    // relay on/off commands (0x01-0x1F), injector and coil tests (0xF7,
+    // 0xF8), heartbeat (0xF4), and anything we don't otherwise know about
+    if ((cmd < 0x20) || (cmd == 0xF7) || (cmd == 0xF8))
+    {
+      m_stats.actuatorCommands++;
+    }
+    reply.append((char)0x00);
+    break;
+  }
+
+  if (m_random.generateDouble() < m_settings.corruptRate)
+  {
+    const int index = m_random.bounded(reply.size());
+    reply[index] = (char)(reply.at(index) ^ (1 + m_random.bounded(255)));
+    m_stats.corrupted++;
+  }
+
+  queueReply(reply);
+}
+
+/**
+ * Queues a reply to be sent after the configured latency. Replies are never
+ * reordered, even if jitter would give a later reply an earlier due time.
+ */
+void ECUEmulator::queueReply(QByteArray reply)
+{
+  PendingReply pending;
+  qint64 due = m_clock.elapsed() + m_settings.latencyMsecs;
+
+  if (m_settings.jitterMsecs > 0)
+  {
+    due += m_random.bounded(m_settings.jitterMsecs + 1);
+  }
+
+  pending.dueMsecs = qMax(due, m_lastDueMsecs);
+  pending.bytes = reply;
+  m_lastDueMsecs = pending.dueMsecs;
+
+  m_pending.append(pending);
+  scheduleSend();
+}
+
+/**
+ * Arms the send timer for the next pending reply, if it isn't already armed.
+ */
+void ECUEmulator::scheduleSend()
+{
+  if (!m_pending.isEmpty() && !m_sendTimer->isActive())
+  {
+    const qint64 wait = m_pending.first().dueMsecs - m_clock.elapsed();
+    m_sendTimer->start((wait > 0) ? (int)wait : 0);
+  }
+}
+
+/**
+ * Writes every reply that is due.
+ */
+void ECUEmulator::onSendTimer()
+{
+  const qint64 now = m_clock.elapsed();
+
+  while (!m_pending.isEmpty() && (m_pending.first().dueMsecs <= now))
+  {
+    const QByteArray bytes = m_pending.takeFirst().bytes;
+
+    if (write(m_pty->masterFd(), bytes.constData(), bytes.size()) != bytes.size())
+    {
+      m_stats.dropped++;
+    }
+  }
+
+  scheduleSend();
+}
+
+/**
+ * Converts a value to a single byte, saturating at the ends of the range.
+ */
+uint8_t ECUEmulator::clampByte(double value)
+{
+  if (value < 0.0)
+  {
+    return 0;
+  }
+  else if (value > 255.0)
+  {
+    return 255;
+  }
+  return (uint8_t)(value + 0.5);
+}
+
+/**
+ * Builds the 28-byte response to the 0x80 data request, using the same
+ * scaling that librosco applies when decoding it.
+ */
+QByteArray ECUEmulator::buildFrame80()
+{
+  const double t = m_clock.elapsed() / 1000.0;
+  QByteArray frame(28, 0);
+
+  const int rpm = (int)m_script.value(SensorScript::EngineSpeed, t);
+  const uint8_t faults = (uint8_t)m_script.value(SensorScript::FaultCodes, t) & ~m_clearedFaults;
+
+  frame[0x00] = 0x1C;
+  frame[0x01] = (char)((rpm >> 8) & 0xFF);
+  frame[0x02] = (char)(rpm & 0xFF);
+  frame[0x03] = (char)clampByte(m_script.value(SensorScript::CoolantTemp, t) + 55);
+  frame[0x04] = (char)clampByte(m_script.value(SensorScript::AmbientTemp, t) + 55);
+  frame[0x05] = (char)clampByte(m_script.value(SensorScript::IntakeAirTemp, t) + 55);
+  frame[0x06] = (char)clampByte(m_script.value(SensorScript::FuelTemp, t) + 55);
+  frame[0x07] = (char)clampByte(m_script.value(SensorScript::ManifoldPressure, t));
+  frame[0x08] = (char)clampByte(m_script.value(SensorScript::BatteryVoltage, t) * 10.0);
+  frame[0x09] = (char)clampByte(m_script.value(SensorScript::ThrottleVoltage, t) / 0.02);
+  frame[0x0A] = (char)((m_script.value(SensorScript::IdleSwitch, t) != 0.0) ? 0x10 : 0x00);
+  frame[0x0C] = (char)((m_script.value(SensorScript::ParkNeutralSwitch, t) != 0.0) ? 0x01 : 0x00);
+
+  // dtc0: coolant (0x01) and air temp (0x02) sensors;
+  // dtc1: fuel pump circuit (0x02) and throttle pot (0x80)
+  frame[0x0D] = (char)(faults & 0x03);
+  frame[0x0E] = (char)(((faults & 0x04) ? 0x02 : 0x00) | ((faults & 0x08) ? 0x80 : 0x00));
+
+  frame[0x12] = (char)clampByte(m_script.value(SensorScript::IACPosition, t) + m_iacOffset);
+
+  return frame;
+}
+
+/**
+ * Builds the 32-byte response to the 0x7D data request.
+ */
+QByteArray ECUEmulator::buildFrame7d()
+{
+  const double t = m_clock.elapsed() / 1000.0;
+  QByteArray frame(32, 0);
+
+  frame[0x00] = 0x20;
+  frame[0x06] = (char)clampByte(m_script.value(SensorScript::LambdaVoltage, t) / 5.0);
+  frame[0x0A] = (char)((m_script.value(SensorScript::ClosedLoop, t) != 0.0) ? 0x01 : 0x00);
+
+  return frame;
+}
@@ -0,0 +1,80 @@
+#ifndef ECUEMULATOR_H
+#define ECUEMULATOR_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+#include <QRandomGenerator>
+#include "ptyport.h"
+#include "sensorscript.h"
+
+/**
+ * Emulates the serial protocol of a MEMS 1.6 ECU on the master side of a
+ * pty. Every command byte is echoed, followed by the command's response
+ * data, after a configurable delay. Faults can be injected by dropping or
+ * corrupting responses.
+ */
+class ECUEmulator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        int latencyMsecs;     // base delay before each response
+        int jitterMsecs;      // random extra delay, 0..jitter
+        double dropRate;      // probability that a command gets no reply
+        double corruptRate;   // probability that one reply byte is altered
+        uint8_t ecuId[4];     // returned in response to the 0xD0 command
+        quint32 seed;         // for the jitter/fault random generator
+    };
+
+    struct Statistics
+    {
+        quint64 commands;
+        quint64 frames80;
+        quint64 frames7d;
+        quint64 actuatorCommands;
+        quint64 dropped;
+        quint64 corrupted;
+    };
+
+    ECUEmulator(PtyPort *pty, const Settings& settings, const SensorScript& script, QObject *parent = 0);
+
+    Statistics statistics() const { return m_stats; }
+
+private slots:
+    void onMasterReadable();
+    void onSendTimer();
+
+private:
+    struct PendingReply
+    {
+        qint64 dueMsecs;
+        QByteArray bytes;
+    };
+
+    PtyPort *m_pty;
+    Settings m_settings;
+    SensorScript m_script;
+    QSocketNotifier *m_notifier;
+    QTimer *m_sendTimer;
+    QElapsedTimer m_clock;
+    QRandomGenerator m_random;
+    QList<PendingReply> m_pending;
+    qint64 m_lastDueMsecs;
+    Statistics m_stats;
+    int m_iacOffset;
+    uint8_t m_clearedFaults;
+
+    void handleCommand(uint8_t cmd);
+    void queueReply(QByteArray reply);
+    void scheduleSend();
+    QByteArray buildFrame80();
+    QByteArray buildFrame7d();
+    uint8_t clampByte(double value);
+};
+
+#endif // ECUEMULATOR_H
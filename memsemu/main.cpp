@@ -0,0 +1,179 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTimer>
+#include <string.h>
+#include "ptyport.h"
+#include "sensorscript.h"
+#include "ecuemulator.h"
+#include "capturereplayer.h"
+#include "rawcapture.h"
+#include "terminationsignals.h"
+
+/**
+ * Parses a four-byte ECU ID written as hex, e.g. "99000303".
+ */
+static bool parseEcuId(QString text, uint8_t *id)
+{
+  QByteArray bytes = QByteArray::fromHex(text.toLatin1());
+
+  if (bytes.size() != 4)
+  {
+    return false;
+  }
+  memcpy(id, bytes.constData(), 4);
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("memsemu");
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Emulates a MEMS 1.6 ECU on a pseudo-terminal, or replays a raw capture of a real one, for testing " PROJECTNAME " without a car.");
+  parser.addHelpOption();
+
+  QCommandLineOption linkOpt("link", "Create a symlink to the pty slave at <path>.", "path");
+  QCommandLineOption latencyOpt("latency", "Delay before each response, in milliseconds (default 5).", "ms", "5");
+  QCommandLineOption jitterOpt("jitter", "Random extra delay of up to <ms> milliseconds (default 0).", "ms", "0");
+  QCommandLineOption dropOpt("drop-rate", "Probability (0-1) that a command gets no reply.", "p", "0");
+  QCommandLineOption corruptOpt("corrupt-rate", "Probability (0-1) that a reply has a corrupted byte.", "p", "0");
+  QCommandLineOption scriptOpt("script", "Sensor waveform script.", "file");
+  QCommandLineOption idOpt("ecu-id", "ECU ID returned during init, as 8 hex digits (default 99000303).", "hex", "99000303");
+  QCommandLineOption seedOpt("seed", "Seed for jitter and fault injection (default 1).", "n", "1");
+  QCommandLineOption replayOpt("replay", "Instead of emulating, answer with the bytes recorded in a raw capture (.mcap) file.", "file");
+  QCommandLineOption speedOpt("speed", "Speed at which to replay a capture, as a multiple of its original timing, or 0 for no delays (default 1).", "x", "1");
+  QCommandLineOption statsOpt("stats", "Print command statistics every <secs> seconds.", "secs");
+
+  parser.addOption(linkOpt);
+  parser.addOption(latencyOpt);
+  parser.addOption(jitterOpt);
+  parser.addOption(dropOpt);
+  parser.addOption(corruptOpt);
+  parser.addOption(scriptOpt);
+  parser.addOption(idOpt);
+  parser.addOption(seedOpt);
+  parser.addOption(replayOpt);
+  parser.addOption(speedOpt);
+  parser.addOption(statsOpt);
+  parser.process(app);
+
+  ECUEmulator::Settings settings;
+  settings.latencyMsecs = parser.value(latencyOpt).toInt();
+  settings.jitterMsecs = parser.value(jitterOpt).toInt();
+  settings.dropRate = parser.value(dropOpt).toDouble();
+  settings.corruptRate = parser.value(corruptOpt).toDouble();
+  settings.seed = parser.value(seedOpt).toUInt();
+
+  if (!parseEcuId(parser.value(idOpt), settings.ecuId))
+  {
+    err << "Invalid ECU ID: " << parser.value(idOpt) << Qt::endl;
+    return 1;
+  }
+
+  SensorScript script;
+  if (parser.isSet(scriptOpt))
+  {
+    QString error;
+    if (!script.load(parser.value(scriptOpt), error))
+    {
+      err << error << Qt::endl;
+      return 1;
+    }
+  }
+
+  PtyPort pty;
+  if (!pty.open())
+  {
+    err << "Failed to allocate a pseudo-terminal." << Qt::endl;
+    return 1;
+  }
+
+  if (parser.isSet(linkOpt) && !pty.createLink(parser.value(linkOpt)))
+  {
+    err << "Failed to create symlink " << parser.value(linkOpt) << Qt::endl;
+    return 1;
+  }
+
+  QTimer statsTimer;
+  ECUEmulator *emulator = 0;
+  CaptureReplayer *replayer = 0;
+
+  if (parser.isSet(replayOpt))
+  {
+    RawCaptureReader reader;
+    QVector<RawCapture::Record> records;
+    RawCapture::Record record;
+    bool haveCommand = false;
+    const double speed = parser.value(speedOpt).toDouble();
+
+    if (!reader.open(parser.value(replayOpt)))
+    {
+      err << parser.value(replayOpt) << ": " << reader.errorString() << Qt::endl;
+      return 1;
+    }
+
+    while (reader.next(record))
+    {
+      haveCommand = haveCommand || (record.direction == RawCapture::Transmit);
+      records.append(record);
+    }
+
+    if (!haveCommand)
+    {
+      err << parser.value(replayOpt) << ": capture contains no commands" << Qt::endl;
+      return 1;
+    }
+
+    if (speed < 0.0)
+    {
+      err << "--speed must not be negative." << Qt::endl;
+      return 1;
+    }
+
+    replayer = new CaptureReplayer(&pty, records, speed, &app);
+  }
+  else
+  {
+    emulator = new ECUEmulator(&pty, settings, script, &app);
+  }
+
+  if (parser.isSet(statsOpt))
+  {
+    QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+      if (emulator)
+      {
+        ECUEmulator::Statistics s = emulator->statistics();
+        out << "commands: " << s.commands << " frames80: " << s.frames80 << " frames7d: " << s.frames7d <<
+          " actuator: " << s.actuatorCommands << " dropped: " << s.dropped << " corrupted: " << s.corrupted << Qt::endl;
+      }
+      else
+      {
+        CaptureReplayer::Statistics s = replayer->statistics();
+        out << "commands: " << s.commands << " replies: " << s.replies << " resyncs: " << s.resyncs <<
+          " mismatches: " << s.mismatches << " loops: " << s.loops << Qt::endl;
+      }
+    });
+    statsTimer.start(parser.value(statsOpt).toInt() * 1000);
+  }
+
+  if (!installTerminationHandlers(app))
+  {
+    err << "Unable to install the signal handlers." << Qt::endl;
+    return 1;
+  }
+
+  if (replayer)
+  {
+    out << "Replaying " << parser.value(replayOpt) << " on " << pty.devicePath() << Qt::endl;
+  }
+  else
+  {
+    out << "Emulating MEMS 1.6 ECU on " << pty.devicePath() << Qt::endl;
+  }
+
+  return app.exec();
+}
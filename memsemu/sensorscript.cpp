@@ -0,0 +1,200 @@
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <math.h>
+#include "sensorscript.h"
+
+/**
+ * Constructor. Sets up the channel names and the default (warm idle) values.
+ */
+SensorScript::SensorScript()
+{
+  m_channelNames.insert("rpm", EngineSpeed);
+  m_channelNames.insert("coolant", CoolantTemp);
+  m_channelNames.insert("intake", IntakeAirTemp);
+  m_channelNames.insert("ambient", AmbientTemp);
+  m_channelNames.insert("fuel", FuelTemp);
+  m_channelNames.insert("map", ManifoldPressure);
+  m_channelNames.insert("battery", BatteryVoltage);
+  m_channelNames.insert("throttle", ThrottleVoltage);
+  m_channelNames.insert("idle", IdleSwitch);
+  m_channelNames.insert("neutral", ParkNeutralSwitch);
+  m_channelNames.insert("faults", FaultCodes);
+  m_channelNames.insert("iac", IACPosition);
+  m_channelNames.insert("lambda", LambdaVoltage);
+  m_channelNames.insert("closedloop", ClosedLoop);
+
+  m_shapeNames.insert("const", Constant);
+  m_shapeNames.insert("sine", Sine);
+  m_shapeNames.insert("ramp", Ramp);
+  m_shapeNames.insert("square", Square);
+  m_shapeNames.insert("triangle", Triangle);
+  m_shapeNames.insert("step", Step);
+
+  setConstant(EngineSpeed, 850);
+  setConstant(CoolantTemp, 88);
+  setConstant(IntakeAirTemp, 35);
+  setConstant(AmbientTemp, 20);
+  setConstant(FuelTemp, 30);
+  setConstant(ManifoldPressure, 35);
+  setConstant(BatteryVoltage, 13.8);
+  setConstant(ThrottleVoltage, 0.58);
+  setConstant(IdleSwitch, 1);
+  setConstant(ParkNeutralSwitch, 1);
+  setConstant(FaultCodes, 0);
+  setConstant(IACPosition, 40);
+  setConstant(ClosedLoop, 1);
+
+  // a healthy lambda sensor in closed loop swings rich/lean about once a second
+  m_waveforms[LambdaVoltage].shape = Square;
+  m_waveforms[LambdaVoltage].a = 150;
+  m_waveforms[LambdaVoltage].b = 750;
+  m_waveforms[LambdaVoltage].period = 1.0;
+  m_waveforms[LambdaVoltage].phase = 0.0;
+}
+
+/**
+ * Sets a channel to a fixed value.
+ */
+void SensorScript::setConstant(Channel channel, double value)
+{
+  m_waveforms[channel].shape = Constant;
+  m_waveforms[channel].a = value;
+  m_waveforms[channel].b = value;
+  m_waveforms[channel].period = 1.0;
+  m_waveforms[channel].phase = 0.0;
+}
+
+/**
+ * Reads waveform definitions from a script file. Channels not mentioned in
+ * the file keep their defaults.
+ * @param path Path to the script file
+ * @param error Receives a description of the first problem encountered
+ * @return True if the whole file was parsed successfully
+ */
+bool SensorScript::load(QString path, QString& error)
+{
+  QFile file(path);
+  int lineNum = 0;
+
+  if (!file.open(QFile::ReadOnly | QFile::Text))
+  {
+    error = "Unable to open " + path;
+    return false;
+  }
+
+  QTextStream in(&file);
+  while (!in.atEnd())
+  {
+    lineNum++;
+    if (!parseLine(in.readLine(), error))
+    {
+      error = QString("%1:%2: %3").arg(path).arg(lineNum).arg(error);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Parses a single line of a script.
+ * @return True if the line was valid (or empty); false otherwise
+ */
+bool SensorScript::parseLine(QString line, QString& error)
+{
+  QStringList fields = line.simplified().split(' ', Qt::SkipEmptyParts);
+  QList<double> params;
+
+  if (fields.isEmpty() || fields.at(0).startsWith('#'))
+  {
+    return true;
+  }
+
+  if ((fields.count() < 3) || !m_channelNames.contains(fields.at(0)) || !m_shapeNames.contains(fields.at(1)))
+  {
+    error = "Expected '<channel> <shape> <parameters>'";
+    return false;
+  }
+
+  for (int i = 2; i < fields.count(); i++)
+  {
+    bool ok = false;
+    params.append(fields.at(i).toDouble(&ok));
+    if (!ok)
+    {
+      error = "Invalid number '" + fields.at(i) + "'";
+      return false;
+    }
+  }
+
+  Waveform wave;
+  wave.shape = m_shapeNames.value(fields.at(1));
+  wave.phase = 0.0;
+
+  if (wave.shape == Constant)
+  {
+    wave.a = wave.b = params.at(0);
+    wave.period = 1.0;
+  }
+  else if (wave.shape == Step)
+  {
+    if (params.count() < 3)
+    {
+      error = "'step' requires <secs> <before> <after>";
+      return false;
+    }
+    wave.period = params.at(0);
+    wave.a = params.at(1);
+    wave.b = params.at(2);
+  }
+  else
+  {
+    if ((params.count() < 3) || (params.at(2) <= 0.0))
+    {
+      error = "Periodic waveforms require <min> <max> <period_secs>";
+      return false;
+    }
+    wave.a = params.at(0);
+    wave.b = params.at(1);
+    wave.period = params.at(2);
+    wave.phase = (params.count() > 3) ? params.at(3) : 0.0;
+  }
+
+  m_waveforms[m_channelNames.value(fields.at(0))] = wave;
+  return true;
+}
+
+/**
+ * Evaluates a channel's waveform.
+ * @param channel Channel to evaluate
+ * @param secs Time since the emulator started, in seconds
+ * @return Value of the channel, in engineering units
+ */
+double SensorScript::value(Channel channel, double secs) const
+{
+  const Waveform& w = m_waveforms[channel];
+  double frac = 0.0;
+
+  if ((w.shape != Constant) && (w.shape != Step))
+  {
+    frac = fmod(secs + w.phase, w.period) / w.period;
+  }
+
+  switch (w.shape)
+  {
+  case Sine:
+    return w.a + ((w.b - w.a) * (0.5 - (0.5 * cos(2.0 * M_PI * frac))));
+  case Ramp:
+    return w.a + ((w.b - w.a) * frac);
+  case Square:
+    return (frac < 0.5) ? w.a : w.b;
+  case Triangle:
+    return w.a + ((w.b - w.a) * ((frac < 0.5) ? (frac * 2.0) : (2.0 - (frac * 2.0))));
+  case Step:
+    return (secs < w.period) ? w.a : w.b;
+  case Constant:
+  default:
+    return w.a;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef SENSORSCRIPT_H
+#define SENSORSCRIPT_H
+
+#include <QString>
+#include <QHash>
+
+/**
+ * Set of time-varying sensor values used to build the emulated ECU's data
+ * frames. Each channel follows a simple waveform; the defaults describe a
+ * warm engine at idle.
+ *
+ * Script files contain one channel per line:
+ *   <channel> const <value>
+ *   <channel> sine|ramp|square|triangle <min> <max> <period_secs> [phase_secs]
+ *   <channel> step <secs> <before> <after>
+ * Blank lines and lines starting with '#' are ignored.
+ */
+class SensorScript
+{
+public:
+    enum Channel
+    {
+        EngineSpeed = 0,
+        CoolantTemp,
+        IntakeAirTemp,
+        AmbientTemp,
+        FuelTemp,
+        ManifoldPressure,
+        BatteryVoltage,
+        ThrottleVoltage,
+        IdleSwitch,
+        ParkNeutralSwitch,
+        FaultCodes,
+        IACPosition,
+        LambdaVoltage,
+        ClosedLoop,
+        NumChannels
+    };
+
+    SensorScript();
+
+    bool load(QString path, QString& error);
+    bool parseLine(QString line, QString& error);
+    double value(Channel channel, double secs) const;
+
+private:
+    enum Shape
+    {
+        Constant,
+        Sine,
+        Ramp,
+        Square,
+        Triangle,
+        Step
+    };
+
+    struct Waveform
+    {
+        Shape shape;
+        double a;
+        double b;
+        double period;
+        double phase;
+    };
+
+    Waveform m_waveforms[NumChannels];
+    QHash<QString,Channel> m_channelNames;
+    QHash<QString,Shape> m_shapeNames;
+
+    void setConstant(Channel channel, double value);
+};
+
+#endif // SENSORSCRIPT_H
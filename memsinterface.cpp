@@ -1,6 +1,7 @@
 #include <QThread>
 #include <QDateTime>
-#include <QCoreApplication>
+#include <QDir>
+#include <QMutexLocker>
 #include <string.h>
 #include "memsinterface.h"
 
@@ -10,7 +11,11 @@
  *  with the ECU.
  */
 MEMSInterface::MEMSInterface(QString device, QObject * parent):
-QObject(parent), m_deviceName(device), m_stopPolling(false), m_shutdownThread(false), m_initComplete(false)
+QObject(parent), m_deviceName(device), m_source(0), m_connected(0), m_stopPolling(false), m_shutdownThread(false),
+m_initComplete(false), m_serviceLoopRunning(false), m_pollTimer(0),
+m_batchDelivery(false), m_batchFirstSeq(0), m_batchCount(0), m_batchErrors(0), m_batchLastReadOk(false),
+m_commandTimer(0), m_autoReconnect(true), m_reconnecting(false), m_consecutiveReadErrors(0),
+m_reconnectAttempt(0), m_reconnectDelayMsecs(0), m_reconnectTimer(0)
 {
   memset(&m_data, 0, sizeof(mems_data));
   memset(m_d0_response_buffer, 0, 4);
@@ -21,23 +26,22 @@ QObject(parent), m_deviceName(device), m_stopPolling(false), m_shutdownThread(fa
  */
 MEMSInterface::~MEMSInterface()
 {
+  delete m_source;
 }
 
 /**
- * Clears the block of fault codes.
+ * Queues a request to clear the block of fault codes.
  */
 void MEMSInterface::onFaultCodesClearRequested()
 {
-  if (m_initComplete && mems_is_connected(&m_memsinfo))
+  if (sourceConnected())
   {
-    if (mems_clear_faults(&m_memsinfo))
-    {
-      emit faultCodesClearSuccess();
-    }
-    else
-    {
-      emit errorSendingCommand();
-    }
+    ECUCommand cmd;
+    cmd.type = ECUCommand::ClearFaults;
+    cmd.priority = ECUCommand::NormalPriority;
+    cmd.completion = ECUCommand::NoCompletion;
+    cmd.hasFollowUp = false;
+    queueCommand(cmd);
   }
   else
   {
@@ -50,33 +54,55 @@ void MEMSInterface::onFaultCodesClearRequested()
  */
 void MEMSInterface::onIdleAirControlMovementRequest(int desiredPos)
 {
-  if (m_initComplete && mems_is_connected(&m_memsinfo))
+  if (sourceConnected())
   {
-    if (!mems_move_iac(&m_memsinfo, desiredPos))
-    {
-      emit errorSendingCommand();
-    }
+    ECUCommand cmd;
+    cmd.type = ECUCommand::MoveIAC;
+    cmd.priority = ECUCommand::NormalPriority;
+    cmd.completion = ECUCommand::MoveIACDone;
+    cmd.iacPosition = desiredPos;
+    cmd.hasFollowUp = false;
+    queueCommand(cmd);
   }
   else
   {
     emit notConnected();
+    emit moveIACComplete();
   }
-
-  emit moveIACComplete();
 }
 
 /**
- * Attempts to open the serial device that is connected to the ECU.
+ * Creates the data source for the current device name and attempts to open
+ * it. For a serial device, this opens the port and performs the ECU init.
  * @return True if serial device was opened successfully and the
  *  ECU is responding to commands; false otherwise.
  */
 bool MEMSInterface::connectToECU()
 {
-  bool status = mems_connect(&m_memsinfo, m_deviceName.toStdString().c_str()) &&
-    mems_init_link(&m_memsinfo, m_d0_response_buffer);
+  // the device name may have changed since the last connection, and may
+  // now refer to a different kind of source
+  m_connected.store(0);
+  {
+    QMutexLocker locker(&m_sourceMutex);
+    delete m_source;
+    m_source = ECUDataSource::create(m_deviceName, &m_replayClock);
+  }
+
+  if (!m_captureDir.isEmpty() && m_source->supportsCapture() &&
+      (QDir(m_captureDir).exists() || QDir().mkpath(m_captureDir)))
+  {
+    const QString name = QString("%1-%2.mcap")
+                           .arg(m_deviceId.isEmpty() ? QString("capture") : m_deviceId)
+                           .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    m_source->setCapturePath(m_captureDir + QDir::separator() + name);
+  }
+
+  bool status = m_source->connect(m_d0_response_buffer);
+  publishConnected();
   if (status)
   {
-    emit gotEcuId(m_d0_response_buffer);
+    m_cachedEcuId = QByteArray((const char*)m_d0_response_buffer, 4);
+    emit gotEcuId(m_cachedEcuId);
   }
   return status;
 }
@@ -87,6 +113,21 @@ bool MEMSInterface::connectToECU()
 void MEMSInterface::disconnectFromECU()
 {
   m_stopPolling = true;
+
+  // if we're between reconnect attempts, there's no read in progress to
+  // notice the flag, so wake the interface thread up
+  QMetaObject::invokeMethod(this, "onStopPollingRequest", Qt::QueuedConnection);
+}
+
+/**
+ * Stops a reconnect that's in progress, in response to a disconnect request.
+ */
+void MEMSInterface::onStopPollingRequest()
+{
+  if (m_reconnecting)
+  {
+    stopServiceLoop();
+  }
 }
 
 /**
@@ -97,6 +138,10 @@ void MEMSInterface::onShutdownThreadRequest()
   if (m_serviceLoopRunning)
   {
     m_shutdownThread = true;
+    if (m_reconnecting)
+    {
+      stopServiceLoop();
+    }
   }
   else
   {
@@ -105,25 +150,69 @@ void MEMSInterface::onShutdownThreadRequest()
 }
 
 /**
- * Indicates whether the serial device is currently open/connected.
+ * Closes the device out from under a read that's blocked in the interface
+ * thread, so that the read fails and the service loop gets a chance to act
+ * on a shutdown request. This may be called from any thread.
+ */
+void MEMSInterface::cancelRead()
+{
+  QMutexLocker locker(&m_sourceMutex);
+  if (m_source != 0)
+  {
+    m_source->cancelRead();
+  }
+}
+
+/**
+ * Indicates whether the serial device is currently open/connected. This
+ * may be called from any thread; it returns the state as last published
+ * by the interface thread, which owns (and replaces) the data source.
  * @return True when the device is connected; false otherwise.
  */
 bool MEMSInterface::isConnected()
 {
-  return (m_initComplete && mems_is_connected(&m_memsinfo));
+  return (m_connected.load() != 0);
 }
 
 /**
- * Responds to the parent thread being started by initializing the library
- * struct and emitting a signal indicating that the interface is ready.
+ * Checks the data source directly. Only for use on the interface thread.
+ */
+bool MEMSInterface::sourceConnected()
+{
+  return (m_initComplete && (m_source != 0) && m_source->isConnected());
+}
+
+/**
+ * Makes the current state of the data source available to isConnected().
+ */
+void MEMSInterface::publishConnected()
+{
+  m_connected.store(sourceConnected() ? 1 : 0);
+}
+
+/**
+ * Responds to the parent thread being started by creating the poll timer
+ * and emitting a signal indicating that the interface is ready.
  */
 void MEMSInterface::onParentThreadStarted()
 {
-  // Initialize the interface state info struct here, so that
-  // it's in the context of the thread that will use it.
+  // Create the timer here, so that it (and the data source, which is
+  // created on connect) lives in the context of the thread that uses it.
   if (!m_initComplete)
   {
-    mems_init(&m_memsinfo);
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setSingleShot(true);
+    m_pollTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_pollTimer, SIGNAL(timeout()), this, SLOT(onPollTimer()));
+
+    m_commandTimer = new QTimer(this);
+    m_commandTimer->setSingleShot(true);
+    connect(m_commandTimer, SIGNAL(timeout()), this, SLOT(onCommandTimer()));
+
+    m_reconnectTimer = new QTimer(this);
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, SIGNAL(timeout()), this, SLOT(onReconnectTimer()));
+
     m_initComplete = true;
   }
 
@@ -135,8 +224,15 @@ void MEMSInterface::onParentThreadStarted()
  */
 void MEMSInterface::onStartPollingRequest()
 {
+  // already polling (or trying to get the link back)
+  if (m_serviceLoopRunning)
+  {
+    return;
+  }
+
   if (connectToECU())
   {
+    onResetLinkStatsRequest();
     emit connected();
 
     m_stopPolling = false;
@@ -160,32 +256,125 @@ void MEMSInterface::onStartPollingRequest()
 }
 
 /**
- * Calls the library in a loop until commanded to stop.
+ * Starts reading from the ECU at the configured rate. Reads are driven by a
+ * timer on this thread's event loop, so queued slots (actuator tests, fault
+ * clearing, etc.) are serviced between reads without any busy-waiting.
  */
 void MEMSInterface::runServiceLoop()
 {
-  bool connected = mems_is_connected(&m_memsinfo);
-
   m_serviceLoopRunning = true;
-  while (!m_stopPolling && !m_shutdownThread && connected)
+  m_reconnecting = false;
+  m_consecutiveReadErrors = 0;
+  m_scheduler.start();
+  m_pollTimer->start(0);
+}
+
+/**
+ * Performs a single read and schedules the next one, or shuts down the
+ * polling if we've been asked to stop. If the link has dropped, starts
+ * trying to re-establish it (when auto-reconnect is enabled).
+ */
+void MEMSInterface::onPollTimer()
+{
+  if (m_stopPolling || m_shutdownThread)
   {
-    if (mems_read(&m_memsinfo, &m_data))
+    stopServiceLoop();
+    return;
+  }
+
+  if (m_autoReconnect)
+  {
+    if (!m_source->isConnected() || (m_consecutiveReadErrors >= s_maxConsecutiveReadErrors))
     {
-      emit readSuccess();
-      emit dataReady();
+      beginReconnect();
+      return;
+    }
+  }
+  else if (!m_source->isConnected())
+  {
+    // without reconnection, keep polling through read errors until the
+    // device itself goes away
+    stopServiceLoop();
+    return;
+  }
+
+  drainCommands();
+
+  const qint64 readStart = m_linkStats.nowUsecs();
+  const bool readOk = m_source->read(&m_data);
+  publishConnected();
+
+  m_linkStats.recordRead(readStart, readOk);
+
+  if (readOk)
+  {
+    m_consecutiveReadErrors = 0;
+
+    if (m_batchCount == 0)
+    {
+      m_batchFirstSeq = m_samples.published();
+    }
+    m_samples.push(m_data);
+  }
+  else
+  {
+    m_consecutiveReadErrors++;
+  }
+
+  if (m_batchDelivery)
+  {
+    m_batchLastReadOk = readOk;
+    if (readOk)
+    {
+      m_batchCount++;
     }
     else
     {
-      emit readError();
+      m_batchErrors++;
     }
-    QCoreApplication::processEvents();
+    deliverBatch(false);
+  }
+  else if (readOk)
+  {
+    emit readSuccess();
+    emit dataReady();
+  }
+  else
+  {
+    emit readError();
   }
-  m_serviceLoopRunning = false;
 
-  if (connected)
+  const int waitMsecs = m_scheduler.pollCompleted();
+
+  if (m_scheduler.rateWindowElapsed())
   {
-    mems_disconnect(&m_memsinfo);
+    const double achieved = m_scheduler.takeAchievedRate();
+
+    m_linkStats.setAchievedRate(achieved);
+    publishLinkStats();
+
+    emit pollRateMeasured(m_scheduler.targetRate(), achieved);
   }
+
+  m_pollTimer->start(waitMsecs);
+}
+
+/**
+ * Stops the poll timer, closes the serial device, and exits the thread if
+ * a shutdown was requested.
+ */
+void MEMSInterface::stopServiceLoop()
+{
+  deliverBatch(true);
+  m_pollTimer->stop();
+  m_reconnectTimer->stop();
+  m_serviceLoopRunning = false;
+  m_reconnecting = false;
+
+  flushCommands();
+  m_source->disconnect();
+  publishConnected();
+  publishLinkStats();
   emit disconnected();
 
   if (m_shutdownThread)
@@ -194,70 +383,394 @@ void MEMSInterface::runServiceLoop()
   }
 }
 
-bool MEMSInterface::actuatorOnOffDelayTest(actuator_cmd onCmd, actuator_cmd offCmd)
+/**
+ * Stops polling and starts trying to re-establish the link. The first
+ * attempt is made straight away; after that, the delay between attempts
+ * doubles each time, up to a limit.
+ */
+void MEMSInterface::beginReconnect()
 {
-  bool status = false;
+  deliverBatch(true);
+  m_pollTimer->stop();
+  flushCommands();
+
+  publishConnected();
+
+  m_reconnecting = true;
+  m_reconnectAttempt = 0;
+  m_reconnectDelayMsecs = s_initialReconnectDelayMsecs;
+  m_outageTimer.start();
+
+  emit linkLost();
+  m_reconnectTimer->start(0);
+}
+
+/**
+ * Makes one attempt to re-establish the link. On success, polling resumes
+ * with the same sample stream, so consumers see a gap rather than a new
+ * session.
+ */
+void MEMSInterface::onReconnectTimer()
+{
+  if (m_stopPolling || m_shutdownThread)
+  {
+    stopServiceLoop();
+    return;
+  }
+
+  m_reconnectAttempt++;
+
+  const bool relinked = m_source->reinitLink(m_d0_response_buffer);
+  publishConnected();
+
+  if (relinked)
+  {
+    const QByteArray ecuId((const char*)m_d0_response_buffer, 4);
+
+    // only bother the GUI with the ID if it's actually a different ECU
+    if (ecuId != m_cachedEcuId)
+    {
+      m_cachedEcuId = ecuId;
+      emit gotEcuId(ecuId);
+    }
+
+    m_linkStats.recordReconnect(m_outageTimer.nsecsElapsed() / 1000);
+
+    emit linkRecovered(m_outageTimer.elapsed(), m_reconnectAttempt);
+
+    m_reconnecting = false;
+    m_consecutiveReadErrors = 0;
+    m_scheduler.start();
+    m_pollTimer->start(0);
+  }
+  else
+  {
+    emit reconnecting(m_reconnectAttempt, m_reconnectDelayMsecs);
+    m_reconnectTimer->start(m_reconnectDelayMsecs);
+    m_reconnectDelayMsecs = qMin(m_reconnectDelayMsecs * 2, s_maxReconnectDelayMsecs);
+  }
+}
+
+/**
+ * Enables or disables batched delivery. In batched mode, the per-read
+ * dataReady(), readSuccess() and readError() signals are replaced by a
+ * single samplesReady() signal, sent no more than s_maxBatchRateHz times a
+ * second, that covers every read since the previous one. Consumers fetch
+ * the samples themselves from the sample ring.
+ */
+void MEMSInterface::onBatchDeliveryChangeRequest(bool enabled)
+{
+  if (!enabled)
+  {
+    deliverBatch(true);
+  }
+  m_batchDelivery = enabled;
+}
+
+/**
+ * Emits samplesReady() for the reads made since the last batch, if there
+ * were any and enough time has passed.
+ * @param force Emit the batch now, regardless of the rate limit
+ */
+void MEMSInterface::deliverBatch(bool force)
+{
+  if ((m_batchCount == 0) && (m_batchErrors == 0))
+  {
+    return;
+  }
 
-  if (m_initComplete && mems_is_connected(&m_memsinfo))
+  if (force || !m_batchTimer.isValid() || (m_batchTimer.elapsed() >= (1000 / s_maxBatchRateHz)))
   {
-    if (mems_test_actuator(&m_memsinfo, onCmd, NULL))
+    emit samplesReady(m_batchFirstSeq, m_batchCount, m_batchErrors, m_batchLastReadOk);
+
+    m_batchCount = 0;
+    m_batchErrors = 0;
+    m_batchTimer.start();
+  }
+}
+
+/**
+ * Returns a copy of the link statistics, as of the last time they were
+ * published (once a second while polling, and on disconnecting). This may
+ * be called from any thread.
+ */
+LinkStats MEMSInterface::getLinkStats()
+{
+  QMutexLocker locker(&m_linkStatsMutex);
+  return m_linkStatsSnapshot;
+}
+
+/**
+ * Copies the link statistics for getLinkStats(). This is the only place
+ * the interface thread takes the lock, so the reads themselves never wait
+ * on it.
+ */
+void MEMSInterface::publishLinkStats()
+{
+  QMutexLocker locker(&m_linkStatsMutex);
+  m_linkStatsSnapshot = m_linkStats;
+}
+
+/**
+ * Clears the link statistics. This is done automatically each time a new
+ * connection is made (but not when the link is re-established after a
+ * dropout).
+ */
+void MEMSInterface::onResetLinkStatsRequest()
+{
+  m_linkStats.reset();
+  publishLinkStats();
+}
+
+/**
+ * Enables or disables automatic reconnection when the link drops.
+ */
+void MEMSInterface::onAutoReconnectChangeRequest(bool enabled)
+{
+  m_autoReconnect = enabled;
+}
+
+/**
+ * Sets the directory in which the raw serial traffic of each connection is
+ * recorded (see CaptureProxy). Takes effect at the next connection.
+ * @param dir Directory for capture files, or an empty string for no capture
+ */
+void MEMSInterface::onCaptureDirectoryChangeRequest(QString dir)
+{
+  m_captureDir = dir;
+}
+
+/**
+ * Sets the number of reads per second to attempt.
+ * @param hz Target rate; zero selects maximum-throughput mode
+ */
+void MEMSInterface::onPollRateChangeRequest(double hz)
+{
+  m_scheduler.setTargetRate(hz);
+}
+
+/**
+ * Returns the nominal interval between reads.
+ * @return Interval in milliseconds, or 0 when polling as fast as possible
+ */
+int MEMSInterface::getIntervalMsecs()
+{
+  return m_scheduler.intervalMsecs();
+}
+
+/**
+ * Adds a command to the queue, and makes sure the queue will be serviced
+ * when the command becomes due even if the next read is further away.
+ */
+void MEMSInterface::queueCommand(const ECUCommand& cmd, int delayMsecs)
+{
+  m_commands.enqueue(cmd, delayMsecs);
+
+  const int wait = m_commands.msecsUntilNextReady();
+  if (!m_commandTimer->isActive() || (m_commandTimer->remainingTime() > wait))
+  {
+    m_commandTimer->start(wait);
+  }
+}
+
+/**
+ * Services the command queue between reads.
+ */
+void MEMSInterface::onCommandTimer()
+{
+  drainCommands();
+}
+
+/**
+ * Sends commands that are due, highest priority first. Only a few are sent
+ * at a time so that a burst of commands can't starve the polling; any that
+ * remain are picked up on the next pass.
+ */
+void MEMSInterface::drainCommands()
+{
+  ECUCommand cmd;
+  int sent = 0;
+
+  while ((sent < s_maxCommandsPerDrain) && m_commands.takeReady(cmd))
+  {
+    if (sourceConnected())
     {
-      QThread::sleep(2);
-      if (mems_test_actuator(&m_memsinfo, offCmd, NULL))
-      {
-        status = true;
-      }
+      executeCommand(cmd);
     }
+    else
+    {
+      emitCompletion(cmd.completion);
+    }
+    sent++;
+  }
+
+  const int wait = m_commands.msecsUntilNextReady();
+  if (wait >= 0)
+  {
+    m_commandTimer->start(wait);
+  }
+}
+
+/**
+ * Empties the queue before disconnecting. Anything that switches an
+ * actuator off is sent immediately, regardless of its scheduled time, so
+ * that no relay is left on; everything else is dropped.
+ */
+void MEMSInterface::flushCommands()
+{
+  ECUCommand cmd;
 
-    if (!status)
+  m_commandTimer->stop();
+  while (m_commands.takeAny(cmd))
+  {
+    if ((cmd.priority == ECUCommand::OffPriority) && m_source->isConnected())
+    {
+      executeCommand(cmd);
+    }
+    else
+    {
+      emitCompletion(cmd.completion);
+    }
+  }
+}
+
+/**
+ * Sends a single command to the ECU. If the command has a follow-up (the
+ * "off" half of an actuator test), that is queued to run after its delay;
+ * otherwise the command's completion signal is emitted.
+ */
+void MEMSInterface::executeCommand(const ECUCommand& cmd)
+{
+  const qint64 start = m_linkStats.nowUsecs();
+  bool status = false;
+
+  switch (cmd.type)
+  {
+  case ECUCommand::Actuator:
+    status = m_source->testActuator(cmd.actuator);
+    break;
+  case ECUCommand::ClearFaults:
+    status = m_source->clearFaults();
+    if (status)
     {
-      emit errorSendingCommand();
+      emit faultCodesClearSuccess();
     }
+    break;
+  case ECUCommand::MoveIAC:
+    status = m_source->moveIAC(cmd.iacPosition);
+    break;
+  }
+
+  m_linkStats.recordCommand(start, status);
+
+  if (!status)
+  {
+    emit errorSendingCommand();
+  }
+
+  if (status && cmd.hasFollowUp)
+  {
+    ECUCommand next = cmd;
+    next.actuator = cmd.followUp;
+    next.priority = ECUCommand::OffPriority;
+    next.hasFollowUp = false;
+    queueCommand(next, cmd.followUpDelayMsecs);
   }
   else
   {
-    emit notConnected();
+    emitCompletion(cmd.completion);
   }
+}
 
-  return status;
+/**
+ * Emits the signal that tells the GUI an operation is finished.
+ */
+void MEMSInterface::emitCompletion(ECUCommand::Completion completion)
+{
+  switch (completion)
+  {
+  case ECUCommand::FuelPumpTestDone:
+    emit fuelPumpTestComplete();
+    break;
+  case ECUCommand::PTCRelayTestDone:
+    emit ptcRelayTestComplete();
+    break;
+  case ECUCommand::ACRelayTestDone:
+    emit acRelayTestComplete();
+    break;
+  case ECUCommand::MoveIACDone:
+    emit moveIACComplete();
+    break;
+  case ECUCommand::NoCompletion:
+  default:
+    break;
+  }
+}
+
+/**
+ * Queues a test that switches an actuator on, and then off again a couple
+ * of seconds later. Polling continues while the actuator is on.
+ */
+void MEMSInterface::queueOnOffTest(actuator_cmd onCmd, actuator_cmd offCmd, ECUCommand::Completion completion)
+{
+  if (sourceConnected())
+  {
+    ECUCommand cmd;
+    cmd.type = ECUCommand::Actuator;
+    cmd.priority = ECUCommand::NormalPriority;
+    cmd.completion = completion;
+    cmd.actuator = onCmd;
+    cmd.hasFollowUp = true;
+    cmd.followUp = offCmd;
+    cmd.followUpDelayMsecs = s_actuatorTestMsecs;
+    queueCommand(cmd);
+  }
+  else
+  {
+    emit notConnected();
+    emitCompletion(completion);
+  }
 }
 
 void MEMSInterface::onFuelPumpTest()
 {
-  actuatorOnOffDelayTest(MEMS_FuelPumpOn, MEMS_FuelPumpOff);
-  emit fuelPumpTestComplete();
+  queueOnOffTest(MEMS_FuelPumpOn, MEMS_FuelPumpOff, ECUCommand::FuelPumpTestDone);
 }
 
 void MEMSInterface::onPTCRelayTest()
 {
-  actuatorOnOffDelayTest(MEMS_PTCRelayOn, MEMS_PTCRelayOff);
-  emit ptcRelayTestComplete();
+  queueOnOffTest(MEMS_PTCRelayOn, MEMS_PTCRelayOff, ECUCommand::PTCRelayTestDone);
 }
 
 void MEMSInterface::onACRelayTest()
 {
-  actuatorOnOffDelayTest(MEMS_ACRelayOn, MEMS_ACRelayOff);
-  emit acRelayTestComplete();
+  queueOnOffTest(MEMS_ACRelayOn, MEMS_ACRelayOff, ECUCommand::ACRelayTestDone);
 }
 
 void MEMSInterface::onIgnitionCoilTest()
 {
-  if (m_initComplete && mems_is_connected(&m_memsinfo))
+  if (sourceConnected())
   {
-    if (!mems_test_actuator(&m_memsinfo, MEMS_FireCoil, NULL))
-    {
-      emit errorSendingCommand();
-    }
+    ECUCommand cmd;
+    cmd.type = ECUCommand::Actuator;
+    cmd.priority = ECUCommand::NormalPriority;
+    cmd.completion = ECUCommand::NoCompletion;
+    cmd.actuator = MEMS_FireCoil;
+    cmd.hasFollowUp = false;
+    queueCommand(cmd);
   }
 }
 
 void MEMSInterface::onFuelInjectorTest()
 {
-  if (m_initComplete && mems_is_connected(&m_memsinfo))
+  if (sourceConnected())
   {
-    if (!mems_test_actuator(&m_memsinfo, MEMS_TestInjectors, NULL))
-    {
-      emit errorSendingCommand();
-    }
+    ECUCommand cmd;
+    cmd.type = ECUCommand::Actuator;
+    cmd.priority = ECUCommand::NormalPriority;
+    cmd.completion = ECUCommand::NoCompletion;
+    cmd.actuator = MEMS_TestInjectors;
+    cmd.hasFollowUp = false;
+    queueCommand(cmd);
   }
 }
@@ -5,9 +5,18 @@
 #include <QString>
 #include <QHash>
 #include <QByteArray>
-#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QAtomicInt>
 #include "rosco.h"
 #include "commonunits.h"
+#include "samplering.h"
+#include "pollscheduler.h"
+#include "ecudatasource.h"
+#include "replayclock.h"
+#include "commandqueue.h"
+#include "linkstats.h"
 
 class MEMSInterface : public QObject
 {
@@ -19,12 +28,17 @@ public:
     void setSerialDevice(QString device) { m_deviceName = device; }
 
     QString getSerialDevice() { return m_deviceName; }
+    void setDeviceId(QString id) { m_deviceId = id; }
+    QString getDeviceId() { return m_deviceId; }
     int getIntervalMsecs();
 
     bool isConnected();
     void disconnectFromECU();
 
-    mems_data* getData()          { return &m_data; }
+    SampleRing* getSampleRing()   { return &m_samples; }
+    ReplayClock* getReplayClock() { return &m_replayClock; }
+    bool isReplay() { return m_deviceName.startsWith(ECUDataSource::replayPrefix()); }
+    LinkStats getLinkStats();
     librosco_version getVersion() { return mems_get_lib_version(); }
 
     void cancelRead();
@@ -34,6 +48,11 @@ public slots:
     void onFaultCodesClearRequested();
     void onStartPollingRequest();
     void onShutdownThreadRequest();
+    void onPollRateChangeRequest(double hz);
+    void onAutoReconnectChangeRequest(bool enabled);
+    void onResetLinkStatsRequest();
+    void onBatchDeliveryChangeRequest(bool enabled);
+    void onCaptureDirectoryChangeRequest(QString dir);
 
     void onFuelPumpTest();
     void onPTCRelayTest();
@@ -52,26 +71,93 @@ signals:
     void failedToConnect(QString dev);
     void interfaceThreadReady();
     void notConnected();
-    void gotEcuId(uint8_t* id_buffer);
+    void gotEcuId(QByteArray id);
     void errorSendingCommand();
     void fuelPumpTestComplete();
     void ptcRelayTestComplete();
     void acRelayTestComplete();
     void moveIACComplete();
+    void pollRateMeasured(double requestedHz, double achievedHz);
+    void samplesReady(quint64 firstSeq, int count, int readErrors, bool lastReadOk);
+    void linkLost();
+    void reconnecting(int attempt, int nextDelayMsecs);
+    void linkRecovered(qint64 outageMsecs, int attempts);
+
+private slots:
+    void onPollTimer();
+    void onCommandTimer();
+    void onReconnectTimer();
+    void onStopPollingRequest();
 
 private:
     mems_data m_data;
+    SampleRing m_samples;
     QString m_deviceName;
-    mems_info m_memsinfo;
+    QString m_deviceId;
+    ECUDataSource *m_source;
+    // held while the source is replaced, so cancelRead() can reach it
+    // from another thread
+    QMutex m_sourceMutex;
+    QAtomicInt m_connected;
+    ReplayClock m_replayClock;
     bool m_stopPolling;
     bool m_shutdownThread;
     bool m_initComplete;
     bool m_serviceLoopRunning;
     uint8_t m_d0_response_buffer[4];
+    QTimer *m_pollTimer;
+    PollScheduler m_scheduler;
+
+    // recorded by the interface thread alone; other threads get the
+    // snapshot, which is refreshed once a second
+    LinkStats m_linkStats;
+    QMutex m_linkStatsMutex;
+    LinkStats m_linkStatsSnapshot;
+
+    bool m_batchDelivery;
+    quint64 m_batchFirstSeq;
+    int m_batchCount;
+    int m_batchErrors;
+    bool m_batchLastReadOk;
+    QElapsedTimer m_batchTimer;
+
+    // upper limit on the rate of samplesReady() signals in batched mode
+    static const int s_maxBatchRateHz = 25;
+    QTimer *m_commandTimer;
+    CommandQueue m_commands;
+
+    static const int s_actuatorTestMsecs = 2000;
+    static const int s_maxCommandsPerDrain = 4;
+
+    QString m_captureDir;
+
+    bool m_autoReconnect;
+    bool m_reconnecting;
+    int m_consecutiveReadErrors;
+    int m_reconnectAttempt;
+    int m_reconnectDelayMsecs;
+    QTimer *m_reconnectTimer;
+    QElapsedTimer m_outageTimer;
+    QByteArray m_cachedEcuId;
+
+    static const int s_maxConsecutiveReadErrors = 10;
+    static const int s_initialReconnectDelayMsecs = 250;
+    static const int s_maxReconnectDelayMsecs = 8000;
 
     void runServiceLoop();
+    void stopServiceLoop();
+    void beginReconnect();
+    void deliverBatch(bool force);
+    void publishLinkStats();
     bool connectToECU();
-    bool actuatorOnOffDelayTest(actuator_cmd onCmd, actuator_cmd offCmd);
+    bool sourceConnected();
+    void publishConnected();
+    void queueOnOffTest(actuator_cmd onCmd, actuator_cmd offCmd, ECUCommand::Completion completion);
+    void queueCommand(const ECUCommand& cmd, int delayMsecs = 0);
+    void drainCommands();
+    void flushCommands();
+    void executeCommand(const ECUCommand& cmd);
+    void emitCompletion(ECUCommand::Completion completion);
 };
 
 #endif // CUXINTERFACE_H
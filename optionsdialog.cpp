@@ -1,13 +1,23 @@
 #include <QSettings>
 #include "optionsdialog.h"
-#include "serialdevenumerator.h"
+#include "ecudatasource.h"
 
 /**
  * Constructor; sets up the options-dialog UI and sets settings-file field names.
  */
 OptionsDialog::OptionsDialog(QString title, QWidget * parent):QDialog(parent),
 m_serialDeviceChanged(false),
-m_settingsGroupName("Settings"), m_settingSerialDev("SerialDevice"), m_settingTemperatureUnits("TemperatureUnits")
+m_settingsGroupName("Settings"), m_settingSerialDev("SerialDevice"),
+m_settingAdditionalDevs("AdditionalSerialDevices"), m_settingTemperatureUnits("TemperatureUnits"),
+m_settingPollRate("PollRateHz"), m_settingAutoReconnect("AutoReconnect"),
+m_settingAutoConnectOnPlug("AutoConnectOnPlug"), m_settingBatchDelivery("BatchDelivery"),
+m_settingLogFormat("LogFormat"), m_settingLogRotateSizeMB("LogRotateSizeMB"),
+m_settingLogRotateMinutes("LogRotateMinutes"), m_settingCompressLogs("CompressLogs"),
+m_settingJournaledLogs("JournaledLogs"), m_settingLogDurability("LogDurability"),
+m_settingRawCapture("RawCapture"), m_settingChangeOnlyLogs("ChangeOnlyLogs"),
+m_settingTriggeredLogging("TriggeredLogging"),
+m_settingTriggerPreSecs("TriggerPreSecs"), m_settingTriggerPostSecs("TriggerPostSecs"),
+m_settingTriggerRpm("TriggerRpm")
 {
   this->setWindowTitle(title);
   readSettings();
@@ -26,9 +36,40 @@ void OptionsDialog::setupWidgets()
   m_serialDeviceLabel = new QLabel("Serial device name:", this);
   m_serialDeviceBox = new QComboBox(this);
 
+  m_additionalDevicesLabel = new QLabel("Additional devices:", this);
+  m_additionalDevicesBox = new QLineEdit(this);
+
   m_temperatureUnitsLabel = new QLabel("Temperature units:", this);
   m_temperatureUnitsBox = new QComboBox(this);
 
+  m_pollRateLabel = new QLabel("Polling rate (Hz):", this);
+  m_pollRateBox = new QSpinBox(this);
+
+  m_logFormatLabel = new QLabel("Log format:", this);
+  m_logFormatBox = new QComboBox(this);
+
+  m_logRotateSizeLabel = new QLabel("New log file every (MB):", this);
+  m_logRotateSizeBox = new QSpinBox(this);
+  m_logRotateMinutesLabel = new QLabel("New log file every (minutes):", this);
+  m_logRotateMinutesBox = new QSpinBox(this);
+  m_compressLogsCheckbox = new QCheckBox("Compress finished log files", this);
+  m_logDurabilityLabel = new QLabel("Sync log files to disk:", this);
+  m_logDurabilityBox = new QComboBox(this);
+  m_journaledLogsCheckbox = new QCheckBox("Journaled log files (recoverable after a power cut)", this);
+  m_rawCaptureCheckbox = new QCheckBox("Capture raw serial traffic", this);
+  m_changeOnlyLogsCheckbox = new QCheckBox("Log only changes (much smaller files)", this);
+  m_triggeredLoggingCheckbox = new QCheckBox("Log only around events (new faults, overheating, high RPM)", this);
+  m_triggerPreSecsLabel = new QLabel("Seconds logged before an event:", this);
+  m_triggerPreSecsBox = new QSpinBox(this);
+  m_triggerPostSecsLabel = new QLabel("Seconds logged after an event:", this);
+  m_triggerPostSecsBox = new QSpinBox(this);
+  m_triggerRpmLabel = new QLabel("Event when engine speed exceeds (RPM):", this);
+  m_triggerRpmBox = new QSpinBox(this);
+
+  m_autoReconnectCheckbox = new QCheckBox("Reconnect automatically", this);
+  m_autoConnectOnPlugCheckbox = new QCheckBox("Connect when the adapter is plugged in", this);
+  m_batchDeliveryCheckbox = new QCheckBox("Limit display update rate", this);
+
   m_horizontalLineA = new QFrame(this);
   m_horizontalLineA->setFrameShape(QFrame::HLine);
   m_horizontalLineA->setFrameShadow(QFrame::Sunken);
@@ -36,23 +77,124 @@ void OptionsDialog::setupWidgets()
   m_okButton = new QPushButton("OK", this);
   m_cancelButton = new QPushButton("Cancel", this);
 
-  SerialDevEnumerator serialDevs;
-
-  m_serialDeviceBox->addItems(serialDevs.getSerialDevList(m_serialDeviceName));
+  // the list of devices is filled in by the device monitor
+  m_serialDeviceBox->addItem(m_serialDeviceName);
   m_serialDeviceBox->setEditable(true);
   m_serialDeviceBox->setMinimumWidth(150);
 
+  // further ECUs to read at the same time as the main one (comma-separated)
+  m_additionalDevicesBox->setText(m_additionalDevices.join(","));
+  m_additionalDevicesBox->setToolTip("Comma-separated list of other serial devices to read simultaneously");
+
   m_temperatureUnitsBox->setEditable(false);
   m_temperatureUnitsBox->addItem("Fahrenheit");
   m_temperatureUnitsBox->addItem("Celsius");
   m_temperatureUnitsBox->setCurrentIndex((int)m_tempUnits);
 
+  // a rate of zero means "read as fast as the ECU will respond"
+  m_pollRateBox->setRange(0, 100);
+  m_pollRateBox->setSpecialValueText("Maximum");
+  m_pollRateBox->setValue(m_pollRateHz);
+
+  // the binary format is much smaller, and can be converted to text later
+  m_logFormatBox->setEditable(false);
+  m_logFormatBox->addItem("Text (CSV)");
+  m_logFormatBox->addItem("Binary");
+  m_logFormatBox->setCurrentIndex(m_logFormat);
+  m_logFormatBox->setToolTip("Binary logs can be converted to text with memslog2csv");
+
+  // zero means a single log file that grows without limit
+  m_logRotateSizeBox->setRange(0, 4096);
+  m_logRotateSizeBox->setSpecialValueText("Never");
+  m_logRotateSizeBox->setValue(m_logRotateSizeMB);
+  m_logRotateMinutesBox->setRange(0, 7 * 24 * 60);
+  m_logRotateMinutesBox->setSpecialValueText("Never");
+  m_logRotateMinutesBox->setValue(m_logRotateMinutes);
+  m_compressLogsCheckbox->setChecked(m_compressLogs);
+  m_compressLogsCheckbox->setToolTip("Gzips each log file once logging moves on to the next one");
+
+  // the order matches LogWriter::Durability
+  m_logDurabilityBox->setEditable(false);
+  m_logDurabilityBox->addItem("Never (fastest)");
+  m_logDurabilityBox->addItem("Every second");
+  m_logDurabilityBox->addItem("After every write (safest)");
+  m_logDurabilityBox->setCurrentIndex(m_logDurability);
+  m_journaledLogsCheckbox->setChecked(m_journaledLogs);
+  m_journaledLogsCheckbox->setToolTip("Journaled logs can be converted to plain files with memslog2csv");
+
+  // the capture is taken through a pseudo-terminal, which Windows lacks
+  m_rawCaptureCheckbox->setChecked(m_rawCapture);
+  m_rawCaptureCheckbox->setToolTip("Records every byte exchanged with the ECU, for replay with memsemu");
+#ifdef WIN32
+  m_rawCaptureCheckbox->setChecked(false);
+  m_rawCaptureCheckbox->setEnabled(false);
+#endif
+
+  // small flickers in the noisier channels (e.g. a few RPM) are ignored
+  m_changeOnlyLogsCheckbox->setChecked(m_changeOnlyLogs);
+  m_changeOnlyLogsCheckbox->setToolTip("Writes a value only when it changes noticeably, with a full record every 10 seconds");
+
+  // the coolant limit is the critical value shown on the temperature gauge
+  m_triggeredLoggingCheckbox->setChecked(m_triggeredLogging);
+  m_triggeredLoggingCheckbox->setToolTip("Keeps recent samples in memory, and only writes them out when something happens");
+  m_triggerPreSecsBox->setRange(1, 600);
+  m_triggerPreSecsBox->setValue(m_triggerPreSecs);
+  m_triggerPostSecsBox->setRange(1, 3600);
+  m_triggerPostSecsBox->setValue(m_triggerPostSecs);
+  m_triggerRpmBox->setRange(0, 9000);
+  m_triggerRpmBox->setSingleStep(100);
+  m_triggerRpmBox->setSpecialValueText("Never");
+  m_triggerRpmBox->setValue(m_triggerRpm);
+
+  m_autoReconnectCheckbox->setChecked(m_autoReconnect);
+  m_autoConnectOnPlugCheckbox->setChecked(m_autoConnectOnPlug);
+
+  // deliver samples to the GUI in batches rather than one event per read
+  m_batchDeliveryCheckbox->setChecked(m_batchDelivery);
+  m_batchDeliveryCheckbox->setToolTip("Reduces CPU load at high polling rates; all samples are still logged");
+
   m_grid->addWidget(m_serialDeviceLabel, row, 0);
   m_grid->addWidget(m_serialDeviceBox, row++, 1);
 
+  m_grid->addWidget(m_additionalDevicesLabel, row, 0);
+  m_grid->addWidget(m_additionalDevicesBox, row++, 1);
+
   m_grid->addWidget(m_temperatureUnitsLabel, row, 0);
   m_grid->addWidget(m_temperatureUnitsBox, row++, 1);
 
+  m_grid->addWidget(m_pollRateLabel, row, 0);
+  m_grid->addWidget(m_pollRateBox, row++, 1);
+
+  m_grid->addWidget(m_logFormatLabel, row, 0);
+  m_grid->addWidget(m_logFormatBox, row++, 1);
+
+  m_grid->addWidget(m_logRotateSizeLabel, row, 0);
+  m_grid->addWidget(m_logRotateSizeBox, row++, 1);
+
+  m_grid->addWidget(m_logRotateMinutesLabel, row, 0);
+  m_grid->addWidget(m_logRotateMinutesBox, row++, 1);
+
+  m_grid->addWidget(m_compressLogsCheckbox, row++, 0, 1, 2);
+
+  m_grid->addWidget(m_logDurabilityLabel, row, 0);
+  m_grid->addWidget(m_logDurabilityBox, row++, 1);
+
+  m_grid->addWidget(m_journaledLogsCheckbox, row++, 0, 1, 2);
+  m_grid->addWidget(m_rawCaptureCheckbox, row++, 0, 1, 2);
+  m_grid->addWidget(m_changeOnlyLogsCheckbox, row++, 0, 1, 2);
+
+  m_grid->addWidget(m_triggeredLoggingCheckbox, row++, 0, 1, 2);
+  m_grid->addWidget(m_triggerPreSecsLabel, row, 0);
+  m_grid->addWidget(m_triggerPreSecsBox, row++, 1);
+  m_grid->addWidget(m_triggerPostSecsLabel, row, 0);
+  m_grid->addWidget(m_triggerPostSecsBox, row++, 1);
+  m_grid->addWidget(m_triggerRpmLabel, row, 0);
+  m_grid->addWidget(m_triggerRpmBox, row++, 1);
+
+  m_grid->addWidget(m_autoReconnectCheckbox, row++, 0, 1, 2);
+  m_grid->addWidget(m_autoConnectOnPlugCheckbox, row++, 0, 1, 2);
+  m_grid->addWidget(m_batchDeliveryCheckbox, row++, 0, 1, 2);
+
   m_grid->addWidget(m_horizontalLineA, row++, 0, 1, 2);
 
   m_grid->addWidget(m_okButton, row, 0);
@@ -72,9 +214,18 @@ void OptionsDialog::accept()
   // set a flag if the serial device has been changed;
   // the main application needs to know if it should
   // reconnect to the ECU
-  if (m_serialDeviceName.compare(newSerialDeviceName) != 0)
+  QStringList newAdditionalDevices;
+
+  foreach (QString dev, m_additionalDevicesBox->text().split(',', Qt::SkipEmptyParts))
+  {
+    newAdditionalDevices.append(dev.trimmed());
+  }
+
+  if ((m_serialDeviceName.compare(newSerialDeviceName) != 0) ||
+      (m_additionalDevices != newAdditionalDevices))
   {
     m_serialDeviceName = newSerialDeviceName;
+    m_additionalDevices = newAdditionalDevices;
     m_serialDeviceChanged = true;
   }
   else
@@ -83,11 +234,46 @@ void OptionsDialog::accept()
   }
 
   m_tempUnits = (TemperatureUnits) (m_temperatureUnitsBox->currentIndex());
+  m_pollRateHz = m_pollRateBox->value();
+  m_autoReconnect = m_autoReconnectCheckbox->isChecked();
+  m_autoConnectOnPlug = m_autoConnectOnPlugCheckbox->isChecked();
+  m_batchDelivery = m_batchDeliveryCheckbox->isChecked();
+  m_logFormat = m_logFormatBox->currentIndex();
+  m_logRotateSizeMB = m_logRotateSizeBox->value();
+  m_logRotateMinutes = m_logRotateMinutesBox->value();
+  m_compressLogs = m_compressLogsCheckbox->isChecked();
+  m_logDurability = m_logDurabilityBox->currentIndex();
+  m_journaledLogs = m_journaledLogsCheckbox->isChecked();
+  m_rawCapture = m_rawCaptureCheckbox->isChecked();
+  m_changeOnlyLogs = m_changeOnlyLogsCheckbox->isChecked();
+  m_triggeredLogging = m_triggeredLoggingCheckbox->isChecked();
+  m_triggerPreSecs = m_triggerPreSecsBox->value();
+  m_triggerPostSecs = m_triggerPostSecsBox->value();
+  m_triggerRpm = m_triggerRpmBox->value();
 
   writeSettings();
   done(QDialog::Accepted);
 }
 
+/**
+ * Refreshes the list of serial devices offered in the drop-down box,
+ * keeping whatever is currently entered.
+ * @param devices Devices that are currently present
+ */
+void OptionsDialog::onSerialDevicesChanged(QStringList devices)
+{
+  const QString current = m_serialDeviceBox->currentText();
+  QStringList items;
+
+  items.append(m_serialDeviceName);
+  items.append(devices);
+  items.removeDuplicates();
+
+  m_serialDeviceBox->clear();
+  m_serialDeviceBox->addItems(items);
+  m_serialDeviceBox->setEditText(current);
+}
+
 /**
  * Reads values for all the settings (either from the settings file, or by return defaults.)
  */
@@ -97,7 +283,24 @@ void OptionsDialog::readSettings()
 
   settings.beginGroup(m_settingsGroupName);
   m_serialDeviceName = settings.value(m_settingSerialDev, "").toString();
+  m_additionalDevices = settings.value(m_settingAdditionalDevs, QStringList()).toStringList();
   m_tempUnits = (TemperatureUnits) (settings.value(m_settingTemperatureUnits, Fahrenheit).toInt());
+  m_pollRateHz = settings.value(m_settingPollRate, 0).toInt();
+  m_autoReconnect = settings.value(m_settingAutoReconnect, true).toBool();
+  m_autoConnectOnPlug = settings.value(m_settingAutoConnectOnPlug, false).toBool();
+  m_batchDelivery = settings.value(m_settingBatchDelivery, false).toBool();
+  m_logFormat = settings.value(m_settingLogFormat, 0).toInt();
+  m_logRotateSizeMB = settings.value(m_settingLogRotateSizeMB, 0).toInt();
+  m_logRotateMinutes = settings.value(m_settingLogRotateMinutes, 0).toInt();
+  m_compressLogs = settings.value(m_settingCompressLogs, false).toBool();
+  m_journaledLogs = settings.value(m_settingJournaledLogs, false).toBool();
+  m_logDurability = settings.value(m_settingLogDurability, 0).toInt();
+  m_rawCapture = settings.value(m_settingRawCapture, false).toBool();
+  m_changeOnlyLogs = settings.value(m_settingChangeOnlyLogs, false).toBool();
+  m_triggeredLogging = settings.value(m_settingTriggeredLogging, false).toBool();
+  m_triggerPreSecs = settings.value(m_settingTriggerPreSecs, 30).toInt();
+  m_triggerPostSecs = settings.value(m_settingTriggerPostSecs, 30).toInt();
+  m_triggerRpm = settings.value(m_settingTriggerRpm, 0).toInt();
 
   settings.endGroup();
 }
@@ -111,7 +314,24 @@ void OptionsDialog::writeSettings()
 
   settings.beginGroup(m_settingsGroupName);
   settings.setValue(m_settingSerialDev, m_serialDeviceName);
+  settings.setValue(m_settingAdditionalDevs, m_additionalDevices);
   settings.setValue(m_settingTemperatureUnits, m_tempUnits);
+  settings.setValue(m_settingPollRate, m_pollRateHz);
+  settings.setValue(m_settingAutoReconnect, m_autoReconnect);
+  settings.setValue(m_settingAutoConnectOnPlug, m_autoConnectOnPlug);
+  settings.setValue(m_settingBatchDelivery, m_batchDelivery);
+  settings.setValue(m_settingLogFormat, m_logFormat);
+  settings.setValue(m_settingLogRotateSizeMB, m_logRotateSizeMB);
+  settings.setValue(m_settingLogRotateMinutes, m_logRotateMinutes);
+  settings.setValue(m_settingCompressLogs, m_compressLogs);
+  settings.setValue(m_settingJournaledLogs, m_journaledLogs);
+  settings.setValue(m_settingLogDurability, m_logDurability);
+  settings.setValue(m_settingRawCapture, m_rawCapture);
+  settings.setValue(m_settingChangeOnlyLogs, m_changeOnlyLogs);
+  settings.setValue(m_settingTriggeredLogging, m_triggeredLogging);
+  settings.setValue(m_settingTriggerPreSecs, m_triggerPreSecs);
+  settings.setValue(m_settingTriggerPostSecs, m_triggerPostSecs);
+  settings.setValue(m_settingTriggerRpm, m_triggerRpm);
 
   settings.endGroup();
 }
@@ -120,10 +340,40 @@ void OptionsDialog::writeSettings()
  * Returns the name of the serial device.
  */
 QString OptionsDialog::getSerialDeviceName()
+{
+  return toPlatformDeviceName(m_serialDeviceName);
+}
+
+/**
+ * Returns the names of all the devices to read from, starting with the
+ * main serial device.
+ */
+QStringList OptionsDialog::getSerialDeviceNames()
+{
+  QStringList names;
+
+  names.append(getSerialDeviceName());
+  foreach (QString dev, m_additionalDevices)
+  {
+    names.append(toPlatformDeviceName(dev));
+  }
+  return names;
+}
+
+/**
+ * Converts a device name as entered by the user into the form needed to
+ * open it.
+ */
+QString OptionsDialog::toPlatformDeviceName(QString name)
 {
 #ifdef WIN32
-  return QString("\\\\.\\%1").arg(m_serialDeviceName);
+  if (name.startsWith(ECUDataSource::replayPrefix()) ||
+      name.startsWith(ECUDataSource::syntheticPrefix()))
+  {
+    return name;
+  }
+  return QString("\\\\.\\%1").arg(name);
 #else
-  return m_serialDeviceName;
+  return name;
 #endif
 }
@@ -13,6 +13,7 @@
 #include <QRadioButton>
 #include <QButtonGroup>
 #include <QString>
+#include <QStringList>
 #include <QHash>
 #include <QFrame>
 #include "commonunits.h"
@@ -24,8 +25,28 @@ class OptionsDialog : public QDialog
 public:
     OptionsDialog(QString title, QWidget *parent = 0);
     QString getSerialDeviceName();
+    QStringList getSerialDeviceNames();
     bool getSerialDeviceChanged() { return m_serialDeviceChanged; }
     TemperatureUnits getTemperatureUnits() { return m_tempUnits; }
+    int getPollRateHz() { return m_pollRateHz; }
+    bool getAutoReconnect() { return m_autoReconnect; }
+    bool getAutoConnectOnPlug() { return m_autoConnectOnPlug; }
+    bool getBatchDelivery() { return m_batchDelivery; }
+    int getLogFormat() { return m_logFormat; }
+    int getLogRotateSizeMB() { return m_logRotateSizeMB; }
+    int getLogRotateMinutes() { return m_logRotateMinutes; }
+    bool getCompressLogs() { return m_compressLogs; }
+    bool getJournaledLogs() { return m_journaledLogs; }
+    int getLogDurability() { return m_logDurability; }
+    bool getRawCapture() { return m_rawCapture; }
+    bool getChangeOnlyLogs() { return m_changeOnlyLogs; }
+    bool getTriggeredLogging() { return m_triggeredLogging; }
+    int getTriggerPreSecs() { return m_triggerPreSecs; }
+    int getTriggerPostSecs() { return m_triggerPostSecs; }
+    int getTriggerRpm() { return m_triggerRpm; }
+
+public slots:
+    void onSerialDevicesChanged(QStringList devices);
 
 protected:
     void accept();
@@ -35,9 +56,40 @@ private:
     QLabel *m_serialDeviceLabel;
     QComboBox *m_serialDeviceBox;
 
+    QLabel *m_additionalDevicesLabel;
+    QLineEdit *m_additionalDevicesBox;
+
     QLabel *m_temperatureUnitsLabel;
     QComboBox *m_temperatureUnitsBox;
 
+    QLabel *m_pollRateLabel;
+    QSpinBox *m_pollRateBox;
+
+    QLabel *m_logFormatLabel;
+    QComboBox *m_logFormatBox;
+
+    QLabel *m_logRotateSizeLabel;
+    QSpinBox *m_logRotateSizeBox;
+    QLabel *m_logRotateMinutesLabel;
+    QSpinBox *m_logRotateMinutesBox;
+    QCheckBox *m_compressLogsCheckbox;
+    QLabel *m_logDurabilityLabel;
+    QComboBox *m_logDurabilityBox;
+    QCheckBox *m_journaledLogsCheckbox;
+    QCheckBox *m_rawCaptureCheckbox;
+    QCheckBox *m_changeOnlyLogsCheckbox;
+    QCheckBox *m_triggeredLoggingCheckbox;
+    QLabel *m_triggerPreSecsLabel;
+    QSpinBox *m_triggerPreSecsBox;
+    QLabel *m_triggerPostSecsLabel;
+    QSpinBox *m_triggerPostSecsBox;
+    QLabel *m_triggerRpmLabel;
+    QSpinBox *m_triggerRpmBox;
+
+    QCheckBox *m_autoReconnectCheckbox;
+    QCheckBox *m_autoConnectOnPlugCheckbox;
+    QCheckBox *m_batchDeliveryCheckbox;
+
     QFrame *m_horizontalLineA;
 
     QCheckBox *m_refreshFuelMapCheckbox;
@@ -46,7 +98,24 @@ private:
     QPushButton *m_cancelButton;
 
     QString m_serialDeviceName;
+    QStringList m_additionalDevices;
     TemperatureUnits m_tempUnits;
+    int m_pollRateHz;
+    bool m_autoReconnect;
+    bool m_autoConnectOnPlug;
+    bool m_batchDelivery;
+    int m_logFormat;
+    int m_logRotateSizeMB;
+    int m_logRotateMinutes;
+    bool m_compressLogs;
+    bool m_journaledLogs;
+    int m_logDurability;
+    bool m_rawCapture;
+    bool m_changeOnlyLogs;
+    bool m_triggeredLogging;
+    int m_triggerPreSecs;
+    int m_triggerPostSecs;
+    int m_triggerRpm;
 
     bool m_serialDeviceChanged;
 
@@ -54,11 +123,29 @@ private:
     const QString m_settingsGroupName;
 
     const QString m_settingSerialDev;
+    const QString m_settingAdditionalDevs;
     const QString m_settingTemperatureUnits;
+    const QString m_settingPollRate;
+    const QString m_settingAutoReconnect;
+    const QString m_settingAutoConnectOnPlug;
+    const QString m_settingBatchDelivery;
+    const QString m_settingLogFormat;
+    const QString m_settingLogRotateSizeMB;
+    const QString m_settingLogRotateMinutes;
+    const QString m_settingCompressLogs;
+    const QString m_settingJournaledLogs;
+    const QString m_settingLogDurability;
+    const QString m_settingRawCapture;
+    const QString m_settingChangeOnlyLogs;
+    const QString m_settingTriggeredLogging;
+    const QString m_settingTriggerPreSecs;
+    const QString m_settingTriggerPostSecs;
+    const QString m_settingTriggerRpm;
 
     void setupWidgets();
     void readSettings();
     void writeSettings();
+    QString toPlatformDeviceName(QString name);
 };
 
 #endif // OPTIONSDIALOG_H
@@ -0,0 +1,107 @@
+#include "pollscheduler.h"
+
+/**
+ * Constructor. Defaults to maximum-throughput mode.
+ */
+PollScheduler::PollScheduler():
+m_targetHz(0.0), m_periodNs(0), m_nextDeadlineNs(0),
+m_windowStartNs(0), m_windowPolls(0), m_missedDeadlines(0)
+{
+  m_clock.start();
+}
+
+/**
+ * Sets the desired number of reads per second.
+ * @param hz Target rate; zero (or less) selects maximum-throughput mode
+ */
+void PollScheduler::setTargetRate(double hz)
+{
+  m_targetHz = (hz > 0.0) ? hz : 0.0;
+  m_periodNs = (m_targetHz > 0.0) ? (qint64)(1000000000.0 / m_targetHz) : 0;
+
+  // re-anchor the schedule so that a rate change takes effect immediately
+  m_nextDeadlineNs = m_clock.nsecsElapsed() + m_periodNs;
+}
+
+/**
+ * Returns the nominal time between reads.
+ * @return Interval in milliseconds, or 0 in maximum-throughput mode
+ */
+int PollScheduler::intervalMsecs() const
+{
+  return (int)(m_periodNs / 1000000);
+}
+
+/**
+ * Resets the schedule and rate measurement; called when polling begins.
+ */
+void PollScheduler::start()
+{
+  const qint64 now = m_clock.nsecsElapsed();
+
+  m_nextDeadlineNs = now;
+  m_windowStartNs = now;
+  m_windowPolls = 0;
+  m_missedDeadlines = 0;
+}
+
+/**
+ * Records a completed read and advances the deadline.
+ * @return Number of milliseconds to wait before the next read
+ */
+int PollScheduler::pollCompleted()
+{
+  const qint64 now = m_clock.nsecsElapsed();
+
+  m_windowPolls++;
+
+  if (m_periodNs == 0)
+  {
+    return 0;
+  }
+
+  m_nextDeadlineNs += m_periodNs;
+
+  // If we've fallen more than a whole period behind (because the ECU was
+  // slow to respond, for example), don't try to make up the lost reads in a
+  // burst; skip the missed slots and stay on the original phase.
+  if (now - m_nextDeadlineNs >= m_periodNs)
+  {
+    const qint64 missed = (now - m_nextDeadlineNs) / m_periodNs;
+    m_missedDeadlines += (unsigned int)missed;
+    m_nextDeadlineNs += missed * m_periodNs;
+  }
+
+  if (m_nextDeadlineNs <= now)
+  {
+    return 0;
+  }
+
+  // round to the nearest millisecond; any error is corrected on the next
+  // cycle because the deadlines themselves are kept in nanoseconds
+  return (int)((m_nextDeadlineNs - now + 500000) / 1000000);
+}
+
+/**
+ * Indicates whether enough time has passed to report a new achieved rate.
+ */
+bool PollScheduler::rateWindowElapsed() const
+{
+  return ((m_clock.nsecsElapsed() - m_windowStartNs) >= s_rateWindowNs);
+}
+
+/**
+ * Returns the number of reads per second achieved since the last call, and
+ * starts a new measurement window.
+ */
+double PollScheduler::takeAchievedRate()
+{
+  const qint64 now = m_clock.nsecsElapsed();
+  const qint64 elapsed = now - m_windowStartNs;
+  const double rate = (elapsed > 0) ? (m_windowPolls * 1000000000.0 / elapsed) : 0.0;
+
+  m_windowStartNs = now;
+  m_windowPolls = 0;
+
+  return rate;
+}
@@ -0,0 +1,41 @@
+#ifndef POLLSCHEDULER_H
+#define POLLSCHEDULER_H
+
+#include <QElapsedTimer>
+
+/**
+ * Keeps track of when the next ECU read is due. Deadlines are advanced by a
+ * fixed period from the time polling started (rather than from the end of the
+ * last read), so the time spent in the read itself doesn't accumulate as
+ * drift. A target rate of zero means "as fast as the link allows".
+ */
+class PollScheduler
+{
+public:
+    PollScheduler();
+
+    void setTargetRate(double hz);
+    double targetRate() const   { return m_targetHz; }
+    int intervalMsecs() const;
+
+    void start();
+    int pollCompleted();
+
+    bool rateWindowElapsed() const;
+    double takeAchievedRate();
+    unsigned int missedDeadlines() const { return m_missedDeadlines; }
+
+private:
+    double m_targetHz;
+    qint64 m_periodNs;
+    qint64 m_nextDeadlineNs;
+    QElapsedTimer m_clock;
+
+    qint64 m_windowStartNs;
+    unsigned int m_windowPolls;
+    unsigned int m_missedDeadlines;
+
+    static const qint64 s_rateWindowNs = 1000000000LL;
+};
+
+#endif // POLLSCHEDULER_H
@@ -0,0 +1,127 @@
+#include <QFile>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "ptyport.h"
+
+/**
+ * Constructor.
+ */
+PtyPort::PtyPort():
+m_masterFd(-1), m_slaveFd(-1)
+{
+}
+
+/**
+ * Destructor. Closes both sides of the pty and removes any symlink.
+ */
+PtyPort::~PtyPort()
+{
+  close();
+}
+
+/**
+ * Allocates a new pty pair. The slave side is put into raw mode and held
+ * open, so that the master doesn't see a hangup between the times that
+ * clients open and close the slave device.
+ * @return True if the pty was created; false otherwise
+ */
+bool PtyPort::open()
+{
+  struct termios tio;
+  const char *name = 0;
+
+  if (m_masterFd >= 0)
+  {
+    return true;
+  }
+
+  m_masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (m_masterFd < 0)
+  {
+    return false;
+  }
+
+  if ((grantpt(m_masterFd) == 0) &&
+      (unlockpt(m_masterFd) == 0) &&
+      ((name = ptsname(m_masterFd)) != 0))
+  {
+    m_slaveName = QString(name);
+    m_slaveFd = ::open(name, O_RDWR | O_NOCTTY);
+  }
+
+  if (m_slaveFd < 0)
+  {
+    close();
+    return false;
+  }
+
+  if (tcgetattr(m_slaveFd, &tio) == 0)
+  {
+    cfmakeraw(&tio);
+    tcsetattr(m_slaveFd, TCSANOW, &tio);
+  }
+
+  fcntl(m_masterFd, F_SETFL, fcntl(m_masterFd, F_GETFL) | O_NONBLOCK);
+
+  return true;
+}
+
+/**
+ * Creates a symlink to the slave device so that clients can be pointed at
+ * a fixed path rather than whichever /dev/pts/N was allocated.
+ * @param linkPath Path of the symlink to create (replacing any existing one)
+ * @return True on success; false otherwise
+ */
+bool PtyPort::createLink(QString linkPath)
+{
+  if (m_slaveName.isEmpty())
+  {
+    return false;
+  }
+
+  QFile::remove(linkPath);
+  if (QFile::link(m_slaveName, linkPath))
+  {
+    m_linkPath = linkPath;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * Returns the path that clients should open: the symlink if one was
+ * created, or the slave device name otherwise.
+ */
+QString PtyPort::devicePath() const
+{
+  return m_linkPath.isEmpty() ? m_slaveName : m_linkPath;
+}
+
+/**
+ * Closes the pty and removes the symlink, if there is one.
+ */
+void PtyPort::close()
+{
+  if (!m_linkPath.isEmpty())
+  {
+    QFile::remove(m_linkPath);
+    m_linkPath.clear();
+  }
+
+  if (m_slaveFd >= 0)
+  {
+    ::close(m_slaveFd);
+    m_slaveFd = -1;
+  }
+
+  if (m_masterFd >= 0)
+  {
+    ::close(m_masterFd);
+    m_masterFd = -1;
+  }
+
+  m_slaveName.clear();
+}
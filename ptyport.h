@@ -0,0 +1,34 @@
+#ifndef PTYPORT_H
+#define PTYPORT_H
+
+#include <QString>
+
+/**
+ * Wraps a Unix pseudo-terminal pair. The master side is used by whatever
+ * is standing in for the ECU; the slave side looks like an ordinary serial
+ * device and can be handed to librosco in place of /dev/ttyUSB*.
+ */
+class PtyPort
+{
+public:
+    PtyPort();
+    ~PtyPort();
+
+    bool open();
+    void close();
+    bool isOpen() const            { return (m_masterFd >= 0); }
+
+    bool createLink(QString linkPath);
+
+    int masterFd() const           { return m_masterFd; }
+    QString slaveName() const      { return m_slaveName; }
+    QString devicePath() const;
+
+private:
+    int m_masterFd;
+    int m_slaveFd;
+    QString m_slaveName;
+    QString m_linkPath;
+};
+
+#endif // PTYPORT_H
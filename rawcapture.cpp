@@ -0,0 +1,259 @@
+#include <QDateTime>
+#include <string.h>
+#include "rawcapture.h"
+
+const char RawCapture::s_magic[8] = { 'M', 'E', 'M', 'S', 'C', 'A', 'P', 0 };
+
+namespace
+{
+  void appendVarint(QByteArray& out, quint64 value)
+  {
+    while (value >= 0x80)
+    {
+      out.append((char)((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    out.append((char)value);
+  }
+
+  void appendLE64(QByteArray& out, qint64 value)
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      out.append((char)(((quint64)value >> (i * 8)) & 0xFF));
+    }
+  }
+
+  qint64 getLE64(const uchar *p)
+  {
+    quint64 value = 0;
+
+    for (int i = 7; i >= 0; i--)
+    {
+      value = (value << 8) | p[i];
+    }
+    return (qint64)value;
+  }
+}
+
+/**
+ * Constructor.
+ */
+RawCaptureWriter::RawCaptureWriter():
+m_lastUs(0), m_bytes(0)
+{
+}
+
+/**
+ * Destructor. Closes the file, writing anything still buffered.
+ */
+RawCaptureWriter::~RawCaptureWriter()
+{
+  close();
+}
+
+/**
+ * Creates a capture file (replacing any existing file of the same name) and
+ * writes its header.
+ * @param path Path of the capture file
+ * @return True if the file was created; false otherwise
+ */
+bool RawCaptureWriter::open(QString path)
+{
+  QByteArray header(RawCapture::s_magic, sizeof(RawCapture::s_magic));
+
+  close();
+  m_file.setFileName(path);
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    return false;
+  }
+
+  header.append((char)(RawCapture::s_version & 0xFF));
+  header.append((char)(RawCapture::s_version >> 8));
+  header.append(2, (char)0);
+  appendLE64(header, QDateTime::currentMSecsSinceEpoch() * 1000);
+
+  if (m_file.write(header) != header.size())
+  {
+    m_file.close();
+    return false;
+  }
+
+  m_clock.start();
+  m_lastUs = 0;
+  m_bytes = 0;
+  return true;
+}
+
+void RawCaptureWriter::close()
+{
+  if (m_file.isOpen())
+  {
+    m_file.close();
+  }
+}
+
+/**
+ * Appends a run of bytes to the capture, timestamped now.
+ * @param direction Whether the bytes were sent to or received from the ECU
+ * @param data Bytes exchanged
+ * @param length Number of bytes
+ */
+void RawCaptureWriter::record(RawCapture::Direction direction, const char *data, int length)
+{
+  QByteArray out;
+  const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+
+  if (!m_file.isOpen() || (length <= 0))
+  {
+    return;
+  }
+
+  out.reserve(length + 8);
+  out.append((char)direction);
+  appendVarint(out, (quint64)qMax(Q_INT64_C(0), nowUs - m_lastUs));
+  appendVarint(out, (quint64)length);
+  out.append(data, length);
+
+  if (m_file.write(out) == out.size())
+  {
+    m_lastUs = nowUs;
+    m_bytes += length;
+  }
+}
+
+/**
+ * Writes any buffered records to the file. The traffic on the serial link
+ * is slow enough that this only needs doing when the link goes quiet.
+ */
+void RawCaptureWriter::flush()
+{
+  if (m_file.isOpen())
+  {
+    m_file.flush();
+  }
+}
+
+/**
+ * Constructor.
+ */
+RawCaptureReader::RawCaptureReader():
+m_startUs(0), m_timeUs(0)
+{
+}
+
+/**
+ * Destructor.
+ */
+RawCaptureReader::~RawCaptureReader()
+{
+  close();
+}
+
+/**
+ * Opens a capture file and checks its header.
+ * @param path Path of the capture file
+ * @return True if the file is a capture that this version can read
+ */
+bool RawCaptureReader::open(QString path)
+{
+  QByteArray header;
+
+  close();
+  m_file.setFileName(path);
+  if (!m_file.open(QIODevice::ReadOnly))
+  {
+    m_error = m_file.errorString();
+    return false;
+  }
+
+  header = m_file.read(RawCapture::s_headerSize);
+  if ((header.size() != RawCapture::s_headerSize) ||
+      (memcmp(header.constData(), RawCapture::s_magic, sizeof(RawCapture::s_magic)) != 0))
+  {
+    m_error = "not a raw capture file";
+    m_file.close();
+    return false;
+  }
+
+  if (((uchar)header.at(8) != RawCapture::s_version) || (header.at(9) != 0))
+  {
+    m_error = "unsupported capture version";
+    m_file.close();
+    return false;
+  }
+
+  m_startUs = getLE64((const uchar*)header.constData() + 12);
+  m_timeUs = 0;
+  m_error.clear();
+  return true;
+}
+
+void RawCaptureReader::close()
+{
+  if (m_file.isOpen())
+  {
+    m_file.close();
+  }
+}
+
+/**
+ * Reads a varint from the current position in the file.
+ */
+bool RawCaptureReader::readVarint(quint64& value)
+{
+  char c;
+  int shift = 0;
+
+  value = 0;
+  while (m_file.getChar(&c))
+  {
+    value |= (quint64)((uchar)c & 0x7F) << shift;
+    if (((uchar)c & 0x80) == 0)
+    {
+      return true;
+    }
+    shift += 7;
+    if (shift > 63)
+    {
+      break;
+    }
+  }
+  return false;
+}
+
+/**
+ * Reads the next record.
+ * @param record Receives the record, with its time from the start of the capture
+ * @return True if a whole record was read; false at the end of the capture
+ */
+bool RawCaptureReader::next(RawCapture::Record& record)
+{
+  char direction;
+  quint64 deltaUs;
+  quint64 length;
+
+  if (!m_file.isOpen() || !m_file.getChar(&direction) ||
+      ((direction != RawCapture::Transmit) && (direction != RawCapture::Receive)) ||
+      !readVarint(deltaUs) || !readVarint(length) || (length > (quint64)m_file.bytesAvailable()))
+  {
+    return false;
+  }
+
+  record.direction = (RawCapture::Direction)direction;
+  record.bytes = m_file.read((qint64)length);
+  m_timeUs += (qint64)deltaUs;
+  record.timeUs = m_timeUs;
+
+  return (record.bytes.size() == (int)length);
+}
+
+/**
+ * Goes back to the first record.
+ */
+bool RawCaptureReader::rewind()
+{
+  m_timeUs = 0;
+  return m_file.isOpen() && m_file.seek(RawCapture::s_headerSize);
+}
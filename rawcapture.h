@@ -0,0 +1,97 @@
+#ifndef RAWCAPTURE_H
+#define RAWCAPTURE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+/**
+ * Record of the raw bytes exchanged with an ECU, for reproducing problems
+ * at the protocol level (which a decoded log can't show).
+ *
+ * A capture file starts with a 20-byte header: the magic "MEMSCAP\0", a
+ * 16-bit version, 16 reserved bits, and the wall-clock time at which the
+ * capture started (usecs since the epoch, 64 bits); all little-endian.
+ * This is followed by one record per run of bytes moving in one direction:
+ * a direction byte ('T' for bytes sent to the ECU, 'R' for bytes received
+ * from it), the usecs since the previous record (or since the start of the
+ * capture, for the first one) as a varint, the number of bytes as a varint,
+ * and then the bytes themselves.
+ */
+class RawCapture
+{
+public:
+    enum Direction
+    {
+        Transmit = 'T',
+        Receive = 'R'
+    };
+
+    struct Record
+    {
+        Direction direction;
+        qint64 timeUs;       // usecs from the start of the capture
+        QByteArray bytes;
+    };
+
+    static const quint16 s_version = 1;
+    static const int s_headerSize = 20;
+    static const char s_magic[8];
+};
+
+/**
+ * Writes a capture file. Timestamps are taken when each run of bytes is
+ * recorded, from a monotonic clock started when the file is opened.
+ */
+class RawCaptureWriter
+{
+public:
+    RawCaptureWriter();
+    ~RawCaptureWriter();
+
+    bool open(QString path);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString path() const { return m_file.fileName(); }
+
+    void record(RawCapture::Direction direction, const char *data, int length);
+    void flush();
+    quint64 bytesRecorded() const { return m_bytes; }
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+    qint64 m_lastUs;
+    quint64 m_bytes;
+};
+
+/**
+ * Reads the records from a capture file, in order. A record cut short at
+ * the end of the file (e.g. because the capture was interrupted) is treated
+ * as the end of the capture.
+ */
+class RawCaptureReader
+{
+public:
+    RawCaptureReader();
+    ~RawCaptureReader();
+
+    bool open(QString path);
+    void close();
+    QString errorString() const { return m_error; }
+    qint64 startTimeUs() const { return m_startUs; }
+
+    bool next(RawCapture::Record& record);
+    bool rewind();
+
+private:
+    QFile m_file;
+    QString m_error;
+    qint64 m_startUs;
+    qint64 m_timeUs;
+
+    bool readVarint(quint64& value);
+};
+
+#endif // RAWCAPTURE_H
@@ -0,0 +1,142 @@
+#include <QMutexLocker>
+#include "replayclock.h"
+
+const double ReplayClock::s_minSpeed = 0.1;
+const double ReplayClock::s_maxSpeed = 50.0;
+const double ReplayClock::s_unpaced = 0.0;
+
+/**
+ * Constructor. Playback starts at the beginning, at normal speed.
+ */
+ReplayClock::ReplayClock():
+m_baseMs(0), m_speed(1.0), m_paused(false), m_seekMs(-1), m_durationMs(0)
+{
+  m_timer.start();
+}
+
+/**
+ * Returns the position, without locking.
+ */
+qint64 ReplayClock::currentPosition() const
+{
+  if (m_paused || (m_speed == s_unpaced))
+  {
+    return m_baseMs;
+  }
+  return m_baseMs + (qint64)(m_timer.elapsed() * m_speed);
+}
+
+/**
+ * Restarts the clock from the given position, without locking.
+ */
+void ReplayClock::rebase(qint64 positionMs)
+{
+  m_baseMs = positionMs;
+  m_timer.restart();
+}
+
+void ReplayClock::play()
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (m_paused)
+  {
+    m_paused = false;
+    m_timer.restart();
+  }
+}
+
+void ReplayClock::pause()
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (!m_paused)
+  {
+    m_baseMs = currentPosition();
+    m_paused = true;
+  }
+}
+
+bool ReplayClock::isPaused() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_paused;
+}
+
+/**
+ * Sets the playback speed, as a multiple of real time. Anything other than
+ * s_unpaced is limited to the range s_minSpeed to s_maxSpeed.
+ */
+void ReplayClock::setSpeed(double speed)
+{
+  QMutexLocker locker(&m_mutex);
+
+  rebase(currentPosition());
+  m_speed = (speed == s_unpaced) ? s_unpaced : qBound(s_minSpeed, speed, s_maxSpeed);
+}
+
+double ReplayClock::speed() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_speed;
+}
+
+/**
+ * Asks for playback to continue from a new position. The data source picks
+ * the request up on its next read.
+ */
+void ReplayClock::seek(qint64 positionMs)
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_seekMs = qMax(Q_INT64_C(0), positionMs);
+  rebase(m_seekMs);
+}
+
+/**
+ * Returns the current playback position, in msecs from the first record.
+ */
+qint64 ReplayClock::positionMs() const
+{
+  QMutexLocker locker(&m_mutex);
+  return currentPosition();
+}
+
+/**
+ * Returns the length of the log, in msecs, as far as it's known so far.
+ */
+qint64 ReplayClock::durationMs() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_durationMs;
+}
+
+/**
+ * Returns the position of the most recent seek request, and clears it.
+ * @return Position to seek to, or -1 if there's no request
+ */
+qint64 ReplayClock::takeSeek()
+{
+  QMutexLocker locker(&m_mutex);
+  const qint64 seekMs = m_seekMs;
+
+  m_seekMs = -1;
+  return seekMs;
+}
+
+/**
+ * Moves the clock to the given position without a seek request (e.g. when
+ * playback wraps around to the start, or in unpaced mode, where the position
+ * follows the records read).
+ */
+void ReplayClock::setPosition(qint64 positionMs)
+{
+  QMutexLocker locker(&m_mutex);
+  rebase(positionMs);
+}
+
+void ReplayClock::setDuration(qint64 durationMs)
+{
+  QMutexLocker locker(&m_mutex);
+  m_durationMs = durationMs;
+}
@@ -0,0 +1,49 @@
+#ifndef REPLAYCLOCK_H
+#define REPLAYCLOCK_H
+
+#include <QMutex>
+#include <QElapsedTimer>
+
+/**
+ * Playback position for a replayed log. The GUI thread uses this to play,
+ * pause, seek and change speed; the interface thread (through the replay
+ * data source) uses it to decide which record is due. Positions are msecs
+ * from the first record in the log. A speed of zero means "unpaced": each
+ * read returns the next record, so the poll rate alone sets the pace.
+ */
+class ReplayClock
+{
+public:
+    static const double s_minSpeed;
+    static const double s_maxSpeed;
+    static const double s_unpaced;
+
+    ReplayClock();
+
+    void play();
+    void pause();
+    bool isPaused() const;
+    void setSpeed(double speed);
+    double speed() const;
+    void seek(qint64 positionMs);
+    qint64 positionMs() const;
+    qint64 durationMs() const;
+
+    qint64 takeSeek();
+    void setPosition(qint64 positionMs);
+    void setDuration(qint64 durationMs);
+
+private:
+    mutable QMutex m_mutex;
+    QElapsedTimer m_timer;
+    qint64 m_baseMs;
+    double m_speed;
+    bool m_paused;
+    qint64 m_seekMs;
+    qint64 m_durationMs;
+
+    qint64 currentPosition() const;
+    void rebase(qint64 positionMs);
+};
+
+#endif // REPLAYCLOCK_H
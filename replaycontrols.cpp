@@ -0,0 +1,171 @@
+#include <QStyle>
+#include "replaycontrols.h"
+
+/**
+ * Constructor.
+ */
+ReplayControls::ReplayControls(QWidget *parent):
+QWidget(parent), m_clock(0)
+{
+  m_layout = new QHBoxLayout(this);
+  m_layout->setContentsMargins(0, 0, 0, 0);
+
+  m_playButton = new QToolButton(this);
+  m_playButton->setToolTip("Play or pause the replayed log");
+
+  // tracking is off, so the position only changes when the slider is let go
+  m_positionSlider = new QSlider(Qt::Horizontal, this);
+  m_positionSlider->setTracking(false);
+  m_positionSlider->setRange(0, 0);
+
+  m_positionLabel = new QLabel(this);
+
+  m_speedBox = new QComboBox(this);
+  m_speedBox->setEditable(false);
+  m_speedBox->addItem("0.1x", 0.1);
+  m_speedBox->addItem("0.25x", 0.25);
+  m_speedBox->addItem("0.5x", 0.5);
+  m_speedBox->addItem("1x", 1.0);
+  m_speedBox->addItem("2x", 2.0);
+  m_speedBox->addItem("5x", 5.0);
+  m_speedBox->addItem("10x", 10.0);
+  m_speedBox->addItem("20x", 20.0);
+  m_speedBox->addItem("50x", 50.0);
+  m_speedBox->addItem("Unpaced", ReplayClock::s_unpaced);
+  m_speedBox->setCurrentIndex(m_speedBox->findData(1.0));
+  m_speedBox->setToolTip("Playback speed. \"Unpaced\" plays one record per poll, at the polling rate.");
+
+  m_layout->addWidget(m_playButton);
+  m_layout->addWidget(m_positionSlider, 1);
+  m_layout->addWidget(m_positionLabel);
+  m_layout->addWidget(m_speedBox);
+
+  m_updateTimer = new QTimer(this);
+  m_updateTimer->setInterval(s_updateIntervalMsecs);
+
+  connect(m_playButton, SIGNAL(clicked()), this, SLOT(onPlayPauseClicked()));
+  connect(m_positionSlider, SIGNAL(sliderMoved(int)), this, SLOT(onSliderMoved(int)));
+  connect(m_positionSlider, SIGNAL(valueChanged(int)), this, SLOT(onSeekRequested(int)));
+  connect(m_speedBox, SIGNAL(activated(int)), this, SLOT(onSpeedChanged(int)));
+  connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(onUpdateTimer()));
+
+  updatePlayButton();
+  updatePositionLabel(0, 0);
+}
+
+/**
+ * Attaches the controls to a clock, or detaches them (with 0).
+ */
+void ReplayControls::setClock(ReplayClock *clock)
+{
+  m_clock = clock;
+
+  if (m_clock)
+  {
+    const int index = m_speedBox->findData(m_clock->speed());
+    if (index >= 0)
+    {
+      m_speedBox->setCurrentIndex(index);
+    }
+    m_updateTimer->start();
+    onUpdateTimer();
+  }
+  else
+  {
+    m_updateTimer->stop();
+  }
+  updatePlayButton();
+}
+
+void ReplayControls::onPlayPauseClicked()
+{
+  if (m_clock)
+  {
+    if (m_clock->isPaused())
+    {
+      m_clock->play();
+    }
+    else
+    {
+      m_clock->pause();
+    }
+    updatePlayButton();
+  }
+}
+
+/**
+ * Shows the position under the slider while it's being dragged.
+ */
+void ReplayControls::onSliderMoved(int value)
+{
+  if (m_clock)
+  {
+    updatePositionLabel((qint64)value * s_msecsPerStep, m_clock->durationMs());
+  }
+}
+
+void ReplayControls::onSeekRequested(int value)
+{
+  if (m_clock)
+  {
+    m_clock->seek((qint64)value * s_msecsPerStep);
+  }
+}
+
+void ReplayControls::onSpeedChanged(int index)
+{
+  if (m_clock)
+  {
+    m_clock->setSpeed(m_speedBox->itemData(index).toDouble());
+  }
+}
+
+/**
+ * Moves the slider to the current playback position.
+ */
+void ReplayControls::onUpdateTimer()
+{
+  if (!m_clock || m_positionSlider->isSliderDown())
+  {
+    return;
+  }
+
+  const qint64 durationMs = m_clock->durationMs();
+  const qint64 positionMs = qMin(m_clock->positionMs(), durationMs);
+
+  // these changes come from playback, not the user, so they mustn't seek
+  m_positionSlider->blockSignals(true);
+  m_positionSlider->setRange(0, (int)(durationMs / s_msecsPerStep));
+  m_positionSlider->setValue((int)(positionMs / s_msecsPerStep));
+  m_positionSlider->blockSignals(false);
+
+  updatePositionLabel(positionMs, durationMs);
+}
+
+void ReplayControls::updatePlayButton()
+{
+  const bool paused = !m_clock || m_clock->isPaused();
+
+  m_playButton->setIcon(style()->standardIcon(paused ? QStyle::SP_MediaPlay : QStyle::SP_MediaPause));
+}
+
+void ReplayControls::updatePositionLabel(qint64 positionMs, qint64 durationMs)
+{
+  m_positionLabel->setText(formatTime(positionMs) + " / " + formatTime(durationMs));
+}
+
+/**
+ * Formats a duration as m:ss, or h:mm:ss if it's an hour or more.
+ */
+QString ReplayControls::formatTime(qint64 msecs)
+{
+  const qint64 secs = msecs / 1000;
+
+  if (secs >= 3600)
+  {
+    return QString("%1:%2:%3").arg(secs / 3600)
+                              .arg((secs / 60) % 60, 2, 10, QChar('0'))
+                              .arg(secs % 60, 2, 10, QChar('0'));
+  }
+  return QString("%1:%2").arg(secs / 60).arg(secs % 60, 2, 10, QChar('0'));
+}
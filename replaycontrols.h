@@ -0,0 +1,51 @@
+#ifndef REPLAYCONTROLS_H
+#define REPLAYCONTROLS_H
+
+#include <QWidget>
+#include <QHBoxLayout>
+#include <QToolButton>
+#include <QSlider>
+#include <QLabel>
+#include <QComboBox>
+#include <QTimer>
+#include "replayclock.h"
+
+/**
+ * Play/pause button, position slider and speed selector for a replayed
+ * log. The controls act on the interface's ReplayClock, and poll it a few
+ * times a second to keep the slider in step with playback.
+ */
+class ReplayControls : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ReplayControls(QWidget *parent = 0);
+
+    void setClock(ReplayClock *clock);
+
+private slots:
+    void onPlayPauseClicked();
+    void onSliderMoved(int value);
+    void onSeekRequested(int value);
+    void onSpeedChanged(int index);
+    void onUpdateTimer();
+
+private:
+    static const int s_msecsPerStep = 100;
+    static const int s_updateIntervalMsecs = 250;
+
+    ReplayClock *m_clock;
+    QHBoxLayout *m_layout;
+    QToolButton *m_playButton;
+    QSlider *m_positionSlider;
+    QLabel *m_positionLabel;
+    QComboBox *m_speedBox;
+    QTimer *m_updateTimer;
+
+    void updatePlayButton();
+    void updatePositionLabel(qint64 positionMs, qint64 durationMs);
+    static QString formatTime(qint64 msecs);
+};
+
+#endif // REPLAYCONTROLS_H
@@ -0,0 +1,156 @@
+#include <QList>
+#include <string.h>
+#include "replaydatasource.h"
+
+/**
+ * Constructor.
+ * @param path Path to a log file written by Logger
+ * @param clock Playback position to follow, or 0 to return every record in
+ *  turn
+ * @param textUnits Units of the temperatures in a text log (binary logs
+ *  record their own)
+ */
+ReplayDataSource::ReplayDataSource(QString path, ReplayClock *clock, TemperatureUnits textUnits):
+m_path(path), m_clock(clock), m_connected(false), m_haveCurrent(false), m_haveNext(false)
+{
+  m_reader.setTextUnits(textUnits);
+}
+
+/**
+ * Opens the log file and starts reading ahead. Playback starts from the
+ * beginning of the log.
+ * @param ecuId Set to all zeros, since logs don't record the ECU ID
+ * @return True if the file could be opened; false otherwise
+ */
+bool ReplayDataSource::connect(uint8_t *ecuId)
+{
+  memset(ecuId, 0, 4);
+
+  m_haveCurrent = false;
+  m_haveNext = false;
+  m_connected = m_reader.open(m_path);
+
+  if (m_connected && m_clock)
+  {
+    m_clock->takeSeek();
+    m_clock->setPosition(0);
+    m_clock->setDuration(m_reader.durationMs());
+  }
+
+  return m_connected;
+}
+
+void ReplayDataSource::disconnect()
+{
+  m_reader.close();
+  m_connected = false;
+  m_haveCurrent = false;
+  m_haveNext = false;
+}
+
+bool ReplayDataSource::isConnected()
+{
+  return m_connected;
+}
+
+/**
+ * Takes the next record from the reader, going back to the start of the
+ * log once the end is reached.
+ */
+bool ReplayDataSource::takeFrame(ReplayReader::Frame& frame)
+{
+  if (m_haveNext)
+  {
+    frame = m_next;
+    m_haveNext = false;
+    return true;
+  }
+
+  if (m_reader.next(frame, s_readTimeoutMsecs))
+  {
+    return true;
+  }
+
+  if (m_reader.atEnd())
+  {
+    m_reader.seek(0);
+    return m_reader.next(frame, s_readTimeoutMsecs);
+  }
+
+  return false;
+}
+
+/**
+ * Returns the record due at the clock's current position: the last one at
+ * or before it. If the clock is paused (or playback hasn't reached the
+ * next record yet), this is the same record as last time. In unpaced mode,
+ * returns the next record.
+ * @return True if a record was read; false if the file has no valid records
+ */
+bool ReplayDataSource::read(mems_data *data)
+{
+  if (!m_connected)
+  {
+    return false;
+  }
+
+  const qint64 seekMs = m_clock ? m_clock->takeSeek() : -1;
+  if (seekMs >= 0)
+  {
+    m_reader.seek(seekMs);
+    m_haveNext = false;
+  }
+
+  if (!m_clock || (m_clock->speed() == ReplayClock::s_unpaced))
+  {
+    if (takeFrame(m_current))
+    {
+      m_haveCurrent = true;
+      if (m_clock)
+      {
+        m_clock->setPosition(m_current.positionMs);
+      }
+    }
+  }
+  else
+  {
+    const qint64 playheadMs = m_clock->positionMs();
+
+    // catch up with the clock, keeping the last record that's due; only
+    // wait for the reader if there's nothing at all to show yet
+    forever
+    {
+      if (!m_haveNext && !m_reader.next(m_next, m_haveCurrent ? 0 : s_readTimeoutMsecs))
+      {
+        break;
+      }
+      m_haveNext = true;
+
+      if (m_next.positionMs > playheadMs)
+      {
+        break;
+      }
+
+      m_current = m_next;
+      m_haveCurrent = true;
+      m_haveNext = false;
+    }
+
+    if (!m_haveNext && m_reader.atEnd() && !m_clock->isPaused())
+    {
+      m_reader.seek(0);
+      m_clock->setPosition(0);
+    }
+  }
+
+  if (m_clock)
+  {
+    m_clock->setDuration(m_reader.durationMs());
+  }
+
+  if (m_haveCurrent)
+  {
+    memcpy(data, &m_current.data, sizeof(mems_data));
+  }
+  return m_haveCurrent;
+}
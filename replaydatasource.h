@@ -0,0 +1,50 @@
+#ifndef REPLAYDATASOURCE_H
+#define REPLAYDATASOURCE_H
+
+#include <QString>
+#include "commonunits.h"
+#include "ecudatasource.h"
+#include "replayreader.h"
+#include "replayclock.h"
+
+/**
+ * Plays back a log file written by Logger (text or binary). The records
+ * are read ahead by a ReplayReader, and each read returns the record that
+ * is due at the current position of the ReplayClock, so the log plays at
+ * its own pace (scaled by the clock's speed) whatever the poll rate. In
+ * unpaced mode, or without a clock, each read simply returns the next
+ * record. Playback wraps around at the end of the file, so the source can
+ * be polled indefinitely. Text logs don't say what units their
+ * temperatures are in, so these are given to the constructor.
+ */
+class ReplayDataSource : public ECUDataSource
+{
+public:
+    explicit ReplayDataSource(QString path, ReplayClock *clock = 0, TemperatureUnits textUnits = Fahrenheit);
+
+    bool connect(uint8_t *ecuId);
+    void disconnect();
+    bool isConnected();
+    bool read(mems_data *data);
+
+    bool testActuator(actuator_cmd)  { return isConnected(); }
+    bool clearFaults()               { return isConnected(); }
+    bool moveIAC(uint8_t)            { return isConnected(); }
+
+private:
+    // how long a read waits for the reader (e.g. just after a seek)
+    static const int s_readTimeoutMsecs = 200;
+
+    QString m_path;
+    ReplayClock *m_clock;
+    ReplayReader m_reader;
+    bool m_connected;
+    ReplayReader::Frame m_current;
+    ReplayReader::Frame m_next;
+    bool m_haveCurrent;
+    bool m_haveNext;
+
+    bool takeFrame(ReplayReader::Frame& frame);
+};
+
+#endif // REPLAYDATASOURCE_H
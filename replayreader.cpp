@@ -0,0 +1,531 @@
+#include <QMutexLocker>
+#include <QList>
+#include "replayreader.h"
+#include "csvformat.h"
+
+/**
+ * Constructor.
+ */
+ReplayReader::ReplayReader(QObject *parent):
+QThread(parent), m_queue(s_queueFrames), m_head(0), m_count(0), m_generation(0), m_seekMs(-1),
+m_eof(false), m_stop(false), m_durationMs(0), m_textUnits(Fahrenheit), m_binary(false), m_journaled(false), m_text(0),
+m_firstRecordPos(0), m_startMs(-1), m_lastTimeOfDayMs(0), m_lastPositionMs(0), m_haveTime(false)
+{
+}
+
+/**
+ * Destructor. Stops the reader thread.
+ */
+ReplayReader::~ReplayReader()
+{
+  close();
+}
+
+/**
+ * Opens a log file and starts reading it from the beginning.
+ * @param path Log file written by Logger, in any of its formats
+ * @return True if the file could be opened
+ */
+bool ReplayReader::open(QString path)
+{
+  close();
+
+  m_path = path;
+  m_journaled = Journal::isJournal(path);
+  m_binary = m_binaryReader.open(path);
+
+  if (!m_binary)
+  {
+    if (m_journaled)
+    {
+      m_text = &m_journal;
+    }
+    else
+    {
+      m_file.setFileName(path);
+      if (!m_file.open(QFile::ReadOnly))
+      {
+        return false;
+      }
+      m_text = &m_file;
+    }
+  }
+
+  // skips the column headings in text logs
+  if (!rewind())
+  {
+    close();
+    return false;
+  }
+  m_firstRecordPos = m_binary ? 0 : m_text->pos();
+
+  // journaled logs aren't indexed, since their offsets aren't plain
+  if (!m_journaled)
+  {
+    m_index.open(path);
+  }
+
+  if (m_binary)
+  {
+    Frame first;
+
+    // binary logs record the full time, so the first record gives the
+    // time that positions are measured from
+    readFrame(first);
+    rewind();
+
+    if ((m_startMs >= 0) && (m_index.count() > 0))
+    {
+      m_durationMs = m_index.timestampAt(m_index.count() - 1) - m_startMs;
+    }
+  }
+  else
+  {
+    // text logs only record the time of day, but the first index entry
+    // (if it's for the first record) gives the full time
+    if ((m_index.count() > 0) && (m_index.offsetAt(0) == m_firstRecordPos))
+    {
+      m_startMs = m_index.timestampAt(0);
+    }
+    m_durationMs = textDurationMs();
+  }
+
+  m_generation++;
+  m_head = 0;
+  m_count = 0;
+  m_seekMs = -1;
+  m_eof = false;
+  start();
+  return true;
+}
+
+/**
+ * Stops the reader thread and closes the file.
+ */
+void ReplayReader::close()
+{
+  if (isRunning())
+  {
+    m_mutex.lock();
+    m_stop = true;
+    m_wakeReader.wakeOne();
+    m_mutex.unlock();
+    wait();
+  }
+
+  m_stop = false;
+  m_binaryReader.close();
+  m_file.close();
+  m_journal.close();
+  m_index.close();
+  m_text = 0;
+  m_binary = false;
+  m_startMs = -1;
+  m_durationMs = 0;
+  m_head = 0;
+  m_count = 0;
+  m_eof = false;
+}
+
+/**
+ * Returns the length of the log, as far as it's known. For some logs (e.g.
+ * binary logs without an index) this grows as the log is read.
+ */
+qint64 ReplayReader::durationMs() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_durationMs;
+}
+
+/**
+ * Discards everything queued and restarts reading at the given position.
+ * The first record queued after this is the last one at or before the
+ * position (if there is one), so that there's always something to show.
+ */
+void ReplayReader::seek(qint64 positionMs)
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_generation++;
+  m_head = 0;
+  m_count = 0;
+  m_eof = false;
+  m_seekMs = qMax(Q_INT64_C(0), positionMs);
+  m_wakeReader.wakeOne();
+}
+
+/**
+ * Takes the next record from the queue.
+ * @param frame Receives the record
+ * @param timeoutMsecs How long to wait if the queue is empty
+ * @return True if a record was available
+ */
+bool ReplayReader::next(Frame& frame, int timeoutMsecs)
+{
+  QMutexLocker locker(&m_mutex);
+
+  if ((m_count == 0) && !m_eof && (timeoutMsecs > 0))
+  {
+    m_frameReady.wait(&m_mutex, timeoutMsecs);
+  }
+
+  if (m_count == 0)
+  {
+    return false;
+  }
+
+  frame = m_queue.at(m_head);
+  m_head = (m_head + 1) % s_queueFrames;
+  m_count--;
+
+  // the reader only waits when the queue is nearly full, so it only needs
+  // waking once on the way down
+  if (m_count == s_queueFrames / 2)
+  {
+    m_wakeReader.wakeOne();
+  }
+
+  return true;
+}
+
+/**
+ * Returns true once every record to the end of the log has been taken.
+ */
+bool ReplayReader::atEnd() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_eof && (m_count == 0) && (m_seekMs < 0);
+}
+
+/**
+ * Reader thread: keeps the queue topped up in chunks, and carries out seek
+ * requests. Chunks read for an earlier seek are thrown away.
+ */
+void ReplayReader::run()
+{
+  QVector<Frame> frames;
+  Frame frame;
+
+  frames.reserve(s_chunkFrames);
+
+  forever
+  {
+    m_mutex.lock();
+    while (!m_stop && (m_seekMs < 0) && (m_eof || (m_count > (s_queueFrames - s_chunkFrames))))
+    {
+      m_wakeReader.wait(&m_mutex);
+    }
+
+    if (m_stop)
+    {
+      m_mutex.unlock();
+      break;
+    }
+
+    const qint64 seekMs = m_seekMs;
+    const quint64 generation = m_generation;
+    m_seekMs = -1;
+    m_mutex.unlock();
+
+    bool more = true;
+    frames.resize(0);
+
+    if (seekMs >= 0)
+    {
+      more = reposition(seekMs, frames);
+    }
+
+    while (more && (frames.size() < s_chunkFrames))
+    {
+      more = readFrame(frame);
+      if (more)
+      {
+        frames.append(frame);
+      }
+    }
+
+    m_mutex.lock();
+    if (generation == m_generation)
+    {
+      for (int i = 0; i < frames.size(); i++)
+      {
+        m_queue[(m_head + m_count) % s_queueFrames] = frames.at(i);
+        m_count++;
+      }
+
+      if (!frames.isEmpty())
+      {
+        m_durationMs = qMax(m_durationMs, frames.last().positionMs);
+      }
+      m_eof = !more;
+      m_frameReady.wakeAll();
+    }
+    m_mutex.unlock();
+  }
+}
+
+/**
+ * Goes back to the first record.
+ * @return True on success
+ */
+bool ReplayReader::rewind()
+{
+  m_haveTime = false;
+  m_lastPositionMs = 0;
+
+  if (m_binary)
+  {
+    return m_binaryReader.open(m_path);
+  }
+
+  if (m_journaled)
+  {
+    // journals can only be read from the start
+    m_journal.close();
+    if (!m_journal.openJournal(m_path))
+    {
+      return false;
+    }
+  }
+  else if (!m_file.seek(m_firstRecordPos))
+  {
+    return false;
+  }
+
+  if ((m_text->pos() == 0) && m_text->peek(1).startsWith('#'))
+  {
+    m_text->readLine();
+  }
+  return true;
+}
+
+/**
+ * Moves the read position to just before the given playback position,
+ * using the index if there is one.
+ * @param positionMs Position to move to
+ * @param frames Receives the last record before the position (if any) and
+ *  the first one after it
+ * @return False if the end of the log was reached
+ */
+bool ReplayReader::reposition(qint64 positionMs, QVector<Frame>& frames)
+{
+  bool found = false;
+
+  if ((m_startMs >= 0) && (m_index.count() > 0))
+  {
+    const int entry = m_index.entryBefore(m_startMs + positionMs);
+
+    if (entry >= 0)
+    {
+      const qint64 offset = m_index.offsetAt(entry);
+
+      found = m_binary ? m_binaryReader.seek(offset) : m_file.seek(offset);
+      if (found)
+      {
+        // the indexed record is the next one read
+        m_haveTime = false;
+        m_lastPositionMs = m_index.timestampAt(entry) - m_startMs;
+      }
+    }
+  }
+
+  if (!found && !rewind())
+  {
+    return false;
+  }
+
+  Frame frame;
+  Frame before;
+  bool haveBefore = false;
+  int skipped = 0;
+
+  while (readFrame(frame))
+  {
+    if (frame.positionMs > positionMs)
+    {
+      if (haveBefore)
+      {
+        frames.append(before);
+      }
+      frames.append(frame);
+      return true;
+    }
+
+    before = frame;
+    haveBefore = true;
+
+    // without an index this can take a while, so give up if there's
+    // already another seek waiting
+    if ((++skipped % 4096) == 0)
+    {
+      QMutexLocker locker(&m_mutex);
+      if ((m_seekMs >= 0) || m_stop)
+      {
+        return true;
+      }
+    }
+  }
+
+  if (haveBefore)
+  {
+    frames.append(before);
+  }
+  return false;
+}
+
+/**
+ * Reads the next sample record, skipping comments.
+ * @return False at the end of the log
+ */
+bool ReplayReader::readFrame(Frame& frame)
+{
+  if (!m_binary)
+  {
+    return readTextFrame(frame);
+  }
+
+  BinaryLogRecord record;
+
+  while (m_binaryReader.next(record))
+  {
+    if (record.type == BinaryLogRecord::Sample)
+    {
+      if (m_startMs < 0)
+      {
+        m_startMs = record.timestampMs;
+      }
+      frame.positionMs = record.timestampMs - m_startMs;
+      frame.data = record.data;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Reads the next record from a text log. These only record the time of
+ * day, so the position is worked out from the change since the previous
+ * record (allowing for midnight). Temperatures are converted back to
+ * degrees C from the units set with setTextUnits().
+ */
+bool ReplayReader::readTextFrame(Frame& frame)
+{
+  forever
+  {
+    const QByteArray line = m_text->readLine();
+    if (line.isEmpty())
+    {
+      return false;
+    }
+
+    CsvDecoder::Record record;
+    if (m_decoder.decodeLine(line.constData(), line.constData() + line.size(), record) != CsvDecoder::SampleLine)
+    {
+      continue;
+    }
+
+    const qint64 timeOfDayMs = record.timeOfDayMs;
+    frame.data = record.data;
+    frame.data.coolant_temp_c = CsvFormat::celsiusTemp(record.data.coolant_temp_c, m_textUnits);
+    frame.data.intake_air_temp_c = CsvFormat::celsiusTemp(record.data.intake_air_temp_c, m_textUnits);
+
+    if (m_haveTime)
+    {
+      qint64 deltaMs = timeOfDayMs - m_lastTimeOfDayMs;
+      if (deltaMs < -(s_msecsPerDay / 2))
+      {
+        deltaMs += s_msecsPerDay;
+      }
+      m_lastPositionMs += deltaMs;
+    }
+
+    m_haveTime = true;
+    m_lastTimeOfDayMs = timeOfDayMs;
+    frame.positionMs = m_lastPositionMs;
+    return true;
+  }
+}
+
+/**
+ * Estimates the length of a plain text log from the times of its first and
+ * last records, without reading the rest of it.
+ */
+qint64 ReplayReader::textDurationMs()
+{
+  if (m_journaled)
+  {
+    return 0;
+  }
+
+  const qint64 size = m_file.size();
+  const qint64 tailStart = qMax(m_firstRecordPos, size - 4096);
+  qint64 firstMs = -1;
+  qint64 lastMs = -1;
+
+  m_file.seek(m_firstRecordPos);
+  while ((firstMs < 0) && !m_file.atEnd())
+  {
+    firstMs = parseTimeOfDay(m_file.readLine());
+  }
+
+  m_file.seek(tailStart);
+  const QList<QByteArray> lines = m_file.read(size - tailStart).split('\n');
+
+  // the first piece of the tail may be part of a line
+  for (int i = lines.count() - 1; (i >= ((tailStart > m_firstRecordPos) ? 1 : 0)) && (lastMs < 0); i--)
+  {
+    lastMs = parseTimeOfDay(lines.at(i));
+  }
+
+  m_file.seek(m_firstRecordPos);
+
+  if ((firstMs < 0) || (lastMs < 0))
+  {
+    return 0;
+  }
+  return (lastMs >= firstMs) ? (lastMs - firstMs) : (lastMs - firstMs + s_msecsPerDay);
+}
+
+/**
+ * Reads the time ("hh:mm:ss.zzz") at the start of a text log record.
+ * @return Msecs since midnight, or -1 if the line doesn't start with a time
+ */
+qint64 ReplayReader::parseTimeOfDay(const QByteArray& line)
+{
+  static const char pattern[] = "00:00:00.000";
+  const int len = sizeof(pattern) - 1;
+
+  if ((line.size() < len) || ((line.size() > len) && (line.at(len) != ',')))
+  {
+    return -1;
+  }
+
+  int digits[9];
+  int n = 0;
+
+  for (int i = 0; i < len; i++)
+  {
+    const char c = line.at(i);
+
+    if (pattern[i] == '0')
+    {
+      if ((c < '0') || (c > '9'))
+      {
+        return -1;
+      }
+      digits[n++] = c - '0';
+    }
+    else if (c != pattern[i])
+    {
+      return -1;
+    }
+  }
+
+  const qint64 hours = digits[0] * 10 + digits[1];
+  const qint64 mins = digits[2] * 10 + digits[3];
+  const qint64 secs = digits[4] * 10 + digits[5];
+  const qint64 msecs = digits[6] * 100 + digits[7] * 10 + digits[8];
+
+  return (((hours * 60) + mins) * 60 + secs) * 1000 + msecs;
+}
@@ -0,0 +1,94 @@
+#ifndef REPLAYREADER_H
+#define REPLAYREADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QFile>
+#include <QString>
+#include "rosco.h"
+#include "commonunits.h"
+#include "binarylog.h"
+#include "journal.h"
+#include "logindex.h"
+#include "csvdecoder.h"
+
+/**
+ * Reads a log (text or binary, plain or journaled) on a thread of its own,
+ * keeping a bounded queue of decoded records ahead of the consumer, so that
+ * replaying even a very long log never waits on the disk or the parser.
+ * seek() discards the queue and restarts reading near the requested
+ * position; when the log has a time index (see LogIndex), this goes
+ * straight to the right part of the file rather than reading everything
+ * before it.
+ */
+class ReplayReader : public QThread
+{
+    Q_OBJECT
+public:
+    struct Frame
+    {
+        qint64 positionMs;   // msecs from the first record in the log
+        mems_data data;
+    };
+
+    explicit ReplayReader(QObject *parent = 0);
+    ~ReplayReader();
+
+    void setTextUnits(TemperatureUnits units) { m_textUnits = units; }
+    bool open(QString path);
+    void close();
+    qint64 durationMs() const;
+
+    void seek(qint64 positionMs);
+    bool next(Frame& frame, int timeoutMsecs = 0);
+    bool atEnd() const;
+
+protected:
+    void run();
+
+private:
+    static const int s_queueFrames = 4096;
+    static const int s_chunkFrames = 256;
+    static const qint64 s_msecsPerDay = 24 * 60 * 60 * 1000;
+
+    // shared with the reader thread; guarded by m_mutex
+    mutable QMutex m_mutex;
+    QWaitCondition m_wakeReader;
+    QWaitCondition m_frameReady;
+    QVector<Frame> m_queue;
+    int m_head;
+    int m_count;
+    quint64 m_generation;
+    qint64 m_seekMs;
+    bool m_eof;
+    bool m_stop;
+    qint64 m_durationMs;
+
+    // used only by the reader thread once it's running
+    QString m_path;
+    TemperatureUnits m_textUnits;
+    bool m_binary;
+    bool m_journaled;
+    BinaryLogReader m_binaryReader;
+    QFile m_file;
+    JournalReader m_journal;
+    QIODevice *m_text;
+    qint64 m_firstRecordPos;
+    LogIndex m_index;
+    qint64 m_startMs;          // wall-clock time of the first record, or -1
+    qint64 m_lastTimeOfDayMs;  // text logs only record the time of day
+    qint64 m_lastPositionMs;
+    bool m_haveTime;
+    CsvDecoder m_decoder;
+
+    bool rewind();
+    bool reposition(qint64 positionMs, QVector<Frame>& frames);
+    bool readFrame(Frame& frame);
+    bool readTextFrame(Frame& frame);
+    qint64 textDurationMs();
+    static qint64 parseTimeOfDay(const QByteArray& line);
+};
+
+#endif // REPLAYREADER_H
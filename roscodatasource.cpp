@@ -0,0 +1,142 @@
+#include "roscodatasource.h"
+#ifndef WIN32
+#include "captureproxy.h"
+#endif
+
+/**
+ * Constructor. Must be called from the thread that will use the object,
+ * since librosco initializes per-connection state here.
+ * @param device Name of (or path to) the serial device
+ */
+RoscoDataSource::RoscoDataSource(QString device):
+m_deviceName(device), m_proxy(0)
+{
+  mems_init(&m_memsinfo);
+}
+
+/**
+ * Destructor. Closes the serial device if it's still open.
+ */
+RoscoDataSource::~RoscoDataSource()
+{
+  disconnect();
+#ifndef WIN32
+  delete m_proxy;
+#endif
+}
+
+/**
+ * Opens the serial device and performs the ECU init sequence. If a capture
+ * path has been set, librosco is connected through a CaptureProxy, which
+ * records the raw traffic.
+ * @param ecuId Receives the four ID bytes returned by the ECU
+ * @return True if the ECU responded correctly; false otherwise
+ */
+bool RoscoDataSource::connect(uint8_t *ecuId)
+{
+  QString device = m_deviceName;
+
+#ifndef WIN32
+  if (!m_capturePath.isEmpty())
+  {
+    if (m_proxy == 0)
+    {
+      m_proxy = new CaptureProxy();
+    }
+    if (!m_proxy->start(m_deviceName, m_capturePath))
+    {
+      return false;
+    }
+    device = m_proxy->devicePath();
+  }
+#endif
+
+  return mems_connect(&m_memsinfo, device.toStdString().c_str()) &&
+         mems_init_link(&m_memsinfo, ecuId);
+}
+
+/**
+ * Closes the serial device. A capture in progress is left open, so that
+ * a later reconnect continues recording to the same file.
+ */
+void RoscoDataSource::disconnect()
+{
+  if (mems_is_connected(&m_memsinfo))
+  {
+    mems_disconnect(&m_memsinfo);
+  }
+
+#ifndef WIN32
+  if (m_proxy != 0)
+  {
+    m_proxy->stop();
+  }
+#endif
+}
+
+/**
+ * Closes the serial device, which makes a read blocked on it (in another
+ * thread) fail. Unlike disconnect(), this leaves the capture proxy alone;
+ * it's stopped when the source is destroyed in its own thread.
+ */
+void RoscoDataSource::cancelRead()
+{
+  if (mems_is_connected(&m_memsinfo))
+  {
+    mems_disconnect(&m_memsinfo);
+  }
+}
+
+bool RoscoDataSource::isConnected()
+{
+  return mems_is_connected(&m_memsinfo);
+}
+
+bool RoscoDataSource::read(mems_data *data)
+{
+  return mems_read(&m_memsinfo, data);
+}
+
+/**
+ * Re-establishes communication after the link has dropped. If the serial
+ * device is still open (e.g. the harness connection was only briefly
+ * interrupted), only the ECU init sequence is repeated; the port is closed
+ * and reopened only if that fails.
+ */
+bool RoscoDataSource::reinitLink(uint8_t *ecuId)
+{
+  if (mems_is_connected(&m_memsinfo) && mems_init_link(&m_memsinfo, ecuId))
+  {
+    return true;
+  }
+
+  disconnect();
+  return connect(ecuId);
+}
+
+bool RoscoDataSource::testActuator(actuator_cmd cmd)
+{
+  return mems_test_actuator(&m_memsinfo, cmd, NULL);
+}
+
+bool RoscoDataSource::clearFaults()
+{
+  return mems_clear_faults(&m_memsinfo);
+}
+
+bool RoscoDataSource::moveIAC(uint8_t desiredPos)
+{
+  return mems_move_iac(&m_memsinfo, desiredPos);
+}
+
+/**
+ * Raw traffic is captured through a pty, so this is only possible on Unix.
+ */
+bool RoscoDataSource::supportsCapture() const
+{
+#ifdef WIN32
+  return false;
+#else
+  return true;
+#endif
+}
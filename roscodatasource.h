@@ -0,0 +1,38 @@
+#ifndef ROSCODATASOURCE_H
+#define ROSCODATASOURCE_H
+
+#include "ecudatasource.h"
+
+class CaptureProxy;
+
+/**
+ * Reads from a real ECU through librosco and a serial device.
+ */
+class RoscoDataSource : public ECUDataSource
+{
+public:
+    explicit RoscoDataSource(QString device);
+    ~RoscoDataSource();
+
+    bool connect(uint8_t *ecuId);
+    void disconnect();
+    bool isConnected();
+    bool read(mems_data *data);
+    bool reinitLink(uint8_t *ecuId);
+    void cancelRead();
+
+    bool testActuator(actuator_cmd cmd);
+    bool clearFaults();
+    bool moveIAC(uint8_t desiredPos);
+
+    bool supportsCapture() const;
+    void setCapturePath(QString path) { m_capturePath = path; }
+
+private:
+    QString m_deviceName;
+    mems_info m_memsinfo;
+    QString m_capturePath;
+    CaptureProxy *m_proxy;
+};
+
+#endif // ROSCODATASOURCE_H
@@ -0,0 +1,166 @@
+#include <QDateTime>
+#include <atomic>
+#include <string.h>
+#include "samplering.h"
+
+/**
+ * Constructor. Allocates the slot array; the capacity is rounded up to the
+ * next power of two so that slot indices can be computed with a mask.
+ * @param capacityPow2 Minimum number of samples the ring can hold
+ */
+SampleRing::SampleRing(unsigned int capacityPow2):
+m_capacity(2), m_writeSeq(0), m_published(0)
+{
+  while (m_capacity < capacityPow2)
+  {
+    m_capacity <<= 1;
+  }
+  m_mask = m_capacity - 1;
+
+  m_slots = new Slot[m_capacity];
+  for (unsigned int i = 0; i < m_capacity; i++)
+  {
+    m_slots[i].version.storeRelaxed(0);
+    memset(&m_slots[i].sample, 0, sizeof(MEMSSample));
+  }
+
+  m_clock.start();
+}
+
+/**
+ * Destructor.
+ */
+SampleRing::~SampleRing()
+{
+  delete [] m_slots;
+}
+
+/**
+ * Stamps a copy of the given data and publishes it to all readers. Must only
+ * be called from a single (producer) thread.
+ * @param data Frame that was just read from the ECU
+ */
+void SampleRing::push(const mems_data& data)
+{
+  const quint64 seq = m_writeSeq;
+  Slot& slot = m_slots[seq & m_mask];
+
+  // an odd version marks the slot as being rewritten
+  slot.version.storeRelaxed((seq * 2) + 1);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.sample.seq = seq;
+  slot.sample.timestampMs = QDateTime::currentMSecsSinceEpoch();
+  slot.sample.monotonicUs = m_clock.nsecsElapsed() / 1000;
+  memcpy(&slot.sample.data, &data, sizeof(mems_data));
+
+  slot.version.storeRelease((seq * 2) + 2);
+  m_writeSeq = seq + 1;
+  m_published.storeRelease(m_writeSeq);
+}
+
+/**
+ * Copies the sample with the given sequence number out of its slot.
+ * @return True if the copy is consistent; false if the producer has since
+ *  reused (or is currently reusing) the slot.
+ */
+bool SampleRing::readSlot(quint64 seq, MEMSSample& sample) const
+{
+  const Slot& slot = m_slots[seq & m_mask];
+  const quint64 expected = (seq * 2) + 2;
+
+  if (slot.version.loadAcquire() != expected)
+  {
+    return false;
+  }
+
+  memcpy(&sample, &slot.sample, sizeof(MEMSSample));
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return (slot.version.loadRelaxed() == expected);
+}
+
+/**
+ * Constructor. New readers start at the end of the ring, so they only see
+ * samples published after they were created.
+ */
+SampleReader::SampleReader(const SampleRing *ring):
+m_ring(ring), m_cursor(ring->published()), m_dropped(0)
+{
+}
+
+/**
+ * Moves the cursor forward past any samples that have already been (or are
+ * about to be) overwritten, and counts them as dropped.
+ */
+void SampleReader::catchUp(quint64 head)
+{
+  // the slot after the oldest one may be rewritten by the next push, so
+  // leave one slot of slack
+  const quint64 cap = m_ring->capacity();
+  const quint64 oldest = (head > cap) ? (head - cap + 1) : 0;
+
+  if (m_cursor < oldest)
+  {
+    m_dropped += (oldest - m_cursor);
+    m_cursor = oldest;
+  }
+}
+
+/**
+ * Returns the oldest sample this reader hasn't seen yet.
+ * @param sample Receives a consistent copy of the sample
+ * @return True if a sample was available; false if the reader is caught up
+ */
+bool SampleReader::next(MEMSSample& sample)
+{
+  quint64 head = m_ring->published();
+
+  catchUp(head);
+  while (m_cursor < head)
+  {
+    if (m_ring->readSlot(m_cursor, sample))
+    {
+      m_cursor++;
+      return true;
+    }
+
+    // the producer lapped us while we were copying
+    head = m_ring->published();
+    catchUp(head);
+  }
+
+  return false;
+}
+
+/**
+ * Returns the most recently published sample and marks everything before it
+ * as read. Intended for consumers (such as the display) that only care about
+ * the current state.
+ * @param sample Receives a consistent copy of the sample
+ * @return True if a sample newer than the last one read was available
+ */
+bool SampleReader::latest(MEMSSample& sample)
+{
+  quint64 head = m_ring->published();
+
+  while (m_cursor < head)
+  {
+    if (m_ring->readSlot(head - 1, sample))
+    {
+      m_cursor = head;
+      return true;
+    }
+    head = m_ring->published();
+  }
+
+  return false;
+}
+
+/**
+ * Discards all unread samples.
+ */
+void SampleReader::skipToEnd()
+{
+  m_cursor = m_ring->published();
+}
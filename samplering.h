@@ -0,0 +1,81 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include "rosco.h"
+
+/**
+ * A single frame of ECU data, stamped at the time it was read.
+ */
+struct MEMSSample
+{
+    quint64 seq;         // position of this sample in the stream (starts at 0)
+    qint64 timestampMs;  // wall-clock time, msecs since the epoch
+    qint64 monotonicUs;  // usecs since the ring was created; never goes backwards
+    mems_data data;
+};
+
+/**
+ * Single-producer / multi-consumer ring of timestamped samples. The producer
+ * (the interface thread) never blocks or takes a lock; each slot carries a
+ * sequence-lock style version number so that readers can detect and discard
+ * a copy that was overwritten while they were taking it. Each consumer keeps
+ * its own read position in a SampleReader.
+ */
+class SampleRing
+{
+public:
+    explicit SampleRing(unsigned int capacityPow2 = 1024);
+    ~SampleRing();
+
+    void push(const mems_data& data);
+
+    quint64 published() const   { return m_published.loadAcquire(); }
+    unsigned int capacity() const { return m_capacity; }
+
+private:
+    friend class SampleReader;
+
+    struct Slot
+    {
+        QAtomicInteger<quint64> version;
+        MEMSSample sample;
+    };
+
+    bool readSlot(quint64 seq, MEMSSample& sample) const;
+
+    Slot *m_slots;
+    unsigned int m_capacity;
+    quint64 m_mask;
+    quint64 m_writeSeq;
+    QAtomicInteger<quint64> m_published;
+    QElapsedTimer m_clock;
+
+    Q_DISABLE_COPY(SampleRing)
+};
+
+/**
+ * Read cursor into a SampleRing. Each consumer owns one of these; readers
+ * never affect one another or the producer.
+ */
+class SampleReader
+{
+public:
+    explicit SampleReader(const SampleRing *ring);
+
+    bool next(MEMSSample& sample);
+    bool latest(MEMSSample& sample);
+    void skipToEnd();
+
+    quint64 dropped() const { return m_dropped; }
+
+private:
+    const SampleRing *m_ring;
+    quint64 m_cursor;
+    quint64 m_dropped;
+
+    void catchUp(quint64 head);
+};
+
+#endif // SAMPLERING_H
@@ -19,6 +19,7 @@ SerialDevEnumerator::SerialDevEnumerator()
 /**
  * Queries the OS / device filesystem for the list of serial devices likely
  * to be the one that is connected to the ECU.
+ * @param savedDevName Previously-selected device, which is listed first
  * @return List of device names
  */
 QStringList SerialDevEnumerator::getSerialDevList(QString savedDevName)
@@ -34,6 +35,20 @@ QStringList SerialDevEnumerator::getSerialDevList(QString savedDevName)
     serialDevices.append(savedDevName);
   }
 
+  serialDevices.append(scanDevices());
+  serialDevices.removeDuplicates();
+  return serialDevices;
+}
+
+/**
+ * Queries the OS / device filesystem for the serial devices that are
+ * currently present.
+ * @return List of device names
+ */
+QStringList SerialDevEnumerator::scanDevices()
+{
+  QStringList serialDevices;
+
 #ifdef linux
 
   // first check to see if this Linux distribution uses the /dev/serial/
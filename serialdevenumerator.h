@@ -8,6 +8,7 @@ class SerialDevEnumerator
 public:
     SerialDevEnumerator();
     QStringList getSerialDevList(QString savedDevName);
+    QStringList scanDevices();
 };
 
 #endif // SERIALDEVENUMERATOR_H
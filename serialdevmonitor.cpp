@@ -0,0 +1,130 @@
+#include <QDir>
+#include <QMutexLocker>
+#include "serialdevmonitor.h"
+#include "serialdevenumerator.h"
+
+/**
+ * Constructor. The watcher and timers are created once the object has been
+ * moved to its thread and that thread has started.
+ */
+SerialDevMonitor::SerialDevMonitor(QObject *parent):
+QObject(parent), m_watcher(0), m_settleTimer(0), m_pollTimer(0), m_haveScanned(false)
+{
+}
+
+/**
+ * Returns the devices found by the most recent scan. This may be called
+ * from any thread.
+ */
+QStringList SerialDevMonitor::devices()
+{
+  QMutexLocker locker(&m_devicesMutex);
+  return m_devices;
+}
+
+/**
+ * Sets up the directory watcher (or polling timer) in the monitor's own
+ * thread and performs the initial scan.
+ */
+void SerialDevMonitor::onParentThreadStarted()
+{
+  m_settleTimer = new QTimer(this);
+  m_settleTimer->setSingleShot(true);
+  connect(m_settleTimer, SIGNAL(timeout()), this, SLOT(rescan()));
+
+#ifdef linux
+  m_watcher = new QFileSystemWatcher(this);
+  connect(m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(onDirectoryChanged()));
+  updateWatchedPaths();
+#else
+  m_pollTimer = new QTimer(this);
+  connect(m_pollTimer, SIGNAL(timeout()), this, SLOT(rescan()));
+  m_pollTimer->start(s_pollMsecs);
+#endif
+
+  rescan();
+}
+
+/**
+ * Adds watches for the device directories. /dev/serial/by-id only exists
+ * while at least one USB serial adapter is present, so its parent is also
+ * watched in order to notice it being created.
+ */
+void SerialDevMonitor::updateWatchedPaths()
+{
+  QStringList paths;
+
+  paths << "/dev" << "/dev/serial" << "/dev/serial/by-id";
+  foreach (QString path, paths)
+  {
+    if (QDir(path).exists() && !m_watcher->directories().contains(path))
+    {
+      m_watcher->addPath(path);
+    }
+  }
+}
+
+/**
+ * Responds to a change in one of the watched directories. Changes tend to
+ * arrive in bursts, so the rescan is deferred until they've stopped.
+ */
+void SerialDevMonitor::onDirectoryChanged()
+{
+  m_settleTimer->start(s_settleMsecs);
+}
+
+/**
+ * Scans for serial devices and reports any that have appeared or
+ * disappeared since the last scan.
+ */
+void SerialDevMonitor::rescan()
+{
+  SerialDevEnumerator enumerator;
+  QStringList current = enumerator.scanDevices();
+  QStringList previous;
+
+  if (m_watcher)
+  {
+    updateWatchedPaths();
+  }
+
+  current.removeDuplicates();
+  current.sort();
+
+  {
+    QMutexLocker locker(&m_devicesMutex);
+    previous = m_devices;
+    m_devices = current;
+  }
+
+  // devices that were already present at startup aren't reported as added
+  if (!m_haveScanned)
+  {
+    m_haveScanned = true;
+    emit devicesChanged(current);
+    return;
+  }
+
+  if (current == previous)
+  {
+    return;
+  }
+
+  foreach (QString dev, previous)
+  {
+    if (!current.contains(dev))
+    {
+      emit deviceRemoved(dev);
+    }
+  }
+
+  foreach (QString dev, current)
+  {
+    if (!previous.contains(dev))
+    {
+      emit deviceAdded(dev);
+    }
+  }
+
+  emit devicesChanged(current);
+}
@@ -0,0 +1,55 @@
+#ifndef SERIALDEVMONITOR_H
+#define SERIALDEVMONITOR_H
+
+#include <QObject>
+#include <QStringList>
+#include <QMutex>
+#include <QTimer>
+#include <QFileSystemWatcher>
+
+/**
+ * Keeps a live list of the serial devices present on the system, and
+ * reports devices as they're plugged in or removed. It's intended to run on
+ * its own thread so that directory scans never block the GUI.
+ *
+ * On Linux, the device directories are watched for changes (via inotify);
+ * on other platforms, they're rescanned periodically.
+ */
+class SerialDevMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SerialDevMonitor(QObject *parent = 0);
+
+    QStringList devices();
+
+public slots:
+    void onParentThreadStarted();
+    void rescan();
+
+signals:
+    void deviceAdded(QString dev);
+    void deviceRemoved(QString dev);
+    void devicesChanged(QStringList devices);
+
+private slots:
+    void onDirectoryChanged();
+
+private:
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_settleTimer;
+    QTimer *m_pollTimer;
+
+    QMutex m_devicesMutex;
+    QStringList m_devices;
+    bool m_haveScanned;
+
+    // udev creates the /dev/serial/by-id links a moment after the device
+    // node itself, so wait for things to settle before rescanning
+    static const int s_settleMsecs = 250;
+    static const int s_pollMsecs = 2000;
+
+    void updateWatchedPaths();
+};
+
+#endif // SERIALDEVMONITOR_H
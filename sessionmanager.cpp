@@ -0,0 +1,638 @@
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <string.h>
+#include "sessionmanager.h"
+
+/**
+ * Constructor.
+ */
+SessionManager::SessionManager(QObject *parent):
+QObject(parent), m_tempUnits(Fahrenheit), m_pollRateHz(0.0), m_autoReconnect(true), m_batchDelivery(false),
+m_rawCapture(false), m_logFlushMsecs(1000), m_logFlushBytes(64 * 1024), m_logFormat(Logger::TextFormat),
+m_logRotateBytes(0), m_logRotateSecs(0), m_logCompress(false),
+m_logJournaled(false), m_logDurability(LogWriter::NoSync), m_logSyncMsecs(1000),
+m_logTriggered(false), m_logChangeOnly(false)
+{
+  m_logTrigger = EventTrigger().settings();
+}
+
+/**
+ * Destructor. Stops all of the worker threads.
+ */
+SessionManager::~SessionManager()
+{
+  shutdown(2000);
+  while (!m_workers.isEmpty())
+  {
+    removeLastWorker();
+  }
+}
+
+/**
+ * Sets the list of serial devices to read from. Existing workers are kept
+ * (and disconnected if their device has changed), new ones are created as
+ * needed, and surplus ones are shut down.
+ * @param devices Device names; the first one is the primary device
+ */
+void SessionManager::setDevices(QStringList devices)
+{
+  for (int i = 0; i < devices.count(); i++)
+  {
+    if (i < m_workers.count())
+    {
+      MEMSInterface *mems = m_workers.at(i).mems;
+      if (mems->getSerialDevice() != devices.at(i))
+      {
+        if (mems->isConnected())
+        {
+          mems->disconnectFromECU();
+        }
+        mems->setSerialDevice(devices.at(i));
+      }
+    }
+    else
+    {
+      addWorker(QString("ECU%1").arg(i + 1), devices.at(i));
+    }
+  }
+
+  while (m_workers.count() > qMax(1, devices.count()))
+  {
+    removeLastWorker();
+  }
+}
+
+/**
+ * Creates a worker (interface, thread, and logger) for a device. The thread
+ * isn't started until a connection is requested.
+ */
+void SessionManager::addWorker(QString id, QString device)
+{
+  Worker w;
+
+  w.id = id;
+  w.mems = new MEMSInterface(device);
+  w.mems->setDeviceId(id);
+  w.thread = new QThread(this);
+  w.logger = new Logger(w.mems);
+  w.logger->setTemperatureUnits(m_tempUnits);
+  w.logger->setFlushPolicy(m_logFlushMsecs, m_logFlushBytes);
+  w.logger->setFormat(m_logFormat);
+  w.logger->setRotation(m_logRotateBytes, m_logRotateSecs, m_logCompress);
+  w.logger->setDurability(m_logJournaled, m_logDurability, m_logSyncMsecs);
+  w.logger->setTriggeredLogging(m_logTriggered, m_logTrigger);
+  w.logger->setChangeOnly(m_logChangeOnly, m_logDeadband);
+  if (!m_logDir.isEmpty())
+  {
+    w.logger->setLogDirectory(m_logDir);
+  }
+
+  w.mems->onPollRateChangeRequest(m_pollRateHz);
+  w.mems->onAutoReconnectChangeRequest(m_autoReconnect);
+  w.mems->onBatchDeliveryChangeRequest(m_batchDelivery);
+  w.mems->onCaptureDirectoryChangeRequest(captureDirectory());
+  w.mems->moveToThread(w.thread);
+
+  connect(w.thread, SIGNAL(started()), w.mems, SLOT(onParentThreadStarted()));
+  connect(w.mems, SIGNAL(interfaceThreadReady()), this, SLOT(onInterfaceThreadReady()));
+  connect(w.mems, SIGNAL(dataReady()), this, SLOT(onWorkerDataReady()));
+  connect(w.mems, SIGNAL(samplesReady(quint64,int,int,bool)),
+          this, SLOT(onWorkerSamplesReady(quint64,int,int,bool)));
+  connect(w.mems, SIGNAL(failedToConnect(QString)), this, SIGNAL(failedToConnect(QString)));
+  connect(w.mems, SIGNAL(gotEcuId(QByteArray)), this, SLOT(onWorkerEcuId(QByteArray)));
+  connect(w.mems, SIGNAL(linkLost()), this, SLOT(onWorkerLinkLost()));
+  connect(w.mems, SIGNAL(linkRecovered(qint64,int)), this, SLOT(onWorkerLinkRecovered(qint64,int)));
+
+  m_workers.append(w);
+}
+
+/**
+ * Shuts down the most recently added worker. A read blocked on the device
+ * is cancelled so that the worker sees the shutdown request; the thread and
+ * interface are deleted once the thread has finished, rather than waiting
+ * for it here.
+ */
+void SessionManager::removeLastWorker()
+{
+  Worker w = m_workers.takeLast();
+
+  m_ecuIds.remove(w.id);
+  w.logger->closeLog();
+  delete w.logger;
+  disconnect(w.mems, 0, this, 0);
+
+  if (w.thread->isRunning())
+  {
+    // the thread may outlive this object (when called from the destructor)
+    w.thread->setParent(0);
+    connect(w.thread, SIGNAL(finished()), w.mems, SLOT(deleteLater()));
+    connect(w.thread, SIGNAL(finished()), w.thread, SLOT(deleteLater()));
+    w.mems->cancelRead();
+    QMetaObject::invokeMethod(w.mems, "onShutdownThreadRequest", Qt::QueuedConnection);
+  }
+  else
+  {
+    delete w.mems;
+    delete w.thread;
+  }
+}
+
+/**
+ * Returns the IDs of all the workers, primary device first.
+ */
+QStringList SessionManager::deviceIds() const
+{
+  QStringList ids;
+
+  foreach (const Worker& w, m_workers)
+  {
+    ids.append(w.id);
+  }
+  return ids;
+}
+
+/**
+ * Returns the interface for the worker with the given ID, or 0 if there's
+ * no such worker.
+ */
+MEMSInterface* SessionManager::getInterface(QString id) const
+{
+  foreach (const Worker& w, m_workers)
+  {
+    if (w.id == id)
+    {
+      return w.mems;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Finds the worker that owns a given interface.
+ * @return Index into the worker list, or -1 if not found
+ */
+int SessionManager::indexOf(QObject *mems) const
+{
+  for (int i = 0; i < m_workers.count(); i++)
+  {
+    if (m_workers.at(i).mems == mems)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Asks every worker that isn't already connected to connect and start
+ * polling. Threads that haven't been started yet are started first; they'll
+ * signal when they're ready.
+ */
+void SessionManager::connectAll()
+{
+  foreach (const Worker& w, m_workers)
+  {
+    startWorker(w);
+  }
+}
+
+/**
+ * Asks a single worker to connect and start polling, if it isn't already.
+ */
+void SessionManager::connectDevice(QString id)
+{
+  foreach (const Worker& w, m_workers)
+  {
+    if (w.id == id)
+    {
+      startWorker(w);
+    }
+  }
+}
+
+/**
+ * Starts a worker's thread, or asks its interface to connect if the thread
+ * is already running.
+ */
+void SessionManager::startWorker(const Worker& w)
+{
+  if (!w.thread->isRunning())
+  {
+    w.thread->start();
+  }
+  else if (!w.mems->isConnected())
+  {
+    QMetaObject::invokeMethod(w.mems, "onStartPollingRequest", Qt::QueuedConnection);
+  }
+}
+
+/**
+ * Finds the worker that reads from a given serial device. Symlinks (such
+ * as those under /dev/serial/by-id) are resolved before comparing.
+ * @return ID of the worker, or an empty string if none uses the device
+ */
+QString SessionManager::findDevice(QString deviceName) const
+{
+  const QString canonical = QFileInfo(deviceName).canonicalFilePath();
+
+  foreach (const Worker& w, m_workers)
+  {
+    const QString dev = w.mems->getSerialDevice();
+
+    if ((dev == deviceName) ||
+        (!canonical.isEmpty() && (QFileInfo(dev).canonicalFilePath() == canonical)))
+    {
+      return w.id;
+    }
+  }
+  return QString();
+}
+
+/**
+ * Asks every worker to stop polling and close its device.
+ */
+void SessionManager::disconnectAll()
+{
+  foreach (const Worker& w, m_workers)
+  {
+    w.mems->disconnectFromECU();
+  }
+}
+
+/**
+ * Stops all the worker threads. Shutdown requests are sent to all workers
+ * before waiting on any of them, and all of them share one timeout, so a
+ * hung device can't hold up the others.
+ * @param timeoutMsecs Maximum total time to wait
+ * @return True if all threads stopped; false if any are still running
+ */
+bool SessionManager::shutdown(int timeoutMsecs)
+{
+  QElapsedTimer timer;
+  bool allStopped = true;
+
+  closeLogs();
+
+  foreach (const Worker& w, m_workers)
+  {
+    if (w.thread->isRunning())
+    {
+      w.mems->cancelRead();
+      QMetaObject::invokeMethod(w.mems, "onShutdownThreadRequest", Qt::QueuedConnection);
+    }
+  }
+
+  timer.start();
+  foreach (const Worker& w, m_workers)
+  {
+    const qint64 remaining = qMax((qint64)0, timeoutMsecs - timer.elapsed());
+    if (!w.thread->wait((unsigned long)remaining))
+    {
+      allStopped = false;
+    }
+  }
+
+  return allStopped;
+}
+
+/**
+ * Sets the polling rate for every worker.
+ */
+void SessionManager::setPollRate(double hz)
+{
+  m_pollRateHz = hz;
+  foreach (const Worker& w, m_workers)
+  {
+    QMetaObject::invokeMethod(w.mems, "onPollRateChangeRequest", Qt::QueuedConnection, Q_ARG(double, hz));
+  }
+}
+
+/**
+ * Sets the temperature units used by every worker's log.
+ */
+void SessionManager::setTemperatureUnits(TemperatureUnits units)
+{
+  m_tempUnits = units;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setTemperatureUnits(units);
+  }
+}
+
+/**
+ * Enables or disables automatic reconnection for every worker.
+ */
+void SessionManager::setAutoReconnect(bool enabled)
+{
+  m_autoReconnect = enabled;
+  foreach (const Worker& w, m_workers)
+  {
+    QMetaObject::invokeMethod(w.mems, "onAutoReconnectChangeRequest", Qt::QueuedConnection, Q_ARG(bool, enabled));
+  }
+}
+
+/**
+ * Switches every worker between per-sample and batched delivery.
+ */
+void SessionManager::setBatchDelivery(bool enabled)
+{
+  m_batchDelivery = enabled;
+  foreach (const Worker& w, m_workers)
+  {
+    QMetaObject::invokeMethod(w.mems, "onBatchDeliveryChangeRequest", Qt::QueuedConnection, Q_ARG(bool, enabled));
+  }
+}
+
+/**
+ * Enables or disables recording of the raw serial traffic of every worker.
+ * Captures are written to the log directory, and take effect at the next
+ * connection.
+ */
+void SessionManager::setRawCapture(bool enabled)
+{
+  m_rawCapture = enabled;
+  applyCaptureDirectory();
+}
+
+/**
+ * Returns the directory that raw captures are written to, or an empty
+ * string when capture is disabled.
+ */
+QString SessionManager::captureDirectory() const
+{
+  if (!m_rawCapture)
+  {
+    return QString();
+  }
+  return m_logDir.isEmpty() ? QString("logs") : m_logDir;
+}
+
+void SessionManager::applyCaptureDirectory()
+{
+  const QString dir = captureDirectory();
+
+  foreach (const Worker& w, m_workers)
+  {
+    QMetaObject::invokeMethod(w.mems, "onCaptureDirectoryChangeRequest", Qt::QueuedConnection, Q_ARG(QString, dir));
+  }
+}
+
+/**
+ * Sets the directory in which every worker's log is written. (The default
+ * is "logs", relative to the current directory.)
+ */
+void SessionManager::setLogDirectory(QString dir)
+{
+  m_logDir = dir;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setLogDirectory(dir);
+  }
+  applyCaptureDirectory();
+}
+
+/**
+ * Sets how often every worker's log is written to disk.
+ * @param intervalMsecs Longest time data may wait before being written
+ * @param sizeBytes Amount of queued data that triggers an immediate write
+ */
+void SessionManager::setLogFlushPolicy(int intervalMsecs, int sizeBytes)
+{
+  m_logFlushMsecs = intervalMsecs;
+  m_logFlushBytes = sizeBytes;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setFlushPolicy(intervalMsecs, sizeBytes);
+  }
+}
+
+/**
+ * Selects text (CSV) or binary logs for every worker. Takes effect the next
+ * time the logs are opened.
+ */
+void SessionManager::setLogFormat(Logger::Format format)
+{
+  m_logFormat = format;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setFormat(format);
+  }
+}
+
+/**
+ * Sets when every worker's log moves on to a new segment, and whether
+ * finished segments are compressed. Takes effect the next time the logs
+ * are opened.
+ * @param maxBytes Segment size limit (0 for none)
+ * @param maxSecs Segment age limit (0 for none)
+ * @param compress True to gzip finished segments
+ */
+void SessionManager::setLogRotation(qint64 maxBytes, int maxSecs, bool compress)
+{
+  m_logRotateBytes = maxBytes;
+  m_logRotateSecs = maxSecs;
+  m_logCompress = compress;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setRotation(maxBytes, maxSecs, compress);
+  }
+}
+
+/**
+ * Sets how well every worker's log survives a crash or power cut. Takes
+ * effect the next time the logs are opened.
+ * @param journaled True to write journaled logs
+ * @param durability When to sync the log files to disk
+ * @param syncIntervalMsecs Longest time between syncs, for periodic syncing
+ */
+void SessionManager::setLogDurability(bool journaled, LogWriter::Durability durability, int syncIntervalMsecs)
+{
+  m_logJournaled = journaled;
+  m_logDurability = durability;
+  m_logSyncMsecs = syncIntervalMsecs;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setDurability(journaled, durability, syncIntervalMsecs);
+  }
+}
+
+/**
+ * Switches every worker between logging every sample and logging only the
+ * periods around events.
+ * @param enabled True to log only around events
+ * @param settings Trigger conditions and window lengths
+ */
+void SessionManager::setTriggeredLogging(bool enabled, const EventTrigger::Settings& settings)
+{
+  m_logTriggered = enabled;
+  m_logTrigger = settings;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setTriggeredLogging(enabled, settings);
+  }
+}
+
+/**
+ * Switches every worker between logging every sample in full and logging
+ * only the channels that change by more than their tolerance.
+ */
+void SessionManager::setChangeOnlyLogging(bool enabled, const LogDeadband& deadband)
+{
+  m_logChangeOnly = enabled;
+  m_logDeadband = deadband;
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->setChangeOnly(enabled, deadband);
+  }
+}
+
+/**
+ * Returns the number of times triggered logging has fired for the worker
+ * with the given ID.
+ */
+quint64 SessionManager::getTriggerCount(QString id) const
+{
+  foreach (const Worker& w, m_workers)
+  {
+    if (w.id == id)
+    {
+      return w.logger->getTriggerCount();
+    }
+  }
+  return 0;
+}
+
+/**
+ * Returns the statistics for the log writer of the worker with the given
+ * ID (all zero if there's no such worker).
+ */
+LogWriter::Stats SessionManager::getLogStats(QString id) const
+{
+  foreach (const Worker& w, m_workers)
+  {
+    if (w.id == id)
+    {
+      return w.logger->getWriterStats();
+    }
+  }
+
+  LogWriter::Stats empty;
+  memset(&empty, 0, sizeof(LogWriter::Stats));
+  return empty;
+}
+
+/**
+ * Opens a log file for every worker. The primary device's log uses the
+ * given name as-is; the others have their ID appended.
+ * @return True if all logs were opened; false otherwise
+ */
+bool SessionManager::openLogs(QString baseName)
+{
+  for (int i = 0; i < m_workers.count(); i++)
+  {
+    const QString name = (i == 0) ? baseName : (baseName + "_" + m_workers.at(i).id);
+
+    if (!m_workers.at(i).logger->openLog(name))
+    {
+      m_lastLogPath = m_workers.at(i).logger->getLogPath();
+      closeLogs();
+      return false;
+    }
+    m_lastLogPath = m_workers.at(i).logger->getLogPath();
+  }
+
+  return true;
+}
+
+/**
+ * Closes all the log files.
+ */
+void SessionManager::closeLogs()
+{
+  foreach (const Worker& w, m_workers)
+  {
+    w.logger->closeLog();
+  }
+}
+
+/**
+ * Responds to a worker thread starting up by asking it to start polling.
+ */
+void SessionManager::onInterfaceThreadReady()
+{
+  QMetaObject::invokeMethod(sender(), "onStartPollingRequest", Qt::QueuedConnection);
+}
+
+/**
+ * Writes new samples from a worker to its log, and re-emits the signal
+ * tagged with the worker's ID.
+ */
+void SessionManager::onWorkerDataReady()
+{
+  const int index = indexOf(sender());
+
+  if (index >= 0)
+  {
+    m_workers.at(index).logger->logData();
+    emit dataReady(m_workers.at(index).id);
+  }
+}
+
+/**
+ * Writes a batch of samples from a worker to its log. The logger reads the
+ * samples straight from the worker's ring, so only the count matters here.
+ */
+void SessionManager::onWorkerSamplesReady(quint64 firstSeq, int count, int readErrors, bool lastReadOk)
+{
+  Q_UNUSED(firstSeq);
+  Q_UNUSED(readErrors);
+  Q_UNUSED(lastReadOk);
+
+  const int index = indexOf(sender());
+
+  if ((index >= 0) && (count > 0))
+  {
+    m_workers.at(index).logger->logData();
+    emit dataReady(m_workers.at(index).id);
+  }
+}
+
+/**
+ * Caches the ID reported by a worker's ECU during init.
+ */
+void SessionManager::onWorkerEcuId(QByteArray id)
+{
+  const int index = indexOf(sender());
+
+  if (index >= 0)
+  {
+    m_ecuIds.insert(m_workers.at(index).id, QString(id.toHex(' ').toUpper()));
+  }
+}
+
+/**
+ * Marks the start of a link outage in the worker's log. Logging carries on
+ * in the same file once the link comes back.
+ */
+void SessionManager::onWorkerLinkLost()
+{
+  const int index = indexOf(sender());
+
+  if (index >= 0)
+  {
+    m_workers.at(index).logger->markGap("link lost");
+  }
+}
+
+/**
+ * Marks the end of a link outage in the worker's log.
+ */
+void SessionManager::onWorkerLinkRecovered(qint64 outageMsecs, int attempts)
+{
+  const int index = indexOf(sender());
+
+  if (index >= 0)
+  {
+    m_workers.at(index).logger->markGap(QString("link recovered after %1 ms (%2 attempts)").arg(outageMsecs).arg(attempts));
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QThread>
+#include "memsinterface.h"
+#include "logger.h"
+#include "commonunits.h"
+
+/**
+ * Owns one MEMSInterface (and worker thread) per serial device, so that
+ * several ECUs can be read at once. Each worker is tagged with an ID
+ * ("ECU1", "ECU2", ...). Workers share nothing but this object, which runs on
+ * the GUI thread, so a device that stops responding only stalls its own
+ * thread.
+ */
+class SessionManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionManager(QObject *parent = 0);
+    ~SessionManager();
+
+    void setDevices(QStringList devices);
+    QStringList deviceIds() const;
+    MEMSInterface* getInterface(QString id) const;
+    QString getEcuId(QString id) const { return m_ecuIds.value(id); }
+
+    void connectAll();
+    void connectDevice(QString id);
+    QString findDevice(QString deviceName) const;
+    void disconnectAll();
+    bool shutdown(int timeoutMsecs);
+
+    void setPollRate(double hz);
+    void setTemperatureUnits(TemperatureUnits units);
+    void setAutoReconnect(bool enabled);
+    void setBatchDelivery(bool enabled);
+    void setRawCapture(bool enabled);
+
+    void setLogDirectory(QString dir);
+    void setLogFlushPolicy(int intervalMsecs, int sizeBytes);
+    void setLogFormat(Logger::Format format);
+    void setLogRotation(qint64 maxBytes, int maxSecs, bool compress);
+    void setLogDurability(bool journaled, LogWriter::Durability durability, int syncIntervalMsecs);
+    void setTriggeredLogging(bool enabled, const EventTrigger::Settings& settings);
+    void setChangeOnlyLogging(bool enabled, const LogDeadband& deadband);
+    LogWriter::Stats getLogStats(QString id) const;
+    quint64 getTriggerCount(QString id) const;
+    bool openLogs(QString baseName);
+    void closeLogs();
+    QString getLastLogPath() const { return m_lastLogPath; }
+
+signals:
+    void dataReady(QString id);
+    void failedToConnect(QString dev);
+
+private slots:
+    void onInterfaceThreadReady();
+    void onWorkerDataReady();
+    void onWorkerSamplesReady(quint64 firstSeq, int count, int readErrors, bool lastReadOk);
+    void onWorkerEcuId(QByteArray id);
+    void onWorkerLinkLost();
+    void onWorkerLinkRecovered(qint64 outageMsecs, int attempts);
+
+private:
+    struct Worker
+    {
+        QString id;
+        QThread *thread;
+        MEMSInterface *mems;
+        Logger *logger;
+    };
+
+    QList<Worker> m_workers;
+    QHash<QString,QString> m_ecuIds;
+    TemperatureUnits m_tempUnits;
+    double m_pollRateHz;
+    bool m_autoReconnect;
+    bool m_batchDelivery;
+    bool m_rawCapture;
+    QString m_lastLogPath;
+    QString m_logDir;
+    int m_logFlushMsecs;
+    int m_logFlushBytes;
+    Logger::Format m_logFormat;
+    qint64 m_logRotateBytes;
+    int m_logRotateSecs;
+    bool m_logCompress;
+    bool m_logJournaled;
+    LogWriter::Durability m_logDurability;
+    int m_logSyncMsecs;
+    bool m_logTriggered;
+    EventTrigger::Settings m_logTrigger;
+    bool m_logChangeOnly;
+    LogDeadband m_logDeadband;
+
+    void addWorker(QString id, QString device);
+    void startWorker(const Worker& w);
+    void removeLastWorker();
+    QString captureDirectory() const;
+    void applyCaptureDirectory();
+    int indexOf(QObject *mems) const;
+};
+
+#endif // SESSIONMANAGER_H
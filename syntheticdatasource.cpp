@@ -0,0 +1,78 @@
+#include <math.h>
+#include <string.h>
+#include "syntheticdatasource.h"
+
+/**
+ * Constructor.
+ * @param seed Seed for the noise generator, so runs can be repeated exactly
+ */
+SyntheticDataSource::SyntheticDataSource(unsigned int seed):
+m_connected(false), m_random(seed ? seed : 1), m_count(0), m_iacPosition(40), m_faults(0)
+{
+}
+
+/**
+ * Returns a small pseudo-random number (xorshift32).
+ */
+quint32 SyntheticDataSource::nextRandom()
+{
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 17;
+  m_random ^= m_random << 5;
+  return m_random;
+}
+
+bool SyntheticDataSource::connect(uint8_t *ecuId)
+{
+  // an ID that can't be mistaken for a real ECU
+  memset(ecuId, 0xEE, 4);
+  m_connected = true;
+  m_count = 0;
+  return true;
+}
+
+/**
+ * Generates the next frame. Values follow slow sweeps (one "drive cycle"
+ * every 1000 frames) with a little noise, so that every field changes
+ * regularly.
+ */
+bool SyntheticDataSource::read(mems_data *data)
+{
+  if (!m_connected)
+  {
+    return false;
+  }
+
+  const double phase = (m_count % 1000) / 1000.0;
+  const double load = 0.5 - (0.5 * cos(2.0 * M_PI * phase));
+  const int noise = (int)(nextRandom() % 21) - 10;
+
+  memset(data, 0, sizeof(mems_data));
+  data->engine_rpm = (uint16_t)(800 + (load * 4200) + noise);
+  data->coolant_temp_c = (uint8_t)qMin(90ULL, 20 + (m_count / 100));
+  data->intake_air_temp_c = 30 + (noise / 5);
+  data->throttle_pot_voltage = (float)(0.5 + (load * 4.0));
+  data->map_kpa = (float)(30 + (load * 70));
+  data->iac_position = m_iacPosition;
+  data->battery_voltage = (float)(13.8 + (noise / 100.0));
+  data->idle_switch = (load < 0.05);
+  data->park_neutral_switch = (load < 0.05);
+  data->closed_loop = (data->coolant_temp_c > 70);
+  data->lambda_voltage_mv = (nextRandom() & 1) ? 750 : 150;
+  data->fault_codes = m_faults;
+
+  m_count++;
+  return true;
+}
+
+bool SyntheticDataSource::clearFaults()
+{
+  m_faults = 0;
+  return m_connected;
+}
+
+bool SyntheticDataSource::moveIAC(uint8_t desiredPos)
+{
+  m_iacPosition = desiredPos;
+  return m_connected;
+}
@@ -0,0 +1,35 @@
+#ifndef SYNTHETICDATASOURCE_H
+#define SYNTHETICDATASOURCE_H
+
+#include "ecudatasource.h"
+
+/**
+ * Generates plausible-looking engine data without any I/O. A read costs
+ * next to nothing, so this source can be polled far faster than a real ECU
+ * in order to load-test everything downstream of MEMSInterface.
+ */
+class SyntheticDataSource : public ECUDataSource
+{
+public:
+    explicit SyntheticDataSource(unsigned int seed = 0);
+
+    bool connect(uint8_t *ecuId);
+    void disconnect()                { m_connected = false; }
+    bool isConnected()               { return m_connected; }
+    bool read(mems_data *data);
+
+    bool testActuator(actuator_cmd)  { return m_connected; }
+    bool clearFaults();
+    bool moveIAC(uint8_t desiredPos);
+
+private:
+    bool m_connected;
+    quint32 m_random;
+    quint64 m_count;
+    uint8_t m_iacPosition;
+    uint8_t m_faults;
+
+    quint32 nextRandom();
+};
+
+#endif // SYNTHETICDATASOURCE_H
@@ -0,0 +1,50 @@
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "terminationsignals.h"
+
+namespace
+{
+  // the signal handler writes to one end; the event loop watches the other
+  int s_signalFds[2] = { -1, -1 };
+
+  /**
+   * Only async-signal-safe calls may be made here, so the handler just
+   * wakes the event loop, which then quits normally.
+   */
+  void onTerminationSignal(int)
+  {
+    const int savedErrno = errno;
+    const char byte = 1;
+
+    // if this fails, a byte is already waiting to be read
+    const ssize_t written = write(s_signalFds[0], &byte, 1);
+    (void)written;
+    errno = savedErrno;
+  }
+}
+
+bool installTerminationHandlers(QCoreApplication& app)
+{
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, s_signalFds) != 0)
+  {
+    return false;
+  }
+  fcntl(s_signalFds[0], F_SETFL, fcntl(s_signalFds[0], F_GETFL) | O_NONBLOCK);
+
+  QSocketNotifier *notifier = new QSocketNotifier(s_signalFds[1], QSocketNotifier::Read, &app);
+  QObject::connect(notifier, SIGNAL(activated(int)), &app, SLOT(quit()));
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = onTerminationSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+
+  return (sigaction(SIGINT, &action, 0) == 0) && (sigaction(SIGTERM, &action, 0) == 0);
+}
@@ -0,0 +1,16 @@
+#ifndef TERMINATIONSIGNALS_H
+#define TERMINATIONSIGNALS_H
+
+class QCoreApplication;
+
+/**
+ * Makes SIGINT and SIGTERM quit a command-line tool cleanly (Unix only).
+ * The handlers are installed with sigaction() and do nothing but write a
+ * byte to a socket pair, since quit() isn't async-signal-safe; a
+ * QSocketNotifier on the other end of the pair calls quit() from the
+ * event loop.
+ * @return True if the handlers were installed; false otherwise
+ */
+bool installTerminationHandlers(QCoreApplication& app);
+
+#endif // TERMINATIONSIGNALS_H